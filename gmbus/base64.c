@@ -57,7 +57,7 @@ static guchar b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz01234
 static gsize
 __alloc_array_encode( const GByteArray * input )
 {
-  return ( ( input->len / 4 ) + 1 ) * 4;
+  return base64encode_len( input->len );
 }
 
 static gsize
@@ -72,38 +72,49 @@ __alloc_array_decode( const GByteArray * input )
 }
 
 /**
-\brief Encodes a number of bytes using Base64
-\param input The byte array containing the data to encode
-\param[out] output A byte array that will contain the Base64 encoded data
-\return the number of bytes of the \a output array
+\brief Returns the length of the Base64 encoding of \a len bytes
+\param len the number of bytes to encode
+\return the number of characters base64encode_raw will write
 */
-gint
-base64encode( const GByteArray * input, GByteArray * output )
+gsize
+base64encode_len( gsize len )
 {
-  gint	i = 0, j = 0;
+  return ( ( len + 2 ) / 3 ) * 4;
+}
+
+/**
+\brief Encodes a number of bytes using Base64 into a preallocated buffer
+\param input the data to encode
+\param len the number of bytes to encode
+\param[out] output buffer of at least base64encode_len( len ) characters
+\return the number of characters written to \a output
+*/
+gsize
+base64encode_raw( const guint8 * input, gsize len, guchar * output )
+{
+  gsize	i = 0, j = 0;
   gint	pad;
 
-  g_byte_array_set_size( output, __alloc_array_encode( input ) );
-  while ( i < input->len ) {
-    pad = 3 - ( input->len - i );
+  while ( i < len ) {
+    pad = len - i < 3 ? 3 - ( gint ) ( len - i ) : 0;
     if ( pad == 2 ) {
-      output->data[ j ] = b64[ input->data[ i ] >> 2 ];
-      output->data[ j + 1 ] = b64[ ( input->data[ i ] & 0x03 ) << 4 ];
-      output->data[ j + 2 ] = '=';
-      output->data[ j + 3 ] = '=';
+      output[ j ] = b64[ input[ i ] >> 2 ];
+      output[ j + 1 ] = b64[ ( input[ i ] & 0x03 ) << 4 ];
+      output[ j + 2 ] = '=';
+      output[ j + 3 ] = '=';
     } else if ( pad == 1 ) {
-      output->data[ j ] = b64[ input->data[ i ] >> 2 ];
-      output->data[ j + 1 ] = b64[ ( ( input->data[ i ] & 0x03 ) << 4 ) |
-				   ( ( input->data[ i + 1 ] & 0xf0 ) >> 4 ) ];
-      output->data[ j + 2 ] = b64[ ( input->data[ i + 1 ] & 0x0f ) << 2 ];
-      output->data[ j + 3 ] = '=';
+      output[ j ] = b64[ input[ i ] >> 2 ];
+      output[ j + 1 ] = b64[ ( ( input[ i ] & 0x03 ) << 4 ) |
+			     ( ( input[ i + 1 ] & 0xf0 ) >> 4 ) ];
+      output[ j + 2 ] = b64[ ( input[ i + 1 ] & 0x0f ) << 2 ];
+      output[ j + 3 ] = '=';
     } else {
-      output->data[ j ] = b64[ input->data[ i ] >> 2 ];
-      output->data[ j + 1 ] = b64[ ( ( input->data[ i ] & 0x03 ) << 4 ) |
-				   ( ( input->data[ i + 1 ] & 0xf0 ) >> 4 ) ];
-      output->data[ j + 2 ] = b64[ ( ( input->data[ i + 1 ] & 0x0f ) << 2 ) |
-				   ( ( input->data[ i + 2 ] & 0xc0 ) >> 6 ) ];
-      output->data[ j + 3 ] = b64[ input->data[ i + 2 ] & 0x3f ];
+      output[ j ] = b64[ input[ i ] >> 2 ];
+      output[ j + 1 ] = b64[ ( ( input[ i ] & 0x03 ) << 4 ) |
+			     ( ( input[ i + 1 ] & 0xf0 ) >> 4 ) ];
+      output[ j + 2 ] = b64[ ( ( input[ i + 1 ] & 0x0f ) << 2 ) |
+			     ( ( input[ i + 2 ] & 0xc0 ) >> 6 ) ];
+      output[ j + 3 ] = b64[ input[ i + 2 ] & 0x3f ];
     }
     i += 3;
     j += 4;
@@ -112,6 +123,20 @@ base64encode( const GByteArray * input, GByteArray * output )
   return j;
 }
 
+/**
+\brief Encodes a number of bytes using Base64
+\param input The byte array containing the data to encode
+\param[out] output A byte array that will contain the Base64 encoded data
+\return the number of bytes of the \a output array
+*/
+gint
+base64encode( const GByteArray * input, GByteArray * output )
+{
+  g_byte_array_set_size( output, __alloc_array_encode( input ) );
+
+  return ( gint ) base64encode_raw( input->data, input->len, output->data );
+}
+
 /* This assumes that an unsigned char is exactly 8 bits. Not portable code! :-) */
 static guchar index_64[ 128 ] = {
   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
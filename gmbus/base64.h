@@ -43,6 +43,8 @@ extern "C" {
 #endif
 
 gint base64encode( const GByteArray * input, GByteArray * output );
+gsize base64encode_len( gsize len );
+gsize base64encode_raw( const guint8 * input, gsize len, guchar * output );
 gint base64decode( const GByteArray * input, GByteArray * output );
 
 #ifdef __cplusplus
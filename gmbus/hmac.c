@@ -41,20 +41,14 @@
 #include <string.h>
 
 /**
-\brief Calulates a HMAC/MD5 digest for a given byte array using a given \a key.
-\param data pointer to the data array for which a digest should be calculated
-\param data_len length of the data in bytes
+\brief Initializes a keyed HMAC/MD5 state. The state may be copied before
+    calling hmac_md5_update to calculate several digests with the same key.
+\param[out] ctx the state to initialize
 \param key pointer to the key
 \param key_len length of the key in bytes
-\param[out] digest a byte array that will contain the digest
 */
-void hmac_md5( const guchar * data,	/* pointer to data stream        */
-	       gint data_len,		/* length of data stream         */
-	       const guchar * key,	/* pointer to authentication key */
-	       gint key_len,		/* length of authentication key  */
-	       guchar digest[ 16 ] ) /* caller digest to be filled in */
+void hmac_md5_init( HMAC_MD5_CTX * ctx, const guchar * key, gint key_len )
 {
-  MD5_CTX	context;
   guchar	k_ipad[ 65 ];    /* inner padding - key XORd with ipad */
   guchar	k_opad[ 65 ];    /* outer padding - key XORd with opad */
   guchar	tk[ 16 ];
@@ -95,20 +89,57 @@ void hmac_md5( const guchar * data,	/* pointer to data stream        */
     k_opad[ i ] ^= 0x5c;
   }
 
-  /*
-   * perform inner MD5
-   */
-  MD5Init( &context );                   /* init context for 1st pass */
-  MD5Update( &context, k_ipad, 64 );     /* start with inner pad      */
-  MD5Update( &context, data, data_len ); /* then text of datagram     */
-  MD5Final( digest, &context );          /* finish up 1st pass        */
-  /*
-   * perform outer MD5
-   */
-  MD5Init( &context );                   /* init context for 2nd pass */
-  MD5Update( &context, k_opad, 64 );     /* start with outer pad      */
-  MD5Update( &context, digest, 16 );     /* then results of 1st hash  */
-  MD5Final( digest, &context );          /* finish up 2nd pass        */
+  /* both pads fill exactly one MD5 block, so the contexts hold nothing
+     but the intermediate hash values afterwards */
+  MD5Init( &ctx->inner );                /* init context for 1st pass */
+  MD5Update( &ctx->inner, k_ipad, 64 );  /* start with inner pad      */
+  MD5Init( &ctx->outer );                /* init context for 2nd pass */
+  MD5Update( &ctx->outer, k_opad, 64 );  /* start with outer pad      */
+}
+
+/**
+\brief Adds data to a HMAC/MD5 calculation.
+\param ctx the state initialized by hmac_md5_init
+\param data pointer to the data
+\param data_len length of the data in bytes
+*/
+void hmac_md5_update( HMAC_MD5_CTX * ctx, const guchar * data, gint data_len )
+{
+  MD5Update( &ctx->inner, data, data_len ); /* text of datagram */
+}
+
+/**
+\brief Finishes a HMAC/MD5 calculation. The state can not be used
+    afterwards.
+\param ctx the state
+\param[out] digest a byte array that will contain the digest
+*/
+void hmac_md5_final( HMAC_MD5_CTX * ctx, guchar digest[ 16 ] )
+{
+  MD5Final( digest, &ctx->inner );          /* finish up 1st pass   */
+  MD5Update( &ctx->outer, digest, 16 );     /* results of 1st hash  */
+  MD5Final( digest, &ctx->outer );          /* finish up 2nd pass   */
+}
+
+/**
+\brief Calulates a HMAC/MD5 digest for a given byte array using a given \a key.
+\param data pointer to the data array for which a digest should be calculated
+\param data_len length of the data in bytes
+\param key pointer to the key
+\param key_len length of the key in bytes
+\param[out] digest a byte array that will contain the digest
+*/
+void hmac_md5( const guchar * data,	/* pointer to data stream        */
+	       gint data_len,		/* length of data stream         */
+	       const guchar * key,	/* pointer to authentication key */
+	       gint key_len,		/* length of authentication key  */
+	       guchar digest[ 16 ] ) /* caller digest to be filled in */
+{
+  HMAC_MD5_CTX	ctx;
+
+  hmac_md5_init( &ctx, key, key_len );
+  hmac_md5_update( &ctx, data, data_len );
+  hmac_md5_final( &ctx, digest );
 }
 
 /*
@@ -40,10 +40,25 @@
 
 #include <glib.h>
 
+#include "gmbus/md5.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
-	
+
+/*
+ * Keyed HMAC/MD5 state. Once initialized with a key it may be copied to
+ * calculate several digests without processing the key again.
+ */
+typedef struct {
+  MD5_CTX	inner;	/* MD5 context after the inner padded key */
+  MD5_CTX	outer;	/* MD5 context after the outer padded key */
+} HMAC_MD5_CTX;
+
+void hmac_md5_init( HMAC_MD5_CTX * ctx, const guchar * key, gint key_len );
+void hmac_md5_update( HMAC_MD5_CTX * ctx, const guchar * data,
+		      gint data_len );
+void hmac_md5_final( HMAC_MD5_CTX * ctx, guchar digest[ 16 ] );
 void hmac_md5( const guchar * data, gint data_len,
 	       const guchar * key,  gint key_len,
 	       guchar digest[ 16 ] );
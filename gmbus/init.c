@@ -22,22 +22,16 @@
 
 #include "gmbus/init.h"
 
-static GMainLoop * __loop;
-
 /**
-\brief Initialize the main loop
+\brief Initialize the main loop of the current event engine
 \param loop If loop is not NULL the given main loop is used, otherwise this
-    function will create a new one.
+    function will create a new one. It is only used by the GLib engine.
+\sa mbus_event_set_engine
 */
 void
 mbus_init( GMainLoop * loop )
 {
-	if ( loop == NULL ) {
-		__loop = g_main_loop_new( NULL, FALSE );
-	} else {
-		g_main_loop_ref( loop );
-		__loop = loop;
-	}
+	mbus_event_engine()->init( loop );
 }
 
 /**
@@ -46,7 +40,7 @@ mbus_init( GMainLoop * loop )
 void
 mbus_loop( void )
 {
-	g_main_loop_run( __loop );
+	mbus_event_engine()->run();
 }
 
 /**
@@ -55,7 +49,7 @@ mbus_loop( void )
 gboolean
 mbus_loop_step( gboolean may_block )
 {
-	return g_main_context_iteration( NULL, may_block );
+	return mbus_event_engine()->iteration( may_block );
 }
 
 /**
@@ -64,8 +58,7 @@ mbus_loop_step( gboolean may_block )
 void
 mbus_quit( void )
 {
-	g_main_loop_quit( __loop );
-	g_main_loop_unref( __loop );
+	mbus_event_engine()->quit();
 }
 
 /* end of init.c */
@@ -25,6 +25,8 @@
 
 #include <glib.h>
 
+#include "gmbus/mevent.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -31,6 +31,7 @@
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <glib.h>
@@ -40,55 +41,90 @@
 \{
 */
 
-/**
-\brief Parses an Mbus address element.
-\param[out] self The Mbus address element for storing the parsed data
-\param buf The string buffer containing the Mbus address element
-\return TRUE if the address element could be parsed, otherwise FALSE
-*/
-gboolean
-mbus_address_element_read( MAddressElement * self, GString * buf )
+/* finds the key and the value of the address element at the current
+   position of the cursor without copying them */
+static gboolean
+__mbus_address_element_scan( MCursor * cursor, const gchar ** key,
+		gsize * key_len, const gchar ** value, gsize * value_len )
 {
-	static gchar	tmp[ M_ADDRESS_ELEMENT_SIZE ];
-
+	const gchar *	pos;
 	gint		el = 0;
-	gchar *	pos;
-
-	self->ok = FALSE;
-
-	tmp[ 0 ] = '\0';
-	self->key = self->value = NULL;
 
 	/* skip white space */
-	mbus_util_cut_whitespaces( buf );
-	pos = buf->str;
+	mbus_cursor_skip_whitespaces( cursor );
+	*key = pos = cursor->pos;
 
 	/* read key */
-	while ( g_ascii_isalnum( *pos ) && ( el < M_ADDRESS_ELEMENT_SIZE ) ) {
-		tmp[ el++ ] = *pos; pos++;
+	while ( pos < cursor->end && g_ascii_isalnum( *pos ) &&
+			( el < M_ADDRESS_ELEMENT_SIZE ) ) {
+		el++; pos++;
 	}
-	tmp[ el ] = '\0';
-	if ( *pos != ':' ) return FALSE;
-	self->key = g_strdup( tmp );
-	g_string_erase( buf, 0, el + 1 );
+	if ( pos >= cursor->end || *pos != ':' ) return FALSE;
+	*key_len = el;
+	cursor->pos = ++pos;
 
 	/* read value */
-	pos = buf->str;
 	el = 0;
-	while ( g_ascii_iscntrl( *pos ) == FALSE && ( *pos != ' ' ) &&
-			( *pos != ')' ) && ( el < M_ADDRESS_ELEMENT_SIZE ) ) {
-		tmp[ el++ ] = *pos;
-		pos++;
+	while ( pos < cursor->end && g_ascii_iscntrl( *pos ) == FALSE &&
+			( *pos != ' ' ) && ( *pos != ')' ) &&
+			( el < M_ADDRESS_ELEMENT_SIZE ) ) {
+		el++; pos++;
 	}
-	tmp[ el ] = '\0';
-	self->value = g_strdup( tmp );
-	g_string_erase( buf, 0, el );
+	*value = cursor->pos;
+	*value_len = el;
+	cursor->pos = pos;
+
+	return TRUE;
+}
 
+/**
+\brief Parses an Mbus address element at the current position of the cursor.
+\param[out] self The Mbus address element for storing the parsed data
+\param cursor The cursor pointing to the Mbus address element. If the
+    address element could be parsed it is moved behind it.
+\return TRUE if the address element could be parsed, otherwise FALSE
+*/
+gboolean
+mbus_address_element_parse( MAddressElement * self, MCursor * cursor )
+{
+	const gchar *	key;
+	const gchar *	value;
+	gsize		key_len, value_len;
+
+	self->ok = FALSE;
+	self->key = self->value = NULL;
+
+	if ( !__mbus_address_element_scan( cursor, &key, &key_len,
+				&value, &value_len ) )
+		return FALSE;
+
+	self->key = g_strndup( key, key_len );
+	self->value = g_strndup( value, value_len );
 	self->ok = TRUE;
 
 	return TRUE;
 }
 
+/**
+\brief Parses an Mbus address element.
+\param[out] self The Mbus address element for storing the parsed data
+\param buf The string buffer containing the Mbus address element. The
+    parsed characters are removed from it.
+\return TRUE if the address element could be parsed, otherwise FALSE
+*/
+gboolean
+mbus_address_element_read( MAddressElement * self, GString * buf )
+{
+	MCursor		cursor;
+	gboolean	ret;
+
+	mbus_cursor_init( &cursor, buf->str, buf->len );
+	ret = mbus_address_element_parse( self, &cursor );
+	g_string_erase( buf, 0, cursor.pos - buf->str );
+
+	return ret;
+}
+
 /**
 \brief Creates a string representation of an Mbus address element
 \param self the Mbus address element
@@ -97,8 +133,16 @@ mbus_address_element_read( MAddressElement * self, GString * buf )
 gboolean
 mbus_address_element_as_string( MAddressElement * self, GString * buf )
 {
-	if ( self->key && self->value )
-		g_string_append_printf( buf, "%s:%s", self->key, self->value );
+	if ( self->key && self->value ) {
+		gsize	key_len = strlen( self->key );
+		gsize	value_len = strlen( self->value );
+		MWriter	writer;
+
+		mbus_writer_init_append( &writer, buf, key_len + value_len + 1 );
+		mbus_writer_put( &writer, self->key, key_len );
+		mbus_writer_put_c( &writer, ':' );
+		mbus_writer_put( &writer, self->value, value_len );
+	}
 
 	return TRUE;
 }
@@ -134,8 +178,153 @@ An MAddress object consists of a list of MAddressElement objects.
 static void
 __mbus_address_init( MAddress * self )
 {
-	self->elements = g_ptr_array_sized_new( 3 );
+	self->elements = self->inline_elements;
+	self->n_elements = 0;
+	self->max_elements = M_ADDRESS_INLINE_ELEMENTS;
+	self->pool = self->inline_pool;
+	self->pool_len = 0;
+	self->pool_size = M_ADDRESS_INLINE_POOL;
+	self->heap = NULL;
 	self->ok = TRUE;
+	self->hash = 0;
+	self->text = NULL;
+	self->text_len = 0;
+	self->text_hash = 0;
+	self->wildcard = FALSE;
+	self->_ref_count = 1;
+	self->intern_key = NULL;
+}
+
+/* moves the pointers of the elements and the text from the pool at \a
+   from to the pool of the address */
+static void
+__mbus_address_rebase( MAddress * self, const gchar * from )
+{
+	guint i;
+
+	if ( from == self->pool ) return;
+
+	for ( i = 0; i < self->n_elements; i++ ) {
+		MAddressElement * elem = &self->elements[ i ];
+
+		elem->key = self->pool + ( elem->key - from );
+		elem->value = self->pool + ( elem->value - from );
+	}
+	if ( self->text ) self->text = self->pool + ( self->text - from );
+}
+
+/* makes room for \a n_elements elements and \a pool_len characters in the
+   pool. If the current block is too small both are moved to a new heap
+   block. */
+static void
+__mbus_address_reserve( MAddress * self, guint n_elements, gsize pool_len )
+{
+	gpointer	heap;
+	gchar *		from = self->pool;
+
+	if ( n_elements <= self->max_elements && pool_len <= self->pool_size )
+		return;
+
+	n_elements = MAX( n_elements, self->max_elements * 2 );
+	pool_len = MAX( pool_len, self->pool_size * 2 );
+
+	heap = g_malloc( n_elements * sizeof( MAddressElement ) + pool_len );
+	memcpy( heap, self->elements, self->n_elements * sizeof( MAddressElement ) );
+	self->elements = heap;
+	self->max_elements = n_elements;
+	self->pool = ( gchar * ) ( self->elements + n_elements );
+	memcpy( self->pool, from, self->pool_len );
+	self->pool_size = pool_len;
+	__mbus_address_rebase( self, from );
+
+	g_free( self->heap );
+	self->heap = heap;
+}
+
+/* copies a string into the pool. The space has to be reserved. */
+static gchar *
+__mbus_address_pool_add( MAddress * self, const gchar * str, gsize len )
+{
+	gchar * pos = self->pool + self->pool_len;
+
+	memcpy( pos, str, len );
+	pos[ len ] = '\0';
+	self->pool_len += len + 1;
+
+	return pos;
+}
+
+static void
+__mbus_address_append( MAddress * self, const gchar * key, gsize key_len,
+		const gchar * value, gsize value_len )
+{
+	MAddressElement * elem;
+
+	__mbus_address_reserve( self, self->n_elements + 1,
+			self->pool_len + key_len + value_len + 2 );
+
+	elem = &self->elements[ self->n_elements++ ];
+	elem->key = __mbus_address_pool_add( self, key, key_len );
+	elem->value = __mbus_address_pool_add( self, value, value_len );
+	elem->ok = TRUE;
+}
+
+/* removes all elements and returns to the inline storage */
+static void
+__mbus_address_clear( MAddress * self )
+{
+	g_free( self->heap );
+	self->heap = NULL;
+	self->elements = self->inline_elements;
+	self->n_elements = 0;
+	self->max_elements = M_ADDRESS_INLINE_ELEMENTS;
+	self->pool = self->inline_pool;
+	self->pool_len = 0;
+	self->pool_size = M_ADDRESS_INLINE_POOL;
+	self->text = NULL;
+}
+
+/* drops the cached hash value and text representation */
+static void
+__mbus_address_invalidate( MAddress * self )
+{
+	self->text = NULL;
+	self->text_len = 0;
+	self->text_hash = 0;
+	self->hash = 0;
+}
+
+/* computes the hash value and the text representation of the address once
+   after its elements have been changed */
+static void
+__mbus_address_update( MAddress * self )
+{
+	MAddressElement *	element;
+	MWriter			writer;
+	gchar *			text;
+	gsize			len;
+	guint			i;
+
+	__mbus_address_invalidate( self );
+
+	self->wildcard = FALSE;
+	for ( i = 0; i < self->n_elements; i++ )
+		if ( self->elements[ i ].value[ 0 ] == '*' ) self->wildcard = TRUE;
+
+	len = mbus_address_text_len( self );
+	__mbus_address_reserve( self, self->n_elements, self->pool_len + len + 1 );
+	text = self->pool + self->pool_len;
+	mbus_writer_init( &writer, text, len );
+	mbus_address_write( self, &writer );
+	text[ len ] = '\0';
+	self->pool_len += len + 1;
+
+	element = mbus_address_find( self, "id" );
+	if ( element ) self->hash = g_str_hash( element->value );
+
+	self->text = text;
+	self->text_len = len;
+	self->text_hash = g_str_hash( text );
 }
 
 /**
@@ -156,32 +345,72 @@ mbus_address_new( void )
 static void
 __mbus_address_finalize( MAddress * self )
 {
-	gint i;
+	g_free( self->heap );
+	g_free( self->intern_key );
+}
+
+/**
+\brief Frees an Mbus address object. If other references to the address
+    exist only the reference of the caller is dropped.
+\param self the Mbus address object to free
+\sa mbus_address_unref
+*/
+void
+mbus_address_free( MAddress * self )
+{
+	mbus_address_unref( self );
+}
 
-	for ( i = 0; i < self->elements->len; i++ ) {
-		MAddressElement * elem = self->elements->pdata[ i ];
+/* the interned addresses by the text they were parsed from. The table does
+   not hold a reference, an address is removed when it is freed. The lock
+   protects the table and the reference counts of the interned addresses
+   dropping to zero, as messages may be parsed by a receive thread. */
+static GHashTable * __mbus_address_interned = NULL;
+static GMutex __mbus_address_intern_lock;
 
-		g_free( elem->key );
-		g_free( elem->value );
-		g_free( elem );
-	}
+/**
+\brief Adds a reference to an Mbus address
+\param self the Mbus address object
+\return the Mbus address object
+*/
+MAddress *
+mbus_address_ref( const MAddress * self )
+{
+	MAddress * me = ( MAddress * ) self;
 
-	g_ptr_array_free( self->elements, TRUE );
+	g_atomic_int_inc( &me->_ref_count );
+
+	return me;
 }
 
 /**
-\brief Frees an Mbus address object
-\param self the Mbus address object to free
+\brief Drops a reference to an Mbus address. The address is freed when
+    the last reference is dropped.
+\param self the Mbus address object
 */
 void
-mbus_address_free( MAddress * self )
+mbus_address_unref( MAddress * self )
 {
+	if ( self->intern_key ) {
+		gboolean last;
+
+		g_mutex_lock( &__mbus_address_intern_lock );
+		last = g_atomic_int_dec_and_test( &self->_ref_count );
+		if ( last )
+			g_hash_table_remove( __mbus_address_interned, self->intern_key );
+		g_mutex_unlock( &__mbus_address_intern_lock );
+
+		if ( !last ) return;
+	} else if ( !g_atomic_int_dec_and_test( &self->_ref_count ) )
+		return;
+
 	__mbus_address_finalize( self );
 	g_free( self );
 }
 
 /**
-\brief Copies an Mbus address
+\brief Copies an Mbus address. The copy is never interned, so it may be
+    modified.
 \param self the Mbus address object to copy
 \return the newly created Mbus address object being a copy of \a self
 */
@@ -195,10 +424,10 @@ mbus_address_copy( MAddress * self )
 	return copy;
 }
 
-gint
-__elements_sort( const MAddressElement ** a, const MAddressElement ** b )
+static gint
+__elements_sort( const MAddressElement * a, const MAddressElement * b )
 {
-	return strcmp( ( *a )->key, ( *b )->key );
+	return strcmp( a->key, b->key );
 }
 
 static gchar *
@@ -226,42 +455,53 @@ __generate_id( void )
 }
 
 /**
-\brief Parses an Mbus address
+\brief Parses an Mbus address at the current position of the cursor
 \param self the Mbus address object storing the parsed data
-\param buf containing the string to parse
+\param cursor the cursor pointing to the address. It is moved behind the
+    parsed characters.
 \return TRUE of the Mbus address could be parsed, otherwise FALSE
 */
 gboolean
-mbus_address_read( MAddress * self, GString * buf )
+mbus_address_parse( MAddress * self, MCursor * cursor )
 {
-	gboolean finished = FALSE;
+	gboolean	finished = FALSE;
+	const gchar *	end;
+
+	g_return_val_if_fail( !mbus_address_is_interned( self ), FALSE );
 
 	self->ok = FALSE;
+	__mbus_address_invalidate( self );
+	__mbus_address_clear( self );
 
-	mbus_util_cut_whitespaces( buf );
-	if ( buf->str[ 0 ] != '(' ) return FALSE;
+	mbus_cursor_skip_whitespaces( cursor );
+	if ( mbus_cursor_peek( cursor ) != '(' ) return FALSE;
+	cursor->pos++;
 
-	g_string_erase( buf, 0, 1 );
+	/* the keys, values and the text representation need at most twice the
+	   length of the address */
+	end = mbus_cursor_find_char( cursor, ')' );
+	if ( end ) __mbus_address_reserve( self, 0, 2 * ( end - cursor->pos ) + 8 );
 
 	while ( !finished ) {
-		MAddressElement * e = g_new( MAddressElement, 1 );
-
-		mbus_address_element_read( e, buf );
-
-		if ( e->ok ) {
-			g_ptr_array_add( self->elements, e );
-			if ( buf->str[ 0 ] == ')' ) finished = TRUE;
-		} else {
-			g_free( e );
+		const gchar *	key;
+		const gchar *	value;
+		gsize		key_len, value_len;
+
+		if ( __mbus_address_element_scan( cursor, &key, &key_len,
+					&value, &value_len ) ) {
+			__mbus_address_append( self, key, key_len, value, value_len );
+			if ( mbus_cursor_peek( cursor ) == ')' ) finished = TRUE;
+		} else
 			finished = TRUE;
-		}
 	} /* while(!finished) */
 
-	mbus_util_cut_whitespaces( buf );
-	if ( buf->str[ 0 ] != ')' ) return FALSE;
-	g_string_erase( buf, 0, 1 );
+	mbus_cursor_skip_whitespaces( cursor );
+	if ( mbus_cursor_peek( cursor ) != ')' ) return FALSE;
+	cursor->pos++;
 
-	g_ptr_array_sort( self->elements, ( GCompareFunc ) __elements_sort );
+	qsort( self->elements, self->n_elements, sizeof( MAddressElement ),
+			( GCompareFunc ) __elements_sort );
+	__mbus_address_update( self );
 
 	self->ok = TRUE;
 
@@ -269,34 +509,103 @@ mbus_address_read( MAddress * self, GString * buf )
 }
 
 /**
-\brief Creates an unique Mbus address
-\param[out] self the Mbus address to disambiguate
+\brief Parses an Mbus address
+\param self the Mbus address object storing the parsed data
+\param buf containing the string to parse. The parsed characters are
+    removed from it.
+\return TRUE of the Mbus address could be parsed, otherwise FALSE
 */
-void
-mbus_address_disambiguate( MAddress * self )
+gboolean
+mbus_address_read( MAddress * self, GString * buf )
 {
-	gint		i;
-	gboolean	finished = FALSE;
+	MCursor		cursor;
+	gboolean	ret;
 
-	finished = FALSE;
-	for ( i = 0; i < self->elements->len; i++ ) {
-		MAddressElement * elem = g_ptr_array_index( self->elements, i );
+	mbus_cursor_init( &cursor, buf->str, buf->len );
+	ret = mbus_address_parse( self, &cursor );
+	g_string_erase( buf, 0, cursor.pos - buf->str );
 
-		if ( ! strcmp( elem->key, "id" ) ) {
-			finished = TRUE;
-			break;
+	return ret;
+}
+
+/**
+\brief Parses an Mbus address at the current position of the cursor and
+    returns a shared handle for it. Addresses are looked up by their text,
+    so each distinct address is only parsed once as long as a reference to
+    it exists. The returned address must not be modified.
+\param cursor the cursor pointing to the address. It is moved behind the
+    parsed characters.
+\return a new reference to the interned address or NULL if the address
+    could not be parsed
+*/
+MAddress *
+mbus_address_intern( MCursor * cursor )
+{
+	const gchar *	end;
+	gchar		tmp[ 128 ];
+	gchar *		key = tmp;
+	gsize		len;
+	MAddress *	self;
+
+	mbus_cursor_skip_whitespaces( cursor );
+	if ( mbus_cursor_peek( cursor ) != '(' ) return NULL;
+	/* address elements cannot contain a closing bracket */
+	end = mbus_cursor_find_char( cursor, ')' );
+	if ( !end ) return NULL;
+	len = end + 1 - cursor->pos;
+
+	if ( len >= sizeof( tmp ) ) key = g_malloc( len + 1 );
+	memcpy( key, cursor->pos, len );
+	key[ len ] = '\0';
+
+	g_mutex_lock( &__mbus_address_intern_lock );
+
+	if ( !__mbus_address_interned )
+		__mbus_address_interned = g_hash_table_new( g_str_hash, g_str_equal );
+
+	self = g_hash_table_lookup( __mbus_address_interned, key );
+	if ( self ) {
+		mbus_address_ref( self );
+		cursor->pos = end + 1;
+	} else {
+		self = mbus_address_new();
+		if ( mbus_address_parse( self, cursor ) && cursor->pos == end + 1 ) {
+			self->intern_key = key == tmp ? g_strdup( tmp ) : key;
+			key = tmp;
+			g_hash_table_insert( __mbus_address_interned, self->intern_key,
+					self );
+		} else {
+			mbus_address_free( self );
+			self = NULL;
 		}
 	}
-	if ( finished == FALSE ) {
-		MAddressElement * e = g_new( MAddressElement, 1 );
 
-		e->key = g_strdup( "id" );
-		e->value = __generate_id();
+	g_mutex_unlock( &__mbus_address_intern_lock );
 
-		g_ptr_array_add( self->elements, e );
+	if ( key != tmp ) g_free( key );
+
+	return self;
+}
+
+/**
+\brief Creates an unique Mbus address
+\param[out] self the Mbus address to disambiguate
+*/
+void
+mbus_address_disambiguate( MAddress * self )
+{
+	g_return_if_fail( !mbus_address_is_interned( self ) );
+
+	if ( !mbus_address_find( self, "id" ) ) {
+		gchar * id = __generate_id();
+
+		__mbus_address_append( self, "id", 2, id, strlen( id ) );
+		g_free( id );
 	}
 
-	g_ptr_array_sort( self->elements, ( GCompareFunc ) __elements_sort );
+	qsort( self->elements, self->n_elements, sizeof( MAddressElement ),
+			( GCompareFunc ) __elements_sort );
+	__mbus_address_update( self );
 }
 
 /**
@@ -309,10 +618,10 @@ mbus_address_disambiguate( MAddress * self )
 MAddressElement *
 mbus_address_find( MAddress * self, const gchar * key )
 {
-	gint i;
+	guint i;
 
-	for ( i = 0; i < self->elements->len; i++ ) {
-		MAddressElement * element = g_ptr_array_index( self->elements, i );
+	for ( i = 0; i < self->n_elements; i++ ) {
+		MAddressElement * element = &self->elements[ i ];
 
 		if ( !strcmp( element->key, key ) ) return element;
 	}
@@ -330,27 +639,85 @@ mbus_address_find( MAddress * self, const gchar * key )
 gboolean
 mbus_address_as_string( MAddress * self, GString * buf )
 {
-	gint i;
+	MWriter writer;
 
-	/* format string */
-	g_string_append_c( buf, '(' );
+	mbus_writer_init_append( &writer, buf, mbus_address_text_len( self ) );
+	mbus_address_write( self, &writer );
 
-	for ( i = 0; i < self->elements->len; i++ ) {
-		MAddressElement * elem = g_ptr_array_index( self->elements, i );
+	return TRUE;
+}
 
-		if ( !mbus_address_element_as_string( elem, buf ) )
-			return FALSE;
-		g_string_append_c( buf, ' ' );
+/**
+\brief Computes the length of the string representation of an Mbus address
+\param self the Mbus address
+\return the number of characters mbus_address_write will write
+*/
+gsize
+mbus_address_text_len( const MAddress * self )
+{
+	gsize	len = 2 + self->n_elements;
+	guint	i;
+
+	if ( self->text ) return self->text_len;
+
+	for ( i = 0; i < self->n_elements; i++ ) {
+		const MAddressElement * elem = &self->elements[ i ];
+
+		if ( elem->key && elem->value )
+			len += strlen( elem->key ) + strlen( elem->value ) + 1;
+	}
+
+	return len;
+}
+
+/**
+\brief Writes the string representation of an Mbus address
+\param self the Mbus address
+\param writer the writer with room for at least mbus_address_text_len
+    characters
+*/
+void
+mbus_address_write( MAddress * self, MWriter * writer )
+{
+	guint i;
+
+	if ( self->text ) {
+		mbus_writer_put( writer, self->text, self->text_len );
+		self->ok = TRUE;
+		return;
 	}
-	g_string_append_c( buf, ')' );
+
+	mbus_writer_put_c( writer, '(' );
+	for ( i = 0; i < self->n_elements; i++ ) {
+		MAddressElement * elem = &self->elements[ i ];
+
+		if ( elem->key && elem->value ) {
+			mbus_writer_put( writer, elem->key, strlen( elem->key ) );
+			mbus_writer_put_c( writer, ':' );
+			mbus_writer_put( writer, elem->value, strlen( elem->value ) );
+		}
+		mbus_writer_put_c( writer, ' ' );
+	}
+	mbus_writer_put_c( writer, ')' );
 
 	self->ok = TRUE;
+}
 
-	return TRUE;
+/* an address with a known text representation and without wildcards */
+#define __mbus_address_is_plain( self ) \
+	( ( self )->text && !( self )->wildcard )
+
+static gboolean
+__mbus_address_text_is_equal( const MAddress * self, const MAddress * other )
+{
+	return self->text_hash == other->text_hash &&
+		self->text_len == other->text_len &&
+		!memcmp( self->text, other->text, self->text_len );
 }
 
 /**
-\brief Copies the Mbus address \a other
+\brief Copies the Mbus address \a other. As all elements and strings of
+    an address are stored in one block, it is copied as a whole.
 \param self the Mbus address storing the copy of \a other
 \param other the Mbus address that is copied to \a self
 \return pointer to the modified Mbus address object \a self
@@ -358,29 +725,24 @@ mbus_address_as_string( MAddress * self, GString * buf )
 MAddress *
 mbus_address_assign( MAddress * self, const MAddress * other )
 {
-	if ( self != other ) {
-		gint i;
-
-		for ( i = 0; i < self->elements->len; i++ ) {
-			MAddressElement * elem = self->elements->pdata[ i ];
-
-			g_free( elem->key );
-			g_free( elem->value );
-			g_free( elem );
-		}
-
-		g_ptr_array_free( self->elements, TRUE );
-		self->elements = g_ptr_array_sized_new( other->elements->len );
-		for ( i = 0; i < other->elements->len; i++ ) {
-			MAddressElement * elem = g_ptr_array_index( other->elements, i );
-			MAddressElement * nelem = g_new( MAddressElement, 1 );
-
-			nelem->key = g_strdup( elem->key );
-			nelem->value = g_strdup( elem->value );
-
-			g_ptr_array_add( self->elements, nelem );
-		}
+	g_return_val_if_fail( !mbus_address_is_interned( self ), self );
 
+	if ( self != other ) {
+		__mbus_address_clear( self );
+		__mbus_address_reserve( self, other->n_elements, other->pool_len );
+
+		memcpy( self->elements, other->elements,
+				other->n_elements * sizeof( MAddressElement ) );
+		self->n_elements = other->n_elements;
+		memcpy( self->pool, other->pool, other->pool_len );
+		self->pool_len = other->pool_len;
+		self->text = other->text;
+		__mbus_address_rebase( self, other->pool );
+
+		self->text_len = other->text_len;
+		self->text_hash = other->text_hash;
+		self->wildcard = other->wildcard;
+		self->hash = other->hash;
 		self->ok = other->ok;
 	}
 
@@ -388,7 +750,10 @@ mbus_address_assign( MAddress * self, const MAddress * other )
 }
 
 /**
-\brief Compares to Mbus address objects
+\brief Compares to Mbus address objects. Interned addresses parsed from
+    the same text are the same object, so comparing them costs a single
+    pointer comparison. Addresses without wildcards are compared by their
+    text representation.
 \param self first of the Mbus addresses to compare
 \param other second of the Mbus addresses to compare
 \return TRUE if the Mbus addresses are equal, otherwise FALSE
@@ -396,20 +761,17 @@ mbus_address_assign( MAddress * self, const MAddress * other )
 gboolean
 mbus_address_is_equal( const MAddress * self, const MAddress * other )
 {
-	GPtrArray *	my = self->elements;
-	GPtrArray *	your = other->elements;
-	gint		i;
-
-	if ( my == your ) return TRUE;
-	if ( my->len != your->len ) return FALSE;
+	guint i;
 
-	for ( i = 0; i < my->len; i++ ) {
-		MAddressElement * my_elem = g_ptr_array_index( my, i );
-		MAddressElement * your_elem = g_ptr_array_index( your, i );
+	if ( self == other ) return TRUE;
+	if ( __mbus_address_is_plain( self ) && __mbus_address_is_plain( other ) )
+		return __mbus_address_text_is_equal( self, other );
+	if ( self->n_elements != other->n_elements ) return FALSE;
 
-		if ( !mbus_address_element_is_equal( my_elem, your_elem ) )
+	for ( i = 0; i < self->n_elements; i++ )
+		if ( !mbus_address_element_is_equal( &self->elements[ i ],
+					&other->elements[ i ] ) )
 			return FALSE;
-	}
 
 	return TRUE;
 }
@@ -427,27 +789,16 @@ mbus_address_is_unique( const MAddress * self )
 
 /**
 \brief Generates a hash value of an Mbus address that can can be used as a
-    key for GHashTable objects
+    key for GHashTable objects. The value is computed when the address is
+    parsed or disambiguated. Only the id element is hashed, so addresses
+    that are equal because of wildcards get the same hash value.
 \param self the Mbus address to create a hash for
 \return the hash value
 */
 guint
 mbus_address_hash( const MAddress * self )
 {
-	GString *			addr_str;
-	guint				hash;
-	MAddressElement *	element;
-
-	element = mbus_address_find( ( MAddress * ) self, "id" );
-
-	if ( !element ) return 0;
-
-	addr_str = g_string_new( NULL );
-	g_string_append( addr_str, element->value );
-	hash = g_string_hash( addr_str );
-	g_string_free( addr_str, TRUE );
-
-	return hash;
+	return self->hash;
 }
 
 /**
@@ -459,18 +810,19 @@ mbus_address_hash( const MAddress * self )
 gboolean
 mbus_address_is_subset_of( const MAddress * self, const MAddress * other )
 {
-	GPtrArray *	my = self->elements;
-	GPtrArray *	your = other->elements;
-	gint		i, j;
+	guint i, j;
 
-	if ( my == your ) return TRUE;
+	if ( self == other ) return TRUE;
+	if ( self->text && other->text &&
+			__mbus_address_text_is_equal( self, other ) )
+		return TRUE;
 
-	for ( j = 0; j < your->len; j++ ) {
-		MAddressElement * your_elem = g_ptr_array_index( your, j );
+	for ( j = 0; j < other->n_elements; j++ ) {
+		const MAddressElement * your_elem = &other->elements[ j ];
 		gboolean found = FALSE;
 
-		for ( i = 0; i < my->len; i++ ) {
-			MAddressElement * my_elem = g_ptr_array_index( my, i );
+		for ( i = 0; i < self->n_elements; i++ ) {
+			const MAddressElement * my_elem = &self->elements[ i ];
 
 			if ( mbus_address_element_is_equal( my_elem, your_elem ) ) {
 				found = TRUE;
@@ -486,3 +838,139 @@ mbus_address_is_subset_of( const MAddress * self, const MAddress * other )
 /**
 \}
 */
+
+/**
+\addtogroup MAddressMatcher
+\{
+An MAddressMatcher answers the question whether a message is addressed to
+an entity, i.e. if the destination address of the message is a subset of
+the entity address, without comparing all elements of both addresses.
+*/
+
+/**
+\brief Compiles an Mbus address into a matcher
+\param address the Mbus address. Its elements have to be sorted by key
+    like after parsing it.
+\return the new matcher
+*/
+MAddressMatcher *
+mbus_address_matcher_new( const MAddress * address )
+{
+	MAddressMatcher *	self = g_new0( MAddressMatcher, 1 );
+	guint			i;
+
+	self->n_elements = address->n_elements;
+	self->elements = g_new( MAddressMatcherElement, self->n_elements );
+	for ( i = 0; i < self->n_elements; i++ ) {
+		const MAddressElement * elem = &address->elements[ i ];
+
+		self->elements[ i ].key = g_strdup( elem->key );
+		self->elements[ i ].value = g_strdup( elem->value );
+		self->elements[ i ].wildcard = elem->value[ 0 ] == '*';
+	}
+
+	return self;
+}
+
+/**
+\brief Frees an address matcher
+\param self the matcher
+*/
+void
+mbus_address_matcher_free( MAddressMatcher * self )
+{
+	guint i;
+
+	for ( i = 0; i < self->n_elements; i++ ) {
+		g_free( self->elements[ i ].key );
+		g_free( self->elements[ i ].value );
+	}
+	for ( i = 0; i < self->n_cached; i++ )
+		g_free( self->cache[ i ].text );
+
+	g_free( self->elements );
+	g_free( self );
+}
+
+/* walks through both sorted element lists at once */
+static gboolean
+__mbus_address_matcher_walk( MAddressMatcher * self, const MAddress * other )
+{
+	guint		i = 0, j;
+
+	for ( j = 0; j < other->n_elements; j++ ) {
+		const MAddressElement *	your_elem = &other->elements[ j ];
+		gboolean		your_wildcard = your_elem->value[ 0 ] == '*';
+		gboolean		found = FALSE;
+		guint			k;
+		gint			cmp = -1;
+
+		while ( i < self->n_elements &&
+				( cmp = strcmp( self->elements[ i ].key,
+						your_elem->key ) ) < 0 )
+			i++;
+		if ( cmp ) return FALSE;
+
+		/* the same key may occur more than once */
+		for ( k = i; k < self->n_elements &&
+				  !strcmp( self->elements[ k ].key, your_elem->key ); k++ )
+			if ( your_wildcard || self->elements[ k ].wildcard ||
+					!strcmp( self->elements[ k ].value, your_elem->value ) ) {
+				found = TRUE;
+				break;
+			}
+		if ( !found ) return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+\brief Checks if an Mbus address is a subset of the compiled address (see
+    mbus_address_is_subset_of). The results for the last
+    M_ADDRESS_MATCHER_CACHE_SIZE distinct addresses are remembered, so
+    checking an address that was seen recently does not compare any
+    elements.
+\param self the matcher
+\param other the Mbus address, e.g. the destination of a message
+\return TRUE if the compiled address is addressed by \a other
+*/
+gboolean
+mbus_address_matcher_match( MAddressMatcher * self, const MAddress * other )
+{
+	MAddressMatcherEntry	entry;
+	guint			i;
+
+	/* only addresses with a known text representation are cached */
+	if ( !other->text ) return __mbus_address_matcher_walk( self, other );
+
+	for ( i = 0; i < self->n_cached; i++ ) {
+		entry = self->cache[ i ];
+		if ( entry.text_hash == other->text_hash &&
+				entry.text_len == other->text_len &&
+				!memcmp( entry.text, other->text, entry.text_len ) )
+			break;
+	}
+
+	if ( i == self->n_cached ) {
+		entry.text = g_strndup( other->text, other->text_len );
+		entry.text_len = other->text_len;
+		entry.text_hash = other->text_hash;
+		entry.match = __mbus_address_matcher_walk( self, other );
+
+		if ( self->n_cached < M_ADDRESS_MATCHER_CACHE_SIZE )
+			self->n_cached++;
+		else
+			g_free( self->cache[ --i ].text );
+	}
+
+	/* move the entry to the front */
+	memmove( self->cache + 1, self->cache, i * sizeof( entry ) );
+	self->cache[ 0 ] = entry;
+
+	return entry.match;
+}
+
+/**
+\}
+*/
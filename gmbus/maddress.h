@@ -28,17 +28,123 @@
 
 #include <glib.h>
 
+#include "gmbus/mcursor.h"
+#include "gmbus/mwriter.h"
+
 typedef struct {
 	gchar *		key;
 	gchar *		value;
 	gboolean	ok;
 } MAddressElement;
 
+/**
+\def M_ADDRESS_INLINE_ELEMENTS
+\brief the number of address elements stored within the MAddress object
+*/
+#define M_ADDRESS_INLINE_ELEMENTS 4
+
+/**
+\def M_ADDRESS_INLINE_POOL
+\brief the number of characters for keys, values and the text
+    representation stored within the MAddress object
+*/
+#define M_ADDRESS_INLINE_POOL 128
+
+/**
+\brief An Mbus address. The elements and all strings are stored in one
+    block: the object itself for small addresses, a single heap block for
+    larger ones. The keys and values of the elements point into the string
+    pool of the block.
+*/
 typedef struct {
-	GPtrArray *	elements;
+	/** the elements sorted by key (see mbus_address_element) */
+	MAddressElement *	elements;
+	/** the number of elements */
+	guint		n_elements;
+	/** the number of elements that fit into the block */
+	guint		max_elements;
+	/** the string pool */
+	gchar *		pool;
+	/** the number of used characters of the pool */
+	gsize		pool_len;
+	/** the size of the pool */
+	gsize		pool_size;
+	/** the heap block or NULL if the inline storage is used */
+	gpointer	heap;
 	gboolean	ok;
+	/** the hash value of the id element (0 if there is none) */
+	guint		hash;
+	/** the cached text representation (stored in the pool) or NULL if it
+	    is not known */
+	gchar *		text;
+	/** the length of the cached text representation */
+	gsize		text_len;
+	/** the hash value of the cached text representation */
+	guint		text_hash;
+	/** TRUE if the value of an element is a wildcard (only valid if the
+	    text representation is cached) */
+	gboolean	wildcard;
+	/** the reference count (see mbus_address_ref) */
+	gint		_ref_count;
+	/** the text the address is registered with in the intern table or
+	    NULL if the address is not interned */
+	gchar *		intern_key;
+	/** inline storage for the elements */
+	MAddressElement	inline_elements[ M_ADDRESS_INLINE_ELEMENTS ];
+	/** inline storage for the string pool */
+	gchar		inline_pool[ M_ADDRESS_INLINE_POOL ];
 } MAddress;
 
+/**
+\def M_ADDRESS_MATCHER_CACHE_SIZE
+\brief the number of recently matched addresses an MAddressMatcher
+    remembers
+*/
+#define M_ADDRESS_MATCHER_CACHE_SIZE 8
+
+/**
+\brief an element of an address compiled into an MAddressMatcher
+*/
+typedef struct {
+	/** the key */
+	gchar *		key;
+	/** the value */
+	gchar *		value;
+	/** TRUE if the value matches any value */
+	gboolean	wildcard;
+} MAddressMatcherElement;
+
+/**
+\brief a recently matched address and the result
+*/
+typedef struct {
+	/** the text representation of the address */
+	gchar *		text;
+	/** the length of the text representation */
+	gsize		text_len;
+	/** the hash value of the text representation */
+	guint		text_hash;
+	/** the result of the match */
+	gboolean	match;
+} MAddressMatcherEntry;
+
+/**
+\brief An Mbus address compiled for fast checks whether it is addressed
+    by other addresses (see mbus_address_is_subset_of)
+*/
+typedef struct {
+	/** the elements of the address sorted by key */
+	MAddressMatcherElement *	elements;
+	/** the number of elements */
+	guint				n_elements;
+	/** the recently matched addresses, the most recent one first */
+	MAddressMatcherEntry		cache[ M_ADDRESS_MATCHER_CACHE_SIZE ];
+	/** the number of used cache entries */
+	guint				n_cached;
+} MAddressMatcher;
+
+gboolean mbus_address_element_parse( MAddressElement * self,
+		MCursor * cursor );
 gboolean mbus_address_element_read( MAddressElement * self, GString * buf );
 gboolean mbus_address_element_as_string( MAddressElement * self,
 		GString * buf );
@@ -48,9 +154,15 @@ gboolean mbus_address_element_is_equal( const MAddressElement * self,
 MAddress * mbus_address_new( void );
 void mbus_address_free( MAddress * self );
 MAddress * mbus_address_copy( MAddress * self );
+MAddress * mbus_address_ref( const MAddress * self );
+void mbus_address_unref( MAddress * self );
+MAddress * mbus_address_intern( MCursor * cursor );
 MAddressElement * mbus_address_find( MAddress * self, const gchar * key );
+gboolean mbus_address_parse( MAddress * self, MCursor * cursor );
 gboolean mbus_address_read( MAddress * self, GString * buf );
 gboolean mbus_address_as_string( MAddress * self, GString * buf );
+gsize mbus_address_text_len( const MAddress * self );
+void mbus_address_write( MAddress * self, MWriter * writer );
 guint mbus_address_hash( const MAddress * self );
 MAddress * mbus_address_assign( MAddress * self, const MAddress * other );
 gboolean mbus_address_is_equal( const MAddress * self, const MAddress * other );
@@ -59,6 +171,31 @@ gboolean mbus_address_is_subset_of( const MAddress * self,
     const MAddress * other );
 void mbus_address_disambiguate( MAddress * self );
 
+MAddressMatcher * mbus_address_matcher_new( const MAddress * address );
+void mbus_address_matcher_free( MAddressMatcher * self );
+gboolean mbus_address_matcher_match( MAddressMatcher * self,
+    const MAddress * other );
+
 #define mbus_address_ok(self) ( self->ok )
 
+/**
+\def mbus_address_size
+\brief returns the number of elements of the address
+*/
+#define mbus_address_size(self) ( ( self )->n_elements )
+
+/**
+\def mbus_address_element
+\brief returns the element at the given index. The element is valid until
+    the address is modified or freed.
+*/
+#define mbus_address_element(self,i) ( &( self )->elements[ i ] )
+
+/**
+\def mbus_address_is_interned
+\brief checks if the address is a shared handle created by
+    mbus_address_intern. Interned addresses must not be modified.
+*/
+#define mbus_address_is_interned(self) ( ( self )->intern_key != NULL )
+
 #endif
@@ -0,0 +1,159 @@
+/* marena.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "gmbus/marena.h"
+
+#include <string.h>
+
+/**
+\addtogroup marena MArena
+\{
+*/
+
+/* all allocations are aligned to this size */
+#define M_ARENA_ALIGN ( 2 * sizeof( gpointer ) )
+#define M_ARENA_ROUND( size ) \
+	( ( ( size ) + M_ARENA_ALIGN - 1 ) & ~( M_ARENA_ALIGN - 1 ) )
+
+struct _MArenaChunk {
+	MArenaChunk *	next;
+	gsize		size;
+	gsize		used;
+};
+
+/* the header is padded, so the memory behind it is aligned */
+#define M_ARENA_HEADER_SIZE M_ARENA_ROUND( sizeof( MArenaChunk ) )
+#define M_ARENA_CHUNK_DATA( chunk ) \
+	( ( guint8 * ) ( chunk ) + M_ARENA_HEADER_SIZE )
+
+static MArenaChunk *
+__mbus_arena_chunk_new( gsize size )
+{
+	MArenaChunk * chunk = g_malloc( M_ARENA_HEADER_SIZE + size );
+
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+
+	return chunk;
+}
+
+/**
+\brief creates a new arena
+\param chunk_size the size of the memory chunks the allocations are taken
+    from. If 0 M_ARENA_CHUNK_SIZE is used.
+\return the new arena
+*/
+MArena *
+mbus_arena_new( gsize chunk_size )
+{
+	MArena * self = g_new( MArena, 1 );
+
+	g_assert( self );
+	self->chunks = NULL;
+	self->chunk_size = chunk_size ? chunk_size : M_ARENA_CHUNK_SIZE;
+
+	return self;
+}
+
+/**
+\brief frees the arena and all memory allocated from it
+\param self the arena
+*/
+void
+mbus_arena_free( MArena * self )
+{
+	MArenaChunk * chunk = self->chunks;
+
+	while ( chunk ) {
+		MArenaChunk * next = chunk->next;
+
+		g_free( chunk );
+		chunk = next;
+	}
+
+	g_free( self );
+}
+
+/**
+\brief allocates memory from the arena. The memory is not initialized and
+    stays valid until the arena is freed.
+\param self the arena
+\param size the number of bytes to allocate
+\return a pointer to the memory
+*/
+gpointer
+mbus_arena_alloc( MArena * self, gsize size )
+{
+	MArenaChunk *	chunk = self->chunks;
+	gpointer	mem;
+
+	size = M_ARENA_ROUND( size );
+
+	if ( !chunk || chunk->size - chunk->used < size ) {
+		if ( size > self->chunk_size / 4 ) {
+			/* large blocks get a chunk of their own, which is put behind
+			   the current one, so its remaining space is still used */
+			chunk = __mbus_arena_chunk_new( size );
+			if ( self->chunks ) {
+				chunk->next = self->chunks->next;
+				self->chunks->next = chunk;
+			} else
+				self->chunks = chunk;
+		} else {
+			chunk = __mbus_arena_chunk_new( self->chunk_size );
+			chunk->next = self->chunks;
+			self->chunks = chunk;
+		}
+	}
+
+	mem = M_ARENA_CHUNK_DATA( chunk ) + chunk->used;
+	chunk->used += size;
+
+	return mem;
+}
+
+/**
+\brief copies \a len characters of \a str into the arena and terminates
+    the copy with a zero byte
+\param self the arena
+\param str the string to copy
+\param len the number of characters to copy
+\return the copy
+*/
+gchar *
+mbus_arena_strndup( MArena * self, const gchar * str, gsize len )
+{
+	gchar * copy = mbus_arena_alloc( self, len + 1 );
+
+	memcpy( copy, str, len );
+	copy[ len ] = '\0';
+
+	return copy;
+}
+
+/**
+\}
+*/
+
+/* end of marena.c */
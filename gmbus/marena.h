@@ -0,0 +1,70 @@
+/* marena.h
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef MBUS_ARENA_H
+#define MBUS_ARENA_H
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+\addtogroup marena MArena
+\{
+*/
+
+typedef struct _MArenaChunk MArenaChunk;
+
+/**
+\brief A bump allocator. Memory is taken from large chunks and is only
+    released as a whole when the arena is freed. It is used to allocate
+    the MObject trees of received messages.
+*/
+typedef struct {
+	/** the chunk that is currently filled, earlier chunks follow */
+	MArenaChunk *	chunks;
+	/** the size of newly allocated chunks */
+	gsize		chunk_size;
+} MArena;
+
+/**
+\brief the default size of the chunks of an arena
+*/
+#define M_ARENA_CHUNK_SIZE 4096
+
+MArena * mbus_arena_new( gsize chunk_size );
+void mbus_arena_free( MArena * self );
+gpointer mbus_arena_alloc( MArena * self, gsize size );
+gchar * mbus_arena_strndup( MArena * self, const gchar * str, gsize len );
+
+/**
+\}
+*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBUS_ARENA_H */
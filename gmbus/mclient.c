@@ -32,22 +32,21 @@ __mbus_client_incoming_message( MMessage * msg, MClient * client )
 {
 	GSList *			walk;
 	MCommandCallback *	cb;
-	MCommand *			command;
 	guint				i;
-	GString *			tmp = g_string_new( NULL );
 
-	mbus_message_as_string( msg, tmp );
-	g_string_free( tmp, TRUE );
 	/* if there are no commands in this message abort */
 	if ( !mbus_payload_size( msg->payload ) ) return;
 
+	/* the commands are compared by their interned names, so only those
+	   commands get parsed that are passed to a callback */
 	for ( i = 0; i < mbus_payload_size( msg->payload ); i++ ) {
-		command = mbus_payload_index( msg->payload, i );
-		walk = client->callbacks;
+		GQuark command = mbus_payload_get_quark( msg->payload, i );
 
+		/* names that were never interned cannot be registered */
+		walk = command ? client->callbacks : NULL;
 		while ( walk ) {
 			cb = walk->data;
-			if ( !strcmp( cb->command, command->cmd->str ) ) break;
+			if ( cb->command == command ) break;
 			walk = g_slist_next( walk );
 		}
 
@@ -204,7 +203,7 @@ mbus_client_register( MClient * self, const gchar * cmd, MMessageFunc func,
 {
 	MCommandCallback * cb = g_new( MCommandCallback, 1 );
 
-	cb->command = g_strdup( cmd );
+	cb->command = g_quark_from_string( cmd );
 	mbus_callback_set( cb->callback, func, data );
 
 	self->callbacks = g_slist_append( self->callbacks, cb );
@@ -219,19 +218,19 @@ from the MCLient obect
 void
 mbus_client_unregister( MClient * self, const gchar * cmd )
 {
-	GSList *			walk = self->callbacks;
+	GQuark				command = g_quark_try_string( cmd );
+	GSList *			walk = command ? self->callbacks : NULL;
 	MCommandCallback *	cb;
 
 	while ( walk ) {
 		cb = walk->data;
-		if ( !strcmp( cb->command, cmd ) ) break;
+		if ( cb->command == command ) break;
 		walk = g_slist_next( walk );
 	}
 
 	if ( walk ) {
-		g_free( cb->command );
 		g_free( cb );
-		self->callbacks = g_slist_remove( self->callbacks, walk );
+		self->callbacks = g_slist_delete_link( self->callbacks, walk );
 	}
 }
 
@@ -252,7 +251,7 @@ mbus_client_send_reliable( MClient * self, MMessage * msg,
 		gboolean ret;
 
 		msg->header->type = RELIABLE;
-		mbus_address_assign( msg->header->destination, addr );
+		mbus_header_set_destination( msg->header, addr );
 		ret = mbus_transport_send( self->trans, msg );
 		mbus_message_free( msg );
 
@@ -72,7 +72,8 @@ typedef enum {
 } MEventType;
 
 typedef struct {
-	gchar *				command;
+	/** the interned name of the registered command */
+	GQuark				command;
 	MMessageCallback	callback;
 } MCommandCallback;
 
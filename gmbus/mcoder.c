@@ -49,16 +49,35 @@ __ident_decode( const GByteArray * key, const GByteArray * buf,
 }
 
 static gint
-__hmac_md5( const GByteArray * key, const GString * buf, GByteArray * digest )
+__hmac_md5( const GByteArray * key, const guchar * data, gsize len,
+		guchar * digest )
 {
-	hmac_md5( ( const guchar * ) buf->str, buf->len, key->data, key->len,
-			digest->data );
+	hmac_md5( data, len, key->data, key->len, digest );
 
 	return 0;
 }
 
+static void
+__hmac_md5_init( const GByteArray * key, MDigestState * state )
+{
+	hmac_md5_init( &state->hmac_md5, key->data, key->len );
+}
+
+static void
+__hmac_md5_update( MDigestState * state, const guchar * data, gsize len )
+{
+	hmac_md5_update( &state->hmac_md5, data, len );
+}
+
+static void
+__hmac_md5_finish( MDigestState * state, guchar * digest )
+{
+	hmac_md5_final( &state->hmac_md5, digest );
+}
+
 static MEncryptor	noencr	= { __ident_encode, __ident_decode };
-static MDigestor	hmacMD5	= { __hmac_md5 };
+static MDigestor	hmacMD5	= { __hmac_md5, __hmac_md5_init, __hmac_md5_update,
+							__hmac_md5_finish };
 
 /* provide the default algorithms: */
 MDigestor *		digestors[]		= { &hmacMD5, 0, 0, 0 };
@@ -86,6 +105,8 @@ __mbus_coder_init( MCoder * me, const MConfig * config )
 	if ( me->ok ) {
 		me->hash_key = config->hash_key;
 		me->encr_key = config->encr_key;
+		/* the key is processed once instead of for each message */
+		me->digest.init( me->hash_key, &me->key_state );
 	}
 
 	return 0;
@@ -114,71 +135,162 @@ mbus_coder_free( MCoder * self )
 	g_free( self );
 }
 
+/**
+\brief initializes a digest calculation with the hash key of the coder
+\param self the coder
+\param[out] state the state to initialize. It can be copied to reuse the
+    digest of the data added so far.
+*/
+void
+mbus_coder_digest_init( const MCoder * self, MDigestState * state )
+{
+	*state = self->key_state;
+}
+
+/**
+\brief adds the \a len bytes at \a data to a digest calculation
+\param self the coder
+\param state the state initialized by mbus_coder_digest_init
+\param data the data
+\param len the number of bytes
+*/
+void
+mbus_coder_digest_update( const MCoder * self, MDigestState * state,
+		const gchar * data, gsize len )
+{
+	self->digest.update( state, ( const guchar * ) data, len );
+}
+
+/* stores the Base64 encoded digest of the data added to state followed by
+   a newline in the DIGEST_SPACE characters at out */
+static void
+__mbus_coder_finish( MCoder * self, MDigestState * state, gchar * out )
+{
+	guchar digest[ DIGEST_BUF_SIZE ];
+
+	memset( digest, 0, sizeof( digest ) );
+	self->digest.finish( state, digest );
+	base64encode_raw( digest, DIGEST_LEN_BIN, ( guchar * ) out );
+	out[ DIGEST_LEN_64 ] = '\n';
+}
+
+/* stores the Base64 encoded digest of the len bytes at data followed by a
+   newline in the DIGEST_SPACE characters at out */
+static void
+__mbus_coder_sign( MCoder * self, const gchar * data, gsize len, gchar * out )
+{
+	MDigestState state = self->key_state;
+
+	self->digest.update( &state, ( const guchar * ) data, len );
+	__mbus_coder_finish( self, &state, out );
+}
+
 gboolean
 mbus_coder_encode( MCoder * self, GString * buf, GByteArray * result )
 {
-	GByteArray *	digest_bin = g_byte_array_sized_new( DIGEST_LEN_BIN );
+	gchar digest64[ DIGEST_SPACE ];
 
-	memset( digest_bin->data, 0, DIGEST_LEN_BIN );
-	/* the next line MUST be there */
-	g_byte_array_set_size( digest_bin, DIGEST_LEN_BIN );
-	self->digest.calculate( self->hash_key, buf, digest_bin );
-	/* base64 encode of digest */
-	base64encode( digest_bin, result );
-	g_byte_array_append( result, ( const guchar * ) "\n", 1 );
-	g_string_prepend_len( buf, ( const gchar * ) result->data,
-			DIGEST_LEN_64 + 1 );
+	__mbus_coder_sign( self, buf->str, buf->len, digest64 );
+	g_string_prepend_len( buf, digest64, DIGEST_SPACE );
 
 	g_byte_array_set_size( result, 0 );
 	/* encrypt message buffer including the digest */
 	self->crypto.encrypt( self->encr_key, buf, result );
 
-	g_byte_array_free( digest_bin, TRUE );
-
 	return TRUE;
 }
 
+/**
+\brief encodes a message text without copying it if possible
+\param self the coder
+\param buf the buffer starting with DIGEST_SPACE unused characters followed
+    by the message text. The digest is written into the unused characters.
+\param[in,out] len the length of the buffer including the digest space. If
+    the data has to be encrypted it is set to the length of the encrypted
+    data.
+\param result stores the encrypted data if encryption is used
+\return the data to send: either \a buf itself or the data of \a result
+*/
+const guchar *
+mbus_coder_encode_in_place( MCoder * self, gchar * buf, gsize * len,
+		GByteArray * result )
+{
+	MDigestState state = self->key_state;
+
+	self->digest.update( &state, ( const guchar * ) buf + DIGEST_SPACE,
+			*len - DIGEST_SPACE );
+
+	return mbus_coder_encode_digested( self, &state, buf, len, result );
+}
+
+/**
+\brief works like mbus_coder_encode_in_place, but the message text has
+    already been added to a digest calculation. This way a text prefix that
+    is the same for several messages has to be added only once.
+\param self the coder
+\param state the digest state containing the whole message text. It can
+    not be used afterwards.
+\param buf the buffer starting with DIGEST_SPACE unused characters followed
+    by the message text
+\param[in,out] len the length of the buffer including the digest space
+\param result stores the encrypted data if encryption is used
+\return the data to send: either \a buf itself or the data of \a result
+*/
+const guchar *
+mbus_coder_encode_digested( MCoder * self, MDigestState * state, gchar * buf,
+		gsize * len, GByteArray * result )
+{
+	GString tmp;
+
+	__mbus_coder_finish( self, state, buf );
+	/* nothing to do without encryption */
+	if ( self->crypto.encrypt == __ident_encode )
+		return ( const guchar * ) buf;
+
+	/* the encryptors expect a GString; it is only read */
+	tmp.str = buf;
+	tmp.len = *len;
+	tmp.allocated_len = *len;
+	g_byte_array_set_size( result, 0 );
+	self->crypto.encrypt( self->encr_key, &tmp, result );
+	*len = result->len;
+
+	return result->data;
+}
+
 gboolean
 mbus_coder_decode( MCoder * self, const GByteArray * buf, GString * result )
 {
-	GByteArray *	digest64 = g_byte_array_sized_new( DIGEST_LEN_64 );
-	GByteArray *	my_digest = g_byte_array_sized_new( DIGEST_LEN_BIN );
-	GByteArray *	my_digest64 = g_byte_array_sized_new( DIGEST_LEN_64 );
-	gchar *	pos;
+	gchar		digest64[ DIGEST_LEN_64 ];
+	gchar		my_digest64[ DIGEST_SPACE ];
+	gchar *		pos;
 	gboolean	ret = TRUE;
 
 	/* decrypt data */
 	self->crypto.decrypt( self->encr_key, buf, result );
 
 	/* find digest and extract it */
-	pos = result->str;
-	while ( *pos != '\0' && *pos != '\n' ) pos++;
-	if ( *pos == '\0' ) {
+	pos = memchr( result->str, '\n', result->len );
+	if ( !pos ) {
 		g_warning( "could not find digest!" );
-		ret = FALSE;
-		goto done;
+		return FALSE;
 	}
 
-	g_byte_array_append( digest64, ( const guchar * ) result->str,
-			( gsize ) ( pos - result->str ) );
+	/* a digest of the wrong size never matches as the Base64 alphabet does
+	   not contain zero bytes */
+	memset( digest64, 0, DIGEST_LEN_64 );
+	memcpy( digest64, result->str,
+			MIN( ( gsize ) ( pos - result->str ), DIGEST_LEN_64 ) );
 	g_string_erase( result, 0, ( gsize ) ( pos - result->str + 1 ) );
 
 	/* calculate digest and check it */
-	g_byte_array_set_size( my_digest, DIGEST_LEN_BIN );
-	g_byte_array_set_size( my_digest64, DIGEST_LEN_64 );
-	self->digest.calculate( self->hash_key, result, my_digest );
-	base64encode( my_digest, my_digest64 );
+	__mbus_coder_sign( self, result->str, result->len, my_digest64 );
 
-	if ( memcmp( my_digest64->data, digest64->data, DIGEST_LEN_64 ) ) {
+	if ( memcmp( my_digest64, digest64, DIGEST_LEN_64 ) ) {
 		g_warning( "digest mis-match: %.16s vs. %.16s",
-				my_digest64->data, digest64->data );
+				my_digest64, digest64 );
 		ret = FALSE;
 	}
 
-  done:
-	g_byte_array_free( digest64, TRUE );
-	g_byte_array_free( my_digest64, TRUE );
-	g_byte_array_free( my_digest, TRUE );
-
 	return ret;
 }
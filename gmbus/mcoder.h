@@ -25,6 +25,7 @@
 #define MBUS_CODER_H
 
 #include "gmbus/mconfig.h"
+#include "gmbus/hmac.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,13 +38,33 @@ extern "C" {
 
 #define DIGEST_LEN_64 16		/* FIXME */
 #define DIGEST_LEN_BIN 12		/* FIXME */
+/** size of the buffer passed to the digest calculators */
+#define DIGEST_BUF_SIZE 16
+/** number of characters in front of the message text that are occupied by
+    the encoded digest and the following newline */
+#define DIGEST_SPACE ( DIGEST_LEN_64 + 1 )
 
 /**
-\brief API for digest calculators.
+\brief The state of a digest calculation. After it has been initialized
+    with a key it can be copied to calculate several digests with the same
+    key.
+*/
+typedef union {
+	HMAC_MD5_CTX	hmac_md5;
+} MDigestState;
+
+/**
+\brief API for digest calculators. The digest of the \a len bytes at \a
+    data is stored in \a digest, which has room for DIGEST_BUF_SIZE bytes.
+    The same calculation can be done incrementally with \a init, \a update
+    and \a finish.
 */
 typedef struct {
-	gint ( *calculate )( const GByteArray * key, const GString * buf,
-			GByteArray * digest );
+	gint ( *calculate )( const GByteArray * key, const guchar * data,
+			gsize len, guchar * digest );
+	void ( *init )( const GByteArray * key, MDigestState * state );
+	void ( *update )( MDigestState * state, const guchar * data, gsize len );
+	void ( *finish )( MDigestState * state, guchar * digest );
 } MDigestor;
 
 
@@ -73,6 +94,8 @@ typedef struct {
 	GByteArray *	hash_key;
 	/** encryption key */
 	GByteArray *	encr_key;
+	/** digest state initialized with the hash key */
+	MDigestState	key_state;
 	/** status information */
 	gboolean		ok;
 } MCoder ;
@@ -80,8 +103,16 @@ typedef struct {
 MCoder * mbus_coder_new( const MConfig * config );
 void mbus_coder_free( MCoder * me );
 gboolean mbus_coder_encode( MCoder * me, GString * buf, GByteArray * result );
+const guchar * mbus_coder_encode_in_place( MCoder * self, gchar * buf,
+		gsize * len, GByteArray * result );
 gboolean mbus_coder_decode( MCoder * me, const GByteArray * buf,
 		GString * result );
+void mbus_coder_digest_init( const MCoder * self, MDigestState * state );
+void mbus_coder_digest_update( const MCoder * self, MDigestState * state,
+		const gchar * data, gsize len );
+const guchar * mbus_coder_encode_digested( MCoder * self,
+		MDigestState * state, gchar * buf, gsize * len,
+		GByteArray * result );
 
 /**
 \brief Retrieves status information
@@ -26,16 +26,69 @@
 #include <stdio.h>
 #include <string.h>
 
+/* releases the name of the command if it is not an interned string */
 static void
-__mbus_command_init( MCommand * self, const gchar * cmd )
+__mbus_command_clear_name( MCommand * self )
+{
+	if ( !self->quark ) g_free( self->cmd );
+	self->cmd = NULL;
+	self->quark = 0;
+}
+
+/* sets the command name. If intern is TRUE the name is added to the table
+   of interned strings. Otherwise only names that are already known are
+   shared, so arbitrary names received from the network do not fill up
+   the table. */
+static void
+__mbus_command_set_name( MCommand * self, const gchar * name, gsize len,
+		gboolean intern )
 {
-	GString * tmp = g_string_new( cmd );
+	__mbus_command_clear_name( self );
+
+	if ( intern ) {
+		gchar * tmp = g_strndup( name, len );
+
+		self->quark = g_quark_from_string( tmp );
+		g_free( tmp );
+	} else
+		self->quark = mbus_quark_try_string_len( name, len );
+
+	if ( self->quark )
+		self->cmd = ( gchar * ) g_quark_to_string( self->quark );
+	else
+		self->cmd = g_strndup( name, len );
+}
+
+static void
+__mbus_command_parse( MCommand * self, MCursor * cursor, MArena * arena,
+		gboolean intern )
+{
+	/* FIXME: we cannot handle escaped newlines in strings! */
+	const gchar * name = cursor->pos;
+
+	/* each command character MUST be a valid MSymbol character */
+	while ( !mbus_cursor_at_end( cursor ) &&
+		mbus_symbol_is_valid_char( *cursor->pos ) ) cursor->pos++;
+
+	__mbus_command_set_name( self, name, cursor->pos - name, intern );
+
+	mbus_list_parse( self->arguments, cursor, arena );
+	self->ok = TRUE;
+}
 
-	self->cmd = g_string_new( NULL );
+static void
+__mbus_command_init( MCommand * self, const gchar * cmd )
+{
+	self->cmd = NULL;
+	self->quark = 0;
 	self->arguments = mbus_list_new();
-	if ( cmd ) mbus_command_read( self, tmp );
+	if ( cmd ) {
+		MCursor cursor;
 
-	g_string_free( tmp, TRUE );
+		mbus_cursor_init( &cursor, cmd, strlen( cmd ) );
+		__mbus_command_parse( self, &cursor, NULL, TRUE );
+	} else
+		__mbus_command_set_name( self, "", 0, FALSE );
 	self->ok = TRUE;
 }
 
@@ -67,7 +120,9 @@ mbus_command_new_with_name( const gchar * cmd )
 
 	g_assert( self );
 
-	self->cmd = g_string_new( cmd );
+	self->cmd = NULL;
+	self->quark = 0;
+	__mbus_command_set_name( self, cmd, strlen( cmd ), TRUE );
 	self->arguments = mbus_list_new();
 
 	self->ok = TRUE;
@@ -78,7 +133,7 @@ mbus_command_new_with_name( const gchar * cmd )
 static void
 __mbus_command_finalize( MCommand * self )
 {
-	g_string_free( self->cmd, TRUE );
+	__mbus_command_clear_name( self );
 	mbus_list_free( self->arguments );
 }
 
@@ -94,33 +149,58 @@ mbus_command_free( MCommand * self )
 }
 
 /**
-\brief Parses a string representation of an Mbus command
+\brief Parses an Mbus command at the current position of the cursor
 \param[out] self Mbus command object that will store the parsed information
-\param buf The string buffer containing the command
+\param cursor the cursor pointing to the command. It is moved behind the
+    argument list of the command. If the argument list could not be parsed
+    the cursor points to the first character that was not understood.
+\param arena if not NULL the arguments are allocated from this arena
+\return TRUE
 */
 gboolean
-mbus_command_read( MCommand * self, GString * buf )
+mbus_command_parse( MCommand * self, MCursor * cursor, MArena * arena )
 {
-	/* FIXME: we cannot handle escaped newlines in strings! */
-	gchar *	cmd = buf->str;
-	gchar         tmp;
-	gint          c;
+	__mbus_command_parse( self, cursor, arena, FALSE );
 
-	/* each command character MUST be a valid MSymbol character */
-	while ( mbus_symbol_is_valid_char( *cmd ) ) cmd++;
+	return TRUE;
+}
 
-	if ( cmd ) {
-		tmp = *cmd;
-		*cmd = '\0';
-	}
-	g_string_erase( self->cmd, 0, -1 );
-	g_string_append( self->cmd, buf->str );
-	*cmd = tmp;
-	g_string_erase( buf, 0, ( gsize ) ( cmd - buf->str ) );
+/**
+\brief Moves the cursor behind the Mbus command at its current position
+    without creating any objects. The cursor ends up at exactly the same
+    position as it would after calling mbus_command_parse.
+\param cursor the cursor pointing to the command
+\return the length of the command name
+*/
+gsize
+mbus_command_skip( MCursor * cursor )
+{
+	const gchar * name = cursor->pos;
+	gsize len;
 
-	c = mbus_list_read( self->arguments, ( const guchar * ) buf->str );
-	if ( c > 0 ) g_string_erase( buf, 0, c );
-	self->ok = TRUE;
+	while ( !mbus_cursor_at_end( cursor ) &&
+		mbus_symbol_is_valid_char( *cursor->pos ) ) cursor->pos++;
+	len = cursor->pos - name;
+
+	mbus_list_skip( cursor );
+
+	return len;
+}
+
+/**
+\brief Parses a string representation of an Mbus command
+\param[out] self Mbus command object that will store the parsed information
+\param buf The string buffer containing the command. The parsed characters
+    are removed from the buffer.
+*/
+gboolean
+mbus_command_read( MCommand * self, GString * buf )
+{
+	MCursor cursor;
+
+	mbus_cursor_init( &cursor, buf->str, buf->len );
+	mbus_command_parse( self, &cursor, NULL );
+	g_string_erase( buf, 0, ( gssize ) ( cursor.pos - buf->str ) );
 
 	return TRUE;
 }
@@ -135,13 +215,39 @@ mbus_command_read( MCommand * self, GString * buf )
 gboolean
 mbus_command_as_string( MCommand * self, GString * buf )
 {
-	g_string_append( buf, self->cmd->str );
-	mbus_list_as_string( self->arguments, buf );
-	self->ok = TRUE;
+	MWriter writer;
+
+	mbus_writer_init_append( &writer, buf, mbus_command_text_len( self ) );
+	mbus_command_write( self, &writer );
 
 	return TRUE;
 }
 
+/**
+\brief Computes the length of the string representation of an Mbus command
+\param self The Mbus command object
+\return the number of characters mbus_command_write will write
+*/
+gsize
+mbus_command_text_len( const MCommand * self )
+{
+	return strlen( self->cmd ) + mbus_object_text_len( self->arguments );
+}
+
+/**
+\brief Writes the string representation of an Mbus command
+\param self The Mbus command object
+\param writer the writer with room for at least mbus_command_text_len
+    characters
+*/
+void
+mbus_command_write( MCommand * self, MWriter * writer )
+{
+	mbus_writer_put( writer, self->cmd, strlen( self->cmd ) );
+	mbus_object_write( self->arguments, writer );
+	self->ok = TRUE;
+}
+
 /**
 \brief Copies the information of one Mbus command to another
 \param self the Mbus command to copy to
@@ -152,7 +258,9 @@ MCommand *
 mbus_command_assign( MCommand * self, const MCommand * other )
 {
 	if ( self != other ) {
-		g_string_assign( self->cmd, other->cmd->str );
+		__mbus_command_clear_name( self );
+		self->quark = other->quark;
+		self->cmd = other->quark ? other->cmd : g_strdup( other->cmd );
 
 		mbus_list_free( self->arguments );
 		self->arguments = mbus_list_copy( other->arguments );
@@ -187,5 +295,35 @@ mbus_command_copy( MCommand * self )
 gboolean
 mbus_command_is_command( const MCommand * self, const gchar * s )
 {
-	return ( strcmp( s, self->cmd->str ) == 0 );
+	return ( strcmp( s, self->cmd ) == 0 );
+}
+
+/**
+\brief Returns the interned atom of the command name. If the name was
+    unknown when the command was parsed the lookup is repeated, as the
+    name may have been interned in the meantime.
+\param self The Mbus command
+\return the atom of the command name or 0 if the name is still unknown
+*/
+GQuark
+mbus_command_get_quark( MCommand * self )
+{
+	/* the command is not changed, as commands of a referenced message may
+	   be read by several threads */
+	if ( !self->quark ) return g_quark_try_string( self->cmd );
+
+	return self->quark;
+}
+
+/**
+\brief Checks if the command name is equal to the given interned string
+\param self The Mbus Command to check for
+\param quark The interned command name to compare with
+\return TRUE if the Mbus command object has the requested command name,
+    otherwise FALSE
+*/
+gboolean
+mbus_command_is( MCommand * self, GQuark quark )
+{
+	return ( quark && mbus_command_get_quark( self ) == quark );
 }
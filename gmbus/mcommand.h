@@ -41,8 +41,11 @@ extern "C" {
 \brief Describes an Mbus command.
 */
 typedef struct {
-	/** The command name */
-	GString *	cmd;
+	/** The command name. For known command names it points to the interned
+	    string, otherwise to a copy owned by the command object */
+	gchar *		cmd;
+	/** The interned atom of the command name or 0 if the name is unknown */
+	GQuark		quark;
 	/** The arguments */
 	MObject *	arguments;
 	/** status information */
@@ -54,9 +57,16 @@ MCommand * mbus_command_new_with_name( const gchar * cmd );
 MCommand * mbus_command_assign( MCommand * self, const MCommand * other );
 MCommand * mbus_command_copy( MCommand * self );
 void mbus_command_free( MCommand * self );
+gboolean mbus_command_parse( MCommand * self, MCursor * cursor,
+		MArena * arena );
+gsize mbus_command_skip( MCursor * cursor );
 gboolean mbus_command_read( MCommand * self, GString * buf );
 gboolean mbus_command_as_string( MCommand * self, GString * buf );
+gsize mbus_command_text_len( const MCommand * self );
+void mbus_command_write( MCommand * self, MWriter * writer );
 gboolean mbus_command_is_command( const MCommand * self, const gchar * s );
+GQuark mbus_command_get_quark( MCommand * self );
+gboolean mbus_command_is( MCommand * self, GQuark quark );
 
 /**
 \brief Returns the status of the Mbus command object
@@ -56,6 +56,8 @@ mbus_config_new( gboolean read )
   config->unicast_addr = mbus_endpoint_new( AF_INET );
   mbus_endpoint_set_address4( config->unicast_addr, INADDR_ANY );
   config->group_addr = mbus_endpoint_new( AF_INET );
+  config->recv_budget = MBUS_DEFAULT_RECV_BUDGET;
+  config->recv_thread_cpu = -1;
 
   if ( read ) mbus_config_read( config );
 
@@ -166,6 +168,37 @@ mbus_config_read( MConfig * c )
 
     /* ENCRYPTION */
     c->encr_algo = M_NOENCR;
+
+    /* RECV_BUDGET */
+    if ( g_key_file_has_key( file, grp, "RECV_BUDGET", NULL ) ) {
+      gint budget = g_key_file_get_integer( file, grp, "RECV_BUDGET", NULL );
+
+      c->recv_budget = budget > 0 ? budget : MBUS_DEFAULT_RECV_BUDGET;
+    }
+
+    /* RCVBUF and SNDBUF */
+    c->rcvbuf_size = g_key_file_get_integer( file, grp, "RCVBUF", NULL );
+    c->sndbuf_size = g_key_file_get_integer( file, grp, "SNDBUF", NULL );
+
+    /* RECV_THREAD */
+    tmp = g_key_file_get_string( file, grp, "RECV_THREAD", NULL );
+    if ( tmp ) {
+      c->recv_thread = ( !strcasecmp( tmp, "true" )
+	  || !strcmp( tmp, "yes" ) || ! strcasecmp( tmp, "1" ) );
+      g_free( tmp );
+    }
+
+    /* RECV_THREAD_CPU */
+    if ( g_key_file_has_key( file, grp, "RECV_THREAD_CPU", NULL ) )
+      c->recv_thread_cpu = g_key_file_get_integer( file, grp,
+	  "RECV_THREAD_CPU", NULL );
+
+    /* RECV_WORKERS */
+    if ( g_key_file_has_key( file, grp, "RECV_WORKERS", NULL ) ) {
+      gint workers = g_key_file_get_integer( file, grp, "RECV_WORKERS", NULL );
+
+      c->recv_workers = workers > 0 ? workers : 0;
+    }
   } else {
     g_error( "filename not found\n" );
     g_free( filename );
@@ -27,6 +27,8 @@
 #include "gmbus/udp.h"
 
 #define MAX_KEY_LEN 64		/* FIXME */
+/* default number of datagrams read per socket event */
+#define MBUS_DEFAULT_RECV_BUDGET 64
 
 #ifdef __cplusplus
 extern "C" {
@@ -50,6 +52,19 @@ typedef struct {
   gboolean		send_unicast;
 
   MbusScope		scope;
+
+  /* maximum number of datagrams read per socket event */
+  guint			recv_budget;
+  /* sizes of the socket buffers in bytes (0 keeps the system default) */
+  gint			rcvbuf_size;
+  gint			sndbuf_size;
+  /* if TRUE the sockets are read by a separate thread */
+  gboolean		recv_thread;
+  /* the CPU the receive thread is bound to (-1 for any) */
+  gint			recv_thread_cpu;
+  /* number of threads verifying and parsing received messages (0 lets
+     the receive thread do it). Implies a receive thread. */
+  guint			recv_workers;
 } MConfig;
 
 MConfig * mbus_config_new( gboolean read );
@@ -0,0 +1,225 @@
+/* mcursor.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "gmbus/mcursor.h"
+
+#include <string.h>
+
+/**
+\addtogroup mcursor MCursor
+\{
+*/
+
+/**
+\brief initializes a cursor pointing to the beginning of the given buffer
+\param[out] self the cursor
+\param buf the buffer to read from. It is not modified.
+\param len the length of the buffer
+*/
+void
+mbus_cursor_init( MCursor * self, const gchar * buf, gsize len )
+{
+	self->pos = buf;
+	self->end = buf + len;
+}
+
+/**
+\brief moves the cursor behind all whitespaces (including zero bytes) at
+    the current position
+\param self the cursor
+*/
+void
+mbus_cursor_skip_whitespaces( MCursor * self )
+{
+	const gchar * pos = self->pos;
+
+	while ( pos < self->end && ( g_ascii_isspace( *pos ) || *pos == '\0' ) )
+		pos++;
+
+	self->pos = pos;
+}
+
+/**
+\brief moves the cursor behind all blanks and tabs at the current position.
+    In opposite to mbus_cursor_skip_whitespaces newlines are not skipped.
+\param self the cursor
+*/
+void
+mbus_cursor_skip_blanks( MCursor * self )
+{
+	const gchar * pos = self->pos;
+
+	while ( pos < self->end && ( *pos == ' ' || *pos == '\t' ) ) pos++;
+
+	self->pos = pos;
+}
+
+/**
+\brief moves the cursor behind the next newline character
+\param self the cursor
+\return TRUE if a newline was found, otherwise FALSE and the cursor is
+    not moved
+*/
+gboolean
+mbus_cursor_skip_line( MCursor * self )
+{
+	const gchar * pos = mbus_cursor_find_char( self, '\n' );
+
+	if ( !pos ) return FALSE;
+	self->pos = pos + 1;
+
+	return TRUE;
+}
+
+/**
+\brief searches for the character \a c starting at the current position of
+    the cursor
+\param self the cursor
+\param c the character to search for
+\return the position of the character if found, otherwise NULL
+*/
+const gchar *
+mbus_cursor_find_char( const MCursor * self, gchar c )
+{
+	if ( mbus_cursor_at_end( self ) ) return NULL;
+
+	return memchr( self->pos, c, self->end - self->pos );
+}
+
+#define M_SWAR_ONES G_GUINT64_CONSTANT( 0x0101010101010101 )
+
+/* checks if the eight characters loaded into v are all digits */
+#define __mbus_swar_is_8digits( v ) \
+	( ( ( ( v ) & ( M_SWAR_ONES * 0xF0 ) ) | \
+	    ( ( ( ( v ) + M_SWAR_ONES * 0x06 ) & ( M_SWAR_ONES * 0xF0 ) ) >> 4 ) ) \
+	  == M_SWAR_ONES * 0x33 )
+
+/* converts eight digits loaded into v (first digit in the lowest byte) into
+   their value using three multiplications */
+static guint32
+__mbus_swar_parse_8digits( guint64 v )
+{
+	const guint64 mask = G_GUINT64_CONSTANT( 0x000000FF000000FF );
+	const guint64 mul1 = 100 + ( G_GUINT64_CONSTANT( 1000000 ) << 32 );
+	const guint64 mul2 = 1 + ( G_GUINT64_CONSTANT( 10000 ) << 32 );
+
+	v -= M_SWAR_ONES * '0';
+	v = ( v * 10 ) + ( v >> 8 );
+	v = ( ( ( v & mask ) * mul1 ) + ( ( ( v >> 16 ) & mask ) * mul2 ) ) >> 32;
+
+	return ( guint32 ) v;
+}
+
+/**
+\brief reads an unsigned decimal number at the current position and moves
+    the cursor behind the last digit. Eight digits are converted at once
+    while enough characters are left in the buffer.
+\param self the cursor
+\param[out] v the number that was read
+\return TRUE if at least one digit could be read and the number fits into 64
+    bits, otherwise FALSE and the cursor is not moved
+*/
+gboolean
+mbus_cursor_read_uint64( MCursor * self, guint64 * v )
+{
+	const gchar *	pos = self->pos;
+	guint64		number = 0;
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+	while ( self->end - pos >= 8 ) {
+		guint64 chunk;
+		guint32 value;
+
+		memcpy( &chunk, pos, sizeof( chunk ) );
+		if ( !__mbus_swar_is_8digits( chunk ) ) break;
+
+		value = __mbus_swar_parse_8digits( chunk );
+		if ( number > ( G_MAXUINT64 - value ) / 100000000 ) return FALSE;
+		number = number * 100000000 + value;
+		pos += 8;
+	}
+#endif
+
+	while ( pos < self->end && g_ascii_isdigit( *pos ) ) {
+		guint digit = *pos - '0';
+
+		if ( number > ( G_MAXUINT64 - digit ) / 10 ) return FALSE;
+		number = number * 10 + digit;
+		pos++;
+	}
+
+	if ( pos == self->pos ) return FALSE;
+
+	*v = number;
+	self->pos = pos;
+
+	return TRUE;
+}
+
+/**
+\brief reads a signed decimal number at the current position and moves the
+    cursor behind the last digit
+\param self the cursor
+\param[out] v the number that was read
+\return TRUE if at least one digit could be read and the number fits into
+    a gint64, otherwise FALSE and the cursor is not moved
+*/
+gboolean
+mbus_cursor_read_int64( MCursor * self, gint64 * v )
+{
+	const gchar *	pos = self->pos;
+	gboolean	negative = FALSE;
+	guint64		number;
+
+	if ( mbus_cursor_peek( self ) == '-' ) {
+		negative = TRUE;
+		self->pos++;
+	}
+
+	if ( !mbus_cursor_read_uint64( self, &number ) ) {
+		self->pos = pos;
+		return FALSE;
+	}
+
+	if ( negative ) {
+		if ( number > ( guint64 ) G_MAXINT64 + 1 ) {
+			self->pos = pos;
+			return FALSE;
+		}
+		*v = ( gint64 ) ( 0 - number );
+	} else {
+		if ( number > G_MAXINT64 ) {
+			self->pos = pos;
+			return FALSE;
+		}
+		*v = ( gint64 ) number;
+	}
+
+	return TRUE;
+}
+
+/**
+\}
+*/
+
+/* end of mcursor.c */
@@ -0,0 +1,88 @@
+/* mcursor.h
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef MBUS_CURSOR_H
+#define MBUS_CURSOR_H
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+\addtogroup mcursor MCursor
+\{
+*/
+
+/**
+\brief A read-only position within a text buffer. All parse functions
+    of the library walk forward through the buffer using a cursor instead
+    of removing the consumed characters from the front of a GString.
+*/
+typedef struct {
+	/** the current read position */
+	const gchar *	pos;
+	/** the end of the buffer (points behind the last character) */
+	const gchar *	end;
+} MCursor;
+
+void mbus_cursor_init( MCursor * self, const gchar * buf, gsize len );
+void mbus_cursor_skip_whitespaces( MCursor * self );
+void mbus_cursor_skip_blanks( MCursor * self );
+gboolean mbus_cursor_skip_line( MCursor * self );
+const gchar * mbus_cursor_find_char( const MCursor * self, gchar c );
+gboolean mbus_cursor_read_uint64( MCursor * self, guint64 * v );
+gboolean mbus_cursor_read_int64( MCursor * self, gint64 * v );
+
+/**
+\def mbus_cursor_at_end
+\brief checks if the cursor has reached the end of the buffer
+*/
+#define mbus_cursor_at_end( self ) ( ( self )->pos >= ( self )->end )
+
+/**
+\def mbus_cursor_peek
+\brief returns the character at the current position or '\\0' if the
+    cursor has reached the end of the buffer
+*/
+#define mbus_cursor_peek( self ) \
+	( mbus_cursor_at_end( self ) ? '\0' : *( self )->pos )
+
+/**
+\def mbus_cursor_left
+\brief returns the number of characters left in the buffer
+*/
+#define mbus_cursor_left( self ) \
+	( mbus_cursor_at_end( self ) ? 0 : \
+	  ( gsize ) ( ( self )->end - ( self )->pos ) )
+
+/**
+\}
+*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBUS_CURSOR_H */
@@ -0,0 +1,1306 @@
+/* mdouble.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "gmbus/mdouble.h"
+
+#include <string.h>
+
+/**
+\addtogroup mdouble MDouble
+\{
+*/
+
+/* formatting uses the Grisu2 algorithm by Florian Loitsch ("Printing
+   Floating-Point Numbers Quickly and Accurately with Integers", 2010). It
+   always creates a text that reads back to the same number and in nearly
+   all cases the shortest one. Parsing uses the algorithm by Daniel Lemire
+   and Michael Eisel ("Number Parsing at a Gigabyte per Second", 2021)
+   and falls back to g_ascii_strtod for the rare cases it cannot decide. */
+
+#define M_DOUBLE_HIDDEN_BIT	G_GUINT64_CONSTANT( 0x0010000000000000 )
+#define M_DOUBLE_FRACTION_MASK	G_GUINT64_CONSTANT( 0x000FFFFFFFFFFFFF )
+#define M_DOUBLE_EXPONENT_MASK	G_GUINT64_CONSTANT( 0x7FF0000000000000 )
+#define M_DOUBLE_SIGN_MASK	G_GUINT64_CONSTANT( 0x8000000000000000 )
+#define M_DOUBLE_EXPONENT_BIAS	1075
+
+/* a floating point number with a 64 bit significand */
+typedef struct {
+	guint64	f;
+	gint	e;
+} MDiyFp;
+
+static guint64
+__mbus_double_bits( gdouble number )
+{
+	guint64 bits;
+
+	memcpy( &bits, &number, sizeof( bits ) );
+
+	return bits;
+}
+
+static gdouble
+__mbus_double_from_bits( guint64 bits )
+{
+	gdouble number;
+
+	memcpy( &number, &bits, sizeof( number ) );
+
+	return number;
+}
+
+/* computes the full 128 bit product of two 64 bit numbers */
+static void
+__mbus_mul64( guint64 a, guint64 b, guint64 * hi, guint64 * lo )
+{
+#ifdef __SIZEOF_INT128__
+	unsigned __int128 r = ( unsigned __int128 ) a * b;
+
+	*hi = ( guint64 ) ( r >> 64 );
+	*lo = ( guint64 ) r;
+#else
+	guint64 a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+	guint64 b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+	guint64 ll = a_lo * b_lo, lh = a_lo * b_hi;
+	guint64 hl = a_hi * b_lo, hh = a_hi * b_hi;
+	guint64 mid = ( ll >> 32 ) + ( lh & 0xFFFFFFFF ) + ( hl & 0xFFFFFFFF );
+
+	*hi = hh + ( lh >> 32 ) + ( hl >> 32 ) + ( mid >> 32 );
+	*lo = ( mid << 32 ) | ( ll & 0xFFFFFFFF );
+#endif
+}
+
+static guint
+__mbus_clz64( guint64 x )
+{
+#if defined( __GNUC__ ) && ( __GNUC__ > 3 || ( __GNUC__ == 3 && __GNUC_MINOR__ >= 4 ) )
+	return __builtin_clzll( x );
+#else
+	guint n = 0;
+
+	while ( !( x & M_DOUBLE_SIGN_MASK ) ) {
+		x <<= 1;
+		n++;
+	}
+
+	return n;
+#endif
+}
+
+static const guint64 __mbus_pow10[] = {
+	G_GUINT64_CONSTANT( 1 ),
+	G_GUINT64_CONSTANT( 10 ),
+	G_GUINT64_CONSTANT( 100 ),
+	G_GUINT64_CONSTANT( 1000 ),
+	G_GUINT64_CONSTANT( 10000 ),
+	G_GUINT64_CONSTANT( 100000 ),
+	G_GUINT64_CONSTANT( 1000000 ),
+	G_GUINT64_CONSTANT( 10000000 ),
+	G_GUINT64_CONSTANT( 100000000 ),
+	G_GUINT64_CONSTANT( 1000000000 ),
+	G_GUINT64_CONSTANT( 10000000000 ),
+	G_GUINT64_CONSTANT( 100000000000 ),
+	G_GUINT64_CONSTANT( 1000000000000 ),
+	G_GUINT64_CONSTANT( 10000000000000 ),
+	G_GUINT64_CONSTANT( 100000000000000 ),
+	G_GUINT64_CONSTANT( 1000000000000000 ),
+	G_GUINT64_CONSTANT( 10000000000000000 ),
+	G_GUINT64_CONSTANT( 100000000000000000 ),
+	G_GUINT64_CONSTANT( 1000000000000000000 ),
+	G_GUINT64_CONSTANT( 10000000000000000000 )
+};
+
+/* normalized approximations of 10^k for k = -348, -340, ..., 340 */
+static const guint64 __mbus_cached_powers_f[] = {
+	G_GUINT64_CONSTANT( 0xfa8fd5a0081c0288 ), G_GUINT64_CONSTANT( 0xbaaee17fa23ebf76 ),
+	G_GUINT64_CONSTANT( 0x8b16fb203055ac76 ), G_GUINT64_CONSTANT( 0xcf42894a5dce35ea ),
+	G_GUINT64_CONSTANT( 0x9a6bb0aa55653b2d ), G_GUINT64_CONSTANT( 0xe61acf033d1a45df ),
+	G_GUINT64_CONSTANT( 0xab70fe17c79ac6ca ), G_GUINT64_CONSTANT( 0xff77b1fcbebcdc4f ),
+	G_GUINT64_CONSTANT( 0xbe5691ef416bd60c ), G_GUINT64_CONSTANT( 0x8dd01fad907ffc3c ),
+	G_GUINT64_CONSTANT( 0xd3515c2831559a83 ), G_GUINT64_CONSTANT( 0x9d71ac8fada6c9b5 ),
+	G_GUINT64_CONSTANT( 0xea9c227723ee8bcb ), G_GUINT64_CONSTANT( 0xaecc49914078536d ),
+	G_GUINT64_CONSTANT( 0x823c12795db6ce57 ), G_GUINT64_CONSTANT( 0xc21094364dfb5637 ),
+	G_GUINT64_CONSTANT( 0x9096ea6f3848984f ), G_GUINT64_CONSTANT( 0xd77485cb25823ac7 ),
+	G_GUINT64_CONSTANT( 0xa086cfcd97bf97f4 ), G_GUINT64_CONSTANT( 0xef340a98172aace5 ),
+	G_GUINT64_CONSTANT( 0xb23867fb2a35b28e ), G_GUINT64_CONSTANT( 0x84c8d4dfd2c63f3b ),
+	G_GUINT64_CONSTANT( 0xc5dd44271ad3cdba ), G_GUINT64_CONSTANT( 0x936b9fcebb25c996 ),
+	G_GUINT64_CONSTANT( 0xdbac6c247d62a584 ), G_GUINT64_CONSTANT( 0xa3ab66580d5fdaf6 ),
+	G_GUINT64_CONSTANT( 0xf3e2f893dec3f126 ), G_GUINT64_CONSTANT( 0xb5b5ada8aaff80b8 ),
+	G_GUINT64_CONSTANT( 0x87625f056c7c4a8b ), G_GUINT64_CONSTANT( 0xc9bcff6034c13053 ),
+	G_GUINT64_CONSTANT( 0x964e858c91ba2655 ), G_GUINT64_CONSTANT( 0xdff9772470297ebd ),
+	G_GUINT64_CONSTANT( 0xa6dfbd9fb8e5b88f ), G_GUINT64_CONSTANT( 0xf8a95fcf88747d94 ),
+	G_GUINT64_CONSTANT( 0xb94470938fa89bcf ), G_GUINT64_CONSTANT( 0x8a08f0f8bf0f156b ),
+	G_GUINT64_CONSTANT( 0xcdb02555653131b6 ), G_GUINT64_CONSTANT( 0x993fe2c6d07b7fac ),
+	G_GUINT64_CONSTANT( 0xe45c10c42a2b3b06 ), G_GUINT64_CONSTANT( 0xaa242499697392d3 ),
+	G_GUINT64_CONSTANT( 0xfd87b5f28300ca0e ), G_GUINT64_CONSTANT( 0xbce5086492111aeb ),
+	G_GUINT64_CONSTANT( 0x8cbccc096f5088cc ), G_GUINT64_CONSTANT( 0xd1b71758e219652c ),
+	G_GUINT64_CONSTANT( 0x9c40000000000000 ), G_GUINT64_CONSTANT( 0xe8d4a51000000000 ),
+	G_GUINT64_CONSTANT( 0xad78ebc5ac620000 ), G_GUINT64_CONSTANT( 0x813f3978f8940984 ),
+	G_GUINT64_CONSTANT( 0xc097ce7bc90715b3 ), G_GUINT64_CONSTANT( 0x8f7e32ce7bea5c70 ),
+	G_GUINT64_CONSTANT( 0xd5d238a4abe98068 ), G_GUINT64_CONSTANT( 0x9f4f2726179a2245 ),
+	G_GUINT64_CONSTANT( 0xed63a231d4c4fb27 ), G_GUINT64_CONSTANT( 0xb0de65388cc8ada8 ),
+	G_GUINT64_CONSTANT( 0x83c7088e1aab65db ), G_GUINT64_CONSTANT( 0xc45d1df942711d9a ),
+	G_GUINT64_CONSTANT( 0x924d692ca61be758 ), G_GUINT64_CONSTANT( 0xda01ee641a708dea ),
+	G_GUINT64_CONSTANT( 0xa26da3999aef774a ), G_GUINT64_CONSTANT( 0xf209787bb47d6b85 ),
+	G_GUINT64_CONSTANT( 0xb454e4a179dd1877 ), G_GUINT64_CONSTANT( 0x865b86925b9bc5c2 ),
+	G_GUINT64_CONSTANT( 0xc83553c5c8965d3d ), G_GUINT64_CONSTANT( 0x952ab45cfa97a0b3 ),
+	G_GUINT64_CONSTANT( 0xde469fbd99a05fe3 ), G_GUINT64_CONSTANT( 0xa59bc234db398c25 ),
+	G_GUINT64_CONSTANT( 0xf6c69a72a3989f5c ), G_GUINT64_CONSTANT( 0xb7dcbf5354e9bece ),
+	G_GUINT64_CONSTANT( 0x88fcf317f22241e2 ), G_GUINT64_CONSTANT( 0xcc20ce9bd35c78a5 ),
+	G_GUINT64_CONSTANT( 0x98165af37b2153df ), G_GUINT64_CONSTANT( 0xe2a0b5dc971f303a ),
+	G_GUINT64_CONSTANT( 0xa8d9d1535ce3b396 ), G_GUINT64_CONSTANT( 0xfb9b7cd9a4a7443c ),
+	G_GUINT64_CONSTANT( 0xbb764c4ca7a44410 ), G_GUINT64_CONSTANT( 0x8bab8eefb6409c1a ),
+	G_GUINT64_CONSTANT( 0xd01fef10a657842c ), G_GUINT64_CONSTANT( 0x9b10a4e5e9913129 ),
+	G_GUINT64_CONSTANT( 0xe7109bfba19c0c9d ), G_GUINT64_CONSTANT( 0xac2820d9623bf429 ),
+	G_GUINT64_CONSTANT( 0x80444b5e7aa7cf85 ), G_GUINT64_CONSTANT( 0xbf21e44003acdd2d ),
+	G_GUINT64_CONSTANT( 0x8e679c2f5e44ff8f ), G_GUINT64_CONSTANT( 0xd433179d9c8cb841 ),
+	G_GUINT64_CONSTANT( 0x9e19db92b4e31ba9 ), G_GUINT64_CONSTANT( 0xeb96bf6ebadf77d9 ),
+	G_GUINT64_CONSTANT( 0xaf87023b9bf0ee6b ),
+};
+
+static const gint16 __mbus_cached_powers_e[] = {
+	-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+	-954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+	-688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+	-422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+	-157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+	109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+	375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+	641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+	907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static MDiyFp
+__mbus_diy_fp_mul( MDiyFp x, MDiyFp y )
+{
+	MDiyFp	r;
+	guint64	hi, lo;
+
+	__mbus_mul64( x.f, y.f, &hi, &lo );
+	/* round to nearest */
+	r.f = hi + ( lo >> 63 );
+	r.e = x.e + y.e + 64;
+
+	return r;
+}
+
+static MDiyFp
+__mbus_diy_fp_normalize( MDiyFp x )
+{
+	guint shift = __mbus_clz64( x.f );
+
+	x.f <<= shift;
+	x.e -= shift;
+
+	return x;
+}
+
+/* computes the boundaries of the interval of numbers that are rounded to
+   the given number. Both share the exponent of the normalized upper one. */
+static void
+__mbus_diy_fp_boundaries( MDiyFp v, MDiyFp * minus, MDiyFp * plus )
+{
+	MDiyFp pl, mi;
+
+	pl.f = ( v.f << 1 ) + 1;
+	pl.e = v.e - 1;
+	pl = __mbus_diy_fp_normalize( pl );
+
+	if ( v.f == M_DOUBLE_HIDDEN_BIT ) {
+		mi.f = ( v.f << 2 ) - 1;
+		mi.e = v.e - 2;
+	} else {
+		mi.f = ( v.f << 1 ) - 1;
+		mi.e = v.e - 1;
+	}
+	mi.f <<= mi.e - pl.e;
+	mi.e = pl.e;
+
+	*minus = mi;
+	*plus = pl;
+}
+
+/* returns the cached power c = 10^-k so that the exponent of c * 2^e is
+   within [-60, -32] */
+static MDiyFp
+__mbus_diy_fp_cached_power( gint e, gint * k )
+{
+	MDiyFp	c;
+	gdouble	dk = ( -61 - e ) * 0.30102999566398114 + 347;
+	gint	index = ( gint ) dk;
+
+	if ( dk - index > 0.0 ) index++;
+	index = ( index >> 3 ) + 1;
+
+	*k = -( -348 + index * 8 );
+	c.f = __mbus_cached_powers_f[ index ];
+	c.e = __mbus_cached_powers_e[ index ];
+
+	return c;
+}
+
+static void
+__mbus_grisu_round( gchar * buf, gint len, guint64 delta, guint64 rest,
+		    guint64 ten_kappa, guint64 wp_w )
+{
+	while ( rest < wp_w && delta - rest >= ten_kappa &&
+		( rest + ten_kappa < wp_w ||
+		  wp_w - rest > rest + ten_kappa - wp_w ) ) {
+		buf[ len - 1 ]--;
+		rest += ten_kappa;
+	}
+}
+
+static gint
+__mbus_count_digits( guint32 n )
+{
+	gint digits = 1;
+
+	while ( digits < 10 && n >= __mbus_pow10[ digits ] ) digits++;
+
+	return digits;
+}
+
+/* generates the shortest digits within (mp - delta, mp) */
+static gint
+__mbus_grisu_digits( MDiyFp w, MDiyFp mp, guint64 delta, gchar * buf,
+		     gint * k )
+{
+	MDiyFp	one;
+	guint64	wp_w = mp.f - w.f;
+	guint32	p1;
+	guint64	p2;
+	gint	kappa, len = 0;
+
+	one.f = G_GUINT64_CONSTANT( 1 ) << -mp.e;
+	one.e = mp.e;
+	p1 = ( guint32 ) ( mp.f >> -one.e );
+	p2 = mp.f & ( one.f - 1 );
+	kappa = __mbus_count_digits( p1 );
+
+	while ( kappa > 0 ) {
+		guint32	div = ( guint32 ) __mbus_pow10[ kappa - 1 ];
+		guint32	d = p1 / div;
+		guint64	rest;
+
+		p1 %= div;
+		if ( d || len ) buf[ len++ ] = '0' + d;
+		kappa--;
+
+		rest = ( ( guint64 ) p1 << -one.e ) + p2;
+		if ( rest <= delta ) {
+			*k += kappa;
+			__mbus_grisu_round( buf, len, delta, rest,
+					    __mbus_pow10[ kappa ] << -one.e, wp_w );
+			return len;
+		}
+	}
+
+	for ( ;; ) {
+		gchar d;
+
+		p2 *= 10;
+		delta *= 10;
+		d = ( gchar ) ( p2 >> -one.e );
+		if ( d || len ) buf[ len++ ] = '0' + d;
+		p2 &= one.f - 1;
+		kappa--;
+
+		if ( p2 < delta ) {
+			*k += kappa;
+			__mbus_grisu_round( buf, len, delta, p2, one.f,
+					    -kappa < 20 ?
+					    wp_w * __mbus_pow10[ -kappa ] : 0 );
+			return len;
+		}
+	}
+}
+
+/* creates the shortest digits of the positive number v: v = buf * 10^k */
+static gint
+__mbus_grisu2( guint64 bits, gchar * buf, gint * k )
+{
+	MDiyFp	v, w, w_m, w_p, c_mk;
+	gint	biased_e = ( gint ) ( ( bits & M_DOUBLE_EXPONENT_MASK ) >> 52 );
+
+	v.f = bits & M_DOUBLE_FRACTION_MASK;
+	if ( biased_e ) {
+		v.f += M_DOUBLE_HIDDEN_BIT;
+		v.e = biased_e - M_DOUBLE_EXPONENT_BIAS;
+	} else
+		v.e = 1 - M_DOUBLE_EXPONENT_BIAS;
+
+	__mbus_diy_fp_boundaries( v, &w_m, &w_p );
+	c_mk = __mbus_diy_fp_cached_power( w_p.e, k );
+	w = __mbus_diy_fp_mul( __mbus_diy_fp_normalize( v ), c_mk );
+	w_p = __mbus_diy_fp_mul( w_p, c_mk );
+	w_m = __mbus_diy_fp_mul( w_m, c_mk );
+	w_m.f++;
+	w_p.f--;
+
+	return __mbus_grisu_digits( w, w_p, w_p.f - w_m.f, buf, k );
+}
+
+static gchar *
+__mbus_double_put_exponent( gchar * pos, gint exponent )
+{
+	*pos++ = 'e';
+	if ( exponent < 0 ) {
+		*pos++ = '-';
+		exponent = -exponent;
+	}
+	if ( exponent >= 100 ) {
+		*pos++ = '0' + exponent / 100;
+		exponent %= 100;
+		*pos++ = '0' + exponent / 10;
+	} else if ( exponent >= 10 )
+		*pos++ = '0' + exponent / 10;
+	*pos++ = '0' + exponent % 10;
+
+	return pos;
+}
+
+/**
+\brief writes the shortest text representation of a floating point number
+    that reads back to exactly the same number. The text always contains a
+    decimal point (e.g. 1.0, 0.001 or 1.5e300), so it is recognized as a
+    floating point number by the parser. Very large and very small numbers
+    are written with an exponent.
+\param number the floating point number
+\param[out] buf a buffer of at least MBUS_DOUBLE_TEXT_SIZE bytes. The text
+    is terminated by a zero byte.
+\return the length of the text without the terminating zero byte
+*/
+gsize
+mbus_double_format( gdouble number, gchar * buf )
+{
+	guint64	bits = __mbus_double_bits( number );
+	gchar	digits[ 20 ];
+	gchar *	pos = buf;
+	gint	len, k, kk, i;
+
+	if ( bits & M_DOUBLE_SIGN_MASK ) {
+		*pos++ = '-';
+		bits &= ~M_DOUBLE_SIGN_MASK;
+	}
+
+	if ( ( bits & M_DOUBLE_EXPONENT_MASK ) == M_DOUBLE_EXPONENT_MASK ) {
+		if ( bits & M_DOUBLE_FRACTION_MASK ) {
+			pos = buf;
+			memcpy( pos, "nan", 3 );
+		} else
+			memcpy( pos, "inf", 3 );
+		pos[ 3 ] = '\0';
+		return pos - buf + 3;
+	}
+
+	if ( !bits ) {
+		memcpy( pos, "0.0", 4 );
+		return pos - buf + 3;
+	}
+
+	len = __mbus_grisu2( bits, digits, &k );
+	/* position of the decimal point relative to the first digit */
+	kk = len + k;
+
+	if ( kk > 0 && kk <= 21 ) {
+		if ( len <= kk ) {
+			/* 1234e3 -> 1234000.0 */
+			memcpy( pos, digits, len );
+			pos += len;
+			for ( i = len; i < kk; i++ ) *pos++ = '0';
+			*pos++ = '.';
+			*pos++ = '0';
+		} else {
+			/* 1234e-2 -> 12.34 */
+			memcpy( pos, digits, kk );
+			pos += kk;
+			*pos++ = '.';
+			memcpy( pos, digits + kk, len - kk );
+			pos += len - kk;
+		}
+	} else if ( kk > -6 && kk <= 0 ) {
+		/* 1234e-6 -> 0.001234 */
+		*pos++ = '0';
+		*pos++ = '.';
+		for ( i = kk; i < 0; i++ ) *pos++ = '0';
+		memcpy( pos, digits, len );
+		pos += len;
+	} else {
+		/* 1234e30 -> 1.234e33 */
+		*pos++ = digits[ 0 ];
+		*pos++ = '.';
+		if ( len > 1 ) {
+			memcpy( pos, digits + 1, len - 1 );
+			pos += len - 1;
+		} else
+			*pos++ = '0';
+		pos = __mbus_double_put_exponent( pos, kk - 1 );
+	}
+
+	*pos = '\0';
+
+	return pos - buf;
+}
+
+/* the powers of ten that are exactly representable as a double */
+static const gdouble __mbus_exact_pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define M_DOUBLE_MIN_POW5 -342
+#define M_DOUBLE_MAX_POW5 308
+
+/* 128 bit approximations of 5^q for q = -342, ..., 308, normalized to have
+   the most significant bit set. The upper 64 bits come first. */
+static const guint64 __mbus_powers_of_five[][ 2 ] = {
+	{ G_GUINT64_CONSTANT( 0xeef453d6923bd65a ), G_GUINT64_CONSTANT( 0x113faa2906a13b3f ) },
+	{ G_GUINT64_CONSTANT( 0x9558b4661b6565f8 ), G_GUINT64_CONSTANT( 0x4ac7ca59a424c507 ) },
+	{ G_GUINT64_CONSTANT( 0xbaaee17fa23ebf76 ), G_GUINT64_CONSTANT( 0x5d79bcf00d2df649 ) },
+	{ G_GUINT64_CONSTANT( 0xe95a99df8ace6f53 ), G_GUINT64_CONSTANT( 0xf4d82c2c107973dc ) },
+	{ G_GUINT64_CONSTANT( 0x91d8a02bb6c10594 ), G_GUINT64_CONSTANT( 0x79071b9b8a4be869 ) },
+	{ G_GUINT64_CONSTANT( 0xb64ec836a47146f9 ), G_GUINT64_CONSTANT( 0x9748e2826cdee284 ) },
+	{ G_GUINT64_CONSTANT( 0xe3e27a444d8d98b7 ), G_GUINT64_CONSTANT( 0xfd1b1b2308169b25 ) },
+	{ G_GUINT64_CONSTANT( 0x8e6d8c6ab0787f72 ), G_GUINT64_CONSTANT( 0xfe30f0f5e50e20f7 ) },
+	{ G_GUINT64_CONSTANT( 0xb208ef855c969f4f ), G_GUINT64_CONSTANT( 0xbdbd2d335e51a935 ) },
+	{ G_GUINT64_CONSTANT( 0xde8b2b66b3bc4723 ), G_GUINT64_CONSTANT( 0xad2c788035e61382 ) },
+	{ G_GUINT64_CONSTANT( 0x8b16fb203055ac76 ), G_GUINT64_CONSTANT( 0x4c3bcb5021afcc31 ) },
+	{ G_GUINT64_CONSTANT( 0xaddcb9e83c6b1793 ), G_GUINT64_CONSTANT( 0xdf4abe242a1bbf3d ) },
+	{ G_GUINT64_CONSTANT( 0xd953e8624b85dd78 ), G_GUINT64_CONSTANT( 0xd71d6dad34a2af0d ) },
+	{ G_GUINT64_CONSTANT( 0x87d4713d6f33aa6b ), G_GUINT64_CONSTANT( 0x8672648c40e5ad68 ) },
+	{ G_GUINT64_CONSTANT( 0xa9c98d8ccb009506 ), G_GUINT64_CONSTANT( 0x680efdaf511f18c2 ) },
+	{ G_GUINT64_CONSTANT( 0xd43bf0effdc0ba48 ), G_GUINT64_CONSTANT( 0x0212bd1b2566def2 ) },
+	{ G_GUINT64_CONSTANT( 0x84a57695fe98746d ), G_GUINT64_CONSTANT( 0x014bb630f7604b57 ) },
+	{ G_GUINT64_CONSTANT( 0xa5ced43b7e3e9188 ), G_GUINT64_CONSTANT( 0x419ea3bd35385e2d ) },
+	{ G_GUINT64_CONSTANT( 0xcf42894a5dce35ea ), G_GUINT64_CONSTANT( 0x52064cac828675b9 ) },
+	{ G_GUINT64_CONSTANT( 0x818995ce7aa0e1b2 ), G_GUINT64_CONSTANT( 0x7343efebd1940993 ) },
+	{ G_GUINT64_CONSTANT( 0xa1ebfb4219491a1f ), G_GUINT64_CONSTANT( 0x1014ebe6c5f90bf8 ) },
+	{ G_GUINT64_CONSTANT( 0xca66fa129f9b60a6 ), G_GUINT64_CONSTANT( 0xd41a26e077774ef6 ) },
+	{ G_GUINT64_CONSTANT( 0xfd00b897478238d0 ), G_GUINT64_CONSTANT( 0x8920b098955522b4 ) },
+	{ G_GUINT64_CONSTANT( 0x9e20735e8cb16382 ), G_GUINT64_CONSTANT( 0x55b46e5f5d5535b0 ) },
+	{ G_GUINT64_CONSTANT( 0xc5a890362fddbc62 ), G_GUINT64_CONSTANT( 0xeb2189f734aa831d ) },
+	{ G_GUINT64_CONSTANT( 0xf712b443bbd52b7b ), G_GUINT64_CONSTANT( 0xa5e9ec7501d523e4 ) },
+	{ G_GUINT64_CONSTANT( 0x9a6bb0aa55653b2d ), G_GUINT64_CONSTANT( 0x47b233c92125366e ) },
+	{ G_GUINT64_CONSTANT( 0xc1069cd4eabe89f8 ), G_GUINT64_CONSTANT( 0x999ec0bb696e840a ) },
+	{ G_GUINT64_CONSTANT( 0xf148440a256e2c76 ), G_GUINT64_CONSTANT( 0xc00670ea43ca250d ) },
+	{ G_GUINT64_CONSTANT( 0x96cd2a865764dbca ), G_GUINT64_CONSTANT( 0x380406926a5e5728 ) },
+	{ G_GUINT64_CONSTANT( 0xbc807527ed3e12bc ), G_GUINT64_CONSTANT( 0xc605083704f5ecf2 ) },
+	{ G_GUINT64_CONSTANT( 0xeba09271e88d976b ), G_GUINT64_CONSTANT( 0xf7864a44c633682e ) },
+	{ G_GUINT64_CONSTANT( 0x93445b8731587ea3 ), G_GUINT64_CONSTANT( 0x7ab3ee6afbe0211d ) },
+	{ G_GUINT64_CONSTANT( 0xb8157268fdae9e4c ), G_GUINT64_CONSTANT( 0x5960ea05bad82964 ) },
+	{ G_GUINT64_CONSTANT( 0xe61acf033d1a45df ), G_GUINT64_CONSTANT( 0x6fb92487298e33bd ) },
+	{ G_GUINT64_CONSTANT( 0x8fd0c16206306bab ), G_GUINT64_CONSTANT( 0xa5d3b6d479f8e056 ) },
+	{ G_GUINT64_CONSTANT( 0xb3c4f1ba87bc8696 ), G_GUINT64_CONSTANT( 0x8f48a4899877186c ) },
+	{ G_GUINT64_CONSTANT( 0xe0b62e2929aba83c ), G_GUINT64_CONSTANT( 0x331acdabfe94de87 ) },
+	{ G_GUINT64_CONSTANT( 0x8c71dcd9ba0b4925 ), G_GUINT64_CONSTANT( 0x9ff0c08b7f1d0b14 ) },
+	{ G_GUINT64_CONSTANT( 0xaf8e5410288e1b6f ), G_GUINT64_CONSTANT( 0x07ecf0ae5ee44dd9 ) },
+	{ G_GUINT64_CONSTANT( 0xdb71e91432b1a24a ), G_GUINT64_CONSTANT( 0xc9e82cd9f69d6150 ) },
+	{ G_GUINT64_CONSTANT( 0x892731ac9faf056e ), G_GUINT64_CONSTANT( 0xbe311c083a225cd2 ) },
+	{ G_GUINT64_CONSTANT( 0xab70fe17c79ac6ca ), G_GUINT64_CONSTANT( 0x6dbd630a48aaf406 ) },
+	{ G_GUINT64_CONSTANT( 0xd64d3d9db981787d ), G_GUINT64_CONSTANT( 0x092cbbccdad5b108 ) },
+	{ G_GUINT64_CONSTANT( 0x85f0468293f0eb4e ), G_GUINT64_CONSTANT( 0x25bbf56008c58ea5 ) },
+	{ G_GUINT64_CONSTANT( 0xa76c582338ed2621 ), G_GUINT64_CONSTANT( 0xaf2af2b80af6f24e ) },
+	{ G_GUINT64_CONSTANT( 0xd1476e2c07286faa ), G_GUINT64_CONSTANT( 0x1af5af660db4aee1 ) },
+	{ G_GUINT64_CONSTANT( 0x82cca4db847945ca ), G_GUINT64_CONSTANT( 0x50d98d9fc890ed4d ) },
+	{ G_GUINT64_CONSTANT( 0xa37fce126597973c ), G_GUINT64_CONSTANT( 0xe50ff107bab528a0 ) },
+	{ G_GUINT64_CONSTANT( 0xcc5fc196fefd7d0c ), G_GUINT64_CONSTANT( 0x1e53ed49a96272c8 ) },
+	{ G_GUINT64_CONSTANT( 0xff77b1fcbebcdc4f ), G_GUINT64_CONSTANT( 0x25e8e89c13bb0f7a ) },
+	{ G_GUINT64_CONSTANT( 0x9faacf3df73609b1 ), G_GUINT64_CONSTANT( 0x77b191618c54e9ac ) },
+	{ G_GUINT64_CONSTANT( 0xc795830d75038c1d ), G_GUINT64_CONSTANT( 0xd59df5b9ef6a2417 ) },
+	{ G_GUINT64_CONSTANT( 0xf97ae3d0d2446f25 ), G_GUINT64_CONSTANT( 0x4b0573286b44ad1d ) },
+	{ G_GUINT64_CONSTANT( 0x9becce62836ac577 ), G_GUINT64_CONSTANT( 0x4ee367f9430aec32 ) },
+	{ G_GUINT64_CONSTANT( 0xc2e801fb244576d5 ), G_GUINT64_CONSTANT( 0x229c41f793cda73f ) },
+	{ G_GUINT64_CONSTANT( 0xf3a20279ed56d48a ), G_GUINT64_CONSTANT( 0x6b43527578c1110f ) },
+	{ G_GUINT64_CONSTANT( 0x9845418c345644d6 ), G_GUINT64_CONSTANT( 0x830a13896b78aaa9 ) },
+	{ G_GUINT64_CONSTANT( 0xbe5691ef416bd60c ), G_GUINT64_CONSTANT( 0x23cc986bc656d553 ) },
+	{ G_GUINT64_CONSTANT( 0xedec366b11c6cb8f ), G_GUINT64_CONSTANT( 0x2cbfbe86b7ec8aa8 ) },
+	{ G_GUINT64_CONSTANT( 0x94b3a202eb1c3f39 ), G_GUINT64_CONSTANT( 0x7bf7d71432f3d6a9 ) },
+	{ G_GUINT64_CONSTANT( 0xb9e08a83a5e34f07 ), G_GUINT64_CONSTANT( 0xdaf5ccd93fb0cc53 ) },
+	{ G_GUINT64_CONSTANT( 0xe858ad248f5c22c9 ), G_GUINT64_CONSTANT( 0xd1b3400f8f9cff68 ) },
+	{ G_GUINT64_CONSTANT( 0x91376c36d99995be ), G_GUINT64_CONSTANT( 0x23100809b9c21fa1 ) },
+	{ G_GUINT64_CONSTANT( 0xb58547448ffffb2d ), G_GUINT64_CONSTANT( 0xabd40a0c2832a78a ) },
+	{ G_GUINT64_CONSTANT( 0xe2e69915b3fff9f9 ), G_GUINT64_CONSTANT( 0x16c90c8f323f516c ) },
+	{ G_GUINT64_CONSTANT( 0x8dd01fad907ffc3b ), G_GUINT64_CONSTANT( 0xae3da7d97f6792e3 ) },
+	{ G_GUINT64_CONSTANT( 0xb1442798f49ffb4a ), G_GUINT64_CONSTANT( 0x99cd11cfdf41779c ) },
+	{ G_GUINT64_CONSTANT( 0xdd95317f31c7fa1d ), G_GUINT64_CONSTANT( 0x40405643d711d583 ) },
+	{ G_GUINT64_CONSTANT( 0x8a7d3eef7f1cfc52 ), G_GUINT64_CONSTANT( 0x482835ea666b2572 ) },
+	{ G_GUINT64_CONSTANT( 0xad1c8eab5ee43b66 ), G_GUINT64_CONSTANT( 0xda3243650005eecf ) },
+	{ G_GUINT64_CONSTANT( 0xd863b256369d4a40 ), G_GUINT64_CONSTANT( 0x90bed43e40076a82 ) },
+	{ G_GUINT64_CONSTANT( 0x873e4f75e2224e68 ), G_GUINT64_CONSTANT( 0x5a7744a6e804a291 ) },
+	{ G_GUINT64_CONSTANT( 0xa90de3535aaae202 ), G_GUINT64_CONSTANT( 0x711515d0a205cb36 ) },
+	{ G_GUINT64_CONSTANT( 0xd3515c2831559a83 ), G_GUINT64_CONSTANT( 0x0d5a5b44ca873e03 ) },
+	{ G_GUINT64_CONSTANT( 0x8412d9991ed58091 ), G_GUINT64_CONSTANT( 0xe858790afe9486c2 ) },
+	{ G_GUINT64_CONSTANT( 0xa5178fff668ae0b6 ), G_GUINT64_CONSTANT( 0x626e974dbe39a872 ) },
+	{ G_GUINT64_CONSTANT( 0xce5d73ff402d98e3 ), G_GUINT64_CONSTANT( 0xfb0a3d212dc8128f ) },
+	{ G_GUINT64_CONSTANT( 0x80fa687f881c7f8e ), G_GUINT64_CONSTANT( 0x7ce66634bc9d0b99 ) },
+	{ G_GUINT64_CONSTANT( 0xa139029f6a239f72 ), G_GUINT64_CONSTANT( 0x1c1fffc1ebc44e80 ) },
+	{ G_GUINT64_CONSTANT( 0xc987434744ac874e ), G_GUINT64_CONSTANT( 0xa327ffb266b56220 ) },
+	{ G_GUINT64_CONSTANT( 0xfbe9141915d7a922 ), G_GUINT64_CONSTANT( 0x4bf1ff9f0062baa8 ) },
+	{ G_GUINT64_CONSTANT( 0x9d71ac8fada6c9b5 ), G_GUINT64_CONSTANT( 0x6f773fc3603db4a9 ) },
+	{ G_GUINT64_CONSTANT( 0xc4ce17b399107c22 ), G_GUINT64_CONSTANT( 0xcb550fb4384d21d3 ) },
+	{ G_GUINT64_CONSTANT( 0xf6019da07f549b2b ), G_GUINT64_CONSTANT( 0x7e2a53a146606a48 ) },
+	{ G_GUINT64_CONSTANT( 0x99c102844f94e0fb ), G_GUINT64_CONSTANT( 0x2eda7444cbfc426d ) },
+	{ G_GUINT64_CONSTANT( 0xc0314325637a1939 ), G_GUINT64_CONSTANT( 0xfa911155fefb5308 ) },
+	{ G_GUINT64_CONSTANT( 0xf03d93eebc589f88 ), G_GUINT64_CONSTANT( 0x793555ab7eba27ca ) },
+	{ G_GUINT64_CONSTANT( 0x96267c7535b763b5 ), G_GUINT64_CONSTANT( 0x4bc1558b2f3458de ) },
+	{ G_GUINT64_CONSTANT( 0xbbb01b9283253ca2 ), G_GUINT64_CONSTANT( 0x9eb1aaedfb016f16 ) },
+	{ G_GUINT64_CONSTANT( 0xea9c227723ee8bcb ), G_GUINT64_CONSTANT( 0x465e15a979c1cadc ) },
+	{ G_GUINT64_CONSTANT( 0x92a1958a7675175f ), G_GUINT64_CONSTANT( 0x0bfacd89ec191ec9 ) },
+	{ G_GUINT64_CONSTANT( 0xb749faed14125d36 ), G_GUINT64_CONSTANT( 0xcef980ec671f667b ) },
+	{ G_GUINT64_CONSTANT( 0xe51c79a85916f484 ), G_GUINT64_CONSTANT( 0x82b7e12780e7401a ) },
+	{ G_GUINT64_CONSTANT( 0x8f31cc0937ae58d2 ), G_GUINT64_CONSTANT( 0xd1b2ecb8b0908810 ) },
+	{ G_GUINT64_CONSTANT( 0xb2fe3f0b8599ef07 ), G_GUINT64_CONSTANT( 0x861fa7e6dcb4aa15 ) },
+	{ G_GUINT64_CONSTANT( 0xdfbdcece67006ac9 ), G_GUINT64_CONSTANT( 0x67a791e093e1d49a ) },
+	{ G_GUINT64_CONSTANT( 0x8bd6a141006042bd ), G_GUINT64_CONSTANT( 0xe0c8bb2c5c6d24e0 ) },
+	{ G_GUINT64_CONSTANT( 0xaecc49914078536d ), G_GUINT64_CONSTANT( 0x58fae9f773886e18 ) },
+	{ G_GUINT64_CONSTANT( 0xda7f5bf590966848 ), G_GUINT64_CONSTANT( 0xaf39a475506a899e ) },
+	{ G_GUINT64_CONSTANT( 0x888f99797a5e012d ), G_GUINT64_CONSTANT( 0x6d8406c952429603 ) },
+	{ G_GUINT64_CONSTANT( 0xaab37fd7d8f58178 ), G_GUINT64_CONSTANT( 0xc8e5087ba6d33b83 ) },
+	{ G_GUINT64_CONSTANT( 0xd5605fcdcf32e1d6 ), G_GUINT64_CONSTANT( 0xfb1e4a9a90880a64 ) },
+	{ G_GUINT64_CONSTANT( 0x855c3be0a17fcd26 ), G_GUINT64_CONSTANT( 0x5cf2eea09a55067f ) },
+	{ G_GUINT64_CONSTANT( 0xa6b34ad8c9dfc06f ), G_GUINT64_CONSTANT( 0xf42faa48c0ea481e ) },
+	{ G_GUINT64_CONSTANT( 0xd0601d8efc57b08b ), G_GUINT64_CONSTANT( 0xf13b94daf124da26 ) },
+	{ G_GUINT64_CONSTANT( 0x823c12795db6ce57 ), G_GUINT64_CONSTANT( 0x76c53d08d6b70858 ) },
+	{ G_GUINT64_CONSTANT( 0xa2cb1717b52481ed ), G_GUINT64_CONSTANT( 0x54768c4b0c64ca6e ) },
+	{ G_GUINT64_CONSTANT( 0xcb7ddcdda26da268 ), G_GUINT64_CONSTANT( 0xa9942f5dcf7dfd09 ) },
+	{ G_GUINT64_CONSTANT( 0xfe5d54150b090b02 ), G_GUINT64_CONSTANT( 0xd3f93b35435d7c4c ) },
+	{ G_GUINT64_CONSTANT( 0x9efa548d26e5a6e1 ), G_GUINT64_CONSTANT( 0xc47bc5014a1a6daf ) },
+	{ G_GUINT64_CONSTANT( 0xc6b8e9b0709f109a ), G_GUINT64_CONSTANT( 0x359ab6419ca1091b ) },
+	{ G_GUINT64_CONSTANT( 0xf867241c8cc6d4c0 ), G_GUINT64_CONSTANT( 0xc30163d203c94b62 ) },
+	{ G_GUINT64_CONSTANT( 0x9b407691d7fc44f8 ), G_GUINT64_CONSTANT( 0x79e0de63425dcf1d ) },
+	{ G_GUINT64_CONSTANT( 0xc21094364dfb5636 ), G_GUINT64_CONSTANT( 0x985915fc12f542e4 ) },
+	{ G_GUINT64_CONSTANT( 0xf294b943e17a2bc4 ), G_GUINT64_CONSTANT( 0x3e6f5b7b17b2939d ) },
+	{ G_GUINT64_CONSTANT( 0x979cf3ca6cec5b5a ), G_GUINT64_CONSTANT( 0xa705992ceecf9c42 ) },
+	{ G_GUINT64_CONSTANT( 0xbd8430bd08277231 ), G_GUINT64_CONSTANT( 0x50c6ff782a838353 ) },
+	{ G_GUINT64_CONSTANT( 0xece53cec4a314ebd ), G_GUINT64_CONSTANT( 0xa4f8bf5635246428 ) },
+	{ G_GUINT64_CONSTANT( 0x940f4613ae5ed136 ), G_GUINT64_CONSTANT( 0x871b7795e136be99 ) },
+	{ G_GUINT64_CONSTANT( 0xb913179899f68584 ), G_GUINT64_CONSTANT( 0x28e2557b59846e3f ) },
+	{ G_GUINT64_CONSTANT( 0xe757dd7ec07426e5 ), G_GUINT64_CONSTANT( 0x331aeada2fe589cf ) },
+	{ G_GUINT64_CONSTANT( 0x9096ea6f3848984f ), G_GUINT64_CONSTANT( 0x3ff0d2c85def7621 ) },
+	{ G_GUINT64_CONSTANT( 0xb4bca50b065abe63 ), G_GUINT64_CONSTANT( 0x0fed077a756b53a9 ) },
+	{ G_GUINT64_CONSTANT( 0xe1ebce4dc7f16dfb ), G_GUINT64_CONSTANT( 0xd3e8495912c62894 ) },
+	{ G_GUINT64_CONSTANT( 0x8d3360f09cf6e4bd ), G_GUINT64_CONSTANT( 0x64712dd7abbbd95c ) },
+	{ G_GUINT64_CONSTANT( 0xb080392cc4349dec ), G_GUINT64_CONSTANT( 0xbd8d794d96aacfb3 ) },
+	{ G_GUINT64_CONSTANT( 0xdca04777f541c567 ), G_GUINT64_CONSTANT( 0xecf0d7a0fc5583a0 ) },
+	{ G_GUINT64_CONSTANT( 0x89e42caaf9491b60 ), G_GUINT64_CONSTANT( 0xf41686c49db57244 ) },
+	{ G_GUINT64_CONSTANT( 0xac5d37d5b79b6239 ), G_GUINT64_CONSTANT( 0x311c2875c522ced5 ) },
+	{ G_GUINT64_CONSTANT( 0xd77485cb25823ac7 ), G_GUINT64_CONSTANT( 0x7d633293366b828b ) },
+	{ G_GUINT64_CONSTANT( 0x86a8d39ef77164bc ), G_GUINT64_CONSTANT( 0xae5dff9c02033197 ) },
+	{ G_GUINT64_CONSTANT( 0xa8530886b54dbdeb ), G_GUINT64_CONSTANT( 0xd9f57f830283fdfc ) },
+	{ G_GUINT64_CONSTANT( 0xd267caa862a12d66 ), G_GUINT64_CONSTANT( 0xd072df63c324fd7b ) },
+	{ G_GUINT64_CONSTANT( 0x8380dea93da4bc60 ), G_GUINT64_CONSTANT( 0x4247cb9e59f71e6d ) },
+	{ G_GUINT64_CONSTANT( 0xa46116538d0deb78 ), G_GUINT64_CONSTANT( 0x52d9be85f074e608 ) },
+	{ G_GUINT64_CONSTANT( 0xcd795be870516656 ), G_GUINT64_CONSTANT( 0x67902e276c921f8b ) },
+	{ G_GUINT64_CONSTANT( 0x806bd9714632dff6 ), G_GUINT64_CONSTANT( 0x00ba1cd8a3db53b6 ) },
+	{ G_GUINT64_CONSTANT( 0xa086cfcd97bf97f3 ), G_GUINT64_CONSTANT( 0x80e8a40eccd228a4 ) },
+	{ G_GUINT64_CONSTANT( 0xc8a883c0fdaf7df0 ), G_GUINT64_CONSTANT( 0x6122cd128006b2cd ) },
+	{ G_GUINT64_CONSTANT( 0xfad2a4b13d1b5d6c ), G_GUINT64_CONSTANT( 0x796b805720085f81 ) },
+	{ G_GUINT64_CONSTANT( 0x9cc3a6eec6311a63 ), G_GUINT64_CONSTANT( 0xcbe3303674053bb0 ) },
+	{ G_GUINT64_CONSTANT( 0xc3f490aa77bd60fc ), G_GUINT64_CONSTANT( 0xbedbfc4411068a9c ) },
+	{ G_GUINT64_CONSTANT( 0xf4f1b4d515acb93b ), G_GUINT64_CONSTANT( 0xee92fb5515482d44 ) },
+	{ G_GUINT64_CONSTANT( 0x991711052d8bf3c5 ), G_GUINT64_CONSTANT( 0x751bdd152d4d1c4a ) },
+	{ G_GUINT64_CONSTANT( 0xbf5cd54678eef0b6 ), G_GUINT64_CONSTANT( 0xd262d45a78a0635d ) },
+	{ G_GUINT64_CONSTANT( 0xef340a98172aace4 ), G_GUINT64_CONSTANT( 0x86fb897116c87c34 ) },
+	{ G_GUINT64_CONSTANT( 0x9580869f0e7aac0e ), G_GUINT64_CONSTANT( 0xd45d35e6ae3d4da0 ) },
+	{ G_GUINT64_CONSTANT( 0xbae0a846d2195712 ), G_GUINT64_CONSTANT( 0x8974836059cca109 ) },
+	{ G_GUINT64_CONSTANT( 0xe998d258869facd7 ), G_GUINT64_CONSTANT( 0x2bd1a438703fc94b ) },
+	{ G_GUINT64_CONSTANT( 0x91ff83775423cc06 ), G_GUINT64_CONSTANT( 0x7b6306a34627ddcf ) },
+	{ G_GUINT64_CONSTANT( 0xb67f6455292cbf08 ), G_GUINT64_CONSTANT( 0x1a3bc84c17b1d542 ) },
+	{ G_GUINT64_CONSTANT( 0xe41f3d6a7377eeca ), G_GUINT64_CONSTANT( 0x20caba5f1d9e4a93 ) },
+	{ G_GUINT64_CONSTANT( 0x8e938662882af53e ), G_GUINT64_CONSTANT( 0x547eb47b7282ee9c ) },
+	{ G_GUINT64_CONSTANT( 0xb23867fb2a35b28d ), G_GUINT64_CONSTANT( 0xe99e619a4f23aa43 ) },
+	{ G_GUINT64_CONSTANT( 0xdec681f9f4c31f31 ), G_GUINT64_CONSTANT( 0x6405fa00e2ec94d4 ) },
+	{ G_GUINT64_CONSTANT( 0x8b3c113c38f9f37e ), G_GUINT64_CONSTANT( 0xde83bc408dd3dd04 ) },
+	{ G_GUINT64_CONSTANT( 0xae0b158b4738705e ), G_GUINT64_CONSTANT( 0x9624ab50b148d445 ) },
+	{ G_GUINT64_CONSTANT( 0xd98ddaee19068c76 ), G_GUINT64_CONSTANT( 0x3badd624dd9b0957 ) },
+	{ G_GUINT64_CONSTANT( 0x87f8a8d4cfa417c9 ), G_GUINT64_CONSTANT( 0xe54ca5d70a80e5d6 ) },
+	{ G_GUINT64_CONSTANT( 0xa9f6d30a038d1dbc ), G_GUINT64_CONSTANT( 0x5e9fcf4ccd211f4c ) },
+	{ G_GUINT64_CONSTANT( 0xd47487cc8470652b ), G_GUINT64_CONSTANT( 0x7647c3200069671f ) },
+	{ G_GUINT64_CONSTANT( 0x84c8d4dfd2c63f3b ), G_GUINT64_CONSTANT( 0x29ecd9f40041e073 ) },
+	{ G_GUINT64_CONSTANT( 0xa5fb0a17c777cf09 ), G_GUINT64_CONSTANT( 0xf468107100525890 ) },
+	{ G_GUINT64_CONSTANT( 0xcf79cc9db955c2cc ), G_GUINT64_CONSTANT( 0x7182148d4066eeb4 ) },
+	{ G_GUINT64_CONSTANT( 0x81ac1fe293d599bf ), G_GUINT64_CONSTANT( 0xc6f14cd848405530 ) },
+	{ G_GUINT64_CONSTANT( 0xa21727db38cb002f ), G_GUINT64_CONSTANT( 0xb8ada00e5a506a7c ) },
+	{ G_GUINT64_CONSTANT( 0xca9cf1d206fdc03b ), G_GUINT64_CONSTANT( 0xa6d90811f0e4851c ) },
+	{ G_GUINT64_CONSTANT( 0xfd442e4688bd304a ), G_GUINT64_CONSTANT( 0x908f4a166d1da663 ) },
+	{ G_GUINT64_CONSTANT( 0x9e4a9cec15763e2e ), G_GUINT64_CONSTANT( 0x9a598e4e043287fe ) },
+	{ G_GUINT64_CONSTANT( 0xc5dd44271ad3cdba ), G_GUINT64_CONSTANT( 0x40eff1e1853f29fd ) },
+	{ G_GUINT64_CONSTANT( 0xf7549530e188c128 ), G_GUINT64_CONSTANT( 0xd12bee59e68ef47c ) },
+	{ G_GUINT64_CONSTANT( 0x9a94dd3e8cf578b9 ), G_GUINT64_CONSTANT( 0x82bb74f8301958ce ) },
+	{ G_GUINT64_CONSTANT( 0xc13a148e3032d6e7 ), G_GUINT64_CONSTANT( 0xe36a52363c1faf01 ) },
+	{ G_GUINT64_CONSTANT( 0xf18899b1bc3f8ca1 ), G_GUINT64_CONSTANT( 0xdc44e6c3cb279ac1 ) },
+	{ G_GUINT64_CONSTANT( 0x96f5600f15a7b7e5 ), G_GUINT64_CONSTANT( 0x29ab103a5ef8c0b9 ) },
+	{ G_GUINT64_CONSTANT( 0xbcb2b812db11a5de ), G_GUINT64_CONSTANT( 0x7415d448f6b6f0e7 ) },
+	{ G_GUINT64_CONSTANT( 0xebdf661791d60f56 ), G_GUINT64_CONSTANT( 0x111b495b3464ad21 ) },
+	{ G_GUINT64_CONSTANT( 0x936b9fcebb25c995 ), G_GUINT64_CONSTANT( 0xcab10dd900beec34 ) },
+	{ G_GUINT64_CONSTANT( 0xb84687c269ef3bfb ), G_GUINT64_CONSTANT( 0x3d5d514f40eea742 ) },
+	{ G_GUINT64_CONSTANT( 0xe65829b3046b0afa ), G_GUINT64_CONSTANT( 0x0cb4a5a3112a5112 ) },
+	{ G_GUINT64_CONSTANT( 0x8ff71a0fe2c2e6dc ), G_GUINT64_CONSTANT( 0x47f0e785eaba72ab ) },
+	{ G_GUINT64_CONSTANT( 0xb3f4e093db73a093 ), G_GUINT64_CONSTANT( 0x59ed216765690f56 ) },
+	{ G_GUINT64_CONSTANT( 0xe0f218b8d25088b8 ), G_GUINT64_CONSTANT( 0x306869c13ec3532c ) },
+	{ G_GUINT64_CONSTANT( 0x8c974f7383725573 ), G_GUINT64_CONSTANT( 0x1e414218c73a13fb ) },
+	{ G_GUINT64_CONSTANT( 0xafbd2350644eeacf ), G_GUINT64_CONSTANT( 0xe5d1929ef90898fa ) },
+	{ G_GUINT64_CONSTANT( 0xdbac6c247d62a583 ), G_GUINT64_CONSTANT( 0xdf45f746b74abf39 ) },
+	{ G_GUINT64_CONSTANT( 0x894bc396ce5da772 ), G_GUINT64_CONSTANT( 0x6b8bba8c328eb783 ) },
+	{ G_GUINT64_CONSTANT( 0xab9eb47c81f5114f ), G_GUINT64_CONSTANT( 0x066ea92f3f326564 ) },
+	{ G_GUINT64_CONSTANT( 0xd686619ba27255a2 ), G_GUINT64_CONSTANT( 0xc80a537b0efefebd ) },
+	{ G_GUINT64_CONSTANT( 0x8613fd0145877585 ), G_GUINT64_CONSTANT( 0xbd06742ce95f5f36 ) },
+	{ G_GUINT64_CONSTANT( 0xa798fc4196e952e7 ), G_GUINT64_CONSTANT( 0x2c48113823b73704 ) },
+	{ G_GUINT64_CONSTANT( 0xd17f3b51fca3a7a0 ), G_GUINT64_CONSTANT( 0xf75a15862ca504c5 ) },
+	{ G_GUINT64_CONSTANT( 0x82ef85133de648c4 ), G_GUINT64_CONSTANT( 0x9a984d73dbe722fb ) },
+	{ G_GUINT64_CONSTANT( 0xa3ab66580d5fdaf5 ), G_GUINT64_CONSTANT( 0xc13e60d0d2e0ebba ) },
+	{ G_GUINT64_CONSTANT( 0xcc963fee10b7d1b3 ), G_GUINT64_CONSTANT( 0x318df905079926a8 ) },
+	{ G_GUINT64_CONSTANT( 0xffbbcfe994e5c61f ), G_GUINT64_CONSTANT( 0xfdf17746497f7052 ) },
+	{ G_GUINT64_CONSTANT( 0x9fd561f1fd0f9bd3 ), G_GUINT64_CONSTANT( 0xfeb6ea8bedefa633 ) },
+	{ G_GUINT64_CONSTANT( 0xc7caba6e7c5382c8 ), G_GUINT64_CONSTANT( 0xfe64a52ee96b8fc0 ) },
+	{ G_GUINT64_CONSTANT( 0xf9bd690a1b68637b ), G_GUINT64_CONSTANT( 0x3dfdce7aa3c673b0 ) },
+	{ G_GUINT64_CONSTANT( 0x9c1661a651213e2d ), G_GUINT64_CONSTANT( 0x06bea10ca65c084e ) },
+	{ G_GUINT64_CONSTANT( 0xc31bfa0fe5698db8 ), G_GUINT64_CONSTANT( 0x486e494fcff30a62 ) },
+	{ G_GUINT64_CONSTANT( 0xf3e2f893dec3f126 ), G_GUINT64_CONSTANT( 0x5a89dba3c3efccfa ) },
+	{ G_GUINT64_CONSTANT( 0x986ddb5c6b3a76b7 ), G_GUINT64_CONSTANT( 0xf89629465a75e01c ) },
+	{ G_GUINT64_CONSTANT( 0xbe89523386091465 ), G_GUINT64_CONSTANT( 0xf6bbb397f1135823 ) },
+	{ G_GUINT64_CONSTANT( 0xee2ba6c0678b597f ), G_GUINT64_CONSTANT( 0x746aa07ded582e2c ) },
+	{ G_GUINT64_CONSTANT( 0x94db483840b717ef ), G_GUINT64_CONSTANT( 0xa8c2a44eb4571cdc ) },
+	{ G_GUINT64_CONSTANT( 0xba121a4650e4ddeb ), G_GUINT64_CONSTANT( 0x92f34d62616ce413 ) },
+	{ G_GUINT64_CONSTANT( 0xe896a0d7e51e1566 ), G_GUINT64_CONSTANT( 0x77b020baf9c81d17 ) },
+	{ G_GUINT64_CONSTANT( 0x915e2486ef32cd60 ), G_GUINT64_CONSTANT( 0x0ace1474dc1d122e ) },
+	{ G_GUINT64_CONSTANT( 0xb5b5ada8aaff80b8 ), G_GUINT64_CONSTANT( 0x0d819992132456ba ) },
+	{ G_GUINT64_CONSTANT( 0xe3231912d5bf60e6 ), G_GUINT64_CONSTANT( 0x10e1fff697ed6c69 ) },
+	{ G_GUINT64_CONSTANT( 0x8df5efabc5979c8f ), G_GUINT64_CONSTANT( 0xca8d3ffa1ef463c1 ) },
+	{ G_GUINT64_CONSTANT( 0xb1736b96b6fd83b3 ), G_GUINT64_CONSTANT( 0xbd308ff8a6b17cb2 ) },
+	{ G_GUINT64_CONSTANT( 0xddd0467c64bce4a0 ), G_GUINT64_CONSTANT( 0xac7cb3f6d05ddbde ) },
+	{ G_GUINT64_CONSTANT( 0x8aa22c0dbef60ee4 ), G_GUINT64_CONSTANT( 0x6bcdf07a423aa96b ) },
+	{ G_GUINT64_CONSTANT( 0xad4ab7112eb3929d ), G_GUINT64_CONSTANT( 0x86c16c98d2c953c6 ) },
+	{ G_GUINT64_CONSTANT( 0xd89d64d57a607744 ), G_GUINT64_CONSTANT( 0xe871c7bf077ba8b7 ) },
+	{ G_GUINT64_CONSTANT( 0x87625f056c7c4a8b ), G_GUINT64_CONSTANT( 0x11471cd764ad4972 ) },
+	{ G_GUINT64_CONSTANT( 0xa93af6c6c79b5d2d ), G_GUINT64_CONSTANT( 0xd598e40d3dd89bcf ) },
+	{ G_GUINT64_CONSTANT( 0xd389b47879823479 ), G_GUINT64_CONSTANT( 0x4aff1d108d4ec2c3 ) },
+	{ G_GUINT64_CONSTANT( 0x843610cb4bf160cb ), G_GUINT64_CONSTANT( 0xcedf722a585139ba ) },
+	{ G_GUINT64_CONSTANT( 0xa54394fe1eedb8fe ), G_GUINT64_CONSTANT( 0xc2974eb4ee658828 ) },
+	{ G_GUINT64_CONSTANT( 0xce947a3da6a9273e ), G_GUINT64_CONSTANT( 0x733d226229feea32 ) },
+	{ G_GUINT64_CONSTANT( 0x811ccc668829b887 ), G_GUINT64_CONSTANT( 0x0806357d5a3f525f ) },
+	{ G_GUINT64_CONSTANT( 0xa163ff802a3426a8 ), G_GUINT64_CONSTANT( 0xca07c2dcb0cf26f7 ) },
+	{ G_GUINT64_CONSTANT( 0xc9bcff6034c13052 ), G_GUINT64_CONSTANT( 0xfc89b393dd02f0b5 ) },
+	{ G_GUINT64_CONSTANT( 0xfc2c3f3841f17c67 ), G_GUINT64_CONSTANT( 0xbbac2078d443ace2 ) },
+	{ G_GUINT64_CONSTANT( 0x9d9ba7832936edc0 ), G_GUINT64_CONSTANT( 0xd54b944b84aa4c0d ) },
+	{ G_GUINT64_CONSTANT( 0xc5029163f384a931 ), G_GUINT64_CONSTANT( 0x0a9e795e65d4df11 ) },
+	{ G_GUINT64_CONSTANT( 0xf64335bcf065d37d ), G_GUINT64_CONSTANT( 0x4d4617b5ff4a16d5 ) },
+	{ G_GUINT64_CONSTANT( 0x99ea0196163fa42e ), G_GUINT64_CONSTANT( 0x504bced1bf8e4e45 ) },
+	{ G_GUINT64_CONSTANT( 0xc06481fb9bcf8d39 ), G_GUINT64_CONSTANT( 0xe45ec2862f71e1d6 ) },
+	{ G_GUINT64_CONSTANT( 0xf07da27a82c37088 ), G_GUINT64_CONSTANT( 0x5d767327bb4e5a4c ) },
+	{ G_GUINT64_CONSTANT( 0x964e858c91ba2655 ), G_GUINT64_CONSTANT( 0x3a6a07f8d510f86f ) },
+	{ G_GUINT64_CONSTANT( 0xbbe226efb628afea ), G_GUINT64_CONSTANT( 0x890489f70a55368b ) },
+	{ G_GUINT64_CONSTANT( 0xeadab0aba3b2dbe5 ), G_GUINT64_CONSTANT( 0x2b45ac74ccea842e ) },
+	{ G_GUINT64_CONSTANT( 0x92c8ae6b464fc96f ), G_GUINT64_CONSTANT( 0x3b0b8bc90012929d ) },
+	{ G_GUINT64_CONSTANT( 0xb77ada0617e3bbcb ), G_GUINT64_CONSTANT( 0x09ce6ebb40173744 ) },
+	{ G_GUINT64_CONSTANT( 0xe55990879ddcaabd ), G_GUINT64_CONSTANT( 0xcc420a6a101d0515 ) },
+	{ G_GUINT64_CONSTANT( 0x8f57fa54c2a9eab6 ), G_GUINT64_CONSTANT( 0x9fa946824a12232d ) },
+	{ G_GUINT64_CONSTANT( 0xb32df8e9f3546564 ), G_GUINT64_CONSTANT( 0x47939822dc96abf9 ) },
+	{ G_GUINT64_CONSTANT( 0xdff9772470297ebd ), G_GUINT64_CONSTANT( 0x59787e2b93bc56f7 ) },
+	{ G_GUINT64_CONSTANT( 0x8bfbea76c619ef36 ), G_GUINT64_CONSTANT( 0x57eb4edb3c55b65a ) },
+	{ G_GUINT64_CONSTANT( 0xaefae51477a06b03 ), G_GUINT64_CONSTANT( 0xede622920b6b23f1 ) },
+	{ G_GUINT64_CONSTANT( 0xdab99e59958885c4 ), G_GUINT64_CONSTANT( 0xe95fab368e45eced ) },
+	{ G_GUINT64_CONSTANT( 0x88b402f7fd75539b ), G_GUINT64_CONSTANT( 0x11dbcb0218ebb414 ) },
+	{ G_GUINT64_CONSTANT( 0xaae103b5fcd2a881 ), G_GUINT64_CONSTANT( 0xd652bdc29f26a119 ) },
+	{ G_GUINT64_CONSTANT( 0xd59944a37c0752a2 ), G_GUINT64_CONSTANT( 0x4be76d3346f0495f ) },
+	{ G_GUINT64_CONSTANT( 0x857fcae62d8493a5 ), G_GUINT64_CONSTANT( 0x6f70a4400c562ddb ) },
+	{ G_GUINT64_CONSTANT( 0xa6dfbd9fb8e5b88e ), G_GUINT64_CONSTANT( 0xcb4ccd500f6bb952 ) },
+	{ G_GUINT64_CONSTANT( 0xd097ad07a71f26b2 ), G_GUINT64_CONSTANT( 0x7e2000a41346a7a7 ) },
+	{ G_GUINT64_CONSTANT( 0x825ecc24c873782f ), G_GUINT64_CONSTANT( 0x8ed400668c0c28c8 ) },
+	{ G_GUINT64_CONSTANT( 0xa2f67f2dfa90563b ), G_GUINT64_CONSTANT( 0x728900802f0f32fa ) },
+	{ G_GUINT64_CONSTANT( 0xcbb41ef979346bca ), G_GUINT64_CONSTANT( 0x4f2b40a03ad2ffb9 ) },
+	{ G_GUINT64_CONSTANT( 0xfea126b7d78186bc ), G_GUINT64_CONSTANT( 0xe2f610c84987bfa8 ) },
+	{ G_GUINT64_CONSTANT( 0x9f24b832e6b0f436 ), G_GUINT64_CONSTANT( 0x0dd9ca7d2df4d7c9 ) },
+	{ G_GUINT64_CONSTANT( 0xc6ede63fa05d3143 ), G_GUINT64_CONSTANT( 0x91503d1c79720dbb ) },
+	{ G_GUINT64_CONSTANT( 0xf8a95fcf88747d94 ), G_GUINT64_CONSTANT( 0x75a44c6397ce912a ) },
+	{ G_GUINT64_CONSTANT( 0x9b69dbe1b548ce7c ), G_GUINT64_CONSTANT( 0xc986afbe3ee11aba ) },
+	{ G_GUINT64_CONSTANT( 0xc24452da229b021b ), G_GUINT64_CONSTANT( 0xfbe85badce996168 ) },
+	{ G_GUINT64_CONSTANT( 0xf2d56790ab41c2a2 ), G_GUINT64_CONSTANT( 0xfae27299423fb9c3 ) },
+	{ G_GUINT64_CONSTANT( 0x97c560ba6b0919a5 ), G_GUINT64_CONSTANT( 0xdccd879fc967d41a ) },
+	{ G_GUINT64_CONSTANT( 0xbdb6b8e905cb600f ), G_GUINT64_CONSTANT( 0x5400e987bbc1c920 ) },
+	{ G_GUINT64_CONSTANT( 0xed246723473e3813 ), G_GUINT64_CONSTANT( 0x290123e9aab23b68 ) },
+	{ G_GUINT64_CONSTANT( 0x9436c0760c86e30b ), G_GUINT64_CONSTANT( 0xf9a0b6720aaf6521 ) },
+	{ G_GUINT64_CONSTANT( 0xb94470938fa89bce ), G_GUINT64_CONSTANT( 0xf808e40e8d5b3e69 ) },
+	{ G_GUINT64_CONSTANT( 0xe7958cb87392c2c2 ), G_GUINT64_CONSTANT( 0xb60b1d1230b20e04 ) },
+	{ G_GUINT64_CONSTANT( 0x90bd77f3483bb9b9 ), G_GUINT64_CONSTANT( 0xb1c6f22b5e6f48c2 ) },
+	{ G_GUINT64_CONSTANT( 0xb4ecd5f01a4aa828 ), G_GUINT64_CONSTANT( 0x1e38aeb6360b1af3 ) },
+	{ G_GUINT64_CONSTANT( 0xe2280b6c20dd5232 ), G_GUINT64_CONSTANT( 0x25c6da63c38de1b0 ) },
+	{ G_GUINT64_CONSTANT( 0x8d590723948a535f ), G_GUINT64_CONSTANT( 0x579c487e5a38ad0e ) },
+	{ G_GUINT64_CONSTANT( 0xb0af48ec79ace837 ), G_GUINT64_CONSTANT( 0x2d835a9df0c6d851 ) },
+	{ G_GUINT64_CONSTANT( 0xdcdb1b2798182244 ), G_GUINT64_CONSTANT( 0xf8e431456cf88e65 ) },
+	{ G_GUINT64_CONSTANT( 0x8a08f0f8bf0f156b ), G_GUINT64_CONSTANT( 0x1b8e9ecb641b58ff ) },
+	{ G_GUINT64_CONSTANT( 0xac8b2d36eed2dac5 ), G_GUINT64_CONSTANT( 0xe272467e3d222f3f ) },
+	{ G_GUINT64_CONSTANT( 0xd7adf884aa879177 ), G_GUINT64_CONSTANT( 0x5b0ed81dcc6abb0f ) },
+	{ G_GUINT64_CONSTANT( 0x86ccbb52ea94baea ), G_GUINT64_CONSTANT( 0x98e947129fc2b4e9 ) },
+	{ G_GUINT64_CONSTANT( 0xa87fea27a539e9a5 ), G_GUINT64_CONSTANT( 0x3f2398d747b36224 ) },
+	{ G_GUINT64_CONSTANT( 0xd29fe4b18e88640e ), G_GUINT64_CONSTANT( 0x8eec7f0d19a03aad ) },
+	{ G_GUINT64_CONSTANT( 0x83a3eeeef9153e89 ), G_GUINT64_CONSTANT( 0x1953cf68300424ac ) },
+	{ G_GUINT64_CONSTANT( 0xa48ceaaab75a8e2b ), G_GUINT64_CONSTANT( 0x5fa8c3423c052dd7 ) },
+	{ G_GUINT64_CONSTANT( 0xcdb02555653131b6 ), G_GUINT64_CONSTANT( 0x3792f412cb06794d ) },
+	{ G_GUINT64_CONSTANT( 0x808e17555f3ebf11 ), G_GUINT64_CONSTANT( 0xe2bbd88bbee40bd0 ) },
+	{ G_GUINT64_CONSTANT( 0xa0b19d2ab70e6ed6 ), G_GUINT64_CONSTANT( 0x5b6aceaeae9d0ec4 ) },
+	{ G_GUINT64_CONSTANT( 0xc8de047564d20a8b ), G_GUINT64_CONSTANT( 0xf245825a5a445275 ) },
+	{ G_GUINT64_CONSTANT( 0xfb158592be068d2e ), G_GUINT64_CONSTANT( 0xeed6e2f0f0d56712 ) },
+	{ G_GUINT64_CONSTANT( 0x9ced737bb6c4183d ), G_GUINT64_CONSTANT( 0x55464dd69685606b ) },
+	{ G_GUINT64_CONSTANT( 0xc428d05aa4751e4c ), G_GUINT64_CONSTANT( 0xaa97e14c3c26b886 ) },
+	{ G_GUINT64_CONSTANT( 0xf53304714d9265df ), G_GUINT64_CONSTANT( 0xd53dd99f4b3066a8 ) },
+	{ G_GUINT64_CONSTANT( 0x993fe2c6d07b7fab ), G_GUINT64_CONSTANT( 0xe546a8038efe4029 ) },
+	{ G_GUINT64_CONSTANT( 0xbf8fdb78849a5f96 ), G_GUINT64_CONSTANT( 0xde98520472bdd033 ) },
+	{ G_GUINT64_CONSTANT( 0xef73d256a5c0f77c ), G_GUINT64_CONSTANT( 0x963e66858f6d4440 ) },
+	{ G_GUINT64_CONSTANT( 0x95a8637627989aad ), G_GUINT64_CONSTANT( 0xdde7001379a44aa8 ) },
+	{ G_GUINT64_CONSTANT( 0xbb127c53b17ec159 ), G_GUINT64_CONSTANT( 0x5560c018580d5d52 ) },
+	{ G_GUINT64_CONSTANT( 0xe9d71b689dde71af ), G_GUINT64_CONSTANT( 0xaab8f01e6e10b4a6 ) },
+	{ G_GUINT64_CONSTANT( 0x9226712162ab070d ), G_GUINT64_CONSTANT( 0xcab3961304ca70e8 ) },
+	{ G_GUINT64_CONSTANT( 0xb6b00d69bb55c8d1 ), G_GUINT64_CONSTANT( 0x3d607b97c5fd0d22 ) },
+	{ G_GUINT64_CONSTANT( 0xe45c10c42a2b3b05 ), G_GUINT64_CONSTANT( 0x8cb89a7db77c506a ) },
+	{ G_GUINT64_CONSTANT( 0x8eb98a7a9a5b04e3 ), G_GUINT64_CONSTANT( 0x77f3608e92adb242 ) },
+	{ G_GUINT64_CONSTANT( 0xb267ed1940f1c61c ), G_GUINT64_CONSTANT( 0x55f038b237591ed3 ) },
+	{ G_GUINT64_CONSTANT( 0xdf01e85f912e37a3 ), G_GUINT64_CONSTANT( 0x6b6c46dec52f6688 ) },
+	{ G_GUINT64_CONSTANT( 0x8b61313bbabce2c6 ), G_GUINT64_CONSTANT( 0x2323ac4b3b3da015 ) },
+	{ G_GUINT64_CONSTANT( 0xae397d8aa96c1b77 ), G_GUINT64_CONSTANT( 0xabec975e0a0d081a ) },
+	{ G_GUINT64_CONSTANT( 0xd9c7dced53c72255 ), G_GUINT64_CONSTANT( 0x96e7bd358c904a21 ) },
+	{ G_GUINT64_CONSTANT( 0x881cea14545c7575 ), G_GUINT64_CONSTANT( 0x7e50d64177da2e54 ) },
+	{ G_GUINT64_CONSTANT( 0xaa242499697392d2 ), G_GUINT64_CONSTANT( 0xdde50bd1d5d0b9e9 ) },
+	{ G_GUINT64_CONSTANT( 0xd4ad2dbfc3d07787 ), G_GUINT64_CONSTANT( 0x955e4ec64b44e864 ) },
+	{ G_GUINT64_CONSTANT( 0x84ec3c97da624ab4 ), G_GUINT64_CONSTANT( 0xbd5af13bef0b113e ) },
+	{ G_GUINT64_CONSTANT( 0xa6274bbdd0fadd61 ), G_GUINT64_CONSTANT( 0xecb1ad8aeacdd58e ) },
+	{ G_GUINT64_CONSTANT( 0xcfb11ead453994ba ), G_GUINT64_CONSTANT( 0x67de18eda5814af2 ) },
+	{ G_GUINT64_CONSTANT( 0x81ceb32c4b43fcf4 ), G_GUINT64_CONSTANT( 0x80eacf948770ced7 ) },
+	{ G_GUINT64_CONSTANT( 0xa2425ff75e14fc31 ), G_GUINT64_CONSTANT( 0xa1258379a94d028d ) },
+	{ G_GUINT64_CONSTANT( 0xcad2f7f5359a3b3e ), G_GUINT64_CONSTANT( 0x096ee45813a04330 ) },
+	{ G_GUINT64_CONSTANT( 0xfd87b5f28300ca0d ), G_GUINT64_CONSTANT( 0x8bca9d6e188853fc ) },
+	{ G_GUINT64_CONSTANT( 0x9e74d1b791e07e48 ), G_GUINT64_CONSTANT( 0x775ea264cf55347e ) },
+	{ G_GUINT64_CONSTANT( 0xc612062576589dda ), G_GUINT64_CONSTANT( 0x95364afe032a819e ) },
+	{ G_GUINT64_CONSTANT( 0xf79687aed3eec551 ), G_GUINT64_CONSTANT( 0x3a83ddbd83f52205 ) },
+	{ G_GUINT64_CONSTANT( 0x9abe14cd44753b52 ), G_GUINT64_CONSTANT( 0xc4926a9672793543 ) },
+	{ G_GUINT64_CONSTANT( 0xc16d9a0095928a27 ), G_GUINT64_CONSTANT( 0x75b7053c0f178294 ) },
+	{ G_GUINT64_CONSTANT( 0xf1c90080baf72cb1 ), G_GUINT64_CONSTANT( 0x5324c68b12dd6339 ) },
+	{ G_GUINT64_CONSTANT( 0x971da05074da7bee ), G_GUINT64_CONSTANT( 0xd3f6fc16ebca5e04 ) },
+	{ G_GUINT64_CONSTANT( 0xbce5086492111aea ), G_GUINT64_CONSTANT( 0x88f4bb1ca6bcf585 ) },
+	{ G_GUINT64_CONSTANT( 0xec1e4a7db69561a5 ), G_GUINT64_CONSTANT( 0x2b31e9e3d06c32e6 ) },
+	{ G_GUINT64_CONSTANT( 0x9392ee8e921d5d07 ), G_GUINT64_CONSTANT( 0x3aff322e62439fd0 ) },
+	{ G_GUINT64_CONSTANT( 0xb877aa3236a4b449 ), G_GUINT64_CONSTANT( 0x09befeb9fad487c3 ) },
+	{ G_GUINT64_CONSTANT( 0xe69594bec44de15b ), G_GUINT64_CONSTANT( 0x4c2ebe687989a9b4 ) },
+	{ G_GUINT64_CONSTANT( 0x901d7cf73ab0acd9 ), G_GUINT64_CONSTANT( 0x0f9d37014bf60a11 ) },
+	{ G_GUINT64_CONSTANT( 0xb424dc35095cd80f ), G_GUINT64_CONSTANT( 0x538484c19ef38c95 ) },
+	{ G_GUINT64_CONSTANT( 0xe12e13424bb40e13 ), G_GUINT64_CONSTANT( 0x2865a5f206b06fba ) },
+	{ G_GUINT64_CONSTANT( 0x8cbccc096f5088cb ), G_GUINT64_CONSTANT( 0xf93f87b7442e45d4 ) },
+	{ G_GUINT64_CONSTANT( 0xafebff0bcb24aafe ), G_GUINT64_CONSTANT( 0xf78f69a51539d749 ) },
+	{ G_GUINT64_CONSTANT( 0xdbe6fecebdedd5be ), G_GUINT64_CONSTANT( 0xb573440e5a884d1c ) },
+	{ G_GUINT64_CONSTANT( 0x89705f4136b4a597 ), G_GUINT64_CONSTANT( 0x31680a88f8953031 ) },
+	{ G_GUINT64_CONSTANT( 0xabcc77118461cefc ), G_GUINT64_CONSTANT( 0xfdc20d2b36ba7c3e ) },
+	{ G_GUINT64_CONSTANT( 0xd6bf94d5e57a42bc ), G_GUINT64_CONSTANT( 0x3d32907604691b4d ) },
+	{ G_GUINT64_CONSTANT( 0x8637bd05af6c69b5 ), G_GUINT64_CONSTANT( 0xa63f9a49c2c1b110 ) },
+	{ G_GUINT64_CONSTANT( 0xa7c5ac471b478423 ), G_GUINT64_CONSTANT( 0x0fcf80dc33721d54 ) },
+	{ G_GUINT64_CONSTANT( 0xd1b71758e219652b ), G_GUINT64_CONSTANT( 0xd3c36113404ea4a9 ) },
+	{ G_GUINT64_CONSTANT( 0x83126e978d4fdf3b ), G_GUINT64_CONSTANT( 0x645a1cac083126ea ) },
+	{ G_GUINT64_CONSTANT( 0xa3d70a3d70a3d70a ), G_GUINT64_CONSTANT( 0x3d70a3d70a3d70a4 ) },
+	{ G_GUINT64_CONSTANT( 0xcccccccccccccccc ), G_GUINT64_CONSTANT( 0xcccccccccccccccd ) },
+	{ G_GUINT64_CONSTANT( 0x8000000000000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xa000000000000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xc800000000000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xfa00000000000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0x9c40000000000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xc350000000000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xf424000000000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0x9896800000000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xbebc200000000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xee6b280000000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0x9502f90000000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xba43b74000000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xe8d4a51000000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0x9184e72a00000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xb5e620f480000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xe35fa931a0000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0x8e1bc9bf04000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xb1a2bc2ec5000000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xde0b6b3a76400000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0x8ac7230489e80000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xad78ebc5ac620000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xd8d726b7177a8000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0x878678326eac9000 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xa968163f0a57b400 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xd3c21bcecceda100 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0x84595161401484a0 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xa56fa5b99019a5c8 ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xcecb8f27f4200f3a ), G_GUINT64_CONSTANT( 0x0000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0x813f3978f8940984 ), G_GUINT64_CONSTANT( 0x4000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xa18f07d736b90be5 ), G_GUINT64_CONSTANT( 0x5000000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xc9f2c9cd04674ede ), G_GUINT64_CONSTANT( 0xa400000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xfc6f7c4045812296 ), G_GUINT64_CONSTANT( 0x4d00000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0x9dc5ada82b70b59d ), G_GUINT64_CONSTANT( 0xf020000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xc5371912364ce305 ), G_GUINT64_CONSTANT( 0x6c28000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xf684df56c3e01bc6 ), G_GUINT64_CONSTANT( 0xc732000000000000 ) },
+	{ G_GUINT64_CONSTANT( 0x9a130b963a6c115c ), G_GUINT64_CONSTANT( 0x3c7f400000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xc097ce7bc90715b3 ), G_GUINT64_CONSTANT( 0x4b9f100000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xf0bdc21abb48db20 ), G_GUINT64_CONSTANT( 0x1e86d40000000000 ) },
+	{ G_GUINT64_CONSTANT( 0x96769950b50d88f4 ), G_GUINT64_CONSTANT( 0x1314448000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xbc143fa4e250eb31 ), G_GUINT64_CONSTANT( 0x17d955a000000000 ) },
+	{ G_GUINT64_CONSTANT( 0xeb194f8e1ae525fd ), G_GUINT64_CONSTANT( 0x5dcfab0800000000 ) },
+	{ G_GUINT64_CONSTANT( 0x92efd1b8d0cf37be ), G_GUINT64_CONSTANT( 0x5aa1cae500000000 ) },
+	{ G_GUINT64_CONSTANT( 0xb7abc627050305ad ), G_GUINT64_CONSTANT( 0xf14a3d9e40000000 ) },
+	{ G_GUINT64_CONSTANT( 0xe596b7b0c643c719 ), G_GUINT64_CONSTANT( 0x6d9ccd05d0000000 ) },
+	{ G_GUINT64_CONSTANT( 0x8f7e32ce7bea5c6f ), G_GUINT64_CONSTANT( 0xe4820023a2000000 ) },
+	{ G_GUINT64_CONSTANT( 0xb35dbf821ae4f38b ), G_GUINT64_CONSTANT( 0xdda2802c8a800000 ) },
+	{ G_GUINT64_CONSTANT( 0xe0352f62a19e306e ), G_GUINT64_CONSTANT( 0xd50b2037ad200000 ) },
+	{ G_GUINT64_CONSTANT( 0x8c213d9da502de45 ), G_GUINT64_CONSTANT( 0x4526f422cc340000 ) },
+	{ G_GUINT64_CONSTANT( 0xaf298d050e4395d6 ), G_GUINT64_CONSTANT( 0x9670b12b7f410000 ) },
+	{ G_GUINT64_CONSTANT( 0xdaf3f04651d47b4c ), G_GUINT64_CONSTANT( 0x3c0cdd765f114000 ) },
+	{ G_GUINT64_CONSTANT( 0x88d8762bf324cd0f ), G_GUINT64_CONSTANT( 0xa5880a69fb6ac800 ) },
+	{ G_GUINT64_CONSTANT( 0xab0e93b6efee0053 ), G_GUINT64_CONSTANT( 0x8eea0d047a457a00 ) },
+	{ G_GUINT64_CONSTANT( 0xd5d238a4abe98068 ), G_GUINT64_CONSTANT( 0x72a4904598d6d880 ) },
+	{ G_GUINT64_CONSTANT( 0x85a36366eb71f041 ), G_GUINT64_CONSTANT( 0x47a6da2b7f864750 ) },
+	{ G_GUINT64_CONSTANT( 0xa70c3c40a64e6c51 ), G_GUINT64_CONSTANT( 0x999090b65f67d924 ) },
+	{ G_GUINT64_CONSTANT( 0xd0cf4b50cfe20765 ), G_GUINT64_CONSTANT( 0xfff4b4e3f741cf6d ) },
+	{ G_GUINT64_CONSTANT( 0x82818f1281ed449f ), G_GUINT64_CONSTANT( 0xbff8f10e7a8921a4 ) },
+	{ G_GUINT64_CONSTANT( 0xa321f2d7226895c7 ), G_GUINT64_CONSTANT( 0xaff72d52192b6a0d ) },
+	{ G_GUINT64_CONSTANT( 0xcbea6f8ceb02bb39 ), G_GUINT64_CONSTANT( 0x9bf4f8a69f764490 ) },
+	{ G_GUINT64_CONSTANT( 0xfee50b7025c36a08 ), G_GUINT64_CONSTANT( 0x02f236d04753d5b4 ) },
+	{ G_GUINT64_CONSTANT( 0x9f4f2726179a2245 ), G_GUINT64_CONSTANT( 0x01d762422c946590 ) },
+	{ G_GUINT64_CONSTANT( 0xc722f0ef9d80aad6 ), G_GUINT64_CONSTANT( 0x424d3ad2b7b97ef5 ) },
+	{ G_GUINT64_CONSTANT( 0xf8ebad2b84e0d58b ), G_GUINT64_CONSTANT( 0xd2e0898765a7deb2 ) },
+	{ G_GUINT64_CONSTANT( 0x9b934c3b330c8577 ), G_GUINT64_CONSTANT( 0x63cc55f49f88eb2f ) },
+	{ G_GUINT64_CONSTANT( 0xc2781f49ffcfa6d5 ), G_GUINT64_CONSTANT( 0x3cbf6b71c76b25fb ) },
+	{ G_GUINT64_CONSTANT( 0xf316271c7fc3908a ), G_GUINT64_CONSTANT( 0x8bef464e3945ef7a ) },
+	{ G_GUINT64_CONSTANT( 0x97edd871cfda3a56 ), G_GUINT64_CONSTANT( 0x97758bf0e3cbb5ac ) },
+	{ G_GUINT64_CONSTANT( 0xbde94e8e43d0c8ec ), G_GUINT64_CONSTANT( 0x3d52eeed1cbea317 ) },
+	{ G_GUINT64_CONSTANT( 0xed63a231d4c4fb27 ), G_GUINT64_CONSTANT( 0x4ca7aaa863ee4bdd ) },
+	{ G_GUINT64_CONSTANT( 0x945e455f24fb1cf8 ), G_GUINT64_CONSTANT( 0x8fe8caa93e74ef6a ) },
+	{ G_GUINT64_CONSTANT( 0xb975d6b6ee39e436 ), G_GUINT64_CONSTANT( 0xb3e2fd538e122b44 ) },
+	{ G_GUINT64_CONSTANT( 0xe7d34c64a9c85d44 ), G_GUINT64_CONSTANT( 0x60dbbca87196b616 ) },
+	{ G_GUINT64_CONSTANT( 0x90e40fbeea1d3a4a ), G_GUINT64_CONSTANT( 0xbc8955e946fe31cd ) },
+	{ G_GUINT64_CONSTANT( 0xb51d13aea4a488dd ), G_GUINT64_CONSTANT( 0x6babab6398bdbe41 ) },
+	{ G_GUINT64_CONSTANT( 0xe264589a4dcdab14 ), G_GUINT64_CONSTANT( 0xc696963c7eed2dd1 ) },
+	{ G_GUINT64_CONSTANT( 0x8d7eb76070a08aec ), G_GUINT64_CONSTANT( 0xfc1e1de5cf543ca2 ) },
+	{ G_GUINT64_CONSTANT( 0xb0de65388cc8ada8 ), G_GUINT64_CONSTANT( 0x3b25a55f43294bcb ) },
+	{ G_GUINT64_CONSTANT( 0xdd15fe86affad912 ), G_GUINT64_CONSTANT( 0x49ef0eb713f39ebe ) },
+	{ G_GUINT64_CONSTANT( 0x8a2dbf142dfcc7ab ), G_GUINT64_CONSTANT( 0x6e3569326c784337 ) },
+	{ G_GUINT64_CONSTANT( 0xacb92ed9397bf996 ), G_GUINT64_CONSTANT( 0x49c2c37f07965404 ) },
+	{ G_GUINT64_CONSTANT( 0xd7e77a8f87daf7fb ), G_GUINT64_CONSTANT( 0xdc33745ec97be906 ) },
+	{ G_GUINT64_CONSTANT( 0x86f0ac99b4e8dafd ), G_GUINT64_CONSTANT( 0x69a028bb3ded71a3 ) },
+	{ G_GUINT64_CONSTANT( 0xa8acd7c0222311bc ), G_GUINT64_CONSTANT( 0xc40832ea0d68ce0c ) },
+	{ G_GUINT64_CONSTANT( 0xd2d80db02aabd62b ), G_GUINT64_CONSTANT( 0xf50a3fa490c30190 ) },
+	{ G_GUINT64_CONSTANT( 0x83c7088e1aab65db ), G_GUINT64_CONSTANT( 0x792667c6da79e0fa ) },
+	{ G_GUINT64_CONSTANT( 0xa4b8cab1a1563f52 ), G_GUINT64_CONSTANT( 0x577001b891185938 ) },
+	{ G_GUINT64_CONSTANT( 0xcde6fd5e09abcf26 ), G_GUINT64_CONSTANT( 0xed4c0226b55e6f86 ) },
+	{ G_GUINT64_CONSTANT( 0x80b05e5ac60b6178 ), G_GUINT64_CONSTANT( 0x544f8158315b05b4 ) },
+	{ G_GUINT64_CONSTANT( 0xa0dc75f1778e39d6 ), G_GUINT64_CONSTANT( 0x696361ae3db1c721 ) },
+	{ G_GUINT64_CONSTANT( 0xc913936dd571c84c ), G_GUINT64_CONSTANT( 0x03bc3a19cd1e38e9 ) },
+	{ G_GUINT64_CONSTANT( 0xfb5878494ace3a5f ), G_GUINT64_CONSTANT( 0x04ab48a04065c723 ) },
+	{ G_GUINT64_CONSTANT( 0x9d174b2dcec0e47b ), G_GUINT64_CONSTANT( 0x62eb0d64283f9c76 ) },
+	{ G_GUINT64_CONSTANT( 0xc45d1df942711d9a ), G_GUINT64_CONSTANT( 0x3ba5d0bd324f8394 ) },
+	{ G_GUINT64_CONSTANT( 0xf5746577930d6500 ), G_GUINT64_CONSTANT( 0xca8f44ec7ee36479 ) },
+	{ G_GUINT64_CONSTANT( 0x9968bf6abbe85f20 ), G_GUINT64_CONSTANT( 0x7e998b13cf4e1ecb ) },
+	{ G_GUINT64_CONSTANT( 0xbfc2ef456ae276e8 ), G_GUINT64_CONSTANT( 0x9e3fedd8c321a67e ) },
+	{ G_GUINT64_CONSTANT( 0xefb3ab16c59b14a2 ), G_GUINT64_CONSTANT( 0xc5cfe94ef3ea101e ) },
+	{ G_GUINT64_CONSTANT( 0x95d04aee3b80ece5 ), G_GUINT64_CONSTANT( 0xbba1f1d158724a12 ) },
+	{ G_GUINT64_CONSTANT( 0xbb445da9ca61281f ), G_GUINT64_CONSTANT( 0x2a8a6e45ae8edc97 ) },
+	{ G_GUINT64_CONSTANT( 0xea1575143cf97226 ), G_GUINT64_CONSTANT( 0xf52d09d71a3293bd ) },
+	{ G_GUINT64_CONSTANT( 0x924d692ca61be758 ), G_GUINT64_CONSTANT( 0x593c2626705f9c56 ) },
+	{ G_GUINT64_CONSTANT( 0xb6e0c377cfa2e12e ), G_GUINT64_CONSTANT( 0x6f8b2fb00c77836c ) },
+	{ G_GUINT64_CONSTANT( 0xe498f455c38b997a ), G_GUINT64_CONSTANT( 0x0b6dfb9c0f956447 ) },
+	{ G_GUINT64_CONSTANT( 0x8edf98b59a373fec ), G_GUINT64_CONSTANT( 0x4724bd4189bd5eac ) },
+	{ G_GUINT64_CONSTANT( 0xb2977ee300c50fe7 ), G_GUINT64_CONSTANT( 0x58edec91ec2cb657 ) },
+	{ G_GUINT64_CONSTANT( 0xdf3d5e9bc0f653e1 ), G_GUINT64_CONSTANT( 0x2f2967b66737e3ed ) },
+	{ G_GUINT64_CONSTANT( 0x8b865b215899f46c ), G_GUINT64_CONSTANT( 0xbd79e0d20082ee74 ) },
+	{ G_GUINT64_CONSTANT( 0xae67f1e9aec07187 ), G_GUINT64_CONSTANT( 0xecd8590680a3aa11 ) },
+	{ G_GUINT64_CONSTANT( 0xda01ee641a708de9 ), G_GUINT64_CONSTANT( 0xe80e6f4820cc9495 ) },
+	{ G_GUINT64_CONSTANT( 0x884134fe908658b2 ), G_GUINT64_CONSTANT( 0x3109058d147fdcdd ) },
+	{ G_GUINT64_CONSTANT( 0xaa51823e34a7eede ), G_GUINT64_CONSTANT( 0xbd4b46f0599fd415 ) },
+	{ G_GUINT64_CONSTANT( 0xd4e5e2cdc1d1ea96 ), G_GUINT64_CONSTANT( 0x6c9e18ac7007c91a ) },
+	{ G_GUINT64_CONSTANT( 0x850fadc09923329e ), G_GUINT64_CONSTANT( 0x03e2cf6bc604ddb0 ) },
+	{ G_GUINT64_CONSTANT( 0xa6539930bf6bff45 ), G_GUINT64_CONSTANT( 0x84db8346b786151c ) },
+	{ G_GUINT64_CONSTANT( 0xcfe87f7cef46ff16 ), G_GUINT64_CONSTANT( 0xe612641865679a63 ) },
+	{ G_GUINT64_CONSTANT( 0x81f14fae158c5f6e ), G_GUINT64_CONSTANT( 0x4fcb7e8f3f60c07e ) },
+	{ G_GUINT64_CONSTANT( 0xa26da3999aef7749 ), G_GUINT64_CONSTANT( 0xe3be5e330f38f09d ) },
+	{ G_GUINT64_CONSTANT( 0xcb090c8001ab551c ), G_GUINT64_CONSTANT( 0x5cadf5bfd3072cc5 ) },
+	{ G_GUINT64_CONSTANT( 0xfdcb4fa002162a63 ), G_GUINT64_CONSTANT( 0x73d9732fc7c8f7f6 ) },
+	{ G_GUINT64_CONSTANT( 0x9e9f11c4014dda7e ), G_GUINT64_CONSTANT( 0x2867e7fddcdd9afa ) },
+	{ G_GUINT64_CONSTANT( 0xc646d63501a1511d ), G_GUINT64_CONSTANT( 0xb281e1fd541501b8 ) },
+	{ G_GUINT64_CONSTANT( 0xf7d88bc24209a565 ), G_GUINT64_CONSTANT( 0x1f225a7ca91a4226 ) },
+	{ G_GUINT64_CONSTANT( 0x9ae757596946075f ), G_GUINT64_CONSTANT( 0x3375788de9b06958 ) },
+	{ G_GUINT64_CONSTANT( 0xc1a12d2fc3978937 ), G_GUINT64_CONSTANT( 0x0052d6b1641c83ae ) },
+	{ G_GUINT64_CONSTANT( 0xf209787bb47d6b84 ), G_GUINT64_CONSTANT( 0xc0678c5dbd23a49a ) },
+	{ G_GUINT64_CONSTANT( 0x9745eb4d50ce6332 ), G_GUINT64_CONSTANT( 0xf840b7ba963646e0 ) },
+	{ G_GUINT64_CONSTANT( 0xbd176620a501fbff ), G_GUINT64_CONSTANT( 0xb650e5a93bc3d898 ) },
+	{ G_GUINT64_CONSTANT( 0xec5d3fa8ce427aff ), G_GUINT64_CONSTANT( 0xa3e51f138ab4cebe ) },
+	{ G_GUINT64_CONSTANT( 0x93ba47c980e98cdf ), G_GUINT64_CONSTANT( 0xc66f336c36b10137 ) },
+	{ G_GUINT64_CONSTANT( 0xb8a8d9bbe123f017 ), G_GUINT64_CONSTANT( 0xb80b0047445d4184 ) },
+	{ G_GUINT64_CONSTANT( 0xe6d3102ad96cec1d ), G_GUINT64_CONSTANT( 0xa60dc059157491e5 ) },
+	{ G_GUINT64_CONSTANT( 0x9043ea1ac7e41392 ), G_GUINT64_CONSTANT( 0x87c89837ad68db2f ) },
+	{ G_GUINT64_CONSTANT( 0xb454e4a179dd1877 ), G_GUINT64_CONSTANT( 0x29babe4598c311fb ) },
+	{ G_GUINT64_CONSTANT( 0xe16a1dc9d8545e94 ), G_GUINT64_CONSTANT( 0xf4296dd6fef3d67a ) },
+	{ G_GUINT64_CONSTANT( 0x8ce2529e2734bb1d ), G_GUINT64_CONSTANT( 0x1899e4a65f58660c ) },
+	{ G_GUINT64_CONSTANT( 0xb01ae745b101e9e4 ), G_GUINT64_CONSTANT( 0x5ec05dcff72e7f8f ) },
+	{ G_GUINT64_CONSTANT( 0xdc21a1171d42645d ), G_GUINT64_CONSTANT( 0x76707543f4fa1f73 ) },
+	{ G_GUINT64_CONSTANT( 0x899504ae72497eba ), G_GUINT64_CONSTANT( 0x6a06494a791c53a8 ) },
+	{ G_GUINT64_CONSTANT( 0xabfa45da0edbde69 ), G_GUINT64_CONSTANT( 0x0487db9d17636892 ) },
+	{ G_GUINT64_CONSTANT( 0xd6f8d7509292d603 ), G_GUINT64_CONSTANT( 0x45a9d2845d3c42b6 ) },
+	{ G_GUINT64_CONSTANT( 0x865b86925b9bc5c2 ), G_GUINT64_CONSTANT( 0x0b8a2392ba45a9b2 ) },
+	{ G_GUINT64_CONSTANT( 0xa7f26836f282b732 ), G_GUINT64_CONSTANT( 0x8e6cac7768d7141e ) },
+	{ G_GUINT64_CONSTANT( 0xd1ef0244af2364ff ), G_GUINT64_CONSTANT( 0x3207d795430cd926 ) },
+	{ G_GUINT64_CONSTANT( 0x8335616aed761f1f ), G_GUINT64_CONSTANT( 0x7f44e6bd49e807b8 ) },
+	{ G_GUINT64_CONSTANT( 0xa402b9c5a8d3a6e7 ), G_GUINT64_CONSTANT( 0x5f16206c9c6209a6 ) },
+	{ G_GUINT64_CONSTANT( 0xcd036837130890a1 ), G_GUINT64_CONSTANT( 0x36dba887c37a8c0f ) },
+	{ G_GUINT64_CONSTANT( 0x802221226be55a64 ), G_GUINT64_CONSTANT( 0xc2494954da2c9789 ) },
+	{ G_GUINT64_CONSTANT( 0xa02aa96b06deb0fd ), G_GUINT64_CONSTANT( 0xf2db9baa10b7bd6c ) },
+	{ G_GUINT64_CONSTANT( 0xc83553c5c8965d3d ), G_GUINT64_CONSTANT( 0x6f92829494e5acc7 ) },
+	{ G_GUINT64_CONSTANT( 0xfa42a8b73abbf48c ), G_GUINT64_CONSTANT( 0xcb772339ba1f17f9 ) },
+	{ G_GUINT64_CONSTANT( 0x9c69a97284b578d7 ), G_GUINT64_CONSTANT( 0xff2a760414536efb ) },
+	{ G_GUINT64_CONSTANT( 0xc38413cf25e2d70d ), G_GUINT64_CONSTANT( 0xfef5138519684aba ) },
+	{ G_GUINT64_CONSTANT( 0xf46518c2ef5b8cd1 ), G_GUINT64_CONSTANT( 0x7eb258665fc25d69 ) },
+	{ G_GUINT64_CONSTANT( 0x98bf2f79d5993802 ), G_GUINT64_CONSTANT( 0xef2f773ffbd97a61 ) },
+	{ G_GUINT64_CONSTANT( 0xbeeefb584aff8603 ), G_GUINT64_CONSTANT( 0xaafb550ffacfd8fa ) },
+	{ G_GUINT64_CONSTANT( 0xeeaaba2e5dbf6784 ), G_GUINT64_CONSTANT( 0x95ba2a53f983cf38 ) },
+	{ G_GUINT64_CONSTANT( 0x952ab45cfa97a0b2 ), G_GUINT64_CONSTANT( 0xdd945a747bf26183 ) },
+	{ G_GUINT64_CONSTANT( 0xba756174393d88df ), G_GUINT64_CONSTANT( 0x94f971119aeef9e4 ) },
+	{ G_GUINT64_CONSTANT( 0xe912b9d1478ceb17 ), G_GUINT64_CONSTANT( 0x7a37cd5601aab85d ) },
+	{ G_GUINT64_CONSTANT( 0x91abb422ccb812ee ), G_GUINT64_CONSTANT( 0xac62e055c10ab33a ) },
+	{ G_GUINT64_CONSTANT( 0xb616a12b7fe617aa ), G_GUINT64_CONSTANT( 0x577b986b314d6009 ) },
+	{ G_GUINT64_CONSTANT( 0xe39c49765fdf9d94 ), G_GUINT64_CONSTANT( 0xed5a7e85fda0b80b ) },
+	{ G_GUINT64_CONSTANT( 0x8e41ade9fbebc27d ), G_GUINT64_CONSTANT( 0x14588f13be847307 ) },
+	{ G_GUINT64_CONSTANT( 0xb1d219647ae6b31c ), G_GUINT64_CONSTANT( 0x596eb2d8ae258fc8 ) },
+	{ G_GUINT64_CONSTANT( 0xde469fbd99a05fe3 ), G_GUINT64_CONSTANT( 0x6fca5f8ed9aef3bb ) },
+	{ G_GUINT64_CONSTANT( 0x8aec23d680043bee ), G_GUINT64_CONSTANT( 0x25de7bb9480d5854 ) },
+	{ G_GUINT64_CONSTANT( 0xada72ccc20054ae9 ), G_GUINT64_CONSTANT( 0xaf561aa79a10ae6a ) },
+	{ G_GUINT64_CONSTANT( 0xd910f7ff28069da4 ), G_GUINT64_CONSTANT( 0x1b2ba1518094da04 ) },
+	{ G_GUINT64_CONSTANT( 0x87aa9aff79042286 ), G_GUINT64_CONSTANT( 0x90fb44d2f05d0842 ) },
+	{ G_GUINT64_CONSTANT( 0xa99541bf57452b28 ), G_GUINT64_CONSTANT( 0x353a1607ac744a53 ) },
+	{ G_GUINT64_CONSTANT( 0xd3fa922f2d1675f2 ), G_GUINT64_CONSTANT( 0x42889b8997915ce8 ) },
+	{ G_GUINT64_CONSTANT( 0x847c9b5d7c2e09b7 ), G_GUINT64_CONSTANT( 0x69956135febada11 ) },
+	{ G_GUINT64_CONSTANT( 0xa59bc234db398c25 ), G_GUINT64_CONSTANT( 0x43fab9837e699095 ) },
+	{ G_GUINT64_CONSTANT( 0xcf02b2c21207ef2e ), G_GUINT64_CONSTANT( 0x94f967e45e03f4bb ) },
+	{ G_GUINT64_CONSTANT( 0x8161afb94b44f57d ), G_GUINT64_CONSTANT( 0x1d1be0eebac278f5 ) },
+	{ G_GUINT64_CONSTANT( 0xa1ba1ba79e1632dc ), G_GUINT64_CONSTANT( 0x6462d92a69731732 ) },
+	{ G_GUINT64_CONSTANT( 0xca28a291859bbf93 ), G_GUINT64_CONSTANT( 0x7d7b8f7503cfdcfe ) },
+	{ G_GUINT64_CONSTANT( 0xfcb2cb35e702af78 ), G_GUINT64_CONSTANT( 0x5cda735244c3d43e ) },
+	{ G_GUINT64_CONSTANT( 0x9defbf01b061adab ), G_GUINT64_CONSTANT( 0x3a0888136afa64a7 ) },
+	{ G_GUINT64_CONSTANT( 0xc56baec21c7a1916 ), G_GUINT64_CONSTANT( 0x088aaa1845b8fdd0 ) },
+	{ G_GUINT64_CONSTANT( 0xf6c69a72a3989f5b ), G_GUINT64_CONSTANT( 0x8aad549e57273d45 ) },
+	{ G_GUINT64_CONSTANT( 0x9a3c2087a63f6399 ), G_GUINT64_CONSTANT( 0x36ac54e2f678864b ) },
+	{ G_GUINT64_CONSTANT( 0xc0cb28a98fcf3c7f ), G_GUINT64_CONSTANT( 0x84576a1bb416a7dd ) },
+	{ G_GUINT64_CONSTANT( 0xf0fdf2d3f3c30b9f ), G_GUINT64_CONSTANT( 0x656d44a2a11c51d5 ) },
+	{ G_GUINT64_CONSTANT( 0x969eb7c47859e743 ), G_GUINT64_CONSTANT( 0x9f644ae5a4b1b325 ) },
+	{ G_GUINT64_CONSTANT( 0xbc4665b596706114 ), G_GUINT64_CONSTANT( 0x873d5d9f0dde1fee ) },
+	{ G_GUINT64_CONSTANT( 0xeb57ff22fc0c7959 ), G_GUINT64_CONSTANT( 0xa90cb506d155a7ea ) },
+	{ G_GUINT64_CONSTANT( 0x9316ff75dd87cbd8 ), G_GUINT64_CONSTANT( 0x09a7f12442d588f2 ) },
+	{ G_GUINT64_CONSTANT( 0xb7dcbf5354e9bece ), G_GUINT64_CONSTANT( 0x0c11ed6d538aeb2f ) },
+	{ G_GUINT64_CONSTANT( 0xe5d3ef282a242e81 ), G_GUINT64_CONSTANT( 0x8f1668c8a86da5fa ) },
+	{ G_GUINT64_CONSTANT( 0x8fa475791a569d10 ), G_GUINT64_CONSTANT( 0xf96e017d694487bc ) },
+	{ G_GUINT64_CONSTANT( 0xb38d92d760ec4455 ), G_GUINT64_CONSTANT( 0x37c981dcc395a9ac ) },
+	{ G_GUINT64_CONSTANT( 0xe070f78d3927556a ), G_GUINT64_CONSTANT( 0x85bbe253f47b1417 ) },
+	{ G_GUINT64_CONSTANT( 0x8c469ab843b89562 ), G_GUINT64_CONSTANT( 0x93956d7478ccec8e ) },
+	{ G_GUINT64_CONSTANT( 0xaf58416654a6babb ), G_GUINT64_CONSTANT( 0x387ac8d1970027b2 ) },
+	{ G_GUINT64_CONSTANT( 0xdb2e51bfe9d0696a ), G_GUINT64_CONSTANT( 0x06997b05fcc0319e ) },
+	{ G_GUINT64_CONSTANT( 0x88fcf317f22241e2 ), G_GUINT64_CONSTANT( 0x441fece3bdf81f03 ) },
+	{ G_GUINT64_CONSTANT( 0xab3c2fddeeaad25a ), G_GUINT64_CONSTANT( 0xd527e81cad7626c3 ) },
+	{ G_GUINT64_CONSTANT( 0xd60b3bd56a5586f1 ), G_GUINT64_CONSTANT( 0x8a71e223d8d3b074 ) },
+	{ G_GUINT64_CONSTANT( 0x85c7056562757456 ), G_GUINT64_CONSTANT( 0xf6872d5667844e49 ) },
+	{ G_GUINT64_CONSTANT( 0xa738c6bebb12d16c ), G_GUINT64_CONSTANT( 0xb428f8ac016561db ) },
+	{ G_GUINT64_CONSTANT( 0xd106f86e69d785c7 ), G_GUINT64_CONSTANT( 0xe13336d701beba52 ) },
+	{ G_GUINT64_CONSTANT( 0x82a45b450226b39c ), G_GUINT64_CONSTANT( 0xecc0024661173473 ) },
+	{ G_GUINT64_CONSTANT( 0xa34d721642b06084 ), G_GUINT64_CONSTANT( 0x27f002d7f95d0190 ) },
+	{ G_GUINT64_CONSTANT( 0xcc20ce9bd35c78a5 ), G_GUINT64_CONSTANT( 0x31ec038df7b441f4 ) },
+	{ G_GUINT64_CONSTANT( 0xff290242c83396ce ), G_GUINT64_CONSTANT( 0x7e67047175a15271 ) },
+	{ G_GUINT64_CONSTANT( 0x9f79a169bd203e41 ), G_GUINT64_CONSTANT( 0x0f0062c6e984d386 ) },
+	{ G_GUINT64_CONSTANT( 0xc75809c42c684dd1 ), G_GUINT64_CONSTANT( 0x52c07b78a3e60868 ) },
+	{ G_GUINT64_CONSTANT( 0xf92e0c3537826145 ), G_GUINT64_CONSTANT( 0xa7709a56ccdf8a82 ) },
+	{ G_GUINT64_CONSTANT( 0x9bbcc7a142b17ccb ), G_GUINT64_CONSTANT( 0x88a66076400bb691 ) },
+	{ G_GUINT64_CONSTANT( 0xc2abf989935ddbfe ), G_GUINT64_CONSTANT( 0x6acff893d00ea435 ) },
+	{ G_GUINT64_CONSTANT( 0xf356f7ebf83552fe ), G_GUINT64_CONSTANT( 0x0583f6b8c4124d43 ) },
+	{ G_GUINT64_CONSTANT( 0x98165af37b2153de ), G_GUINT64_CONSTANT( 0xc3727a337a8b704a ) },
+	{ G_GUINT64_CONSTANT( 0xbe1bf1b059e9a8d6 ), G_GUINT64_CONSTANT( 0x744f18c0592e4c5c ) },
+	{ G_GUINT64_CONSTANT( 0xeda2ee1c7064130c ), G_GUINT64_CONSTANT( 0x1162def06f79df73 ) },
+	{ G_GUINT64_CONSTANT( 0x9485d4d1c63e8be7 ), G_GUINT64_CONSTANT( 0x8addcb5645ac2ba8 ) },
+	{ G_GUINT64_CONSTANT( 0xb9a74a0637ce2ee1 ), G_GUINT64_CONSTANT( 0x6d953e2bd7173692 ) },
+	{ G_GUINT64_CONSTANT( 0xe8111c87c5c1ba99 ), G_GUINT64_CONSTANT( 0xc8fa8db6ccdd0437 ) },
+	{ G_GUINT64_CONSTANT( 0x910ab1d4db9914a0 ), G_GUINT64_CONSTANT( 0x1d9c9892400a22a2 ) },
+	{ G_GUINT64_CONSTANT( 0xb54d5e4a127f59c8 ), G_GUINT64_CONSTANT( 0x2503beb6d00cab4b ) },
+	{ G_GUINT64_CONSTANT( 0xe2a0b5dc971f303a ), G_GUINT64_CONSTANT( 0x2e44ae64840fd61d ) },
+	{ G_GUINT64_CONSTANT( 0x8da471a9de737e24 ), G_GUINT64_CONSTANT( 0x5ceaecfed289e5d2 ) },
+	{ G_GUINT64_CONSTANT( 0xb10d8e1456105dad ), G_GUINT64_CONSTANT( 0x7425a83e872c5f47 ) },
+	{ G_GUINT64_CONSTANT( 0xdd50f1996b947518 ), G_GUINT64_CONSTANT( 0xd12f124e28f77719 ) },
+	{ G_GUINT64_CONSTANT( 0x8a5296ffe33cc92f ), G_GUINT64_CONSTANT( 0x82bd6b70d99aaa6f ) },
+	{ G_GUINT64_CONSTANT( 0xace73cbfdc0bfb7b ), G_GUINT64_CONSTANT( 0x636cc64d1001550b ) },
+	{ G_GUINT64_CONSTANT( 0xd8210befd30efa5a ), G_GUINT64_CONSTANT( 0x3c47f7e05401aa4e ) },
+	{ G_GUINT64_CONSTANT( 0x8714a775e3e95c78 ), G_GUINT64_CONSTANT( 0x65acfaec34810a71 ) },
+	{ G_GUINT64_CONSTANT( 0xa8d9d1535ce3b396 ), G_GUINT64_CONSTANT( 0x7f1839a741a14d0d ) },
+	{ G_GUINT64_CONSTANT( 0xd31045a8341ca07c ), G_GUINT64_CONSTANT( 0x1ede48111209a050 ) },
+	{ G_GUINT64_CONSTANT( 0x83ea2b892091e44d ), G_GUINT64_CONSTANT( 0x934aed0aab460432 ) },
+	{ G_GUINT64_CONSTANT( 0xa4e4b66b68b65d60 ), G_GUINT64_CONSTANT( 0xf81da84d5617853f ) },
+	{ G_GUINT64_CONSTANT( 0xce1de40642e3f4b9 ), G_GUINT64_CONSTANT( 0x36251260ab9d668e ) },
+	{ G_GUINT64_CONSTANT( 0x80d2ae83e9ce78f3 ), G_GUINT64_CONSTANT( 0xc1d72b7c6b426019 ) },
+	{ G_GUINT64_CONSTANT( 0xa1075a24e4421730 ), G_GUINT64_CONSTANT( 0xb24cf65b8612f81f ) },
+	{ G_GUINT64_CONSTANT( 0xc94930ae1d529cfc ), G_GUINT64_CONSTANT( 0xdee033f26797b627 ) },
+	{ G_GUINT64_CONSTANT( 0xfb9b7cd9a4a7443c ), G_GUINT64_CONSTANT( 0x169840ef017da3b1 ) },
+	{ G_GUINT64_CONSTANT( 0x9d412e0806e88aa5 ), G_GUINT64_CONSTANT( 0x8e1f289560ee864e ) },
+	{ G_GUINT64_CONSTANT( 0xc491798a08a2ad4e ), G_GUINT64_CONSTANT( 0xf1a6f2bab92a27e2 ) },
+	{ G_GUINT64_CONSTANT( 0xf5b5d7ec8acb58a2 ), G_GUINT64_CONSTANT( 0xae10af696774b1db ) },
+	{ G_GUINT64_CONSTANT( 0x9991a6f3d6bf1765 ), G_GUINT64_CONSTANT( 0xacca6da1e0a8ef29 ) },
+	{ G_GUINT64_CONSTANT( 0xbff610b0cc6edd3f ), G_GUINT64_CONSTANT( 0x17fd090a58d32af3 ) },
+	{ G_GUINT64_CONSTANT( 0xeff394dcff8a948e ), G_GUINT64_CONSTANT( 0xddfc4b4cef07f5b0 ) },
+	{ G_GUINT64_CONSTANT( 0x95f83d0a1fb69cd9 ), G_GUINT64_CONSTANT( 0x4abdaf101564f98e ) },
+	{ G_GUINT64_CONSTANT( 0xbb764c4ca7a4440f ), G_GUINT64_CONSTANT( 0x9d6d1ad41abe37f1 ) },
+	{ G_GUINT64_CONSTANT( 0xea53df5fd18d5513 ), G_GUINT64_CONSTANT( 0x84c86189216dc5ed ) },
+	{ G_GUINT64_CONSTANT( 0x92746b9be2f8552c ), G_GUINT64_CONSTANT( 0x32fd3cf5b4e49bb4 ) },
+	{ G_GUINT64_CONSTANT( 0xb7118682dbb66a77 ), G_GUINT64_CONSTANT( 0x3fbc8c33221dc2a1 ) },
+	{ G_GUINT64_CONSTANT( 0xe4d5e82392a40515 ), G_GUINT64_CONSTANT( 0x0fabaf3feaa5334a ) },
+	{ G_GUINT64_CONSTANT( 0x8f05b1163ba6832d ), G_GUINT64_CONSTANT( 0x29cb4d87f2a7400e ) },
+	{ G_GUINT64_CONSTANT( 0xb2c71d5bca9023f8 ), G_GUINT64_CONSTANT( 0x743e20e9ef511012 ) },
+	{ G_GUINT64_CONSTANT( 0xdf78e4b2bd342cf6 ), G_GUINT64_CONSTANT( 0x914da9246b255416 ) },
+	{ G_GUINT64_CONSTANT( 0x8bab8eefb6409c1a ), G_GUINT64_CONSTANT( 0x1ad089b6c2f7548e ) },
+	{ G_GUINT64_CONSTANT( 0xae9672aba3d0c320 ), G_GUINT64_CONSTANT( 0xa184ac2473b529b1 ) },
+	{ G_GUINT64_CONSTANT( 0xda3c0f568cc4f3e8 ), G_GUINT64_CONSTANT( 0xc9e5d72d90a2741e ) },
+	{ G_GUINT64_CONSTANT( 0x8865899617fb1871 ), G_GUINT64_CONSTANT( 0x7e2fa67c7a658892 ) },
+	{ G_GUINT64_CONSTANT( 0xaa7eebfb9df9de8d ), G_GUINT64_CONSTANT( 0xddbb901b98feeab7 ) },
+	{ G_GUINT64_CONSTANT( 0xd51ea6fa85785631 ), G_GUINT64_CONSTANT( 0x552a74227f3ea565 ) },
+	{ G_GUINT64_CONSTANT( 0x8533285c936b35de ), G_GUINT64_CONSTANT( 0xd53a88958f87275f ) },
+	{ G_GUINT64_CONSTANT( 0xa67ff273b8460356 ), G_GUINT64_CONSTANT( 0x8a892abaf368f137 ) },
+	{ G_GUINT64_CONSTANT( 0xd01fef10a657842c ), G_GUINT64_CONSTANT( 0x2d2b7569b0432d85 ) },
+	{ G_GUINT64_CONSTANT( 0x8213f56a67f6b29b ), G_GUINT64_CONSTANT( 0x9c3b29620e29fc73 ) },
+	{ G_GUINT64_CONSTANT( 0xa298f2c501f45f42 ), G_GUINT64_CONSTANT( 0x8349f3ba91b47b8f ) },
+	{ G_GUINT64_CONSTANT( 0xcb3f2f7642717713 ), G_GUINT64_CONSTANT( 0x241c70a936219a73 ) },
+	{ G_GUINT64_CONSTANT( 0xfe0efb53d30dd4d7 ), G_GUINT64_CONSTANT( 0xed238cd383aa0110 ) },
+	{ G_GUINT64_CONSTANT( 0x9ec95d1463e8a506 ), G_GUINT64_CONSTANT( 0xf4363804324a40aa ) },
+	{ G_GUINT64_CONSTANT( 0xc67bb4597ce2ce48 ), G_GUINT64_CONSTANT( 0xb143c6053edcd0d5 ) },
+	{ G_GUINT64_CONSTANT( 0xf81aa16fdc1b81da ), G_GUINT64_CONSTANT( 0xdd94b7868e94050a ) },
+	{ G_GUINT64_CONSTANT( 0x9b10a4e5e9913128 ), G_GUINT64_CONSTANT( 0xca7cf2b4191c8326 ) },
+	{ G_GUINT64_CONSTANT( 0xc1d4ce1f63f57d72 ), G_GUINT64_CONSTANT( 0xfd1c2f611f63a3f0 ) },
+	{ G_GUINT64_CONSTANT( 0xf24a01a73cf2dccf ), G_GUINT64_CONSTANT( 0xbc633b39673c8cec ) },
+	{ G_GUINT64_CONSTANT( 0x976e41088617ca01 ), G_GUINT64_CONSTANT( 0xd5be0503e085d813 ) },
+	{ G_GUINT64_CONSTANT( 0xbd49d14aa79dbc82 ), G_GUINT64_CONSTANT( 0x4b2d8644d8a74e18 ) },
+	{ G_GUINT64_CONSTANT( 0xec9c459d51852ba2 ), G_GUINT64_CONSTANT( 0xddf8e7d60ed1219e ) },
+	{ G_GUINT64_CONSTANT( 0x93e1ab8252f33b45 ), G_GUINT64_CONSTANT( 0xcabb90e5c942b503 ) },
+	{ G_GUINT64_CONSTANT( 0xb8da1662e7b00a17 ), G_GUINT64_CONSTANT( 0x3d6a751f3b936243 ) },
+	{ G_GUINT64_CONSTANT( 0xe7109bfba19c0c9d ), G_GUINT64_CONSTANT( 0x0cc512670a783ad4 ) },
+	{ G_GUINT64_CONSTANT( 0x906a617d450187e2 ), G_GUINT64_CONSTANT( 0x27fb2b80668b24c5 ) },
+	{ G_GUINT64_CONSTANT( 0xb484f9dc9641e9da ), G_GUINT64_CONSTANT( 0xb1f9f660802dedf6 ) },
+	{ G_GUINT64_CONSTANT( 0xe1a63853bbd26451 ), G_GUINT64_CONSTANT( 0x5e7873f8a0396973 ) },
+	{ G_GUINT64_CONSTANT( 0x8d07e33455637eb2 ), G_GUINT64_CONSTANT( 0xdb0b487b6423e1e8 ) },
+	{ G_GUINT64_CONSTANT( 0xb049dc016abc5e5f ), G_GUINT64_CONSTANT( 0x91ce1a9a3d2cda62 ) },
+	{ G_GUINT64_CONSTANT( 0xdc5c5301c56b75f7 ), G_GUINT64_CONSTANT( 0x7641a140cc7810fb ) },
+	{ G_GUINT64_CONSTANT( 0x89b9b3e11b6329ba ), G_GUINT64_CONSTANT( 0xa9e904c87fcb0a9d ) },
+	{ G_GUINT64_CONSTANT( 0xac2820d9623bf429 ), G_GUINT64_CONSTANT( 0x546345fa9fbdcd44 ) },
+	{ G_GUINT64_CONSTANT( 0xd732290fbacaf133 ), G_GUINT64_CONSTANT( 0xa97c177947ad4095 ) },
+	{ G_GUINT64_CONSTANT( 0x867f59a9d4bed6c0 ), G_GUINT64_CONSTANT( 0x49ed8eabcccc485d ) },
+	{ G_GUINT64_CONSTANT( 0xa81f301449ee8c70 ), G_GUINT64_CONSTANT( 0x5c68f256bfff5a74 ) },
+	{ G_GUINT64_CONSTANT( 0xd226fc195c6a2f8c ), G_GUINT64_CONSTANT( 0x73832eec6fff3111 ) },
+	{ G_GUINT64_CONSTANT( 0x83585d8fd9c25db7 ), G_GUINT64_CONSTANT( 0xc831fd53c5ff7eab ) },
+	{ G_GUINT64_CONSTANT( 0xa42e74f3d032f525 ), G_GUINT64_CONSTANT( 0xba3e7ca8b77f5e55 ) },
+	{ G_GUINT64_CONSTANT( 0xcd3a1230c43fb26f ), G_GUINT64_CONSTANT( 0x28ce1bd2e55f35eb ) },
+	{ G_GUINT64_CONSTANT( 0x80444b5e7aa7cf85 ), G_GUINT64_CONSTANT( 0x7980d163cf5b81b3 ) },
+	{ G_GUINT64_CONSTANT( 0xa0555e361951c366 ), G_GUINT64_CONSTANT( 0xd7e105bcc332621f ) },
+	{ G_GUINT64_CONSTANT( 0xc86ab5c39fa63440 ), G_GUINT64_CONSTANT( 0x8dd9472bf3fefaa7 ) },
+	{ G_GUINT64_CONSTANT( 0xfa856334878fc150 ), G_GUINT64_CONSTANT( 0xb14f98f6f0feb951 ) },
+	{ G_GUINT64_CONSTANT( 0x9c935e00d4b9d8d2 ), G_GUINT64_CONSTANT( 0x6ed1bf9a569f33d3 ) },
+	{ G_GUINT64_CONSTANT( 0xc3b8358109e84f07 ), G_GUINT64_CONSTANT( 0x0a862f80ec4700c8 ) },
+	{ G_GUINT64_CONSTANT( 0xf4a642e14c6262c8 ), G_GUINT64_CONSTANT( 0xcd27bb612758c0fa ) },
+	{ G_GUINT64_CONSTANT( 0x98e7e9cccfbd7dbd ), G_GUINT64_CONSTANT( 0x8038d51cb897789c ) },
+	{ G_GUINT64_CONSTANT( 0xbf21e44003acdd2c ), G_GUINT64_CONSTANT( 0xe0470a63e6bd56c3 ) },
+	{ G_GUINT64_CONSTANT( 0xeeea5d5004981478 ), G_GUINT64_CONSTANT( 0x1858ccfce06cac74 ) },
+	{ G_GUINT64_CONSTANT( 0x95527a5202df0ccb ), G_GUINT64_CONSTANT( 0x0f37801e0c43ebc8 ) },
+	{ G_GUINT64_CONSTANT( 0xbaa718e68396cffd ), G_GUINT64_CONSTANT( 0xd30560258f54e6ba ) },
+	{ G_GUINT64_CONSTANT( 0xe950df20247c83fd ), G_GUINT64_CONSTANT( 0x47c6b82ef32a2069 ) },
+	{ G_GUINT64_CONSTANT( 0x91d28b7416cdd27e ), G_GUINT64_CONSTANT( 0x4cdc331d57fa5441 ) },
+	{ G_GUINT64_CONSTANT( 0xb6472e511c81471d ), G_GUINT64_CONSTANT( 0xe0133fe4adf8e952 ) },
+	{ G_GUINT64_CONSTANT( 0xe3d8f9e563a198e5 ), G_GUINT64_CONSTANT( 0x58180fddd97723a6 ) },
+	{ G_GUINT64_CONSTANT( 0x8e679c2f5e44ff8f ), G_GUINT64_CONSTANT( 0x570f09eaa7ea7648 ) },
+};
+
+/* computes w * 10^q. If the result cannot be determined exactly FALSE is
+   returned. */
+static gboolean
+__mbus_eisel_lemire( guint64 w, gint q, gboolean negative, gdouble * number )
+{
+	const guint64 *	pow5;
+	guint64		x_hi, x_lo, mantissa, exponent;
+	guint		lz, msb;
+
+	if ( q < M_DOUBLE_MIN_POW5 || q > M_DOUBLE_MAX_POW5 ) return FALSE;
+	pow5 = __mbus_powers_of_five[ q - M_DOUBLE_MIN_POW5 ];
+
+	lz = __mbus_clz64( w );
+	w <<= lz;
+	/* floor( log2( 10 ) * q ) + 64 + bias - lz */
+	exponent = ( guint64 ) ( ( ( 217706 * q ) >> 16 ) + 64 + 1023 ) - lz;
+
+	__mbus_mul64( w, pow5[ 0 ], &x_hi, &x_lo );
+	/* the lower bits are all set: the product with the lower half of the
+	   power may carry into them */
+	if ( ( x_hi & 0x1FF ) == 0x1FF && x_lo + w < x_lo ) {
+		guint64 y_hi, y_lo, merged_hi = x_hi, merged_lo;
+
+		__mbus_mul64( w, pow5[ 1 ], &y_hi, &y_lo );
+		merged_lo = x_lo + y_hi;
+		if ( merged_lo < x_lo ) merged_hi++;
+		if ( ( merged_hi & 0x1FF ) == 0x1FF && merged_lo + 1 == 0 &&
+		     y_lo + w < y_lo )
+			return FALSE;
+		x_hi = merged_hi;
+		x_lo = merged_lo;
+	}
+
+	msb = ( guint ) ( x_hi >> 63 );
+	mantissa = x_hi >> ( msb + 9 );
+	exponent -= 1 ^ msb;
+
+	/* exactly halfway between two numbers */
+	if ( !x_lo && !( x_hi & 0x1FF ) && ( mantissa & 3 ) == 1 ) return FALSE;
+
+	mantissa += mantissa & 1;
+	mantissa >>= 1;
+	if ( mantissa >> 53 ) {
+		mantissa >>= 1;
+		exponent++;
+	}
+
+	/* subnormal numbers, infinity and overflows are left to strtod */
+	if ( exponent - 1 >= 0x7FF - 1 ) return FALSE;
+
+	mantissa = ( exponent << 52 ) | ( mantissa & M_DOUBLE_FRACTION_MASK );
+	if ( negative ) mantissa |= M_DOUBLE_SIGN_MASK;
+	*number = __mbus_double_from_bits( mantissa );
+
+	return TRUE;
+}
+
+static gdouble
+__mbus_double_parse_slow( const gchar * str, gsize len )
+{
+	gchar	tmp[ 64 ];
+	gchar *	number = tmp;
+	gdouble	result;
+
+	if ( len >= sizeof( tmp ) ) number = g_malloc( len + 1 );
+	memcpy( number, str, len );
+	number[ len ] = '\0';
+
+	result = g_ascii_strtod( number, NULL );
+
+	if ( number != tmp ) g_free( number );
+
+	return result;
+}
+
+/**
+\brief parses the text representation of a floating point number. The
+    result is the double nearest to the decimal number.
+\param str the text. It has to consist of an optional minus sign, the
+    digits with an optional decimal point and an optional exponent
+    introduced by e or E.
+\param len the length of the text
+\param[out] number the floating point number
+\return TRUE if the whole text is a valid number, otherwise FALSE and \a
+    number is not modified
+*/
+gboolean
+mbus_double_parse( const gchar * str, gsize len, gdouble * number )
+{
+	const gchar *	pos = str;
+	const gchar *	end = str + len;
+	guint64		w = 0;
+	gint		q = 0, digits = 0, exponent = 0;
+	gboolean	negative = FALSE, any = FALSE, truncated = FALSE;
+
+	if ( pos < end && *pos == '-' ) {
+		negative = TRUE;
+		pos++;
+	}
+
+	for ( ; pos < end && g_ascii_isdigit( *pos ); pos++ ) {
+		any = TRUE;
+		if ( !w && *pos == '0' ) continue;
+		if ( digits < 19 ) {
+			w = w * 10 + ( *pos - '0' );
+			digits++;
+		} else
+			truncated = TRUE;
+		if ( truncated ) q++;
+	}
+
+	if ( pos < end && *pos == '.' ) {
+		for ( pos++; pos < end && g_ascii_isdigit( *pos ); pos++ ) {
+			any = TRUE;
+			if ( !w && *pos == '0' ) {
+				q--;
+				continue;
+			}
+			if ( digits < 19 ) {
+				w = w * 10 + ( *pos - '0' );
+				digits++;
+				q--;
+			} else
+				truncated = TRUE;
+		}
+	}
+
+	if ( !any ) return FALSE;
+
+	if ( pos < end && ( *pos == 'e' || *pos == 'E' ) ) {
+		gboolean negative_exp = FALSE;
+
+		pos++;
+		if ( pos < end && ( *pos == '-' || *pos == '+' ) )
+			negative_exp = *pos++ == '-';
+		if ( pos == end || !g_ascii_isdigit( *pos ) ) return FALSE;
+		for ( ; pos < end && g_ascii_isdigit( *pos ); pos++ )
+			if ( exponent < 100000 )
+				exponent = exponent * 10 + ( *pos - '0' );
+		q += negative_exp ? -exponent : exponent;
+	}
+
+	if ( pos != end ) return FALSE;
+
+	if ( !w ) {
+		*number = negative ? -0.0 : 0.0;
+		return TRUE;
+	}
+
+	if ( !truncated ) {
+		/* both w and 10^|q| are exact doubles, so is the result of a
+		   single multiplication or division */
+		if ( w <= G_GUINT64_CONSTANT( 1 ) << 53 && q >= -22 && q <= 22 ) {
+			gdouble result = ( gdouble ) w;
+
+			if ( q < 0 )
+				result /= __mbus_exact_pow10[ -q ];
+			else
+				result *= __mbus_exact_pow10[ q ];
+			*number = negative ? -result : result;
+			return TRUE;
+		}
+
+		if ( __mbus_eisel_lemire( w, q, negative, number ) ) return TRUE;
+	}
+
+	*number = __mbus_double_parse_slow( str, len );
+
+	return TRUE;
+}
+
+/**
+\}
+*/
+
+/* end of mdouble.c */
@@ -0,0 +1,57 @@
+/* mdouble.h
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef MBUS_DOUBLE_H
+#define MBUS_DOUBLE_H
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+\addtogroup mdouble MDouble
+\{
+*/
+
+/**
+\def MBUS_DOUBLE_TEXT_SIZE
+\brief the size of a buffer that is big enough to hold the text
+    representation of any floating point number including the terminating
+    zero byte
+*/
+#define MBUS_DOUBLE_TEXT_SIZE 32
+
+gsize mbus_double_format( gdouble number, gchar * buf );
+gboolean mbus_double_parse( const gchar * str, gsize len, gdouble * number );
+
+/**
+\}
+*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBUS_DOUBLE_H */
@@ -0,0 +1,544 @@
+/* mepoll.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "gmbus/mevent.h"
+
+#if defined( HAVE_SYS_EPOLL_H ) && defined( HAVE_SYS_TIMERFD_H )
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+/** maximum number of events fetched by a single call of epoll_wait */
+#define MBUS_EPOLL_BATCH_SIZE 64
+
+/* marks a timer that is not in the heap */
+#define MBUS_EPOLL_NO_INDEX G_MAXUINT
+
+typedef enum { M_EPOLL_IO, M_EPOLL_TIMEOUT, M_EPOLL_IDLE } MEpollType;
+
+/* an I/O watch, timeout or idle function of the epoll engine */
+typedef struct {
+	guint			id;
+	MEpollType		type;
+	/** TRUE if the source was removed. It is freed at the end of the
+		current iteration, as events may still refer to it. */
+	gboolean		removed;
+	MEventIOFunc	io_func;
+	GSourceFunc		func;
+	gpointer		data;
+	/** the watched file descriptor */
+	gint			fd;
+	/** TRUE if the watch has to be dispatched again. The watch is in the
+		list of pending watches exactly if this is set. */
+	gboolean		pending;
+	/** TRUE while the function of the watch runs. Like GLib a watch is
+		not dispatched again by a nested iteration. */
+	gboolean		in_dispatch;
+	/** interval of a timeout in milliseconds */
+	guint			interval;
+	/** the time the timeout expires at in milliseconds */
+	gint64			deadline;
+	/** the position of the timeout in the heap */
+	guint			index;
+} MEpollSource;
+
+static gint			__mbus_epoll_fd = -1;
+static gint			__mbus_epoll_timer_fd = -1;
+/* the deadline the timer file descriptor is set to or -1 */
+static gint64		__mbus_epoll_armed = -1;
+static GHashTable *	__mbus_epoll_sources = NULL;
+static guint		__mbus_epoll_next_id = 1;
+/* the timeouts ordered by their deadlines as a binary heap */
+static GPtrArray *	__mbus_epoll_timers = NULL;
+static GPtrArray *	__mbus_epoll_idles = NULL;
+/* the I/O watches with data left behind */
+static GPtrArray *	__mbus_epoll_pending = NULL;
+static GPtrArray *	__mbus_epoll_removed = NULL;
+static gint			__mbus_epoll_depth = 0;
+static gboolean		__mbus_epoll_quit = FALSE;
+
+static gint64
+__mbus_epoll_now( void )
+{
+	return g_get_monotonic_time() / 1000;
+}
+
+static void
+__mbus_epoll_setup( void )
+{
+	struct epoll_event ev;
+
+	if ( __mbus_epoll_fd != -1 ) return;
+
+	__mbus_epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+	if ( __mbus_epoll_fd == -1 ) {
+		perror( "epoll_create1" );
+		g_error( "failed to setup epoll event engine" );
+	}
+
+	__mbus_epoll_timer_fd = timerfd_create( CLOCK_MONOTONIC,
+			TFD_NONBLOCK | TFD_CLOEXEC );
+	if ( __mbus_epoll_timer_fd == -1 ) {
+		perror( "timerfd_create" );
+		g_error( "failed to setup epoll event engine" );
+	}
+
+	/* the timer is the only event without a source */
+	memset( &ev, 0, sizeof( ev ) );
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	epoll_ctl( __mbus_epoll_fd, EPOLL_CTL_ADD, __mbus_epoll_timer_fd, &ev );
+
+	__mbus_epoll_sources = g_hash_table_new( g_direct_hash, g_direct_equal );
+	__mbus_epoll_timers = g_ptr_array_new();
+	__mbus_epoll_idles = g_ptr_array_new();
+	__mbus_epoll_pending = g_ptr_array_new();
+	__mbus_epoll_removed = g_ptr_array_new();
+}
+
+static MEpollSource *
+__mbus_epoll_source_new( MEpollType type, gpointer data )
+{
+	MEpollSource * self = g_new0( MEpollSource, 1 );
+
+	__mbus_epoll_setup();
+
+	/* zero is no valid identifier */
+	if ( !__mbus_epoll_next_id ) __mbus_epoll_next_id++;
+	self->id = __mbus_epoll_next_id++;
+	self->type = type;
+	self->data = data;
+	self->fd = -1;
+	self->index = MBUS_EPOLL_NO_INDEX;
+	g_hash_table_insert( __mbus_epoll_sources, GUINT_TO_POINTER( self->id ),
+			self );
+
+	return self;
+}
+
+#define __mbus_epoll_timer( i ) \
+	( ( MEpollSource * ) g_ptr_array_index( __mbus_epoll_timers, i ) )
+
+static void
+__mbus_epoll_heap_set( guint i, MEpollSource * timer )
+{
+	g_ptr_array_index( __mbus_epoll_timers, i ) = timer;
+	timer->index = i;
+}
+
+static void
+__mbus_epoll_heap_up( guint i )
+{
+	MEpollSource * timer = __mbus_epoll_timer( i );
+
+	while ( i > 0 ) {
+		guint parent = ( i - 1 ) / 2;
+
+		if ( __mbus_epoll_timer( parent )->deadline <= timer->deadline ) break;
+		__mbus_epoll_heap_set( i, __mbus_epoll_timer( parent ) );
+		i = parent;
+	}
+	__mbus_epoll_heap_set( i, timer );
+}
+
+static void
+__mbus_epoll_heap_down( guint i )
+{
+	MEpollSource *	timer = __mbus_epoll_timer( i );
+	guint			len = __mbus_epoll_timers->len;
+
+	for ( ;; ) {
+		guint child = 2 * i + 1;
+
+		if ( child >= len ) break;
+		if ( child + 1 < len && __mbus_epoll_timer( child + 1 )->deadline <
+				__mbus_epoll_timer( child )->deadline )
+			child++;
+		if ( timer->deadline <= __mbus_epoll_timer( child )->deadline ) break;
+		__mbus_epoll_heap_set( i, __mbus_epoll_timer( child ) );
+		i = child;
+	}
+	__mbus_epoll_heap_set( i, timer );
+}
+
+static void
+__mbus_epoll_heap_push( MEpollSource * timer )
+{
+	g_ptr_array_add( __mbus_epoll_timers, timer );
+	__mbus_epoll_heap_up( __mbus_epoll_timers->len - 1 );
+}
+
+static void
+__mbus_epoll_heap_remove( MEpollSource * timer )
+{
+	guint			i = timer->index;
+	MEpollSource *	last;
+
+	last = g_ptr_array_remove_index( __mbus_epoll_timers,
+			__mbus_epoll_timers->len - 1 );
+	timer->index = MBUS_EPOLL_NO_INDEX;
+	if ( last == timer ) return;
+
+	__mbus_epoll_heap_set( i, last );
+	__mbus_epoll_heap_up( i );
+	__mbus_epoll_heap_down( last->index );
+}
+
+/* sets the timer file descriptor to the deadline of the next timeout */
+static void
+__mbus_epoll_arm( void )
+{
+	struct itimerspec	spec;
+	gint64				deadline = -1;
+
+	if ( __mbus_epoll_timers->len )
+		deadline = __mbus_epoll_timer( 0 )->deadline;
+	if ( deadline == __mbus_epoll_armed ) return;
+
+	/* a zero value disarms the timer */
+	memset( &spec, 0, sizeof( spec ) );
+	if ( deadline >= 0 ) {
+		spec.it_value.tv_sec = deadline / 1000;
+		spec.it_value.tv_nsec = ( deadline % 1000 ) * 1000000;
+		if ( !deadline ) spec.it_value.tv_nsec = 1;
+	}
+	if ( timerfd_settime( __mbus_epoll_timer_fd, TFD_TIMER_ABSTIME, &spec,
+				NULL ) == -1 )
+		perror( "timerfd_settime" );
+	__mbus_epoll_armed = deadline;
+}
+
+static void
+__mbus_epoll_init( gpointer loop )
+{
+	__mbus_epoll_setup();
+}
+
+static gboolean
+__mbus_epoll_dispatching( void )
+{
+	return __mbus_epoll_depth > 0;
+}
+
+static guint
+__mbus_epoll_add_io( gint fd, MEventIOFunc func, gpointer data )
+{
+	MEpollSource *		self = __mbus_epoll_source_new( M_EPOLL_IO, data );
+	struct epoll_event	ev;
+
+	self->io_func = func;
+	self->fd = fd;
+
+	memset( &ev, 0, sizeof( ev ) );
+	ev.events = EPOLLIN | EPOLLET;
+	ev.data.ptr = self;
+	if ( epoll_ctl( __mbus_epoll_fd, EPOLL_CTL_ADD, fd, &ev ) == -1 ) {
+		perror( "epoll_ctl" );
+		g_hash_table_remove( __mbus_epoll_sources,
+				GUINT_TO_POINTER( self->id ) );
+		g_free( self );
+		return 0;
+	}
+
+	return self->id;
+}
+
+static guint
+__mbus_epoll_add_timeout( guint interval, GSourceFunc func, gpointer data )
+{
+	MEpollSource * self = __mbus_epoll_source_new( M_EPOLL_TIMEOUT, data );
+
+	self->func = func;
+	self->interval = interval;
+	self->deadline = __mbus_epoll_now() + interval;
+	__mbus_epoll_heap_push( self );
+
+	return self->id;
+}
+
+static guint
+__mbus_epoll_add_idle( GSourceFunc func, gpointer data )
+{
+	MEpollSource * self = __mbus_epoll_source_new( M_EPOLL_IDLE, data );
+
+	self->func = func;
+	g_ptr_array_add( __mbus_epoll_idles, self );
+
+	return self->id;
+}
+
+static void
+__mbus_epoll_remove( guint id )
+{
+	MEpollSource * self;
+
+	if ( !__mbus_epoll_sources ) return;
+	self = g_hash_table_lookup( __mbus_epoll_sources, GUINT_TO_POINTER( id ) );
+	if ( !self ) return;
+
+	g_hash_table_remove( __mbus_epoll_sources, GUINT_TO_POINTER( id ) );
+	self->removed = TRUE;
+
+	switch ( self->type ) {
+	case M_EPOLL_IO:
+		epoll_ctl( __mbus_epoll_fd, EPOLL_CTL_DEL, self->fd, NULL );
+		if ( self->pending )
+			g_ptr_array_remove( __mbus_epoll_pending, self );
+		break;
+	case M_EPOLL_TIMEOUT:
+		if ( self->index != MBUS_EPOLL_NO_INDEX )
+			__mbus_epoll_heap_remove( self );
+		break;
+	default:
+		g_ptr_array_remove( __mbus_epoll_idles, self );
+		break;
+	}
+
+	g_ptr_array_add( __mbus_epoll_removed, self );
+}
+
+/* makes the next iteration dispatch the watch again */
+static void
+__mbus_epoll_set_pending( MEpollSource * self )
+{
+	if ( !self->pending ) g_ptr_array_add( __mbus_epoll_pending, self );
+	self->pending = TRUE;
+}
+
+static void
+__mbus_epoll_dispatch_io( MEpollSource * self )
+{
+	MEventResult result;
+
+	if ( self->removed ) return;
+
+	/* the edge reported to a nested iteration is handled after the
+	   running function returned */
+	if ( self->in_dispatch ) {
+		__mbus_epoll_set_pending( self );
+		return;
+	}
+
+	self->in_dispatch = TRUE;
+	result = self->io_func( self->fd, self->data );
+	self->in_dispatch = FALSE;
+	if ( self->removed ) return;
+
+	switch ( result ) {
+	case M_EVENT_REMOVE:
+		__mbus_epoll_remove( self->id );
+		break;
+	case M_EVENT_PENDING:
+		/* no further edge will be reported for the data left behind */
+		__mbus_epoll_set_pending( self );
+		break;
+	default:
+		break;
+	}
+}
+
+/* runs all expired timeouts. Timeouts added or rescheduled by the
+   callbacks expire in the next iteration at the earliest. */
+static void
+__mbus_epoll_dispatch_timers( void )
+{
+	GPtrArray *	expired = g_ptr_array_new();
+	gint64		now = __mbus_epoll_now();
+	guint64		ticks;
+	guint		i;
+
+	if ( read( __mbus_epoll_timer_fd, &ticks, sizeof( ticks ) ) == -1 &&
+			errno != EAGAIN )
+		perror( "read" );
+	/* the timer has to be set again even for the same deadline */
+	__mbus_epoll_armed = -1;
+
+	while ( __mbus_epoll_timers->len &&
+			__mbus_epoll_timer( 0 )->deadline <= now ) {
+		MEpollSource * timer = __mbus_epoll_timer( 0 );
+
+		__mbus_epoll_heap_remove( timer );
+		g_ptr_array_add( expired, timer );
+	}
+
+	for ( i = 0; i < expired->len; i++ ) {
+		MEpollSource * timer = g_ptr_array_index( expired, i );
+
+		if ( timer->removed ) continue;
+		if ( timer->func( timer->data ) ) {
+			if ( timer->removed ) continue;
+			timer->deadline = __mbus_epoll_now() + timer->interval;
+			__mbus_epoll_heap_push( timer );
+		} else if ( !timer->removed )
+			__mbus_epoll_remove( timer->id );
+	}
+
+	g_ptr_array_free( expired, TRUE );
+}
+
+/* runs the idle functions that existed when the iteration started */
+static void
+__mbus_epoll_dispatch_idles( void )
+{
+	GPtrArray *	idles = __mbus_epoll_idles;
+	guint		i;
+
+	__mbus_epoll_idles = g_ptr_array_new();
+
+	for ( i = 0; i < idles->len; i++ ) {
+		MEpollSource * idle = g_ptr_array_index( idles, i );
+
+		if ( idle->removed ) continue;
+		if ( idle->func( idle->data ) ) {
+			if ( !idle->removed ) g_ptr_array_add( __mbus_epoll_idles, idle );
+		} else if ( !idle->removed )
+			__mbus_epoll_remove( idle->id );
+	}
+
+	g_ptr_array_free( idles, TRUE );
+}
+
+/* frees the removed sources. No list or event refers to them anymore. */
+static void
+__mbus_epoll_cleanup( void )
+{
+	guint i;
+
+	for ( i = 0; i < __mbus_epoll_removed->len; i++ )
+		g_free( g_ptr_array_index( __mbus_epoll_removed, i ) );
+	g_ptr_array_set_size( __mbus_epoll_removed, 0 );
+}
+
+/* processes the events reported by a single call of epoll_wait. The
+   watches left with pending data are dispatched first. Idle functions run
+   after all events. */
+static gboolean
+__mbus_epoll_iteration( gboolean may_block )
+{
+	struct epoll_event	events[ MBUS_EPOLL_BATCH_SIZE ];
+	GPtrArray *			pending;
+	gint				timeout = may_block ? -1 : 0;
+	gint				n, i;
+	gboolean			dispatched;
+
+	__mbus_epoll_setup();
+
+	if ( __mbus_epoll_idles->len || __mbus_epoll_pending->len ) timeout = 0;
+	__mbus_epoll_arm();
+
+	n = epoll_wait( __mbus_epoll_fd, events, MBUS_EPOLL_BATCH_SIZE, timeout );
+	if ( n == -1 ) {
+		if ( errno != EINTR ) perror( "epoll_wait" );
+		n = 0;
+	}
+
+	__mbus_epoll_depth++;
+
+	pending = __mbus_epoll_pending;
+	__mbus_epoll_pending = g_ptr_array_new();
+	for ( i = 0; i < ( gint ) pending->len; i++ )
+		( ( MEpollSource * ) g_ptr_array_index( pending, i ) )->pending = FALSE;
+	for ( i = 0; i < ( gint ) pending->len; i++ )
+		__mbus_epoll_dispatch_io( g_ptr_array_index( pending, i ) );
+
+	for ( i = 0; i < n; i++ ) {
+		if ( events[ i ].data.ptr )
+			__mbus_epoll_dispatch_io( events[ i ].data.ptr );
+		else
+			__mbus_epoll_dispatch_timers();
+	}
+
+	__mbus_epoll_dispatch_idles();
+
+	__mbus_epoll_depth--;
+
+	dispatched = n > 0 || pending->len > 0;
+	g_ptr_array_free( pending, TRUE );
+	/* an outer iteration may still refer to the removed sources */
+	if ( !__mbus_epoll_depth ) __mbus_epoll_cleanup();
+
+	return dispatched;
+}
+
+static void
+__mbus_epoll_run( void )
+{
+	__mbus_epoll_quit = FALSE;
+
+	while ( !__mbus_epoll_quit ) __mbus_epoll_iteration( TRUE );
+}
+
+static void
+__mbus_epoll_quit_loop( void )
+{
+	__mbus_epoll_quit = TRUE;
+}
+
+static const MEventEngine __mbus_epoll_engine = {
+	"epoll",
+	__mbus_epoll_init,
+	__mbus_epoll_run,
+	__mbus_epoll_iteration,
+	__mbus_epoll_quit_loop,
+	__mbus_epoll_dispatching,
+	__mbus_epoll_add_io,
+	__mbus_epoll_add_timeout,
+	__mbus_epoll_add_idle,
+	__mbus_epoll_remove
+};
+
+#endif
+
+/**
+\addtogroup mevent MEventEngine
+\{
+*/
+
+/**
+\brief Returns the event engine based on epoll and a timerfd. Sockets are
+    watched edge-triggered and the events are processed in batches. All
+    timeouts share a single timer file descriptor. The engine is not
+    thread-safe.
+\return the epoll event engine or NULL if it is not supported by the
+    system
+*/
+const MEventEngine *
+mbus_event_epoll_engine( void )
+{
+#if defined( HAVE_SYS_EPOLL_H ) && defined( HAVE_SYS_TIMERFD_H )
+	return &__mbus_epoll_engine;
+#else
+	return NULL;
+#endif
+}
+
+/**
+\}
+*/
+
+/* end of mepoll.c */
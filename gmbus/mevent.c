@@ -0,0 +1,172 @@
+/* mevent.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "gmbus/mevent.h"
+
+/**
+\addtogroup mevent MEventEngine
+\{
+*/
+
+/* the main loop of the GLib engine */
+static GMainLoop * __mbus_glib_loop = NULL;
+
+/* an I/O watch of the GLib engine */
+typedef struct {
+	MEventIOFunc	func;
+	gpointer		data;
+} MGlibWatch;
+
+static void
+__mbus_glib_init( gpointer loop )
+{
+	if ( loop == NULL ) {
+		__mbus_glib_loop = g_main_loop_new( NULL, FALSE );
+	} else {
+		g_main_loop_ref( loop );
+		__mbus_glib_loop = loop;
+	}
+}
+
+static void
+__mbus_glib_run( void )
+{
+	g_main_loop_run( __mbus_glib_loop );
+}
+
+static gboolean
+__mbus_glib_iteration( gboolean may_block )
+{
+	return g_main_context_iteration( NULL, may_block );
+}
+
+static void
+__mbus_glib_quit( void )
+{
+	g_main_loop_quit( __mbus_glib_loop );
+	g_main_loop_unref( __mbus_glib_loop );
+}
+
+static gboolean
+__mbus_glib_dispatching( void )
+{
+	return g_main_depth() > 0;
+}
+
+/* GLib watches are level-triggered, so pending data causes another event
+   anyway */
+static gboolean
+__mbus_glib_io_event( GIOChannel * channel, GIOCondition cond,
+		MGlibWatch * watch )
+{
+	return watch->func( g_io_channel_unix_get_fd( channel ), watch->data )
+		!= M_EVENT_REMOVE;
+}
+
+static guint
+__mbus_glib_add_io( gint fd, MEventIOFunc func, gpointer data )
+{
+	GIOChannel *	channel = g_io_channel_unix_new( fd );
+	MGlibWatch *	watch = g_new( MGlibWatch, 1 );
+	guint			id;
+
+	watch->func = func;
+	watch->data = data;
+	id = g_io_add_watch_full( channel, G_PRIORITY_DEFAULT, G_IO_IN,
+			( GIOFunc ) __mbus_glib_io_event, watch, g_free );
+	g_io_channel_unref( channel );
+
+	return id;
+}
+
+static guint
+__mbus_glib_add_timeout( guint interval, GSourceFunc func, gpointer data )
+{
+	return g_timeout_add( interval, func, data );
+}
+
+/* idle functions flush queued data, so they run before other events */
+static guint
+__mbus_glib_add_idle( GSourceFunc func, gpointer data )
+{
+	return g_idle_add_full( G_PRIORITY_HIGH, func, data, NULL );
+}
+
+static void
+__mbus_glib_remove( guint id )
+{
+	g_source_remove( id );
+}
+
+static const MEventEngine __mbus_glib_engine = {
+	"glib",
+	__mbus_glib_init,
+	__mbus_glib_run,
+	__mbus_glib_iteration,
+	__mbus_glib_quit,
+	__mbus_glib_dispatching,
+	__mbus_glib_add_io,
+	__mbus_glib_add_timeout,
+	__mbus_glib_add_idle,
+	__mbus_glib_remove
+};
+
+static const MEventEngine * __mbus_engine = &__mbus_glib_engine;
+
+/**
+\brief Returns the event engine based on the default GMainContext of GLib.
+    It is used unless another engine is selected.
+\return the GLib event engine
+*/
+const MEventEngine *
+mbus_event_glib_engine( void )
+{
+	return &__mbus_glib_engine;
+}
+
+/**
+\brief Selects the event engine used by the library. It must be called
+    before mbus_init and before any Mbus object is created.
+\param engine the event engine. If it is NULL the GLib engine is used.
+*/
+void
+mbus_event_set_engine( const MEventEngine * engine )
+{
+	__mbus_engine = engine ? engine : &__mbus_glib_engine;
+}
+
+/**
+\brief Returns the current event engine
+\return the event engine used by the library
+*/
+const MEventEngine *
+mbus_event_engine( void )
+{
+	return __mbus_engine;
+}
+
+/**
+\}
+*/
+
+/* end of mevent.c */
@@ -0,0 +1,136 @@
+/* mevent.h
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef MBUS_EVENT_H
+#define MBUS_EVENT_H
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+\addtogroup mevent MEventEngine
+\{
+*/
+
+/**
+\brief tells the event engine what to do with an I/O watch after its
+    callback returned
+*/
+typedef enum {
+	/** remove the watch */
+	M_EVENT_REMOVE,
+	/** the file descriptor was read until it would block */
+	M_EVENT_DRAINED,
+	/** data may still be waiting. An edge-triggered engine invokes the
+		callback again in its next iteration. */
+	M_EVENT_PENDING
+} MEventResult;
+
+/**
+\brief callback of an I/O watch invoked when \a fd becomes readable
+*/
+typedef MEventResult ( *MEventIOFunc )( gint fd, gpointer data );
+
+/**
+\brief The operations of an event engine. All sockets and timers of the
+    library are registered through the current engine, so the main loop
+    can be replaced. The identifiers returned by the add functions are
+    only unique within an engine and never 0.
+*/
+typedef struct {
+	/** name of the engine */
+	const gchar *	name;
+	/** sets up the main loop. The argument is a GMainLoop for the GLib
+		engine and ignored by the others. */
+	void ( *init )( gpointer loop );
+	/** runs the main loop until quit is called */
+	void ( *run )( void );
+	/** runs a single iteration of the main loop */
+	gboolean ( *iteration )( gboolean may_block );
+	/** stops the main loop */
+	void ( *quit )( void );
+	/** TRUE while the engine dispatches events */
+	gboolean ( *dispatching )( void );
+	/** watches a file descriptor for incoming data */
+	guint ( *add_io )( gint fd, MEventIOFunc func, gpointer data );
+	/** calls a function every \a interval milliseconds as long as it
+		returns TRUE */
+	guint ( *add_timeout )( guint interval, GSourceFunc func, gpointer data );
+	/** calls a function once the pending events are processed as long as
+		it returns TRUE */
+	guint ( *add_idle )( GSourceFunc func, gpointer data );
+	/** removes an I/O watch, timeout or idle function */
+	void ( *remove )( guint id );
+} MEventEngine;
+
+const MEventEngine * mbus_event_glib_engine( void );
+const MEventEngine * mbus_event_epoll_engine( void );
+void mbus_event_set_engine( const MEventEngine * engine );
+const MEventEngine * mbus_event_engine( void );
+
+/**
+\def mbus_event_add_io
+\brief watches a file descriptor using the current event engine
+*/
+#define mbus_event_add_io( fd, func, data ) \
+	( mbus_event_engine()->add_io( fd, func, data ) )
+
+/**
+\def mbus_event_add_timeout
+\brief adds a timeout to the current event engine
+*/
+#define mbus_event_add_timeout( interval, func, data ) \
+	( mbus_event_engine()->add_timeout( interval, func, data ) )
+
+/**
+\def mbus_event_add_idle
+\brief adds an idle function to the current event engine
+*/
+#define mbus_event_add_idle( func, data ) \
+	( mbus_event_engine()->add_idle( func, data ) )
+
+/**
+\def mbus_event_remove
+\brief removes a watch, timeout or idle function from the current event
+    engine
+*/
+#define mbus_event_remove( id ) ( mbus_event_engine()->remove( id ) )
+
+/**
+\def mbus_event_dispatching
+\brief checks if the current event engine is dispatching events
+*/
+#define mbus_event_dispatching() ( mbus_event_engine()->dispatching() )
+
+/**
+\}
+*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBUS_EVENT_H */
@@ -26,7 +26,6 @@
 
 #include <time.h>
 #include <string.h>
-#include <ctype.h>
 
 static const char * pvers = "mbus/1.0";
 
@@ -69,50 +68,105 @@ mbus_header_free( MHeader * self )
 	g_free( self );
 }
 
+static gboolean
+__mbus_header_intern_address( MAddress ** address, MCursor * cursor )
+{
+	MAddress * interned = mbus_address_intern( cursor );
+
+	if ( !interned ) return FALSE;
+
+	mbus_address_unref( *address );
+	*address = interned;
+
+	return TRUE;
+}
+
+/* interned addresses are shared instead of copied. An address that is
+   shared with others is replaced instead of modified. */
+static void
+__mbus_header_assign_address( MAddress ** address, const MAddress * other )
+{
+	if ( mbus_address_is_interned( other ) ) {
+		if ( *address == other ) return;
+		mbus_address_unref( *address );
+		*address = mbus_address_ref( other );
+	} else if ( mbus_address_is_interned( *address ) ) {
+		mbus_address_unref( *address );
+		*address = mbus_address_copy( ( MAddress * ) other );
+	} else
+		mbus_address_assign( *address, other );
+}
+
+/**
+\brief Sets the source address of a header. An interned address of a
+    received message is replaced, so the header may be sent again with
+    another source.
+\param self the header
+\param address the new source address
+*/
+void
+mbus_header_set_source( MHeader * self, const MAddress * address )
+{
+	__mbus_header_assign_address( &self->source, address );
+}
+
+/**
+\brief Sets the destination address of a header. An interned address of
+    a received message is replaced, so the header may be sent again to
+    another destination.
+\param self the header
+\param address the new destination address
+*/
+void
+mbus_header_set_destination( MHeader * self, const MAddress * address )
+{
+	__mbus_header_assign_address( &self->destination, address );
+}
+
+/**
+\brief Parses an Mbus message header at the current position of the cursor
+\param[out] self the header object storing the parsed information
+\param cursor the cursor pointing to the header. It is moved forward while
+    parsing and points to the closing bracket of the acknowledgement list
+    on success.
+\return TRUE if the header could be parsed, otherwise FALSE
+*/
 gboolean
-mbus_header_read( MHeader * self, GString * buf )
+mbus_header_parse( MHeader * self, MCursor * cursor )
 {
-	gint		pvlen = strlen( pvers );
-	gchar		numbuf[ 64 ];
-	gchar *		pos;
-	gint		nc = 0;
+	gsize		pvlen = strlen( pvers );
+	const gchar *	pos;
 
 	self->ok = FALSE;
 
-	mbus_util_cut_whitespaces( buf );
+	mbus_cursor_skip_whitespaces( cursor );
 
-	if ( strncmp( buf->str, pvers, pvlen ) != 0 ) return FALSE;
-	g_string_erase( buf, 0, pvlen );
-	mbus_util_cut_whitespaces( buf );
+	if ( mbus_cursor_left( cursor ) < pvlen ||
+			strncmp( cursor->pos, pvers, pvlen ) != 0 ) return FALSE;
+	cursor->pos += pvlen;
+	mbus_cursor_skip_whitespaces( cursor );
 
-	/* copy version number */
-	numbuf[ 0 ] = '\0';
-	pos = buf->str;
-	while( isdigit( *pos ) && ( nc < 64 ) ) {
-		numbuf[ nc++ ] = *pos; ++pos;
-	}
-	numbuf[ nc ] = '\0';
-
-	if ( !mbus_util_str_to_uint64( numbuf, &self->sequence_no ) ||
-			!isspace( *pos ) )
+	/* sequence number */
+	pos = cursor->pos;
+	if ( !mbus_cursor_read_uint64( cursor, &self->sequence_no ) ||
+			!g_ascii_isspace( mbus_cursor_peek( cursor ) ) ) {
+		cursor->pos = pos;
 		return FALSE;
-
-	g_string_erase( buf, 0, nc + 1 );
-	mbus_util_cut_whitespaces( buf );
-	pos = buf->str;
-	nc = 0;
-	while ( isdigit( *pos ) && ( nc < 64 ) ) {
-		numbuf[ nc++ ] = *pos; ++pos;
 	}
-	numbuf[ nc++ ] = '\0';
-	if ( !mbus_util_str_to_uint64( numbuf, &self->timestamp ) ||
-			!isspace( *pos ) )
+	cursor->pos++;
+	mbus_cursor_skip_whitespaces( cursor );
+
+	/* timestamp */
+	pos = cursor->pos;
+	if ( !mbus_cursor_read_uint64( cursor, &self->timestamp ) ||
+			!g_ascii_isspace( mbus_cursor_peek( cursor ) ) ) {
+		cursor->pos = pos;
 		return FALSE;
+	}
+	cursor->pos++;
 
-	/* cut behind terminating zero (after timestamp) */
-	g_string_erase( buf, 0, nc );
 	/* message type */
-	switch( buf->str[ 0 ] ) {
+	switch( mbus_cursor_peek( cursor ) ) {
 	case 'U':
 		self->type = UNRELIABLE;
 		break;
@@ -122,106 +176,156 @@ mbus_header_read( MHeader * self, GString * buf )
 	default:
 		return FALSE;			/* error */
 	}
-	++pos;
+	cursor->pos++;
+	mbus_cursor_skip_whitespaces( cursor );
 
-	g_string_erase( buf, 0, 1 );
-	mbus_util_cut_whitespaces( buf );
+	/* the addresses of received messages are interned */
+	if ( !__mbus_header_intern_address( &self->source, cursor ) ||
+			!__mbus_header_intern_address( &self->destination, cursor ) )
+		return FALSE;
 
-	mbus_address_read( self->source, buf );
-	if ( !mbus_address_ok( self->source ) ) return FALSE;
+	mbus_cursor_skip_whitespaces( cursor );
+	/* reading acknowledgement list */
+	if ( mbus_cursor_peek( cursor ) != '(' ) return FALSE;
+	cursor->pos++;
+	/* the header may be parsed again */
+	g_array_set_size( self->acks, 0 );
 
-	mbus_address_read( self->destination, buf );
-	if ( !mbus_address_ok( self->destination ) ) return FALSE;
+	while ( TRUE ) {
+		guint64 v;
 
-	mbus_util_cut_whitespaces( buf );
-	/* reading acknowledgement list */
-	if ( buf->str[ 0 ] != '(' ) {
-		return FALSE;
-	} else {
-		gboolean finished = FALSE;
-
-		g_string_erase( buf, 0, 1 );
-
-		while ( !finished ) {
-			guint64 v;
-
-			mbus_util_cut_whitespaces( buf );
-			pos = buf->str;
-			nc = 0;
-			if ( *pos == ')' ) {
-				finished = TRUE;
-			} else {
-				while ( isdigit( *pos ) && ( nc < 64 ) ) {
-					numbuf[ nc++ ] = *pos; ++pos;
-				}
-				numbuf[ nc ] = '\0';
-				if ( ( !isspace( *pos ) || *pos == ')' ) ||
-						! mbus_util_str_to_uint64( numbuf, &v ) )
-					return FALSE;
-
-				g_array_append_val( self->acks, v );
-				g_string_erase( buf, 0, nc );
-			}
-		} /* while(!finished) */
-	}
+		mbus_cursor_skip_whitespaces( cursor );
+		if ( mbus_cursor_peek( cursor ) == ')' ) break;
+
+		pos = cursor->pos;
+		if ( !mbus_cursor_read_uint64( cursor, &v ) ||
+				!g_ascii_isspace( mbus_cursor_peek( cursor ) ) ) {
+			cursor->pos = pos;
+			return FALSE;
+		}
 
-	g_string_erase( buf, 0, ( gsize ) ( pos - buf->str ) );
+		g_array_append_val( self->acks, v );
+	} /* while(TRUE) */
 
 	self->ok = TRUE;
 
 	return TRUE;
 }
 
+/**
+\brief Parses an Mbus message header
+\param[out] self the header object storing the parsed information
+\param buf the buffer containing the header. All characters in front of
+    the closing bracket of the acknowledgement list are removed from it.
+\return TRUE if the header could be parsed, otherwise FALSE
+*/
+gboolean
+mbus_header_read( MHeader * self, GString * buf )
+{
+	MCursor		cursor;
+	gboolean	ret;
+
+	mbus_cursor_init( &cursor, buf->str, buf->len );
+	ret = mbus_header_parse( self, &cursor );
+	g_string_erase( buf, 0, cursor.pos - buf->str );
+
+	return ret;
+}
+
 gboolean
 mbus_header_as_string( MHeader * self, GString * buf )
 {
-	gchar		type;
-	GTimeVal	now;
-	guint64		timestamp;
-	guint		i;
+	MWriter	writer;
+	guint64	timestamp = mbus_header_timestamp_now();
+
+	mbus_writer_init_append( &writer, buf,
+			mbus_header_text_len( self, timestamp ) );
+	mbus_header_write( self, timestamp, &writer );
+
+	return TRUE;
+}
+
+/**
+\brief Returns the current time in the format used for the timestamp of
+    message headers
+\return the number of milliseconds since the epoch
+*/
+guint64
+mbus_header_timestamp_now( void )
+{
+	GTimeVal now;
 
 	g_get_current_time( &now );
+
+	return ( guint64 ) now.tv_sec * 1000 + ( guint64 ) now.tv_usec / 1000;
+}
+
+/**
+\brief Computes the length of the string representation of the header
+\param self the header
+\param timestamp the timestamp that will be written
+\return the number of characters mbus_header_write will write
+*/
+gsize
+mbus_header_text_len( const MHeader * self, guint64 timestamp )
+{
+	gsize	len;
+	guint	i;
+
+	/* <protocol version> <sequence no> <timestamp> <type> */
+	len = strlen( pvers ) + 1 + mbus_writer_uint64_len( self->sequence_no ) +
+		1 + mbus_writer_uint64_len( timestamp ) + 3;
+	/* <source> <destination> (<acks>) */
+	len += mbus_address_text_len( self->source ) + 1 +
+		mbus_address_text_len( self->destination ) + 3;
+	for ( i = 0; i < self->acks->len; i++ )
+		len += mbus_writer_int64_len( g_array_index( self->acks, glong, i ) ) + 1;
+
+	return len;
+}
+
+/**
+\brief Writes the string representation of the header
+\param self the header
+\param timestamp the timestamp to write. The timestamp of the header is
+    left unchanged, as messages are stamped when they are sent.
+\param writer the writer with room for at least mbus_header_text_len
+    characters
+*/
+void
+mbus_header_write( MHeader * self, guint64 timestamp, MWriter * writer )
+{
+	guint i;
+
 	self->ok = FALSE;
-	/* calc type */
-	switch ( self->type ) {
-	case RELIABLE:
-		type = 'R';
-		break;
-	case UNRELIABLE:
-	default:
-		type = 'U';
-		break;
-	}
 
 	/* <protocol version> <sequence no> <timestamp> <type> */
-	timestamp = ( guint64 ) now.tv_sec * 1000 + ( guint64 ) now.tv_usec / 1000;
-	g_string_append( buf, pvers );
-	g_string_append_c( buf, ' ' );
-	mbus_util_int64_to_str( buf, self->sequence_no, FALSE );
-	g_string_append_c( buf, ' ' );
-	mbus_util_int64_to_str( buf, timestamp, FALSE );
-	g_string_append_c( buf, ' ' );
-	g_string_append_c( buf, type );
-	g_string_append_c( buf, ' ' );
+	mbus_writer_put( writer, pvers, strlen( pvers ) );
+	mbus_writer_put_c( writer, ' ' );
+	mbus_writer_put_uint64( writer, self->sequence_no );
+	mbus_writer_put_c( writer, ' ' );
+	mbus_writer_put_uint64( writer, timestamp );
+	mbus_writer_put_c( writer, ' ' );
+	mbus_writer_put_c( writer, self->type == RELIABLE ? 'R' : 'U' );
+	mbus_writer_put_c( writer, ' ' );
 
 	/* source address */
-	mbus_address_as_string( self->source, buf );
-	g_string_append_c( buf, ' ' );
+	mbus_address_write( self->source, writer );
+	mbus_writer_put_c( writer, ' ' );
 
 	/* destination address */
-	mbus_address_as_string( self->destination, buf );
-	g_string_append( buf, " (" );
+	mbus_address_write( self->destination, writer );
+	mbus_writer_put( writer, " (", 2 );
 
 	/* acknowledgements */
-	for ( i = 0; i < self->acks->len; i++ )
-		g_string_append_printf( buf, "%ld ",
-			    g_array_index( self->acks, glong, i ) );
+	for ( i = 0; i < self->acks->len; i++ ) {
+		mbus_writer_put_int64( writer, g_array_index( self->acks, glong, i ) );
+		mbus_writer_put_c( writer, ' ' );
+	}
 
-	g_string_append_c( buf, ')' );
+	mbus_writer_put_c( writer, ')' );
 
 	self->ok = TRUE;
-
-	return TRUE;
 }
 
 MHeader *
@@ -232,8 +336,9 @@ mbus_header_assign( MHeader * self, MHeader * rhs )
 		self->pvers = rhs->pvers; /* pvers isn't strduped */
 		self->sequence_no = rhs->sequence_no;
 		self->timestamp = rhs->timestamp;
-		mbus_address_assign( self->source, rhs->source );
-		mbus_address_assign( self->destination, rhs->destination );
+		__mbus_header_assign_address( &self->source, rhs->source );
+		__mbus_header_assign_address( &self->destination,
+				rhs->destination );
 
 		/* copy array of long's */
 		g_array_free( self->acks, TRUE );
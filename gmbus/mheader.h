@@ -69,9 +69,16 @@ typedef struct {
 
 MHeader * mbus_header_new( void );
 MHeader * mbus_header_assign( MHeader * self, MHeader * rhs );
+void mbus_header_set_source( MHeader * self, const MAddress * address );
+void mbus_header_set_destination( MHeader * self,
+		const MAddress * address );
 void mbus_header_free( MHeader * me );
+gboolean mbus_header_parse( MHeader * me, MCursor * cursor );
 gboolean mbus_header_read( MHeader * me, GString * buf );
 gboolean mbus_header_as_string( MHeader * me, GString * buf );
+guint64 mbus_header_timestamp_now( void );
+gsize mbus_header_text_len( const MHeader * self, guint64 timestamp );
+void mbus_header_write( MHeader * self, guint64 timestamp, MWriter * writer );
 #define mbus_header_ok(m) ( m->ok )
 
 /**
@@ -21,12 +21,143 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 
+/* recvmmsg and sendmmsg are GNU extensions */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "gmbus/mlink.h"
+#include "gmbus/mevent.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#ifdef HAVE_UDP_SEGMENT
+#include <netinet/udp.h>
+#endif
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+
+/* maximum number of segments and bytes the kernel accepts for a single
+   UDP GSO send */
+#define M_LINK_GSO_MAX_SEGMENTS 64
+#define M_LINK_GSO_MAX_BYTES 65000
+
+/* a message waiting in the send queue */
+typedef struct {
+	/** position of the encoded message in the queue buffer */
+	gsize		offset;
+	/** length of the encoded message */
+	gsize		len;
+	/** the receiver */
+	MEndpoint	ep;
+} MLinkQueued;
+
+struct _MLinkBatch {
+	/** MBUS_LINK_BATCH_SIZE receive buffers of MBUS_MESSAGE_BUF_SIZE
+		bytes each */
+	guchar *		recv_ring;
+	/** senders of the received datagrams */
+	MEndpoint		recv_from[ MBUS_LINK_BATCH_SIZE ];
+	/** lengths of the received datagrams */
+	gsize			recv_len[ MBUS_LINK_BATCH_SIZE ];
+#ifdef HAVE_RECVMMSG
+	struct mmsghdr	recv_msgs[ MBUS_LINK_BATCH_SIZE ];
+	struct iovec	recv_iov[ MBUS_LINK_BATCH_SIZE ];
+#endif
+	/** the decoded messages of the last batch. A callback may run a
+		nested iteration of the main loop that receives into the buffers
+		above again, so a batch is decoded before it is delivered. */
+	MMessage *		recv_messages[ MBUS_LINK_BATCH_SIZE ];
+	/** the errors of decoding the datagrams */
+	MErrorType		recv_errors[ MBUS_LINK_BATCH_SIZE ];
+	/** senders of the decoded messages */
+	MEndpoint		recv_senders[ MBUS_LINK_BATCH_SIZE ];
+	/** index of the next decoded message to deliver */
+	guint			recv_next;
+	/** number of decoded messages */
+	guint			recv_count;
+
+	/** the encoded messages waiting to be sent */
+	GByteArray *	send_data;
+	/** the messages waiting to be sent */
+	MLinkQueued		send_queue[ MBUS_LINK_BATCH_SIZE ];
+	/** the number of messages waiting to be sent */
+	guint			send_count;
+	/** event source flushing the send queue or 0 */
+	guint			flush_source;
+#ifdef HAVE_SENDMMSG
+	struct mmsghdr	send_msgs[ MBUS_LINK_BATCH_SIZE ];
+	struct iovec	send_iov[ MBUS_LINK_BATCH_SIZE ];
+#ifdef HAVE_UDP_SEGMENT
+	union {
+		gchar			buf[ CMSG_SPACE( sizeof( guint16 ) ) ];
+		struct cmsghdr	align;
+	}				send_control[ MBUS_LINK_BATCH_SIZE ];
+	/** FALSE if the kernel rejected a GSO send */
+	gboolean		gso;
+#endif
+#endif
+};
+
+/* a message (or an error) passed from the receive thread to the main loop */
+typedef struct {
+	/** the received message or NULL on error */
+	MMessage *	message;
+	/** the sender of the message */
+	MEndpoint	sender;
+	/** the error that occured */
+	MErrorType	error;
+	/** the socket the error occured on */
+	gint		fd;
+	/** the received datagram while it waits for a worker */
+	guchar *	data;
+	/** length of the received datagram */
+	gsize		len;
+	/** TRUE if the message is decoded and may be dispatched */
+	gint		done;
+} MLinkReceived;
+
+struct _MLinkReceiver {
+	/** the receive thread */
+	GThread *		thread;
+	/** the CPU the thread is bound to or -1 */
+	gint			cpu;
+	/** pipe used to wake up the thread for stopping it */
+	gint			stop_pipe[ 2 ];
+	/** TRUE if the thread should stop */
+	gint			stop;
+	/** pipe used to wake up the main loop for dispatching the received
+		messages */
+	gint			notify_pipe[ 2 ];
+	/** the event source watching the notification pipe */
+	guint			notify_source;
+	/** threads decoding the received datagrams or NULL if the receive
+		thread decodes them itself */
+	GThreadPool *	workers;
+	/** single producer single consumer queue of received messages. The
+		messages are kept in the order they were received, so a message
+		decoded by a worker waits for the ones received before it. */
+	MLinkReceived	ring[ MBUS_LINK_RING_SIZE ];
+	/** number of messages put into the ring (written by the thread) */
+	gint			head;
+	/** number of messages taken from the ring (written by the main
+		loop) */
+	gint			tail;
+	/** the receive counters of the thread. They are folded into the
+		statistics of the link by mbus_link_stats. */
+	MLinkStats		stats;
+	/** protects stats */
+	GMutex			stats_lock;
+};
 
 static GSList * __mbus_sessions = NULL;
 
@@ -48,6 +179,22 @@ __mbus_link_when_message( MLink * self, MLinkMessage * msg )
 	}
 }
 
+static gboolean
+__mbus_link_wants_payload( MLink * self, const MHeader * header )
+{
+	gint i;
+
+	for ( i = 0; i < self->callbacks->len; i++ ) {
+		MLinkCallback * cb = &( g_array_index( self->callbacks,
+						MLinkCallback, i ) );
+
+		if ( !cb->wants_payload || cb->wants_payload( header, cb->data ) )
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 static void
 __mbus_link_when_error( MLink * self, MError * error )
 {
@@ -61,65 +208,647 @@ __mbus_link_when_error( MLink * self, MError * error )
 	}
 }
 
-static gboolean
-__mbus_link_udp_event( GIOChannel * source, GIOCondition cond, MLink * link )
+/* decodes a received datagram and parses the message. If filter is TRUE
+   the payload is only parsed if at least one transport is interested in
+   the message. On failure NULL is returned and error is set. */
+static MMessage *
+__mbus_link_decode( MLink * link, guchar * data, gsize len, gboolean filter,
+		MErrorType * error )
 {
-	gsize			len;
-	MMessage *		msg = NULL;
-	MEndpoint		ep;
-	guint			slen = sizeof( MEndpoint );
-	gint			fd = g_io_channel_unix_get_fd( source );
+	MMessage *		msg;
+	GByteArray		buf;
+	GString *		mbuf = g_string_new( NULL );
+	MCursor			cursor;
+
+	/* the coder only reads the data */
+	buf.data = data;
+	buf.len = len;
+
+	if ( ! mbus_coder_decode( link->coder, &buf, mbuf ) ) {
+		g_string_free( mbuf, TRUE );
+		*error = MERR_DECODE;
+
+		return NULL;
+	}
+
+	msg = mbus_message_new();
+	mbus_cursor_init( &cursor, mbuf->str, mbuf->len );
+
+	if ( mbus_message_parse_header( msg, &cursor ) &&
+			!mbus_cursor_at_end( &cursor ) ) {
+		if ( !filter || __mbus_link_wants_payload( link, msg->header ) )
+			mbus_payload_scan( msg->payload, &cursor );
+		else
+			link->skipped_bytes += mbus_cursor_left( &cursor );
+	}
+
+	g_string_free( mbuf, TRUE );
+
+	if ( !mbus_message_ok( msg ) ) {
+		mbus_message_free( msg );
+		*error = MERR_PARSE;
+
+		return NULL;
+	}
+
+	*error = MERR_NOERR;
+
+	return msg;
+}
+
+/* passes a received message to the callbacks or sets the error of the
+   link. Only read errors are reported to the callbacks. The message is
+   freed afterwards. */
+static void
+__mbus_link_deliver( MLink * link, MMessage * msg, MErrorType error,
+		const MEndpoint * ep, gint fd )
+{
+	MLinkMessage lmsg;
 
 	mbus_error_reset( link->error );
 
-	if ( ( len = recvfrom( fd, link->buf->data, MBUS_MESSAGE_BUF_SIZE, 0,
-							( struct sockaddr * ) &ep, &slen ) ) == -1 ) {
+	switch ( error ) {
+	case MERR_NOERR:
+		lmsg.sender = *ep;
+		lmsg.message = msg;
+		__mbus_link_when_message( link, &lmsg );
+		mbus_message_free( msg );
+		break;
+	case MERR_READ:
 		mbus_error_printf( &link->error, MERR_READ,
 				"failed to read data from socket %d", fd );
+		__mbus_link_when_error( link, &link->error );
+		break;
+	case MERR_DECODE:
+		mbus_error_set( link->error, MERR_DECODE,
+				"could not decode message" );
+		break;
+	default:
+		mbus_error_set( link->error, MERR_PARSE,
+				"error parsing message" );
+		break;
+	}
+}
+
+/* receives up to max (at most MBUS_LINK_BATCH_SIZE) datagrams waiting on
+   fd into the receive ring and returns their number or -1 on failure */
+static gint
+__mbus_link_receive( MLink * link, gint fd, gint max )
+{
+	MLinkBatch *	batch = link->batch;
+	gint			n;
+
+#ifdef HAVE_RECVMMSG
+	gint			i;
+
+	for ( i = 0; i < max; i++ ) {
+		batch->recv_msgs[ i ].msg_hdr.msg_namelen = sizeof( MEndpoint );
+		batch->recv_msgs[ i ].msg_hdr.msg_flags = 0;
+	}
+
+	n = recvmmsg( fd, batch->recv_msgs, max, MSG_DONTWAIT, NULL );
+	if ( n == -1 )
+		return ( errno == EAGAIN || errno == EWOULDBLOCK ) ? 0 : -1;
+
+	for ( i = 0; i < n; i++ )
+		batch->recv_len[ i ] = batch->recv_msgs[ i ].msg_len;
+#else
+	for ( n = 0; n < max; n++ ) {
+		socklen_t	slen = sizeof( MEndpoint );
+		ssize_t		len;
+
+		len = recvfrom( fd, batch->recv_ring + n * MBUS_MESSAGE_BUF_SIZE,
+				MBUS_MESSAGE_BUF_SIZE, MSG_DONTWAIT,
+				( struct sockaddr * ) &batch->recv_from[ n ], &slen );
+		if ( len == -1 ) {
+			if ( errno == EAGAIN || errno == EWOULDBLOCK ) break;
+			if ( !n ) return -1;
+			break;
+		}
+		batch->recv_len[ n ] = len;
+	}
+#endif
+
+	return n;
+}
+
+/* adds the counters of other to self */
+static void
+__mbus_link_stats_add( MLinkStats * self, const MLinkStats * other )
+{
+	self->recv_batches += other->recv_batches;
+	self->recv_datagrams += other->recv_datagrams;
+	self->recv_batch_max = MAX( self->recv_batch_max, other->recv_batch_max );
+	self->recv_budget_exhausted += other->recv_budget_exhausted;
+	self->recv_ring_drops += other->recv_ring_drops;
+	self->send_batches += other->send_batches;
+	self->send_datagrams += other->send_datagrams;
+	self->send_batch_max = MAX( self->send_batch_max, other->send_batch_max );
+	self->send_calls += other->send_calls;
+	self->send_gso_datagrams += other->send_gso_datagrams;
+}
+
+/* adds the receive counters of a call of __mbus_link_drain to the
+   statistics. The receive thread keeps its own counters, which are read
+   by the main loop. */
+static void
+__mbus_link_count( MLink * link, const MLinkStats * stats )
+{
+	MLinkReceiver * r = link->receiver;
+
+	if ( !r ) {
+		__mbus_link_stats_add( &link->stats, stats );
+		return;
+	}
+
+	g_mutex_lock( &r->stats_lock );
+	__mbus_link_stats_add( &r->stats, stats );
+	g_mutex_unlock( &r->stats_lock );
+}
+
+/* moves the counters of the receive thread into the statistics of the
+   link. It is called by the main loop. */
+static void
+__mbus_link_fold_stats( MLink * link )
+{
+	MLinkReceiver * r = link->receiver;
+
+	g_mutex_lock( &r->stats_lock );
+	__mbus_link_stats_add( &link->stats, &r->stats );
+	memset( &r->stats, 0, sizeof( MLinkStats ) );
+	g_mutex_unlock( &r->stats_lock );
+}
+
+/* returns the next free entry of the ring of the receive thread or NULL
+   if the ring is full. In that case the message is dropped and counted in
+   stats. */
+static MLinkReceived *
+__mbus_link_receiver_reserve( MLink * link, MLinkStats * stats )
+{
+	MLinkReceiver *	r = link->receiver;
+	guint			head = ( guint ) r->head;
+
+	if ( head - ( guint ) g_atomic_int_get( &r->tail ) == MBUS_LINK_RING_SIZE ) {
+		stats->recv_ring_drops++;
+		return NULL;
+	}
+
+	return &r->ring[ head % MBUS_LINK_RING_SIZE ];
+}
+
+/* passes the reserved entry to the main loop */
+static void
+__mbus_link_receiver_publish( MLinkReceiver * r )
+{
+	g_atomic_int_set( &r->head, r->head + 1 );
+}
+
+/* wakes up the main loop to dispatch the messages in the ring */
+static void
+__mbus_link_receiver_notify( MLinkReceiver * r )
+{
+	/* a full pipe wakes up the main loop anyway */
+	if ( write( r->notify_pipe[ 1 ], "", 1 ) == -1 && errno != EAGAIN )
+		perror( "write" );
+}
+
+/* marks a published entry as ready for dispatching. Only finishing the
+   oldest entry of the ring allows the main loop to continue, so it is
+   only woken up in that case. */
+static void
+__mbus_link_receiver_finish( MLinkReceiver * r, MLinkReceived * entry )
+{
+	guint tail;
+
+	g_atomic_int_set( &entry->done, TRUE );
+
+	tail = ( guint ) g_atomic_int_get( &r->tail );
+	if ( entry == &r->ring[ tail % MBUS_LINK_RING_SIZE ] )
+		__mbus_link_receiver_notify( r );
+}
+
+/* decodes a datagram handed to a worker of the receive thread */
+static void
+__mbus_link_worker_run( MLinkReceived * entry, MLink * link )
+{
+	entry->message = __mbus_link_decode( link, entry->data, entry->len,
+			FALSE, &entry->error );
+	g_free( entry->data );
+	entry->data = NULL;
+
+	__mbus_link_receiver_finish( link->receiver, entry );
+}
+
+/* puts a received datagram into the ring of the receive thread. It is
+   decoded right away or by one of the workers. The callbacks deciding
+   about the payload belong to the main loop, so the payload is always
+   scanned and dropped by the main loop if nobody is interested in it. */
+static void
+__mbus_link_receiver_push( MLink * link, guchar * data, gsize len,
+		const MEndpoint * ep, MLinkStats * stats )
+{
+	MLinkReceiver *	r = link->receiver;
+	MLinkReceived *	entry = __mbus_link_receiver_reserve( link, stats );
+
+	if ( !entry ) return;
+
+	entry->sender = *ep;
+	entry->fd = -1;
+
+	if ( r->workers ) {
+		entry->message = NULL;
+		entry->data = g_memdup( data, len );
+		entry->len = len;
+		entry->done = FALSE;
+		__mbus_link_receiver_publish( r );
+		g_thread_pool_push( r->workers, entry, NULL );
 	} else {
-		GString *	mbuf = g_string_new( NULL );
+		entry->message = __mbus_link_decode( link, data, len, FALSE,
+				&entry->error );
+		entry->done = TRUE;
+		__mbus_link_receiver_publish( r );
+	}
+}
 
-		g_byte_array_set_size( link->buf,  len );
+/* puts a read error into the ring of the receive thread */
+static void
+__mbus_link_receiver_push_error( MLink * link, gint fd, MLinkStats * stats )
+{
+	MLinkReceiver *	r = link->receiver;
+	MLinkReceived *	entry = __mbus_link_receiver_reserve( link, stats );
 
-		if ( ! mbus_coder_decode( link->coder, link->buf, mbuf ) ) {
-			mbus_error_set( link->error, MERR_DECODE,
-					"could not decode message" );
-			g_string_free( mbuf, TRUE );
+	if ( !entry ) return;
 
-			return TRUE;
-		} else {
-			msg = mbus_message_new();
+	entry->message = NULL;
+	entry->error = MERR_READ;
+	entry->fd = fd;
+	entry->done = FALSE;
+	__mbus_link_receiver_publish( r );
+	__mbus_link_receiver_finish( r, entry );
+}
 
-			mbus_message_read( msg, mbuf );
+/* delivers the decoded messages of the last batch. The next message is
+   taken before calling back, so a nested iteration of the main loop
+   continues with the messages behind it and the order of reception is
+   kept. Returns FALSE if nobody is interested in further messages. */
+static gboolean
+__mbus_link_deliver_batch( MLink * link )
+{
+	MLinkBatch * batch = link->batch;
+
+	while ( batch->recv_next < batch->recv_count ) {
+		guint i = batch->recv_next++;
 
-			if ( !mbus_message_ok( msg ) ) {
-				mbus_error_set( link->error, MERR_PARSE,
-						"error parsing message" );
-				g_string_free( mbuf, TRUE );
-				mbus_message_free( msg );
+		__mbus_link_deliver( link, batch->recv_messages[ i ],
+				batch->recv_errors[ i ], &batch->recv_senders[ i ], -1 );
+		if ( link->ref_count == 1 ) return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* reads the datagrams waiting on the sockets fds[ 0 ] and fds[ 1 ] (which
+   may be -1) until both are empty or the receive budget is used up. The
+   sockets are read alternately, so a busy one cannot starve the other.
+   With a receive thread the messages are put into its ring, otherwise they
+   are passed to the callbacks. Returns the number of datagrams read. */
+static guint
+__mbus_link_drain( MLink * link, const gint fds[ 2 ] )
+{
+	gboolean	drained[ 2 ];
+	guint		received = 0;
+	gint		current;
+	MLinkStats	stats;
+
+	memset( &stats, 0, sizeof( stats ) );
+	drained[ 0 ] = ( fds[ 0 ] == -1 );
+	drained[ 1 ] = ( fds[ 1 ] == -1 );
+
+	/* the messages left behind by the drain this one is nested in were
+	   received first */
+	if ( !link->receiver && !__mbus_link_deliver_batch( link ) )
+		drained[ 0 ] = drained[ 1 ] = TRUE;
+
+	for ( current = 0; received < link->recv_budget &&
+			!( drained[ 0 ] && drained[ 1 ] ); current = !current ) {
+		gint	want = MIN( MBUS_LINK_BATCH_SIZE,
+				link->recv_budget - received );
+		gint	i, n;
+
+		if ( drained[ current ] ) continue;
+
+		if ( ( n = __mbus_link_receive( link, fds[ current ], want ) ) == -1 ) {
+			if ( link->receiver )
+				__mbus_link_receiver_push_error( link, fds[ current ],
+						&stats );
+			else
+				__mbus_link_deliver( link, NULL, MERR_READ, NULL,
+						fds[ current ] );
+			drained[ current ] = TRUE;
+			continue;
+		}
 
-				return TRUE;
+		/* fewer datagrams than requested: the socket is empty */
+		if ( n < want ) drained[ current ] = TRUE;
+		if ( !n ) continue;
+
+		stats.recv_batches++;
+		stats.recv_datagrams += n;
+		if ( n > stats.recv_batch_max ) stats.recv_batch_max = n;
+		received += n;
+
+		for ( i = 0; i < n; i++ ) {
+			MLinkBatch *	batch = link->batch;
+			guchar *		data = batch->recv_ring + i * MBUS_MESSAGE_BUF_SIZE;
+
+			if ( link->receiver )
+				__mbus_link_receiver_push( link, data, batch->recv_len[ i ],
+						&batch->recv_from[ i ], &stats );
+			else {
+				batch->recv_messages[ i ] = __mbus_link_decode( link, data,
+						batch->recv_len[ i ], TRUE, &batch->recv_errors[ i ] );
+				batch->recv_senders[ i ] = batch->recv_from[ i ];
 			}
 		}
 
-		g_string_free( mbuf, TRUE );
+		if ( link->receiver ) continue;
+
+		link->batch->recv_next = 0;
+		link->batch->recv_count = n;
+		/* nobody is interested in further messages */
+		if ( !__mbus_link_deliver_batch( link ) ) break;
 	}
 
-	if ( mbus_link_ok( link ) ) {
-		MLinkMessage lmsg;
+	if ( received >= link->recv_budget && !( drained[ 0 ] && drained[ 1 ] ) )
+		stats.recv_budget_exhausted++;
+	__mbus_link_count( link, &stats );
 
-		lmsg.sender = ep;
-		lmsg.message = msg;
-		__mbus_link_when_message( link, &lmsg );
-	} else {
-		__mbus_link_when_error( link, &link->error );
+	return received;
+}
+
+/* reads the sockets if one of them becomes readable. Datagrams may be left
+   behind if the receive budget was used up. */
+static MEventResult
+__mbus_link_udp_event( gint fd, MLink * link )
+{
+	gint		fds[ 2 ];
+	gboolean	pending;
+
+	/* start with the socket that caused the event */
+	fds[ 0 ] = fd;
+	if ( fd == g_io_channel_unix_get_fd( link->multicast ) )
+		fds[ 1 ] = link->unicast ? g_io_channel_unix_get_fd( link->unicast ) : -1;
+	else
+		fds[ 1 ] = g_io_channel_unix_get_fd( link->multicast );
+
+	/* a callback may detach the last transport from the link */
+	link->ref_count++;
+	pending = __mbus_link_drain( link, fds ) >= link->recv_budget;
+	mbus_link_free( link );
+
+	return pending ? M_EVENT_PENDING : M_EVENT_DRAINED;
+}
+
+static gpointer
+__mbus_link_receiver_run( MLink * link )
+{
+	MLinkReceiver *	r = link->receiver;
+	struct pollfd	pfds[ 3 ];
+	gint			fds[ 2 ];
+	gint			i;
+
+#ifdef HAVE_SCHED_SETAFFINITY
+	if ( r->cpu >= 0 ) {
+		cpu_set_t set;
+
+		CPU_ZERO( &set );
+		CPU_SET( r->cpu, &set );
+		if ( sched_setaffinity( 0, sizeof( set ), &set ) == -1 )
+			perror( "sched_setaffinity" );
 	}
+#endif
 
-	if ( msg ) mbus_message_free( msg );
+	fds[ 0 ] = g_io_channel_unix_get_fd( link->multicast );
+	fds[ 1 ] = g_io_channel_unix_get_fd( link->unicast );
+	for ( i = 0; i < 2; i++ ) {
+		pfds[ i ].fd = fds[ i ];
+		pfds[ i ].events = POLLIN;
+	}
+	pfds[ 2 ].fd = r->stop_pipe[ 0 ];
+	pfds[ 2 ].events = POLLIN;
+
+	while ( !g_atomic_int_get( &r->stop ) ) {
+		if ( poll( pfds, 3, -1 ) == -1 ) {
+			if ( errno == EINTR ) continue;
+			perror( "poll" );
+			break;
+		}
+		if ( pfds[ 2 ].revents ) break;
+
+		/* the workers wake up the main loop when they are done */
+		if ( __mbus_link_drain( link, fds ) && !r->workers )
+			__mbus_link_receiver_notify( r );
+	}
+
+	return NULL;
+}
+
+/* checks if the oldest message of the ring may be dispatched */
+static gboolean
+__mbus_link_receiver_ready( MLinkReceiver * r )
+{
+	guint tail = ( guint ) r->tail;
+
+	return ( guint ) g_atomic_int_get( &r->head ) != tail &&
+		g_atomic_int_get( &r->ring[ tail % MBUS_LINK_RING_SIZE ].done );
+}
+
+/* drops the scanned payload of a message decoded by the receive thread if
+   no transport is interested in it, so its commands are never parsed */
+static void
+__mbus_link_filter_payload( MLink * link, MMessage * msg )
+{
+	MPayload * payload = msg->payload;
+
+	if ( !payload->text || __mbus_link_wants_payload( link, msg->header ) )
+		return;
+
+	link->skipped_bytes += payload->text->len;
+	mbus_payload_free( payload );
+	msg->payload = mbus_payload_new();
+}
+
+/* passes the messages received by the thread to the callbacks. At most
+   the receive budget is dispatched at once to keep the main loop
+   responsive. */
+static MEventResult
+__mbus_link_receiver_event( gint fd, MLink * link )
+{
+	MLinkReceiver *	r = link->receiver;
+	gchar			buf[ 64 ];
+	guint			n;
+
+	/* the notifications are consumed before looking at the ring, so a
+	   message finished in between causes a new one */
+	while ( read( fd, buf, sizeof( buf ) ) > 0 );
+
+	/* a callback may detach the last transport from the link */
+	link->ref_count++;
+
+	for ( n = 0; n < link->recv_budget && link->ref_count > 1; n++ ) {
+		guint			tail = ( guint ) r->tail;
+		MLinkReceived	entry;
+
+		/* keep the order of reception even if a later message was
+		   decoded first */
+		if ( !__mbus_link_receiver_ready( r ) ) break;
+
+		entry = r->ring[ tail % MBUS_LINK_RING_SIZE ];
+		g_atomic_int_set( &r->tail, ( gint ) ( tail + 1 ) );
+
+		if ( entry.message ) __mbus_link_filter_payload( link, entry.message );
+		__mbus_link_deliver( link, entry.message, entry.error,
+				&entry.sender, entry.fd );
+	}
+
+	/* the messages left behind need another notification */
+	if ( link->ref_count > 1 && __mbus_link_receiver_ready( r ) )
+		__mbus_link_receiver_notify( r );
+
+	mbus_link_free( link );
+
+	return M_EVENT_DRAINED;
+}
+
+/* closes the pipes of a receive thread and frees it */
+static void
+__mbus_link_receiver_free( MLinkReceiver * r )
+{
+	g_mutex_clear( &r->stats_lock );
+	close( r->stop_pipe[ 0 ] );
+	close( r->stop_pipe[ 1 ] );
+	close( r->notify_pipe[ 0 ] );
+	close( r->notify_pipe[ 1 ] );
+	g_free( r );
+}
+
+/* starts a thread receiving, verifying and parsing the messages of the
+   link. If workers is not zero the received datagrams are verified and
+   parsed by a pool of that many threads. */
+static gboolean
+__mbus_link_receiver_start( MLink * link, gint cpu, guint workers )
+{
+	MLinkReceiver *	r = g_new0( MLinkReceiver, 1 );
+
+	if ( pipe( r->stop_pipe ) == -1 ) {
+		perror( "pipe" );
+		g_free( r );
+		return FALSE;
+	}
+	if ( pipe( r->notify_pipe ) == -1 ) {
+		perror( "pipe" );
+		close( r->stop_pipe[ 0 ] );
+		close( r->stop_pipe[ 1 ] );
+		g_free( r );
+		return FALSE;
+	}
+	g_mutex_init( &r->stats_lock );
+	/* neither the thread nor the main loop may block on the notifications */
+	fcntl( r->notify_pipe[ 0 ], F_SETFL, O_NONBLOCK );
+	fcntl( r->notify_pipe[ 1 ], F_SETFL, O_NONBLOCK );
+
+	if ( workers ) {
+		GError * error = NULL;
+
+		r->workers = g_thread_pool_new( ( GFunc ) __mbus_link_worker_run,
+				link, workers, TRUE, &error );
+		if ( !r->workers ) {
+			g_warning( "failed to start workers: %s", error->message );
+			g_error_free( error );
+			__mbus_link_receiver_free( r );
+			return FALSE;
+		}
+	}
+
+	r->cpu = cpu;
+	r->notify_source = mbus_event_add_io( r->notify_pipe[ 0 ],
+			( MEventIOFunc ) __mbus_link_receiver_event, link );
+
+	link->receiver = r;
+	r->thread = g_thread_new( "mbus-receive",
+			( GThreadFunc ) __mbus_link_receiver_run, link );
 
 	return TRUE;
 }
 
+/* stops the receive thread and drops the messages it has not passed to
+   the main loop */
+static void
+__mbus_link_receiver_stop( MLink * link )
+{
+	MLinkReceiver *	r = link->receiver;
+	guint			tail;
+
+	g_atomic_int_set( &r->stop, TRUE );
+	if ( write( r->stop_pipe[ 1 ], "", 1 ) == -1 ) perror( "write" );
+	g_thread_join( r->thread );
+	/* waits for the workers to finish the queued datagrams */
+	if ( r->workers ) g_thread_pool_free( r->workers, FALSE, TRUE );
+
+	for ( tail = r->tail; tail != ( guint ) r->head; tail++ ) {
+		MLinkReceived * entry = &r->ring[ tail % MBUS_LINK_RING_SIZE ];
+
+		if ( entry->message ) mbus_message_free( entry->message );
+	}
+
+	mbus_event_remove( r->notify_source );
+	__mbus_link_fold_stats( link );
+	__mbus_link_receiver_free( r );
+	link->receiver = NULL;
+}
+
+static MLinkBatch *
+__mbus_link_batch_new( void )
+{
+	MLinkBatch *	batch = g_new0( MLinkBatch, 1 );
+#ifdef HAVE_RECVMMSG
+	gint			i;
+#endif
+
+	batch->recv_ring = g_malloc( MBUS_LINK_BATCH_SIZE * MBUS_MESSAGE_BUF_SIZE );
+	batch->send_data = g_byte_array_new();
+#ifdef HAVE_RECVMMSG
+	for ( i = 0; i < MBUS_LINK_BATCH_SIZE; i++ ) {
+		batch->recv_iov[ i ].iov_base =
+			batch->recv_ring + i * MBUS_MESSAGE_BUF_SIZE;
+		batch->recv_iov[ i ].iov_len = MBUS_MESSAGE_BUF_SIZE;
+		batch->recv_msgs[ i ].msg_hdr.msg_name = &batch->recv_from[ i ];
+		batch->recv_msgs[ i ].msg_hdr.msg_iov = &batch->recv_iov[ i ];
+		batch->recv_msgs[ i ].msg_hdr.msg_iovlen = 1;
+	}
+#endif
+#if defined( HAVE_SENDMMSG ) && defined( HAVE_UDP_SEGMENT )
+	batch->gso = TRUE;
+#endif
+
+	return batch;
+}
+
+static void
+__mbus_link_batch_free( MLinkBatch * batch )
+{
+	guint i;
+
+	/* the last transport may detach before the batch was delivered */
+	for ( i = batch->recv_next; i < batch->recv_count; i++ )
+		if ( batch->recv_messages[ i ] )
+			mbus_message_free( batch->recv_messages[ i ] );
+
+	g_free( batch->recv_ring );
+	g_byte_array_free( batch->send_data, TRUE );
+	g_free( batch );
+}
+
 static MLink *
 __mbus_session_find_link( MConfig * config )
 {
@@ -155,7 +884,16 @@ mbus_link_new( MConfig * config )
 		self->multicast = NULL;
 		self->unicast = NULL;
 		self->ref_count = 1;
-		self->buf = g_byte_array_sized_new( MBUS_MESSAGE_BUF_SIZE );
+		self->skipped_bytes = 0;
+		self->recv_budget = config->recv_budget ?
+			config->recv_budget : MBUS_DEFAULT_RECV_BUDGET;
+		memset( &self->stats, 0, sizeof( self->stats ) );
+		self->batch = __mbus_link_batch_new();
+		self->receiver = NULL;
+		self->source_multicast = 0;
+		self->source_unicast = 0;
+		self->send_buf = g_byte_array_new();
+		self->crypt_buf = g_byte_array_new();
 		self->callbacks = g_array_new( FALSE, TRUE, sizeof( MLinkCallback ) );
 		self->default_dest = *( config->group_addr );
 		self->coder = mbus_coder_new( config );
@@ -167,7 +905,8 @@ mbus_link_new( MConfig * config )
 		}
 
 		/* set up multicast socket */
-		self->multicast = mbus_socket_new( config->group_addr, TRUE );
+		self->multicast = mbus_socket_new( config->group_addr, TRUE,
+				config->rcvbuf_size, config->sndbuf_size );
 		if( !self->multicast ) {
 			mbus_error_set( self->error, MERR_MULTICAST_JOIN,
 					"failed to setup multicast socket" );
@@ -176,11 +915,10 @@ mbus_link_new( MConfig * config )
 
 		/* retrieve local socket address */
 		mbus_socket_get_name( self->multicast, &( self->ep_multicast ) );
-		self->source_multicast = g_io_add_watch( self->multicast, G_IO_IN,
-				( GIOFunc ) __mbus_link_udp_event, self );
 
 		/* create unicast socket for sending */
-		self->unicast = mbus_socket_new( config->unicast_addr, FALSE );
+		self->unicast = mbus_socket_new( config->unicast_addr, FALSE,
+				config->rcvbuf_size, config->sndbuf_size );
 		if( !self->unicast ) {
 			mbus_error_set( self->error, MERR_UNICAST,
 					"failed to setup unicast socket" );
@@ -188,8 +926,22 @@ mbus_link_new( MConfig * config )
 		}
 
 		mbus_socket_get_name( self->unicast, &( self->ep_unicast ) );
-		self->source_unicast = g_io_add_watch( self->unicast, G_IO_IN,
-				( GIOFunc ) __mbus_link_udp_event, self );
+
+		if ( config->recv_thread || config->recv_workers ) {
+			if ( !__mbus_link_receiver_start( self,
+						config->recv_thread_cpu, config->recv_workers ) ) {
+				mbus_error_set( self->error, MERR_READ,
+						"failed to start receive thread" );
+				goto done;
+			}
+		} else {
+			self->source_multicast = mbus_event_add_io(
+					g_io_channel_unix_get_fd( self->multicast ),
+					( MEventIOFunc ) __mbus_link_udp_event, self );
+			self->source_unicast = mbus_event_add_io(
+					g_io_channel_unix_get_fd( self->unicast ),
+					( MEventIOFunc ) __mbus_link_udp_event, self );
+		}
 	}
 
 	return self;
@@ -211,17 +963,26 @@ mbus_link_free( MLink * self )
 	/* just delete the object if there are no more references to it */
 	if ( self->ref_count ) return;
 
+	/* messages sent by the last transport may still be queued */
+	mbus_link_flush( self );
+
+	if ( self->receiver ) __mbus_link_receiver_stop( self );
+
 	if( self->multicast ) {
-		g_source_remove( self->source_multicast );
+		if ( self->source_multicast )
+			mbus_event_remove( self->source_multicast );
 		g_io_channel_unref( self->multicast );
 		self->multicast = NULL;
 	}
 	if(self->unicast) {
-		g_source_remove( self->source_unicast );
+		if ( self->source_unicast )
+			mbus_event_remove( self->source_unicast );
 		g_io_channel_unref( self->unicast );
 		self->unicast = NULL;
 	}
-	g_byte_array_free( self->buf, TRUE );
+	__mbus_link_batch_free( self->batch );
+	g_byte_array_free( self->send_buf, TRUE );
+	g_byte_array_free( self->crypt_buf, TRUE );
 
 	g_free( self );
 }
@@ -238,48 +999,268 @@ mbus_link_error( const MLink * self )
 	return &self->error;
 }
 
+guint64
+mbus_link_skipped_bytes( const MLink * self )
+{
+	return self->skipped_bytes;
+}
+
+/**
+\brief returns the statistics about the batches of datagrams received and
+    sent by the link. It has to be called by the thread running the main
+    loop, which collects the counters of the receive thread.
+\param self the link
+\return the statistics. They are updated while the link is used.
+*/
+const MLinkStats *
+mbus_link_stats( const MLink * self )
+{
+	MLink * me = ( MLink * ) self;
+
+	if ( me->receiver ) __mbus_link_fold_stats( me );
+
+	return &self->stats;
+}
+
+/* returns the socket used for sending */
+static gint
+__mbus_link_send_fd( MLink * self )
+{
+	if ( self->unicast )
+		return g_io_channel_unix_get_fd( self->unicast );
+	else
+		return g_io_channel_unix_get_fd( self->multicast );
+}
+
+static void
+__mbus_link_send_failed( MLink * self, const gchar * call )
+{
+	perror( call );
+	mbus_error_set( self->error, MERR_SEND,
+			"sending to Mbus session failed" );
+	g_error( self->error.message );
+}
+
+/* waits until the socket accepts datagrams again if the last send failed
+   because its buffer was full. Returns FALSE for any other error. */
 static gboolean
-__mbus_link_do_send( MLink * self, MMessage * msg, const MEndpoint * ep )
+__mbus_link_send_wait( gint fd )
 {
-	GString *	str = g_string_new( NULL );
-	GByteArray *	buf = g_byte_array_new();
+	struct pollfd pfd;
 
-	/* reset error variable */
-	mbus_error_reset( self->error );
+	if ( errno == EINTR ) return TRUE;
+	if ( errno != EAGAIN && errno != EWOULDBLOCK ) return FALSE;
 
-	/* serialize msg */
-	mbus_message_as_string( msg, str );
+	pfd.fd = fd;
+	pfd.events = POLLOUT;
 
-	if ( !mbus_message_ok( msg ) ) {
-		mbus_error_set( self->error, MERR_WRITE,
-				"could not create message text" );
-	} else {			/* encode */
-		/* encode into my msg buffer */
-		if ( ! mbus_coder_encode( self->coder, str, buf ) ) {
-			mbus_error_set( self->error, MERR_ENCODE,
-					"failed to encode message" );
-		} else {			/* send now */
-			gint	fd;
-			gint	ep_size = mbus_endpoint_get_size( ( MEndpoint * ) ep );
-
-			if ( self->unicast )
-				fd = g_io_channel_unix_get_fd( self->unicast );
-			else
-				fd = g_io_channel_unix_get_fd( self->multicast );
+	return poll( &pfd, 1, -1 ) != -1 || errno == EINTR;
+}
+
+#ifdef HAVE_SENDMMSG
+/* fills the message headers for the queued messages starting at first and
+   returns the number of headers. Consecutive messages of the same length
+   for the same receiver are combined into a single GSO send, the last of
+   them may be shorter. */
+static guint
+__mbus_link_prepare_batch( MLink * self, guint first )
+{
+	MLinkBatch *	batch = self->batch;
+	guint			i = first;
+	guint			n = 0;
+
+	while ( i < batch->send_count ) {
+		MLinkQueued *		q = &batch->send_queue[ i ];
+		struct msghdr *		hdr = &batch->send_msgs[ n ].msg_hdr;
+		guint				count = 1;
+#ifdef HAVE_UDP_SEGMENT
+		gsize				total = q->len;
+
+		while ( batch->gso && i + count < batch->send_count &&
+				count < M_LINK_GSO_MAX_SEGMENTS ) {
+			MLinkQueued * next = &batch->send_queue[ i + count ];
+
+			if ( next->len > q->len ||
+					total + next->len > M_LINK_GSO_MAX_BYTES ||
+					!mbus_endpoint_is_equal( &next->ep, &q->ep ) )
+				break;
+			total += next->len;
+			count++;
+			/* a shorter message has to be the last segment */
+			if ( next->len < q->len ) break;
+		}
+#endif
+
+		memset( hdr, 0, sizeof( *hdr ) );
+		hdr->msg_name = &q->ep;
+		hdr->msg_namelen = mbus_endpoint_get_size( &q->ep );
+		hdr->msg_iov = &batch->send_iov[ i ];
+		hdr->msg_iovlen = count;
+
+#ifdef HAVE_UDP_SEGMENT
+		if ( count > 1 ) {
+			struct cmsghdr * cm;
+
+			hdr->msg_control = batch->send_control[ n ].buf;
+			hdr->msg_controllen = sizeof( batch->send_control[ n ].buf );
+			cm = CMSG_FIRSTHDR( hdr );
+			cm->cmsg_level = IPPROTO_UDP;
+			cm->cmsg_type = UDP_SEGMENT;
+			cm->cmsg_len = CMSG_LEN( sizeof( guint16 ) );
+			*( guint16 * ) CMSG_DATA( cm ) = ( guint16 ) q->len;
+		}
+#endif
+
+		i += count;
+		n++;
+	}
+
+	return n;
+}
+#endif
+
+/**
+\brief sends all queued messages. Messages that are sent while the main
+    loop dispatches events are queued and sent in a batch after the
+    dispatching has finished. It is not necessary to call this function
+    unless the messages have to be sent immediately.
+\param self the link
+*/
+void
+mbus_link_flush( MLink * self )
+{
+	MLinkBatch *	batch = self->batch;
+	gint			fd;
+	guint			i;
 
+	if ( batch->flush_source ) {
+		mbus_event_remove( batch->flush_source );
+		batch->flush_source = 0;
+	}
+
+	if ( !batch->send_count ) return;
+
+	fd = __mbus_link_send_fd( self );
+	self->stats.send_batches++;
+	self->stats.send_datagrams += batch->send_count;
+	if ( batch->send_count > self->stats.send_batch_max )
+		self->stats.send_batch_max = batch->send_count;
+
+#ifdef HAVE_SENDMMSG
+	for ( i = 0; i < batch->send_count; i++ ) {
+		batch->send_iov[ i ].iov_base =
+			batch->send_data->data + batch->send_queue[ i ].offset;
+		batch->send_iov[ i ].iov_len = batch->send_queue[ i ].len;
+	}
 
-			if ( sendto( fd, buf->data, buf->len, MSG_DONTWAIT,
-							( struct sockaddr * ) ep, ep_size ) == -1 ) {
-				perror( "sendto" );
-				mbus_error_set( self->error, MERR_SEND,
-						"sending to Mbus session failed" );
-				g_error( self->error.message );
+	i = 0;
+	while ( i < batch->send_count ) {
+		guint	n = __mbus_link_prepare_batch( self, i );
+		gint	sent;
+		gint	j;
+
+		self->stats.send_calls++;
+		sent = sendmmsg( fd, batch->send_msgs, n, MSG_DONTWAIT );
+		if ( sent <= 0 ) {
+#ifdef HAVE_UDP_SEGMENT
+			/* the kernel or the network device does not support GSO */
+			if ( batch->gso && ( errno == EIO || errno == EINVAL ||
+							errno == ENOPROTOOPT ) ) {
+				batch->gso = FALSE;
+				continue;
 			}
+#endif
+			if ( __mbus_link_send_wait( fd ) ) continue;
+			__mbus_link_send_failed( self, "sendmmsg" );
+			break;
+		}
+
+		/* a batch may be prepared again after a failed call, so GSO sends
+		   are only counted once they succeeded */
+		for ( j = 0; j < sent; j++ ) {
+			guint count = batch->send_msgs[ j ].msg_hdr.msg_iovlen;
+
+			if ( count > 1 ) self->stats.send_gso_datagrams += count;
+			i += count;
+		}
+	}
+#else
+	i = 0;
+	while ( i < batch->send_count ) {
+		MLinkQueued * q = &batch->send_queue[ i ];
+
+		self->stats.send_calls++;
+		if ( sendto( fd, batch->send_data->data + q->offset, q->len,
+						MSG_DONTWAIT, ( struct sockaddr * ) &q->ep,
+						mbus_endpoint_get_size( &q->ep ) ) != -1 )
+			i++;
+		else if ( !__mbus_link_send_wait( fd ) ) {
+			__mbus_link_send_failed( self, "sendto" );
+			break;
 		}
 	}
+#endif
+
+	batch->send_count = 0;
+	g_byte_array_set_size( batch->send_data, 0 );
+}
 
-	g_byte_array_free( buf, TRUE );
-	g_string_free( str, TRUE );
+static gboolean
+__mbus_link_when_flush( MLink * self )
+{
+	self->batch->flush_source = 0;
+	mbus_link_flush( self );
+
+	return FALSE;
+}
+
+/* queues the len bytes at data for sending to ep */
+static void
+__mbus_link_send_data( MLink * self, const guchar * data, gsize len,
+		const MEndpoint * ep )
+{
+	MLinkBatch *	batch = self->batch;
+	MLinkQueued *	q = &batch->send_queue[ batch->send_count++ ];
+
+	q->offset = batch->send_data->len;
+	q->len = len;
+	q->ep = *ep;
+	g_byte_array_append( batch->send_data, data, len );
+
+	/* outside of an event dispatch there is no end of the loop iteration
+	   to wait for */
+	if ( batch->send_count == MBUS_LINK_BATCH_SIZE ||
+			!mbus_event_dispatching() )
+		mbus_link_flush( self );
+	else if ( !batch->flush_source )
+		batch->flush_source = mbus_event_add_idle(
+				( GSourceFunc ) __mbus_link_when_flush, self );
+}
+
+static gboolean
+__mbus_link_do_send( MLink * self, MMessage * msg, const MEndpoint * ep )
+{
+	guint64			timestamp = mbus_header_timestamp_now();
+	const guchar *	data;
+	gsize			len;
+	MWriter			writer;
+
+	/* reset error variable */
+	mbus_error_reset( self->error );
+
+	/* serialize msg into the send buffer behind the space reserved for the
+	   digest, so the whole message is created in a single buffer. Writing
+	   the text and encoding it cannot fail. */
+	len = DIGEST_SPACE + mbus_message_text_len( msg, timestamp );
+	g_byte_array_set_size( self->send_buf, len );
+	mbus_writer_init( &writer, ( gchar * ) self->send_buf->data + DIGEST_SPACE,
+			len - DIGEST_SPACE );
+	mbus_message_write( msg, timestamp, &writer );
+	g_assert( mbus_writer_at_end( &writer ) );
+
+	data = mbus_coder_encode_in_place( self->coder,
+			( gchar * ) self->send_buf->data, &len, self->crypt_buf );
+	__mbus_link_send_data( self, data, len, ep );
 
 	return TRUE;
 }
@@ -296,6 +1277,112 @@ mbus_link_send_unicast( MLink * self, MMessage * msg, const MEndpoint * ep )
 	return __mbus_link_do_send( self, msg, ep );
 }
 
+/**
+\brief creates a template for sending the given message several times
+\param self the link the template is used with
+\param msg the message. Its header must contain the final source and
+    destination address. Sequence number and timestamp are ignored.
+\return the template or NULL if the message text could not be created
+*/
+MLinkTemplate *
+mbus_link_template_new( MLink * self, MMessage * msg )
+{
+	MLinkTemplate *	tmpl;
+	gsize			len;
+	MWriter			writer;
+	const gchar *	pos;
+	guint64			sequence_no = msg->header->sequence_no;
+
+	/* with a zero sequence number and timestamp the header starts with
+	   "<protocol version> 0 0 ". The sequence number of the message is
+	   restored, as it belongs to the caller. */
+	msg->header->sequence_no = 0;
+	len = mbus_message_text_len( msg, 0 );
+
+	tmpl = g_new( MLinkTemplate, 1 );
+	tmpl->text = g_malloc( len );
+	mbus_writer_init( &writer, tmpl->text, len );
+	mbus_message_write( msg, 0, &writer );
+	msg->header->sequence_no = sequence_no;
+	pos = memchr( tmpl->text, ' ', len );
+
+	if ( !pos || len - ( pos - tmpl->text ) < 4 ) {
+		mbus_link_template_free( tmpl );
+		return NULL;
+	}
+
+	tmpl->prefix_len = pos - tmpl->text + 1;
+	tmpl->suffix = tmpl->text + tmpl->prefix_len + 3;
+	tmpl->suffix_len = len - tmpl->prefix_len - 3;
+
+	mbus_coder_digest_init( self->coder, &tmpl->state );
+	mbus_coder_digest_update( self->coder, &tmpl->state, tmpl->text,
+			tmpl->prefix_len );
+
+	return tmpl;
+}
+
+/**
+\brief frees a template created by mbus_link_template_new
+\param tmpl the template
+*/
+void
+mbus_link_template_free( MLinkTemplate * tmpl )
+{
+	g_free( tmpl->text );
+	g_free( tmpl );
+}
+
+/**
+\brief sends the message of a template with the given sequence number and
+    the current time as timestamp
+\param self the link
+\param tmpl the template
+\param sequence_no the sequence number of the message
+\param tail text appended to the message of the template, e.g. further
+    commands of the payload. It may be NULL if \a tail_len is 0.
+\param tail_len the number of characters at \a tail
+\param ep the receiver or NULL to send the message to the Mbus session
+\return TRUE
+*/
+gboolean
+mbus_link_send_template( MLink * self, const MLinkTemplate * tmpl,
+		guint64 sequence_no, const gchar * tail, gsize tail_len,
+		const MEndpoint * ep )
+{
+	MDigestState	state = tmpl->state;
+	guint64			timestamp = mbus_header_timestamp_now();
+	const guchar *	data;
+	gsize			len;
+	MWriter			writer;
+
+	mbus_error_reset( self->error );
+
+	len = DIGEST_SPACE + tmpl->prefix_len +
+		mbus_writer_uint64_len( sequence_no ) + 1 +
+		mbus_writer_uint64_len( timestamp ) + tmpl->suffix_len + tail_len;
+	g_byte_array_set_size( self->send_buf, len );
+	mbus_writer_init( &writer, ( gchar * ) self->send_buf->data + DIGEST_SPACE,
+			len - DIGEST_SPACE );
+	mbus_writer_put( &writer, tmpl->text, tmpl->prefix_len );
+	mbus_writer_put_uint64( &writer, sequence_no );
+	mbus_writer_put_c( &writer, ' ' );
+	mbus_writer_put_uint64( &writer, timestamp );
+	mbus_writer_put( &writer, tmpl->suffix, tmpl->suffix_len );
+	if ( tail_len ) mbus_writer_put( &writer, tail, tail_len );
+	g_assert( mbus_writer_at_end( &writer ) );
+
+	/* only the text behind the prefix is added to the digest */
+	mbus_coder_digest_update( self->coder, &state,
+			( gchar * ) self->send_buf->data + DIGEST_SPACE + tmpl->prefix_len,
+			len - DIGEST_SPACE - tmpl->prefix_len );
+	data = mbus_coder_encode_digested( self->coder, &state,
+			( gchar * ) self->send_buf->data, &len, self->crypt_buf );
+	__mbus_link_send_data( self, data, len, ep ? ep : &self->default_dest );
+
+	return TRUE;
+}
+
 void
 mbus_link_attach( MLink * self, MLinkCallback c )
 {
@@ -52,9 +52,74 @@ typedef struct {
 	void ( *when_error )( const MError * c, gpointer object );
 	/** for received messages */
 	void ( *when_message )( const MLinkMessage * c, gpointer object );
+	/** decides by the header of a received message whether its payload
+		should be parsed. If NULL the payload is always parsed. */
+	gboolean ( *wants_payload )( const MHeader * h, gpointer object );
 } MLinkCallback;
 
 #define MBUS_MESSAGE_BUF_SIZE 32768
+/** maximum number of datagrams received or sent with a single system
+    call */
+#define MBUS_LINK_BATCH_SIZE 16
+/** number of received messages the receive thread of a link can queue for
+    the main loop */
+#define MBUS_LINK_RING_SIZE 1024
+
+/**
+\brief statistics about the batches of datagrams received and sent by a
+    link
+*/
+typedef struct {
+	/** number of receive calls that delivered datagrams */
+	guint64		recv_batches;
+	/** number of received datagrams */
+	guint64		recv_datagrams;
+	/** largest number of datagrams received by a single call */
+	guint		recv_batch_max;
+	/** number of socket events that ended because the receive budget was
+		used up while datagrams may still have been waiting */
+	guint64		recv_budget_exhausted;
+	/** number of messages dropped by the receive thread because the main
+		loop did not keep up */
+	guint64		recv_ring_drops;
+	/** number of times the send queue was flushed */
+	guint64		send_batches;
+	/** number of sent datagrams */
+	guint64		send_datagrams;
+	/** largest number of datagrams sent by a single flush */
+	guint		send_batch_max;
+	/** number of system calls used for sending */
+	guint64		send_calls;
+	/** number of datagrams sent as segments of a UDP GSO send */
+	guint64		send_gso_datagrams;
+} MLinkStats;
+
+/** receive buffers and send queue of a link (private) */
+typedef struct _MLinkBatch MLinkBatch;
+
+/** receive thread of a link and its queue of received messages
+    (private) */
+typedef struct _MLinkReceiver MLinkReceiver;
+
+/**
+\brief A message that is serialized once and sent several times. Only the
+    sequence number and the timestamp of the header and optionally some
+    text appended to the message are written for each message. The digest
+    of the text in front of the sequence number is calculated in advance.
+*/
+typedef struct {
+	/** the message text with a zero sequence number and timestamp */
+	gchar *			text;
+	/** number of characters in front of the sequence number */
+	gsize			prefix_len;
+	/** the text behind the timestamp */
+	const gchar *	suffix;
+	/** number of characters behind the timestamp */
+	gsize			suffix_len;
+	/** digest state after adding the text in front of the sequence
+		number */
+	MDigestState	state;
+} MLinkTemplate;
 
 typedef struct {
 	/** Represents the mulicast channel to the Mbus session */
@@ -72,8 +137,16 @@ typedef struct {
 
 	/** Last error that occured */
 	MError	error;
-	/** dynamic transmission buffer */
-	GByteArray *	buf;
+	/** receive buffers and queue of outgoing messages */
+	MLinkBatch *	batch;
+	/** the receive thread or NULL if the sockets are read by the main
+		loop */
+	MLinkReceiver *	receiver;
+	/** buffer the text of outgoing messages is written to. It is reused
+		for each message, so it only grows up to the largest message. */
+	GByteArray *	send_buf;
+	/** stores encrypted outgoing messages if encryption is used */
+	GByteArray *	crypt_buf;
 	/** List of MLinkCallback objects. Each MTransport object attaching
 		to an Mbus session does this by subscribing to corresponding
 		MLink object. These subscriptions are stores in this list.*/
@@ -87,15 +160,33 @@ typedef struct {
 	/** Counts the number of MTransport objects attached to this MLink
 	 * object */
 	guint		ref_count;
+
+	/** number of payload bytes that were not parsed because no attached
+	 * MTransport object was interested in the message. With a receive
+	 * thread the payload is still scanned by the thread, but its commands
+	 * are not parsed. */
+	guint64		skipped_bytes;
+	/** maximum number of datagrams read per socket event */
+	guint		recv_budget;
+	/** statistics about received and sent batches of datagrams */
+	MLinkStats	stats;
 } MLink;
 
 MLink * mbus_link_new( MConfig * config );
 void mbus_link_free( MLink * self );
 gboolean mbus_link_ok( const MLink * self );
 const MError *mbus_link_error( const MLink * self );
+guint64 mbus_link_skipped_bytes( const MLink * self );
+const MLinkStats * mbus_link_stats( const MLink * self );
+void mbus_link_flush( MLink * self );
 gboolean mbus_link_send( MLink * self, MMessage * msg );
 gboolean mbus_link_send_unicast( MLink * self, MMessage * msg,
 		const MEndpoint * ep );
+MLinkTemplate * mbus_link_template_new( MLink * self, MMessage * msg );
+void mbus_link_template_free( MLinkTemplate * tmpl );
+gboolean mbus_link_send_template( MLink * self, const MLinkTemplate * tmpl,
+		guint64 sequence_no, const gchar * tail, gsize tail_len,
+		const MEndpoint * ep );
 void mbus_link_attach( MLink * self, MLinkCallback c );
 gboolean mbus_link_detach( MLink * self, MLinkCallback c );
 
@@ -32,6 +32,7 @@ __mbus_message_init( MMessage * self )
   self->payload = mbus_payload_new();
   self->ok = TRUE;
   self->_index = 0;
+  self->_ref_count = 1;
 }
 
 /**
@@ -70,44 +71,145 @@ __mbus_message_finalize( MMessage * self )
 }
 
 /**
-\brief Frees an Mbus message object
+\brief Frees an Mbus message object. If other references to the message
+    exist only the reference of the caller is dropped.
 \param self the MMessage object to destroy
+\sa mbus_message_unref
 */
 void
 mbus_message_free( MMessage * self )
 {
+  mbus_message_unref( self );
+}
+
+/**
+\brief Adds a reference to an Mbus message. This allows to keep a message
+    passed to a callback function after the callback has returned without
+    copying it. The message must not be modified while it is shared.
+\param self the MMessage object
+\return the MMessage object
+*/
+MMessage *
+mbus_message_ref( const MMessage * self )
+{
+  /* callback functions receive constant messages */
+  MMessage * me = ( MMessage * ) self;
+
+  g_atomic_int_inc( &me->_ref_count );
+
+  return me;
+}
+
+/**
+\brief Drops a reference to an Mbus message. The message is freed when the
+    last reference is dropped.
+\param self the MMessage object
+*/
+void
+mbus_message_unref( MMessage * self )
+{
+  if ( !g_atomic_int_dec_and_test( &self->_ref_count ) ) return;
+
   __mbus_message_finalize( self );
   g_free( self );
 }
 
 /**
-\brief Parses an Mbus message
-\param self the MMessage object to store the parsed message
-\param buf the string containing the text to parse
-\return TRUE if the message parsing was successful, otherwise FALSE
+\brief Parses only the header of an Mbus message. This allows to decide
+    whether the payload is of any interest before parsing it.
+\param self the MMessage object to store the parsed header
+\param cursor the cursor pointing to the message. On success it is moved to
+    the first line of the payload.
+\return TRUE if the header could be parsed, otherwise FALSE
+\sa mbus_payload_scan
 */
 gboolean
-mbus_message_read( MMessage * self, GString * buf )
+mbus_message_parse_header( MMessage * self, MCursor * cursor )
 {
-  gchar * pos;
-
   self->ok = FALSE;
 
-  mbus_header_read( self->header, buf );
+  mbus_header_parse( self->header, cursor );
   if ( !mbus_header_ok( self->header ) ) return FALSE;
-  pos = strchr( buf->str, '\n' );
-  if ( ! pos ) return FALSE;
-  else pos++;
+  if ( !mbus_cursor_skip_line( cursor ) ) return FALSE;
 
-  g_string_erase( buf, 0, ( gsize ) ( pos - buf->str ) );
+  self->ok = TRUE;
 
-  if ( buf->len ) mbus_payload_read( self->payload, buf );
+  return TRUE;
+}
 
-  self->ok = TRUE;
+static gboolean
+__mbus_message_parse( MMessage * self, MCursor * cursor, gboolean lazy )
+{
+  if ( !mbus_message_parse_header( self, cursor ) ) return FALSE;
+
+  if ( !mbus_cursor_at_end( cursor ) ) {
+    if ( lazy )
+      mbus_payload_scan( self->payload, cursor );
+    else
+      mbus_payload_parse( self->payload, cursor );
+  }
 
   return TRUE;
 }
 
+/**
+\brief Parses an Mbus message in a single pass without modifying the buffer
+\param self the MMessage object to store the parsed message
+\param buf the text to parse
+\param len the length of \a buf
+\return TRUE if the message parsing was successful, otherwise FALSE
+*/
+gboolean
+mbus_message_parse( MMessage * self, const gchar * buf, gsize len )
+{
+  MCursor cursor;
+
+  mbus_cursor_init( &cursor, buf, len );
+
+  return __mbus_message_parse( self, &cursor, FALSE );
+}
+
+/**
+\brief Parses the header of an Mbus message and scans its payload. The
+    commands of the payload are parsed when they are accessed for the first
+    time, so the work is only done for messages that are actually handled.
+\param self the MMessage object to store the parsed message
+\param buf the text to parse
+\param len the length of \a buf
+\return TRUE if the message parsing was successful, otherwise FALSE
+\sa mbus_payload_scan
+*/
+gboolean
+mbus_message_scan( MMessage * self, const gchar * buf, gsize len )
+{
+  MCursor cursor;
+
+  mbus_cursor_init( &cursor, buf, len );
+
+  return __mbus_message_parse( self, &cursor, TRUE );
+}
+
+/**
+\brief Parses an Mbus message
+\param self the MMessage object to store the parsed message
+\param buf the string containing the text to parse. The parsed characters
+    are removed from the buffer.
+\return TRUE if the message parsing was successful, otherwise FALSE
+\sa mbus_message_parse
+*/
+gboolean
+mbus_message_read( MMessage * self, GString * buf )
+{
+  MCursor	cursor;
+  gboolean	ret;
+
+  mbus_cursor_init( &cursor, buf->str, buf->len );
+  ret = __mbus_message_parse( self, &cursor, FALSE );
+  g_string_erase( buf, 0, ( gssize ) ( cursor.pos - buf->str ) );
+
+  return ret;
+}
+
 /**
 \brief Converts an Mbus message object into a string representation usable for
     transport over Mbus
@@ -117,15 +219,51 @@ mbus_message_read( MMessage * self, GString * buf )
 */
 gboolean
 mbus_message_as_string( MMessage * self, GString * buf )
+{
+  MWriter	writer;
+  guint64	timestamp = mbus_header_timestamp_now();
+
+  mbus_writer_init_append( &writer, buf,
+			   mbus_message_text_len( self, timestamp ) );
+
+  return mbus_message_write( self, timestamp, &writer );
+}
+
+/**
+\brief computes the exact length of the string representation of an Mbus
+    message
+\param self The MMessage object
+\param timestamp the timestamp that will be written into the header
+\return the number of characters mbus_message_write will write
+*/
+gsize
+mbus_message_text_len( MMessage * self, guint64 timestamp )
+{
+  return mbus_header_text_len( self->header, timestamp ) + 1 +
+    mbus_payload_text_len( self->payload );
+}
+
+/**
+\brief writes the string representation of an Mbus message into a
+    preallocated buffer
+\param self The MMessage object
+\param timestamp the timestamp to write into the header, usually the
+    current time. The timestamp of the message is left unchanged.
+\param writer the writer with room for at least mbus_message_text_len
+    characters
+\return TRUE if the conversion to string was successful, otherwise FALSE
+*/
+gboolean
+mbus_message_write( MMessage * self, guint64 timestamp, MWriter * writer )
 {
   self->ok = FALSE;
 
-  mbus_header_as_string( self->header, buf );
+  mbus_header_write( self->header, timestamp, writer );
   if ( !mbus_header_ok( self->header ) ) return FALSE;
 
-  g_string_append_c( buf, '\n' );
+  mbus_writer_put_c( writer, '\n' );
 
-  mbus_payload_as_string( self->payload, buf );
+  mbus_payload_write( self->payload, writer );
   if ( !mbus_payload_ok( self->payload ) ) return FALSE;
 
   self->ok = TRUE;
@@ -144,8 +282,7 @@ mbus_message_contains( const MMessage * self, const gchar * command )
 {
   if ( !mbus_payload_size( self->payload ) ) return FALSE;
 
-  return mbus_command_is_command( mbus_payload_index( self->payload, 0 ),
-				  command );
+  return mbus_payload_is_command( self->payload, 0, command );
 }
 
 /**
@@ -185,7 +322,8 @@ mbus_message_add_command( MMessage * self, const gchar * cmd )
     application registered for an command in the message the application may
     want to have access to the corresponding MCommand object. As an MMessage
     object may contain more than one MCommand objects this function provides an
-    easy way to access the relevant MCommand object.
+    easy way to access the relevant MCommand object. It is only valid
+    while the callback function is running.
 \param self the MMessage object
 \return The relevant MCommand object if found, otherwise NULL
 */
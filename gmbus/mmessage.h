@@ -37,7 +37,9 @@ extern "C" {
 */
 
 /**
-\brief describes an Mbus message with header and payload
+\brief describes an Mbus message with header and payload. Messages are
+    reference counted, so a message passed to a callback function can be
+    kept by calling mbus_message_ref instead of copying it.
 \sa MHeader, MPayload
 */
 typedef struct {
@@ -46,13 +48,22 @@ typedef struct {
   gboolean	ok;
 
   guint         _index;
+  gint		_ref_count;
 } MMessage;
 
 MMessage * mbus_message_new( void );
 MMessage * mbus_message_assign( MMessage * self, MMessage * rhs );
 void mbus_message_free( MMessage * me );
+MMessage * mbus_message_ref( const MMessage * self );
+void mbus_message_unref( MMessage * self );
+gboolean mbus_message_parse_header( MMessage * self, MCursor * cursor );
+gboolean mbus_message_parse( MMessage * self, const gchar * buf, gsize len );
+gboolean mbus_message_scan( MMessage * self, const gchar * buf, gsize len );
 gboolean mbus_message_read( MMessage * me, GString * buf );
 gboolean mbus_message_as_string( MMessage * me, GString * buf );
+gsize mbus_message_text_len( MMessage * self, guint64 timestamp );
+gboolean mbus_message_write( MMessage * self, guint64 timestamp,
+			     MWriter * writer );
 
 gboolean mbus_message_contains( const MMessage * msg, const gchar * command );
 gboolean mbus_message_add( MMessage * me, MCommand * c );
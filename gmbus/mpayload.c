@@ -26,11 +26,22 @@
 #include <string.h>
 #include <stdio.h>
 
+/* serializes the parsing of scanned commands. A referenced message may be
+   read by several threads at the same time */
+static GMutex __mbus_payload_lock;
+
+/* returns the command at index i or NULL if it has not been parsed yet */
+#define __mbus_payload_parsed( self, i ) \
+  ( ( MCommand * ) g_atomic_pointer_get( &( self )->cmds->pdata[ i ] ) )
+
 static void
 __mbus_payload_init( MPayload * self )
 {
   self->cmds = g_ptr_array_sized_new( 1 );
   self->ok = TRUE;
+  self->text = NULL;
+  self->spans = NULL;
+  self->arena = NULL;
 }
 
 /**
@@ -54,9 +65,29 @@ __mbus_payload_finalize( MPayload * self )
   gint i;
 
   for ( i = 0; i < self->cmds->len; i++ )
-    mbus_command_free( self->cmds->pdata[ i ] );
+    if ( self->cmds->pdata[ i ] ) mbus_command_free( self->cmds->pdata[ i ] );
 
   g_ptr_array_free( self->cmds, TRUE );
+  if ( self->text ) g_string_free( self->text, TRUE );
+  if ( self->spans ) g_array_free( self->spans, TRUE );
+  /* the commands may have used the arena, so it is freed last */
+  if ( self->arena ) mbus_arena_free( self->arena );
+}
+
+/* parses the scanned command at index i. The arguments are allocated from
+   the arena if given */
+static MCommand *
+__mbus_payload_parse_span( const MPayload * self, guint i, MArena * arena )
+{
+  MPayloadSpan *	span = &g_array_index( self->spans, MPayloadSpan, i );
+  MCommand *		cmd = mbus_command_new( NULL );
+  MCursor		cursor;
+
+  mbus_cursor_init( &cursor, self->text->str + span->offset,
+		    self->text->len - span->offset );
+  mbus_command_parse( cmd, &cursor, arena );
+
+  return cmd;
 }
 
 /**
@@ -72,42 +103,105 @@ mbus_payload_free( MPayload * self )
 }
 
 /**
-\brief parses the body of an Mbus message by using the MCommand parse for
-    each line in the body.
+\brief parses the body of an Mbus message by using the MCommand parser for
+    each line in the body. The arguments of the commands are allocated from
+    the arena of the payload.
 \param self the payload object used to store the parsed data
-\param buf the buffer to parse
+\param cursor the cursor pointing to the first line of the body
 \return TRUE if the message body could be parsed successfully, otherwise FALSE
-\sa mbus_command_read
+\sa mbus_command_parse
 */
 gboolean
-mbus_payload_read( MPayload * self, GString * buf )
+mbus_payload_parse( MPayload * self, MCursor * cursor )
 {
   MCommand *	cmd;
-  gboolean	finished = FALSE;
 
   self->ok = TRUE;			/* payload may be empty */
+  if ( !self->arena ) self->arena = mbus_arena_new( 0 );
 
-  while ( !finished && ( buf->str[ 0 ] != '\n' ) && ( buf->len > 1 ) ) {
+  while ( ( mbus_cursor_peek( cursor ) != '\n' ) &&
+	  ( mbus_cursor_left( cursor ) > 1 ) ) {
     cmd = mbus_command_new( NULL );
-    mbus_command_read( cmd, buf );
-    if ( mbus_command_ok( cmd ) ) {
-      g_ptr_array_add( self->cmds, cmd );
-      /* look for end of line */
-      while ( buf->str[ 0 ] != '\n' ) {
-	if ( buf->str[ 0 ] == '\0' ) return FALSE;
-	g_string_erase( buf, 0, 1 );
-      }
-      g_string_erase( buf, 0, 1 );
-      finished = FALSE;
-    } else {
-      mbus_command_free( cmd );
-      finished = TRUE;
-    }
-  } /* while(!finished) */
+    mbus_command_parse( cmd, cursor, self->arena );
+    g_ptr_array_add( self->cmds, cmd );
+    /* look for end of line */
+    if ( !mbus_cursor_skip_line( cursor ) ) return FALSE;
+  }
 
   return TRUE;
 }
 
+/**
+\brief scans the body of an Mbus message. In opposite to mbus_payload_parse
+    only the position of each command is recorded and the text is copied
+    into the payload. The MCommand objects are created by
+    mbus_payload_index when they are accessed for the first time.
+\param self the payload object used to store the scanned data
+\param cursor the cursor pointing to the first line of the body
+\return TRUE if the message body could be scanned successfully, otherwise
+    FALSE
+\sa mbus_payload_parse
+*/
+gboolean
+mbus_payload_scan( MPayload * self, MCursor * cursor )
+{
+  const gchar *	start = cursor->pos;
+  gboolean	ret = TRUE;
+
+  self->ok = TRUE;			/* payload may be empty */
+
+  if ( !self->spans )
+    self->spans = g_array_new( FALSE, TRUE, sizeof( MPayloadSpan ) );
+  if ( !self->text ) self->text = g_string_new( NULL );
+
+  while ( ( mbus_cursor_peek( cursor ) != '\n' ) &&
+	  ( mbus_cursor_left( cursor ) > 1 ) ) {
+    MPayloadSpan span;
+
+    span.offset = self->text->len + ( cursor->pos - start );
+    span.name_len = mbus_command_skip( cursor );
+    /* resolved on demand by mbus_payload_get_quark */
+    span.quark = 0;
+    /* commands already in the payload keep their index */
+    g_array_set_size( self->spans, self->cmds->len );
+    g_array_append_val( self->spans, span );
+    g_ptr_array_add( self->cmds, NULL );
+    /* look for end of line */
+    if ( !mbus_cursor_skip_line( cursor ) ) {
+      /* keep the rest of the text as the parser may look at it */
+      cursor->pos = cursor->end;
+      ret = FALSE;
+      break;
+    }
+  }
+
+  g_string_append_len( self->text, start, cursor->pos - start );
+
+  return ret;
+}
+
+/**
+\brief parses the body of an Mbus message by using the MCommand parser for
+    each line in the body.
+\param self the payload object used to store the parsed data
+\param buf the buffer to parse. The parsed characters are removed from the
+    buffer.
+\return TRUE if the message body could be parsed successfully, otherwise FALSE
+\sa mbus_payload_parse
+*/
+gboolean
+mbus_payload_read( MPayload * self, GString * buf )
+{
+  MCursor	cursor;
+  gboolean	ret;
+
+  mbus_cursor_init( &cursor, buf->str, buf->len );
+  ret = mbus_payload_parse( self, &cursor );
+  g_string_erase( buf, 0, ( gssize ) ( cursor.pos - buf->str ) );
+
+  return ret;
+}
+
 /**
 \brief creates a text representation of the payloiad object used for Mbus
     transport
@@ -120,18 +214,48 @@ mbus_payload_read( MPayload * self, GString * buf )
 gboolean
 mbus_payload_as_string( MPayload * self, GString * buf )
 {
-  gint i;
+  MWriter writer;
 
-  for ( i = 0; i < self->cmds->len; i++ ) {
-    MCommand * cmd  = g_ptr_array_index( self->cmds, i );
+  mbus_writer_init_append( &writer, buf, mbus_payload_text_len( self ) );
+  mbus_payload_write( self, &writer );
 
-    mbus_command_as_string( cmd, buf );
-    g_string_append_c( buf, '\n' );
+  return TRUE;
+}
+
+/**
+\brief computes the length of the text representation of the payload
+\param self the payload object
+\return the number of characters mbus_payload_write will write
+*/
+gsize
+mbus_payload_text_len( MPayload * self )
+{
+  gsize len = 0;
+  guint i;
+
+  for ( i = 0; i < self->cmds->len; i++ )
+    len += mbus_command_text_len( mbus_payload_index( self, i ) ) + 1;
+
+  return len;
+}
+
+/**
+\brief writes the text representation of the payload
+\param self the payload object
+\param writer the writer with room for at least mbus_payload_text_len
+    characters
+*/
+void
+mbus_payload_write( MPayload * self, MWriter * writer )
+{
+  guint i;
+
+  for ( i = 0; i < self->cmds->len; i++ ) {
+    mbus_command_write( mbus_payload_index( self, i ), writer );
+    mbus_writer_put_c( writer, '\n' );
   }
 
   self->ok = TRUE;
-
-  return TRUE;
 }
 
 /**
@@ -148,6 +272,92 @@ mbus_payload_add( MPayload * self, MCommand * cmd )
   return TRUE;
 }
 
+/**
+\brief retrieves an MCommand object at index \a i. If the payload was
+    filled by mbus_payload_scan the command is parsed on first access.
+\param self the payload object
+\param i the index of the MCommand object to retrieve
+\return a pointer to the MCommand object if found, otherwise NULL
+*/
+MCommand *
+mbus_payload_index( MPayload * self, guint i )
+{
+  MCommand * cmd;
+
+  if ( i >= self->cmds->len ) return NULL;
+
+  cmd = __mbus_payload_parsed( self, i );
+  if ( !cmd ) {
+    g_mutex_lock( &__mbus_payload_lock );
+    /* another thread may have parsed the command in the meantime */
+    cmd = __mbus_payload_parsed( self, i );
+    if ( !cmd ) {
+      if ( !self->arena ) self->arena = mbus_arena_new( 0 );
+      cmd = __mbus_payload_parse_span( self, i, self->arena );
+      g_atomic_pointer_set( &self->cmds->pdata[ i ], cmd );
+    }
+    g_mutex_unlock( &__mbus_payload_lock );
+  }
+
+  return cmd;
+}
+
+/**
+\brief checks if the command at index \a i has the given name. For commands
+    that have not been parsed yet only the name is compared.
+\param self the payload object
+\param i the index of the command
+\param name the command name to compare with
+\return TRUE if the command has the given name, otherwise FALSE
+*/
+gboolean
+mbus_payload_is_command( const MPayload * self, guint i, const gchar * name )
+{
+  MPayloadSpan *	span;
+  MCommand *		cmd;
+
+  if ( i >= self->cmds->len ) return FALSE;
+  if ( ( cmd = __mbus_payload_parsed( self, i ) ) )
+    return mbus_command_is_command( cmd, name );
+
+  span = &g_array_index( self->spans, MPayloadSpan, i );
+
+  return ( strlen( name ) == span->name_len &&
+	   !memcmp( self->text->str + span->offset, name, span->name_len ) );
+}
+
+/**
+\brief returns the interned atom of the name of the command at index \a i.
+    Comparing atoms is cheaper than comparing the names.
+\param self the payload object
+\param i the index of the command
+\return the atom of the command name or 0 if the name is unknown or there
+    is no command at the given index
+*/
+GQuark
+mbus_payload_get_quark( MPayload * self, guint i )
+{
+  MPayloadSpan *	span;
+  MCommand *		cmd;
+  GQuark		quark;
+
+  if ( i >= self->cmds->len ) return 0;
+  if ( ( cmd = __mbus_payload_parsed( self, i ) ) )
+    return mbus_command_get_quark( cmd );
+
+  span = &g_array_index( self->spans, MPayloadSpan, i );
+  /* unknown names are looked up again as they may have been interned in
+     the meantime. Looking up the same name twice is harmless. */
+  quark = ( GQuark ) g_atomic_int_get( ( gint * ) &span->quark );
+  if ( !quark ) {
+    quark = mbus_quark_try_string_len( self->text->str + span->offset,
+				       span->name_len );
+    g_atomic_int_set( ( gint * ) &span->quark, ( gint ) quark );
+  }
+
+  return quark;
+}
+
 /**
 \brief assigns the MPayload object self a new list of MCommand objects copied
     from the MPayload object other
@@ -162,9 +372,12 @@ mbus_payload_assign( MPayload * self, const MPayload * other )
     gint i;
 
     g_ptr_array_set_size( self->cmds, self->cmds->len );
-    for ( i = 0; i < other->cmds->len; i++ )
-      g_ptr_array_add( self->cmds,
-		       mbus_command_copy( other->cmds->pdata[ i ] ) );
+    for ( i = 0; i < other->cmds->len; i++ ) {
+      MCommand * cmd = __mbus_payload_parsed( other, i );
+
+      g_ptr_array_add( self->cmds, cmd ? mbus_command_copy( cmd ) :
+		       __mbus_payload_parse_span( other, i, NULL ) );
+    }
     self->ok = other->ok;
   }
 
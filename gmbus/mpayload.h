@@ -37,21 +37,51 @@ extern "C" {
 \{
 */
 
+/**
+\brief describes the position of a command within the text of a payload
+    that has been scanned but not parsed yet
+*/
+typedef struct {
+  /** offset of the command within the text */
+  guint		offset;
+  /** length of the command name */
+  guint		name_len;
+  /** the interned atom of the command name or 0 if it is unknown */
+  GQuark	quark;
+} MPayloadSpan;
+
 /**
 \brief describes the payload of an Mbus message and contains a list of
-    MCommand objects
+    MCommand objects. A payload filled by mbus_payload_scan keeps a copy of
+    the message text and creates the MCommand objects on first access.
 */
 typedef struct {
+  /** the MCommand objects. NULL entries have not been parsed yet */
   GPtrArray *	cmds;
   gboolean	ok;
+  /** text of a scanned payload or NULL */
+  GString *	text;
+  /** positions of the commands within text (MPayloadSpan) */
+  GArray *	spans;
+  /** the arena that the arguments of parsed commands are allocated from.
+      It is freed together with the payload. */
+  MArena *	arena;
 } MPayload;
 
 MPayload * mbus_payload_new( void );
 void mbus_payload_free( MPayload * self );
 MPayload * mbus_payload_assign( MPayload * self, const MPayload * other );
+gboolean mbus_payload_parse( MPayload * self, MCursor * cursor );
+gboolean mbus_payload_scan( MPayload * self, MCursor * cursor );
 gboolean mbus_payload_read( MPayload * self, GString * buf );
 gboolean mbus_payload_as_string( MPayload * self, GString * buf );
+gsize mbus_payload_text_len( MPayload * self );
+void mbus_payload_write( MPayload * self, MWriter * writer );
 gboolean mbus_payload_add( MPayload * self, MCommand * cmd );
+MCommand * mbus_payload_index( MPayload * self, guint i );
+gboolean mbus_payload_is_command( const MPayload * self, guint i,
+				  const gchar * name );
+GQuark mbus_payload_get_quark( MPayload * self, guint i );
 
 /**
 \def mbus_payload_size
@@ -60,15 +90,6 @@ gboolean mbus_payload_add( MPayload * self, MCommand * cmd );
 */
 #define mbus_payload_size( self ) ( self->cmds->len )
 
-/**
-\def mbus_payload_index
-\brief retrieves an MCommand object at index \a i
-\param self the payload object
-\param i the index of the MCommand object to retrieve
-\return a pointer to the MCommand object if found, otherwise NULL
-*/
-#define mbus_payload_index( self, i ) ( g_ptr_array_index( self->cmds, i ) )
-
 /**
 \def mbus_payload_ok
 \brief returns the status of the payload object
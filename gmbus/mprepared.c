@@ -0,0 +1,217 @@
+/* mprepared.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "gmbus/mprepared.h"
+#include "gmbus/base64.h"
+
+#include <string.h>
+
+/**
+\addtogroup mprepared MPreparedMessage
+\{
+*/
+
+/* the type letters of mbus_argument_check that can be prepared */
+static const gchar	__mbus_prepared_types[] = "ifsyd";
+
+/**
+\brief prepares a message for sending the given command several times
+\param client the client sending the message. It must not be freed before
+    the prepared message.
+\param destination the destination of the message or NULL to address all
+    entities of the Mbus session
+\param command the name of the command
+\param signature the types of the arguments (see MPreparedMessage)
+\return the prepared message. If the signature is invalid or the message
+    header could not be created mbus_prepared_ok is FALSE.
+*/
+MPreparedMessage *
+mbus_prepared_new( MClient * client, const MAddress * destination,
+		const gchar * command, const gchar * signature )
+{
+	MPreparedMessage *	self = g_new( MPreparedMessage, 1 );
+	MMessage *			msg;
+
+	g_assert( self );
+
+	self->client = client;
+	self->destination = mbus_address_new();
+	if ( destination )
+		mbus_address_assign( self->destination, destination );
+	self->command_len = strlen( command ) + 1;
+	self->command = g_strconcat( command, "(", NULL );
+	self->signature = g_strdup( signature );
+	self->n_args = strlen( signature );
+	self->values = g_new( MPreparedValue, MAX( self->n_args, 1 ) );
+	self->buf = g_byte_array_new();
+	self->ok = ( strspn( signature, __mbus_prepared_types ) == self->n_args );
+
+	if ( !self->ok )
+		g_warning( "unsupported argument signature '%s'", signature );
+
+	/* the template contains the header and the empty line separating it
+	   from the payload */
+	msg = mbus_message_new();
+	mbus_header_set_destination( msg->header, self->destination );
+	self->header = mbus_transport_template_new( client->trans, msg );
+	mbus_message_free( msg );
+
+	if ( !self->header ) self->ok = FALSE;
+
+	return self;
+}
+
+/**
+\brief frees a prepared message
+\param self the prepared message
+*/
+void
+mbus_prepared_free( MPreparedMessage * self )
+{
+	if ( self->header ) mbus_link_template_free( self->header );
+	mbus_address_free( self->destination );
+	g_free( self->command );
+	g_free( self->signature );
+	g_free( self->values );
+	g_byte_array_free( self->buf, TRUE );
+	g_free( self );
+}
+
+/**
+\brief sends the prepared message with the given argument values
+\param self the prepared message
+\param args the values of the arguments as described by the signature.
+    Strings are escaped like MString objects.
+\return TRUE if the message was sent, otherwise FALSE. A symbol argument
+    with characters that are not valid for symbols is not sent.
+*/
+gboolean
+mbus_prepared_send_valist( MPreparedMessage * self, va_list args )
+{
+	MPreparedValue *	value;
+	MWriter				writer;
+	gsize				len;
+	guint				i;
+
+	if ( !mbus_prepared_ok( self ) ) return FALSE;
+
+	/* <command>(<argument> ... )\n */
+	len = self->command_len + 2;
+	for ( i = 0; i < self->n_args; i++ ) {
+		value = &self->values[ i ];
+
+		switch ( self->signature[ i ] ) {
+		case 'i':
+			value->integer = va_arg( args, gint64 );
+			len += mbus_writer_int64_len( value->integer );
+			break;
+		case 'f':
+			value->len = mbus_double_format( va_arg( args, gdouble ),
+					value->text );
+			len += value->len;
+			break;
+		case 's':
+			value->str = va_arg( args, const gchar * );
+			value->len = strlen( value->str );
+			len += mbus_string_quoted_len( value->str, value->len );
+			break;
+		case 'y':
+			value->str = va_arg( args, const gchar * );
+			value->len = strlen( value->str );
+			if ( !mbus_symbol_is_valid_text( value->str, value->len ) ) {
+				g_warning( "invalid characters in symbol (not sent)" );
+				return FALSE;
+			}
+			len += value->len;
+			break;
+		case 'd':
+			value->data = va_arg( args, const GByteArray * );
+			len += base64encode_len( value->data->len ) + 2;
+			break;
+		}
+
+		len++;
+	}
+
+	g_byte_array_set_size( self->buf, len );
+	mbus_writer_init( &writer, ( gchar * ) self->buf->data, len );
+	mbus_writer_put( &writer, self->command, self->command_len );
+
+	for ( i = 0; i < self->n_args; i++ ) {
+		value = &self->values[ i ];
+
+		switch ( self->signature[ i ] ) {
+		case 'i':
+			mbus_writer_put_int64( &writer, value->integer );
+			break;
+		case 'f':
+			mbus_writer_put( &writer, value->text, value->len );
+			break;
+		case 's':
+			mbus_string_write_quoted( &writer, value->str, value->len );
+			break;
+		case 'y':
+			mbus_writer_put( &writer, value->str, value->len );
+			break;
+		case 'd':
+			mbus_writer_put_c( &writer, '<' );
+			writer.pos += base64encode_raw( value->data->data,
+					value->data->len, ( guchar * ) writer.pos );
+			mbus_writer_put_c( &writer, '>' );
+			break;
+		}
+
+		mbus_writer_put_c( &writer, ' ' );
+	}
+
+	mbus_writer_put( &writer, ")\n", 2 );
+	g_assert( mbus_writer_at_end( &writer ) );
+
+	return mbus_transport_send_template( self->client->trans, self->header,
+			self->destination, ( const gchar * ) self->buf->data, len );
+}
+
+/**
+\brief sends the prepared message with the given argument values
+\param self the prepared message
+\param ... the values of the arguments as described by the signature
+\return TRUE if the message was sent, otherwise FALSE
+*/
+gboolean
+mbus_prepared_send( MPreparedMessage * self, ... )
+{
+	va_list		args;
+	gboolean	ret;
+
+	va_start( args, self );
+	ret = mbus_prepared_send_valist( self, args );
+	va_end( args );
+
+	return ret;
+}
+
+/**
+\}
+*/
+
+/* end of mprepared.c */
@@ -0,0 +1,123 @@
+/* mprepared.h
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef MBUS_PREPARED_H
+#define MBUS_PREPARED_H
+
+#include <stdarg.h>
+
+#include "gmbus/mclient.h"
+#include "gmbus/mdouble.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+\addtogroup mprepared MPreparedMessage
+\{
+*/
+
+/**
+\brief The value of a single argument of a prepared message while it is
+    sent
+*/
+typedef struct {
+	/** value of an MInteger argument */
+	gint64				integer;
+	/** value of an MString or MSymbol argument */
+	const gchar *		str;
+	/** value of an MData argument */
+	const GByteArray *	data;
+	/** the text of an MFloat argument */
+	gchar				text[ MBUS_DOUBLE_TEXT_SIZE ];
+	/** the length of the string or the text */
+	gsize				len;
+} MPreparedValue;
+
+/**
+\brief A message with a single command that is sent several times to the
+    same destination. The header and the command name are serialized once
+    by mbus_prepared_new, so mbus_prepared_send only has to write the
+    argument values. No MMessage, MCommand or MObject is created for
+    sending.
+
+    The types of the arguments are described by a signature using the
+    letters of mbus_argument_check. The values passed to
+    mbus_prepared_send must have these C types:
+
+    \li \c i gint64
+    \li \c f gdouble
+    \li \c s const gchar * (a zero terminated string)
+    \li \c y const gchar * (a zero terminated symbol)
+    \li \c d const GByteArray *
+
+    Lists are not supported. Prepared messages are always sent unreliably.
+*/
+typedef struct {
+	/** the client sending the message */
+	MClient *		client;
+	/** the destination of the message */
+	MAddress *		destination;
+	/** the message header serialized in advance */
+	MLinkTemplate *	header;
+	/** the command name followed by the opening bracket of the argument
+		list */
+	gchar *			command;
+	/** the number of characters of \a command */
+	gsize			command_len;
+	/** a type letter for each argument */
+	gchar *			signature;
+	/** the number of arguments */
+	guint			n_args;
+	/** storage for the argument values of the message being sent */
+	MPreparedValue *	values;
+	/** the payload of the message being sent. It is reused for each
+		message, so it only grows up to the largest payload. */
+	GByteArray *	buf;
+	/** status information */
+	gboolean		ok;
+} MPreparedMessage;
+
+MPreparedMessage * mbus_prepared_new( MClient * client,
+		const MAddress * destination, const gchar * command,
+		const gchar * signature );
+void mbus_prepared_free( MPreparedMessage * self );
+gboolean mbus_prepared_send( MPreparedMessage * self, ... );
+gboolean mbus_prepared_send_valist( MPreparedMessage * self, va_list args );
+
+/**
+\brief checks the status of a prepared message
+\return TRUE if the message could be prepared, otherwise FALSE
+*/
+#define mbus_prepared_ok( self ) ( ( self )->ok )
+
+/**
+\}
+*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBUS_PREPARED_H */
@@ -0,0 +1,225 @@
+/* mscan.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "gmbus/mscan.h"
+
+/* the vector kernels need the target attribute and the CPU detection of
+   newer compilers. Otherwise only the scalar version is available */
+#if ( defined( __x86_64__ ) || defined( __i386__ ) ) && \
+	( defined( __clang__ ) || __GNUC__ > 4 || \
+	  ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) )
+#  define MBUS_SCAN_X86 1
+#  include <immintrin.h>
+#endif
+
+/**
+\addtogroup mscan MScan
+\{
+*/
+
+typedef const gchar * ( *MScanFunc )( const gchar * pos, const gchar * end );
+
+static MScanFunc	__mbus_scan = NULL;
+static const gchar *	__mbus_scan_name = NULL;
+/* non-zero once an implementation has been selected */
+static gsize		__mbus_scan_selected = 0;
+
+#define __mbus_is_structural( c ) \
+	( ( c ) == ' ' || ( c ) == '\t' || ( c ) == '\n' || \
+	  ( c ) == '(' || ( c ) == ')' || ( c ) == '"' || \
+	  ( c ) == '<' || ( c ) == '>' )
+
+static const gchar *
+__mbus_scan_scalar( const gchar * pos, const gchar * end )
+{
+	while ( pos < end && !__mbus_is_structural( *pos ) ) pos++;
+
+	return pos;
+}
+
+#ifdef MBUS_SCAN_X86
+
+/* '(' and ')' as well as '<' and '>' differ in a single bit, so each pair
+   is matched by one comparison after setting that bit */
+
+__attribute__(( target( "sse2" ) ))
+static const gchar *
+__mbus_scan_sse2( const gchar * pos, const gchar * end )
+{
+	const __m128i	space = _mm_set1_epi8( ' ' );
+	const __m128i	tab = _mm_set1_epi8( '\t' );
+	const __m128i	newline = _mm_set1_epi8( '\n' );
+	const __m128i	quote = _mm_set1_epi8( '"' );
+	const __m128i	paren = _mm_set1_epi8( ')' );
+	const __m128i	angle = _mm_set1_epi8( '>' );
+	const __m128i	bit0 = _mm_set1_epi8( 0x01 );
+	const __m128i	bit1 = _mm_set1_epi8( 0x02 );
+
+	while ( end - pos >= 16 ) {
+		__m128i	v = _mm_loadu_si128( ( const __m128i * ) pos );
+		__m128i	m;
+		gint	mask;
+
+		m = _mm_or_si128( _mm_cmpeq_epi8( v, space ),
+				_mm_cmpeq_epi8( v, tab ) );
+		m = _mm_or_si128( m, _mm_cmpeq_epi8( v, newline ) );
+		m = _mm_or_si128( m, _mm_cmpeq_epi8( v, quote ) );
+		m = _mm_or_si128( m,
+				_mm_cmpeq_epi8( _mm_or_si128( v, bit0 ), paren ) );
+		m = _mm_or_si128( m,
+				_mm_cmpeq_epi8( _mm_or_si128( v, bit1 ), angle ) );
+
+		mask = _mm_movemask_epi8( m );
+		if ( mask ) return pos + __builtin_ctz( mask );
+		pos += 16;
+	}
+
+	return __mbus_scan_scalar( pos, end );
+}
+
+__attribute__(( target( "avx2" ) ))
+static const gchar *
+__mbus_scan_avx2( const gchar * pos, const gchar * end )
+{
+	const __m256i	space = _mm256_set1_epi8( ' ' );
+	const __m256i	tab = _mm256_set1_epi8( '\t' );
+	const __m256i	newline = _mm256_set1_epi8( '\n' );
+	const __m256i	quote = _mm256_set1_epi8( '"' );
+	const __m256i	paren = _mm256_set1_epi8( ')' );
+	const __m256i	angle = _mm256_set1_epi8( '>' );
+	const __m256i	bit0 = _mm256_set1_epi8( 0x01 );
+	const __m256i	bit1 = _mm256_set1_epi8( 0x02 );
+
+	while ( end - pos >= 32 ) {
+		__m256i	v = _mm256_loadu_si256( ( const __m256i * ) pos );
+		__m256i	m;
+		guint	mask;
+
+		m = _mm256_or_si256( _mm256_cmpeq_epi8( v, space ),
+				_mm256_cmpeq_epi8( v, tab ) );
+		m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, newline ) );
+		m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, quote ) );
+		m = _mm256_or_si256( m,
+				_mm256_cmpeq_epi8( _mm256_or_si256( v, bit0 ), paren ) );
+		m = _mm256_or_si256( m,
+				_mm256_cmpeq_epi8( _mm256_or_si256( v, bit1 ), angle ) );
+
+		mask = ( guint ) _mm256_movemask_epi8( m );
+		if ( mask ) return pos + __builtin_ctz( mask );
+		pos += 32;
+	}
+
+	return __mbus_scan_sse2( pos, end );
+}
+
+#endif /* MBUS_SCAN_X86 */
+
+static void
+__mbus_scan_detect( void )
+{
+	/* the environment variable allows to compare the kernels */
+	gboolean scalar = ( g_getenv( "MBUS_SCAN_SCALAR" ) != NULL );
+
+	__mbus_scan_name = "scalar";
+	__mbus_scan = __mbus_scan_scalar;
+
+#ifdef MBUS_SCAN_X86
+	if ( scalar ) return;
+
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx2" ) ) {
+		__mbus_scan_name = "avx2";
+		__mbus_scan = __mbus_scan_avx2;
+	} else if ( __builtin_cpu_supports( "sse2" ) ) {
+		__mbus_scan_name = "sse2";
+		__mbus_scan = __mbus_scan_sse2;
+	}
+#else
+	( void ) scalar;
+#endif
+}
+
+/* selects the implementation exactly once, as messages may be parsed by
+   the receive and worker threads as well */
+static void
+__mbus_scan_select( void )
+{
+	if ( g_once_init_enter( &__mbus_scan_selected ) ) {
+		__mbus_scan_detect();
+		g_once_init_leave( &__mbus_scan_selected, 1 );
+	}
+}
+
+/**
+\brief searches for the next structural character of the Mbus text format,
+    which is a blank, tab, newline, bracket, quote or angle bracket. The
+    fastest implementation available on the CPU is selected on first use.
+\param pos the position to start the search at
+\param end the end of the buffer
+\return the position of the structural character or \a end if none was
+    found
+*/
+const gchar *
+mbus_scan_structural( const gchar * pos, const gchar * end )
+{
+	__mbus_scan_select();
+
+	return __mbus_scan( pos, end );
+}
+
+/**
+\brief searches for the end of a number or symbol token, which is
+    terminated by a blank, tab, newline or closing bracket
+\param pos the first character of the token
+\param end the end of the buffer
+\return the position behind the last character of the token
+*/
+const gchar *
+mbus_scan_token_end( const gchar * pos, const gchar * end )
+{
+	while ( ( pos = mbus_scan_structural( pos, end ) ) < end ) {
+		if ( *pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == ')' )
+			break;
+		pos++;
+	}
+
+	return pos;
+}
+
+/**
+\brief returns the name of the scanning implementation used on this CPU
+    ("avx2", "sse2" or "scalar")
+*/
+const gchar *
+mbus_scan_impl_name( void )
+{
+	__mbus_scan_select();
+
+	return __mbus_scan_name;
+}
+
+/**
+\}
+*/
+
+/* end of mscan.c */
@@ -27,6 +27,7 @@
 #include "gmbus/mbus.h"
 #include "gmbus/mmessage.h"
 #include "gmbus/mutil.h"
+#include "gmbus/mevent.h"
 
 static const gdouble	c_hello_factor = 200.0;
 static const gdouble	c_hello_min = 1000.0;
@@ -140,9 +141,12 @@ __calculate_hello_interval( MTransport * self )
 static gboolean
 __mbus_transport_when_hello( MTransport * self )
 {
-	mbus_transport_send( self, self->hello_message );
+	if ( self->hello_template )
+		mbus_transport_send_template( self, self->hello_template,
+				self->hello_message->header->destination, NULL, 0 );
 
-	self->hello_timer = g_timeout_add( __calculate_hello_interval( self ),
+	self->hello_timer = mbus_event_add_timeout(
+			__calculate_hello_interval( self ),
 			( GSourceFunc ) __mbus_transport_when_hello, self );
 
 	return FALSE; /* remove old hello timer */
@@ -172,7 +176,7 @@ __mbus_transport_check_for_new_entity( MTransport * self,
 					lmsg->message->header->source ) ) {
 		/* add new entity to list */
 		MEntity *	ep = g_new( MEntity, 1 );
-		MAddress *	addr = mbus_address_copy( lmsg->message->header->source );
+		MAddress *	addr = mbus_address_ref( lmsg->message->header->source );
 
 		ep->endpoint = lmsg->sender;
 		g_get_current_time( &ep->last_hello );
@@ -198,7 +202,7 @@ __mbus_transport_check_for_acks( MTransport * self, const MMessage * msg )
 		if ( rel ) {
 			MReliableMessage *	rmsg = ( MReliableMessage * ) rel;
 
-			if ( rmsg->timer ) g_source_remove( rmsg->timer );
+			if ( rmsg->timer ) mbus_event_remove( rmsg->timer );
 			mbus_message_free( rmsg->message );
 			g_hash_table_lookup_extended( self->reliable_messages, key,
 					&key, &rel );
@@ -225,7 +229,7 @@ __mbus_transport_handle_message( MTransport * self, const MLinkMessage * lmsg )
 		__mbus_transport_recv_bye( self, lmsg->message );
 	else {
 		/* is addressed to this entity */
-		if ( !mbus_address_is_subset_of( self->address,
+		if ( !mbus_address_matcher_match( self->matcher,
 						lmsg->message->header->destination ) ) return;
 
 		if ( mbus_callback_ok( self->incoming_message ) &&
@@ -243,6 +247,19 @@ __mbus_transport_is_my_message( MTransport * self, const MLinkMessage * lmsg )
 }
 
 /* callback messages for the link layer */
+static gboolean
+__mbus_transport_wants_link_payload( const MHeader * header, gpointer data )
+{
+	MTransport * self = data;
+
+	/* own messages are dropped anyway. Hellos are addressed to everyone
+	   and therefore always pass the destination check */
+	if ( mbus_address_is_equal( self->address, header->source ) )
+		return FALSE;
+
+	return mbus_address_matcher_match( self->matcher, header->destination );
+}
+
 static void
 __mbus_transport_when_link_error( const MError * error, gpointer data )
 {
@@ -261,8 +278,8 @@ __mbus_transport_send_acks( MAcknowledgement * ack )
 
 	g_array_append_vals( msg->header->acks, ack->acks->data, ack->acks->len );
 	msg->header->sequence_no = ack->transport->sequence_no++;
-	mbus_address_assign( msg->header->destination, ack->source );
-	mbus_address_assign( msg->header->source, ack->transport->address );
+	mbus_header_set_destination( msg->header, ack->source );
+	mbus_header_set_source( msg->header, ack->transport->address );
 	mbus_link_send( ack->transport->link, msg );
 
 	g_hash_table_remove( ack->transport->acknowledgements, ack->source );
@@ -296,13 +313,13 @@ __mbus_transport_when_link_message( const MLinkMessage * lmsg, gpointer data )
 		} else {
 			MAcknowledgement *	ack = g_new( MAcknowledgement, 1 );
 			MAddress *			addr =
-					mbus_address_copy( lmsg->message->header->source );
+					mbus_address_ref( lmsg->message->header->source );
 
 			ack->acks = g_array_new( FALSE, FALSE, sizeof( gulong ) );
 			g_array_append_val( ack->acks, lmsg->message->header->sequence_no );
 			ack->source = addr;
 			ack->transport = transport;
-			ack->timer = g_timeout_add( T_c,
+			ack->timer = mbus_event_add_timeout( T_c,
 					( GSourceFunc ) __mbus_transport_send_acks, ack );
 			g_hash_table_insert( transport->acknowledgements, addr, ack );
 		}
@@ -316,7 +333,8 @@ __mbus_transport_init( MTransport * self, MConfig * config )
 {
 	MLinkCallback cl = { ( gpointer ) self,
 						 __mbus_transport_when_link_error,
-						 __mbus_transport_when_link_message };
+						 __mbus_transport_when_link_message,
+						 __mbus_transport_wants_link_payload };
 
 	/* init members */
 	self->sequence_no = 0;
@@ -347,12 +365,16 @@ __mbus_transport_init( MTransport * self, MConfig * config )
 	self->hello_timer = 0;
 	self->hello_message = mbus_message_new();
 	mbus_message_add_command( self->hello_message, "mbus.hello ()" );
+	self->hello_template = NULL;
+	if ( self->ok )
+		self->hello_template =
+			mbus_transport_template_new( self, self->hello_message );
 	/* do NOT send hello message directly from here as it causes mysterious
 	   problems with the sockets */
-	self->hello_timer = g_timeout_add( 0,
+	self->hello_timer = mbus_event_add_timeout( 0,
 			( GSourceFunc ) __mbus_transport_when_hello, self );
 
-	self->lost_timer = g_timeout_add( 1000, ( GSourceFunc )
+	self->lost_timer = mbus_event_add_timeout( 1000, ( GSourceFunc )
 			__mbus_transport_check_lost_entities,
 			self );
 }
@@ -377,6 +399,7 @@ mbus_transport_new( MConfig * config, const gchar * address )
 	self->address = mbus_address_new();
 	mbus_address_read( self->address, tmp );
 	mbus_address_disambiguate( self->address );
+	self->matcher = mbus_address_matcher_new( self->address );
 	self->ok = mbus_address_ok( self->address );
 
 	g_string_erase( tmp, 0, -1 );
@@ -397,11 +420,14 @@ __mbus_transport_finalize( MTransport * self )
 	g_hash_table_destroy( self->reliable_messages );
 	g_hash_table_destroy( self->acknowledgements );
 
-	g_source_remove( self->hello_timer );
-	g_source_remove( self->lost_timer );
+	mbus_event_remove( self->hello_timer );
+	mbus_event_remove( self->lost_timer );
 
 	mbus_address_free( self->address );
+	mbus_address_matcher_free( self->matcher );
 	mbus_message_free( self->hello_message );
+	if ( self->hello_template )
+		mbus_link_template_free( self->hello_template );
 
 	return 0;
 }
@@ -423,7 +449,7 @@ __retransmit_reliable( MReliableMessage * message )
 	message->n++;
 
 	if ( message->n < N_r ) {
-		message->timer = g_timeout_add( message->n * T_r,
+		message->timer = mbus_event_add_timeout( message->n * T_r,
 				( GSourceFunc ) __retransmit_reliable, message );
 	} else {
 		gpointer	key = NULL;
@@ -475,7 +501,7 @@ mbus_transport_send( MTransport * self, MMessage * msg )
 	MEntity * entity;
 
 	msg->header->sequence_no = self->sequence_no++;
-	mbus_address_assign( msg->header->source, self->address );
+	mbus_header_set_source( msg->header, self->address );
 
 	if ( msg->header->type == RELIABLE ) {
 		gulong *			key = g_new( gulong, 1 );
@@ -486,7 +512,7 @@ mbus_transport_send( MTransport * self, MMessage * msg )
 		rel_message->transport = self;
 		rel_message->message = mbus_message_new();
 		mbus_message_assign( rel_message->message, msg );
-		rel_message->timer = g_timeout_add( rel_message->n * T_r,
+		rel_message->timer = mbus_event_add_timeout( rel_message->n * T_r,
 				( GSourceFunc ) __retransmit_reliable, rel_message );
 		g_hash_table_insert( self->reliable_messages, key, rel_message );
 	}
@@ -498,7 +524,7 @@ mbus_transport_send( MTransport * self, MMessage * msg )
 						msg->header->destination );
 		if ( ack ) {
 			/* stop timer */
-			g_source_remove( ack->timer );
+			mbus_event_remove( ack->timer );
 			g_array_append_vals( msg->header->acks, ack->acks->data,
 					ack->acks->len );
 			g_hash_table_remove( self->acknowledgements, ack->source );
@@ -516,6 +542,51 @@ mbus_transport_send( MTransport * self, MMessage * msg )
 		return mbus_link_send_unicast( self->link, msg, &( entity->endpoint ) );
 }
 
+/**
+\brief creates a template for sending a message several times with
+	mbus_transport_send_template
+\param self the transport object
+\param msg the unreliable message. The source address of its header is set
+	to the address of the transport object.
+\return the template or NULL on failure. It must be freed with
+	mbus_link_template_free.
+*/
+MLinkTemplate *
+mbus_transport_template_new( MTransport * self, MMessage * msg )
+{
+	g_return_val_if_fail( msg->header->type == UNRELIABLE, NULL );
+
+	mbus_header_set_source( msg->header, self->address );
+
+	return mbus_link_template_new( self->link, msg );
+}
+
+/**
+\brief sends the message of a template with the next sequence number.
+	In opposite to mbus_transport_send no acknowledgements are added to the
+	message, they are sent when their timer expires.
+\param self the transport object
+\param tmpl the template created by mbus_transport_template_new
+\param destination the destination address of the template message. It
+	is used to choose the unicast endpoint.
+\param tail text appended to the message of the template
+\param tail_len the number of characters at \a tail
+\return TRUE means the operation was successfully completed, otherwise
+	FALSE
+*/
+gboolean
+mbus_transport_send_template( MTransport * self, const MLinkTemplate * tmpl,
+		const MAddress * destination, const gchar * tail, gsize tail_len )
+{
+	MEntity * entity = NULL;
+
+	if ( self->config->send_unicast )
+		entity = g_hash_table_lookup( self->entities, destination );
+
+	return mbus_link_send_template( self->link, tmpl, self->sequence_no++,
+			tail, tail_len, entity ? &( entity->endpoint ) : NULL );
+}
+
 /**
 \brief checks if a given Mbus entity exists in the current Mbus session
 	managed by the transport object
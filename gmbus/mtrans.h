@@ -59,6 +59,9 @@ typedef struct {
 	MLink *			link;
 	/** The Mbus address of this entity */
 	MAddress *		address;
+	/** The address of this entity compiled for checking the destination
+		of received messages */
+	MAddressMatcher *	matcher;
 
 	/** List of known entites */
 	GHashTable *	entities;
@@ -72,6 +75,9 @@ typedef struct {
 
 	/** Mbus hello message object*/
 	MMessage *		hello_message;
+	/** the hello message serialized in advance, so only sequence number
+		and timestamp are written for each hello */
+	MLinkTemplate *	hello_template;
 
 	/** ID for the hello timer */
 	guint			hello_timer;
@@ -103,6 +109,11 @@ typedef struct {
 MTransport * mbus_transport_new( MConfig * config, const gchar * address );
 void mbus_transport_free( MTransport * self );
 gboolean mbus_transport_send( MTransport * self, MMessage * msg );
+MLinkTemplate * mbus_transport_template_new( MTransport * self,
+		MMessage * msg );
+gboolean mbus_transport_send_template( MTransport * self,
+		const MLinkTemplate * tmpl, const MAddress * destination,
+		const gchar * tail, gsize tail_len );
 gboolean mbus_transport_is_entity_available( MTransport * self,
 		const MAddress * addr );
 
@@ -22,9 +22,67 @@
  */
 
 #include "gmbus/base64.h"
+#include "gmbus/mdouble.h"
 #include "gmbus/mtypes.h"
+#include "gmbus/mscan.h"
 #include "gmbus/mutil.h"
 
+#include <string.h>
+
+/* Sharing */
+
+/* adds a reference to the shared part of an object. The counter is
+   allocated when the object is copied for the first time. The object to
+   copy may be read by several threads, so the counter is installed
+   atomically. */
+static gint *
+__mbus_share( gint ** refs )
+{
+  gint * counter = g_atomic_pointer_get( refs );
+
+  if ( !counter ) {
+    counter = g_new( gint, 1 );
+    *counter = 1;
+    if ( !g_atomic_pointer_compare_and_exchange( refs, NULL, counter ) ) {
+      g_free( counter );
+      counter = g_atomic_pointer_get( refs );
+    }
+  }
+  g_atomic_int_inc( counter );
+
+  return counter;
+}
+
+/* drops the reference of an object to its shared part. Returns TRUE if
+   the object was the last one using it, so the caller has to free it. */
+static gboolean
+__mbus_release( gint ** refs )
+{
+  gboolean last = TRUE;
+
+  if ( *refs ) {
+    last = g_atomic_int_dec_and_test( *refs );
+    if ( last ) g_free( *refs );
+    *refs = NULL;
+  }
+
+  return last;
+}
+
+/* checks if the shared part is used by other objects as well */
+#define __mbus_is_shared( refs ) \
+  ( ( refs ) && g_atomic_int_get( refs ) > 1 )
+
+/* appends the text representation of an object of any type */
+static void
+__mbus_object_append( const MObject * obj, GString * buf )
+{
+  MWriter writer;
+
+  mbus_writer_init_append( &writer, buf, mbus_object_text_len( obj ) );
+  mbus_object_write( obj, &writer );
+}
+
 /* Integer */
 MObject *
 mbus_integer_new( gint64 number )
@@ -59,7 +117,7 @@ void
 mbus_integer_as_string( MObject * mint, GString * buf )
 {
   M_OBJECT_ASSERT( mint, MINTEGER );
-  mbus_util_int64_to_str( buf, M_INTEGER( mint )->number, TRUE );
+  __mbus_object_append( mint, buf );
 }
 
 
@@ -97,15 +155,71 @@ void
 mbus_float_as_string( MObject * mfloat, GString * buf )
 {
   M_OBJECT_ASSERT( mfloat, MFLOAT );
-  g_string_append_printf( buf, "%f", M_FLOAT( mfloat )->number );
+  __mbus_object_append( mfloat, buf );
 }
 
 /* String */
+
+/* stores the characters in the object if they fit, otherwise in a heap
+   buffer. Strings and symbols share the same layout. */
+static void
+__mbus_string_assign( MObject * obj, const gchar * str, gsize len )
+{
+  MString *	me = M_STRING( obj );
+  gchar *	old = NULL;
+
+  /* a shared buffer is left to the other objects */
+  if ( obj->heap_data && __mbus_release( &me->refs ) ) old = me->str;
+
+  if ( len < M_STRING_INLINE_SIZE ) {
+    memmove( me->inline_str, str, len );
+    me->str = me->inline_str;
+    obj->heap_data = FALSE;
+  } else {
+    me->str = g_malloc( len + 1 );
+    memcpy( me->str, str, len );
+    obj->heap_data = TRUE;
+  }
+  me->str[ len ] = '\0';
+  me->len = len;
+  if ( obj->type == MSYMBOL ) M_SYMBOL( obj )->quark = 0;
+
+  if ( old ) g_free( old );
+}
+
+static void
+__mbus_string_finalize( MObject * obj )
+{
+  if ( obj->heap_data && __mbus_release( &M_STRING( obj )->refs ) )
+    g_free( M_STRING( obj )->str );
+}
+
+/* makes obj a copy of other. Heap buffers are shared, short strings and
+   buffers allocated from an arena are copied. */
+static void
+__mbus_string_share( MObject * obj, const MObject * other )
+{
+  MString * me = M_STRING( obj );
+  MString * you = M_STRING( other );
+
+  if ( !other->heap_data ) {
+    __mbus_string_assign( obj, you->str, you->len );
+    return;
+  }
+
+  __mbus_string_finalize( obj );
+  me->refs = __mbus_share( &you->refs );
+  me->str = you->str;
+  me->len = you->len;
+  obj->heap_data = TRUE;
+}
+
 MObject *
 mbus_string_new( const gchar * str )
 {
   M_OBJECT_ALLOC( MString, MSTRING );
-  me->str = g_string_new( str );
+  me->refs = NULL;
+  __mbus_string_assign( obj, str ? str : "", str ? strlen( str ) : 0 );
 
   return obj;
 }
@@ -113,21 +227,25 @@ mbus_string_new( const gchar * str )
 MObject *
 mbus_string_copy( const MObject * mstring )
 {
-  return mbus_string_new( M_STRING( mstring )->str->str );
+  MObject * copy = mbus_string_new( NULL );
+
+  __mbus_string_share( copy, mstring );
+
+  return copy;
 }
 
 void
 mbus_string_set( MObject * mstring, const gchar * str )
 {
   M_OBJECT_ASSERT( mstring, MSTRING );
-  g_string_assign( M_STRING( mstring )->str, str );
+  __mbus_string_assign( mstring, str ? str : "", str ? strlen( str ) : 0 );
 }
 
 void
 mbus_string_free( MObject * mstring )
 {
   M_OBJECT_ASSERT( mstring, MSTRING );
-  g_string_free( M_STRING( mstring )->str, TRUE );
+  __mbus_string_finalize( mstring );
   M_OBJECT_FREE( mstring );
 }
 
@@ -135,7 +253,58 @@ void
 mbus_string_as_string( MObject * mstring, GString * buf )
 {
   M_OBJECT_ASSERT( mstring, MSTRING );
-  g_string_append_printf( buf, "\"%s\"", M_STRING( mstring )->str->str );
+  __mbus_object_append( mstring, buf );
+}
+
+/* quotes, backslashes and newlines within strings are escaped with a
+   backslash */
+#define __mbus_string_is_special( c ) \
+  ( ( c ) == '"' || ( c ) == '\\' || ( c ) == '\n' )
+
+/**
+\brief computes the length of the text representation of a string
+    including the quotes and escape characters
+\param str the characters of the string
+\param len the number of characters
+\return the number of characters mbus_string_write_quoted will write
+*/
+gsize
+mbus_string_quoted_len( const gchar * str, gsize len )
+{
+  gsize n = len + 2;
+  gsize i;
+
+  for ( i = 0; i < len; i++ )
+    if ( __mbus_string_is_special( str[ i ] ) ) n++;
+
+  return n;
+}
+
+/**
+\brief writes the text representation of a string. Quotes, backslashes
+    and newlines are escaped with a backslash.
+\param writer the writer with room for at least mbus_string_quoted_len
+    characters
+\param str the characters of the string
+\param len the number of characters
+*/
+void
+mbus_string_write_quoted( MWriter * writer, const gchar * str, gsize len )
+{
+  gsize start = 0;
+  gsize i;
+
+  mbus_writer_put_c( writer, '"' );
+  for ( i = 0; i < len; i++ ) {
+    if ( !__mbus_string_is_special( str[ i ] ) ) continue;
+
+    mbus_writer_put( writer, str + start, i - start );
+    mbus_writer_put_c( writer, '\\' );
+    mbus_writer_put_c( writer, str[ i ] == '\n' ? 'n' : str[ i ] );
+    start = i + 1;
+  }
+  mbus_writer_put( writer, str + start, len - start );
+  mbus_writer_put_c( writer, '"' );
 }
 
 /* Symbol */
@@ -154,8 +323,9 @@ MObject *
 mbus_symbol_new( const gchar * str )
 {
   if ( !str || __is_valid_symbol( str ) ) {
-    M_OBJECT_ALLOC( MString, MSYMBOL );
-    me->str = g_string_new( str );
+    M_OBJECT_ALLOC( MSymbol, MSYMBOL );
+    me->refs = NULL;
+    __mbus_string_assign( obj, str ? str : "", str ? strlen( str ) : 0 );
 
     return obj;
   }
@@ -166,7 +336,12 @@ mbus_symbol_new( const gchar * str )
 MObject *
 mbus_symbol_copy( const MObject * msymbol )
 {
-  return mbus_symbol_new( M_SYMBOL( msymbol )->str->str );
+  MObject * copy = mbus_symbol_new( NULL );
+
+  __mbus_string_share( copy, msymbol );
+  M_SYMBOL( copy )->quark = M_SYMBOL( msymbol )->quark;
+
+  return copy;
 }
 
 gboolean
@@ -182,7 +357,7 @@ mbus_symbol_is_valid( const MObject * msymbol )
   gchar * walk;
 
   M_OBJECT_ASSERT( msymbol, MSYMBOL );
-  walk = M_SYMBOL( msymbol )->str->str;
+  walk = M_SYMBOL( msymbol )->str;
   while ( *walk ) {
     if ( ! mbus_symbol_is_valid_char( *walk ) )
       return FALSE;
@@ -197,8 +372,8 @@ mbus_symbol_set( MObject * msymbol, const gchar * str )
 {
   M_OBJECT_ASSERT( msymbol, MSYMBOL );
 
-  if ( mbus_symbol_is_valid( msymbol ) )
-    g_string_assign( M_SYMBOL( msymbol )->str, str );
+  if ( __is_valid_symbol( str ) )
+    __mbus_string_assign( msymbol, str, strlen( str ) );
   else
     g_error( "invalid characters in symbol (not set)" );
 }
@@ -207,7 +382,7 @@ void
 mbus_symbol_free( MObject * msymbol )
 {
   M_OBJECT_ASSERT( msymbol, MSYMBOL );
-  g_string_free( M_SYMBOL( msymbol )->str, TRUE );
+  __mbus_string_finalize( msymbol );
   M_OBJECT_FREE( msymbol );
 }
 
@@ -215,15 +390,60 @@ void
 mbus_symbol_as_string( MObject * msymbol, GString * buf )
 {
   M_OBJECT_ASSERT( msymbol, MSYMBOL );
-  g_string_append( buf, M_SYMBOL( msymbol )->str->str );
+  __mbus_object_append( msymbol, buf );
 }
 
-/* Data */
-MObject *
-mbus_data_new( const guint8 * str, guint len, gboolean decode )
+/* returns the interned atom of the symbol. Symbols are never added to the
+   table of interned strings, so unknown symbols return 0. As the value
+   of a symbol may become known later on 0 is not cached. */
+GQuark
+mbus_symbol_get_quark( MObject * msymbol )
 {
-  M_OBJECT_ALLOC( MData, MDATA );
+  MSymbol * me = M_SYMBOL( msymbol );
+
+  M_OBJECT_ASSERT( msymbol, MSYMBOL );
+  if ( !me->quark )
+    me->quark = g_quark_try_string( me->str );
+
+  return me->quark;
+}
+
+/* checks if the symbol is equal to the interned string given by quark */
+gboolean
+mbus_symbol_is( MObject * msymbol, GQuark quark )
+{
+  return ( quark && mbus_symbol_get_quark( msymbol ) == quark );
+}
+
+/* looks up the interned atom of a string that is not zero terminated. The
+   string is not added to the table of interned strings, so 0 is returned
+   for unknown strings. */
+GQuark
+mbus_quark_try_string_len( const gchar * str, gsize len )
+{
+  gchar		buf[ 64 ];
+  gchar *	tmp;
+  GQuark	quark;
 
+  if ( len < sizeof( buf ) ) {
+    memcpy( buf, str, len );
+    buf[ len ] = '\0';
+
+    return g_quark_try_string( buf );
+  }
+
+  tmp = g_strndup( str, len );
+  quark = g_quark_try_string( tmp );
+  g_free( tmp );
+
+  return quark;
+}
+
+/* Data */
+static void
+__mbus_data_init( MData * me, const guint8 * str, guint len, gboolean decode )
+{
+  me->refs = NULL;
   if ( str ) {
     if ( decode ) {
       GByteArray * tmp = g_byte_array_sized_new( len );
@@ -239,120 +459,203 @@ mbus_data_new( const guint8 * str, guint len, gboolean decode )
     }
   } else
     me->array = g_byte_array_new();
+}
+
+MObject *
+mbus_data_new( const guint8 * str, guint len, gboolean decode )
+{
+  M_OBJECT_ALLOC( MData, MDATA );
+  __mbus_data_init( me, str, len, decode );
 
   return obj;
 }
 
+/* the byte array is always allocated on the heap, so it is shared even if
+   the object itself was allocated from an arena */
 MObject *
 mbus_data_copy( const MObject * mdata )
 {
-  return mbus_data_new( M_DATA( mdata )->array->data,
-			M_DATA( mdata )->array->len, FALSE );
+  M_OBJECT_ALLOC( MData, MDATA );
+  me->refs = __mbus_share( &M_DATA( mdata )->refs );
+  me->array = M_DATA( mdata )->array;
+
+  return obj;
 }
 
 void
 mbus_data_set( MObject * mdata, const guint8 * str, guint len )
 {
-  GByteArray * array;
+  MData * me = M_DATA( mdata );
 
   M_OBJECT_ASSERT( mdata, MDATA );
-  array = M_DATA( mdata )->array;
-  g_byte_array_remove_range( array, 0, array->len );
-  g_byte_array_append( array, str, len );
+  if ( __mbus_is_shared( me->refs ) ) {
+    __mbus_release( &me->refs );
+    me->array = g_byte_array_sized_new( len );
+  } else
+    g_byte_array_remove_range( me->array, 0, me->array->len );
+  g_byte_array_append( me->array, str, len );
 }
 
 void
 mbus_data_free( MObject * mdata )
 {
   M_OBJECT_ASSERT( mdata, MDATA );
-  g_byte_array_free( M_DATA( mdata )->array, TRUE );
+  if ( __mbus_release( &M_DATA( mdata )->refs ) )
+    g_byte_array_free( M_DATA( mdata )->array, TRUE );
   M_OBJECT_FREE( mdata );
 }
 
 void
 mbus_data_as_string( MObject * mdata, GString * buf )
 {
-  GByteArray * tmp = g_byte_array_new();
-
   M_OBJECT_ASSERT( mdata, MDATA );
-  base64encode( M_DATA( mdata )->array, tmp );
-  g_byte_array_prepend( tmp, ( guchar * ) "<", 1 );
-  g_byte_array_append( tmp, ( guchar * ) ">", 1 );
-  g_string_append_len( buf, ( gchar * ) tmp->data, tmp->len );
-
-  g_byte_array_free( tmp, TRUE );
+  __mbus_object_append( mdata, buf );
 }
 
 /* List */
+
+/* copies each element of the array into a new array */
+static GPtrArray *
+__mbus_list_copy_elements( const GPtrArray * elements )
+{
+  GPtrArray *	copy = g_ptr_array_sized_new( elements->len );
+  guint		i;
+
+  for ( i = 0; i < elements->len; i++ ) {
+    MObject * object = mbus_object_copy( g_ptr_array_index( elements, i ) );
+
+    if ( object ) g_ptr_array_add( copy, object );
+  }
+
+  return copy;
+}
+
 MObject *
 mbus_list_new( void )
 {
   M_OBJECT_ALLOC( MList, MLIST );
-  me->list = NULL;
+  me->elements = g_ptr_array_new();
 
   return obj;
 }
 
+/**
+\brief creates a new list with room for \a size elements. Appending up to
+    \a size elements does not reallocate the list.
+\param size the number of elements to reserve
+\return the new list object
+*/
 MObject *
-mbus_list_copy( const MObject * mlist )
+mbus_list_new_sized( guint size )
 {
-  MObject * copy = mbus_list_new();
-  GSList *	list;
-  MObject *	object;
+  M_OBJECT_ALLOC( MList, MLIST );
+  me->elements = g_ptr_array_sized_new( size );
+
+  return obj;
+}
+
+/**
+\brief makes sure that the list can hold at least \a size elements without
+    reallocating
+\param mlist the list object
+\param size the number of elements to reserve
+*/
+void
+mbus_list_reserve( MObject * mlist, guint size )
+{
+  GPtrArray * elements;
+  guint len;
 
   M_OBJECT_ASSERT( mlist, MLIST );
-  list = M_LIST( mlist )->list;
-
-  while ( list ) {
-    object = ( MObject * ) list->data;
-
-    if ( M_OBJECT_IS( object, MINTEGER ) ) {
-      mbus_list_append( copy, mbus_integer_copy( object ) );
-    } else if ( M_OBJECT_IS( object, MFLOAT ) ) {
-      mbus_list_append( copy, mbus_float_copy( object ) );
-    } else if ( M_OBJECT_IS( object, MSTRING ) ) {
-      mbus_list_append( copy, mbus_string_copy( object ) );
-    } else if ( M_OBJECT_IS( object, MSYMBOL ) ) {
-      mbus_list_append( copy, mbus_symbol_copy( object ) );
-    } else if ( M_OBJECT_IS( object, MDATA ) ) {
-      mbus_list_append( copy, mbus_data_copy( object ) );
-    } else if ( M_OBJECT_IS( object, MLIST ) ) {
-      mbus_list_append( copy, mbus_list_copy( object ) );
-    }
-    list = g_slist_next( list );
+  elements = M_LIST( mlist )->elements;
+  len = elements->len;
+
+  if ( size <= len ) return;
+  /* growing the array allocates the memory, shrinking it keeps it */
+  g_ptr_array_set_size( elements, size );
+  g_ptr_array_set_size( elements, len );
+}
+
+/**
+\brief frees an Mbus object of any type
+\param object the object to free
+*/
+void
+mbus_object_free( MObject * object )
+{
+  if ( M_OBJECT_IS( object, MINTEGER ) ) {
+    mbus_integer_free( object );
+  } else if ( M_OBJECT_IS( object, MFLOAT ) ) {
+    mbus_float_free( object );
+  } else if ( M_OBJECT_IS( object, MSTRING ) ) {
+    mbus_string_free( object );
+  } else if ( M_OBJECT_IS( object, MSYMBOL ) ) {
+    mbus_symbol_free( object );
+  } else if ( M_OBJECT_IS( object, MDATA ) ) {
+    mbus_data_free( object );
+  } else if ( M_OBJECT_IS( object, MLIST ) ) {
+    mbus_list_free( object );
   }
+}
 
-  return copy;
+/**
+\brief copies a list. Each element is copied, so the copy can be modified
+    independently of the original list. Long strings and data of the
+    elements are shared until one of the objects is modified.
+\param mlist the list to copy
+\return the copy of the list
+*/
+MObject *
+mbus_list_copy( const MObject * mlist )
+{
+  M_OBJECT_ALLOC( MList, MLIST );
+  M_OBJECT_ASSERT( mlist, MLIST );
+
+  me->elements = __mbus_list_copy_elements( M_LIST( mlist )->elements );
+
+  return obj;
+}
+
+/**
+\brief creates a copy of an Mbus object of any type. The copy is always
+    allocated on the heap, so this is the way to keep an object of a
+    received message that was allocated from its arena.
+\param object the object to copy
+\return the copy or NULL if the object has an unknown type
+*/
+MObject *
+mbus_object_copy( const MObject * object )
+{
+  if ( M_OBJECT_IS( object, MINTEGER ) ) {
+    return mbus_integer_copy( object );
+  } else if ( M_OBJECT_IS( object, MFLOAT ) ) {
+    return mbus_float_copy( object );
+  } else if ( M_OBJECT_IS( object, MSTRING ) ) {
+    return mbus_string_copy( object );
+  } else if ( M_OBJECT_IS( object, MSYMBOL ) ) {
+    return mbus_symbol_copy( object );
+  } else if ( M_OBJECT_IS( object, MDATA ) ) {
+    return mbus_data_copy( object );
+  } else if ( M_OBJECT_IS( object, MLIST ) ) {
+    return mbus_list_copy( object );
+  }
+
+  return NULL;
 }
 
 void
 mbus_list_free( MObject * mlist )
 {
-  GSList * list;
+  GPtrArray *	elements;
+  guint		i;
 
   M_OBJECT_ASSERT( mlist, MLIST );
-  list = M_LIST( mlist )->list;
-
-  while ( list ) {
-    MObject * object = list->data;
-
-    if ( M_OBJECT_IS( object, MINTEGER ) ) {
-      mbus_integer_free( object );
-    } else if ( M_OBJECT_IS( object, MFLOAT ) ) {
-      mbus_float_free( object );
-    } else if ( M_OBJECT_IS( object, MSTRING ) ) {
-      mbus_string_free( object );
-    } else if ( M_OBJECT_IS( object, MSYMBOL ) ) {
-      mbus_symbol_free( object );
-    } else if ( M_OBJECT_IS( object, MDATA ) ) {
-      mbus_data_free( object );
-    } else if ( M_OBJECT_IS( object, MLIST ) ) {
-      mbus_list_free( object );
-    }
-    list = g_slist_next( list );
-  }
+  elements = M_LIST( mlist )->elements;
 
-  g_slist_free( M_LIST( mlist )->list );
+  for ( i = 0; i < elements->len; i++ )
+    mbus_object_free( g_ptr_array_index( elements, i ) );
+
+  g_ptr_array_free( elements, TRUE );
   M_OBJECT_FREE( mlist );
 }
 
@@ -360,128 +663,459 @@ void
 mbus_list_append( MObject * mlist, MObject * element )
 {
   M_OBJECT_ASSERT( mlist, MLIST );
+  g_ptr_array_add( M_LIST( mlist )->elements, element );
+}
+
+/* Arena */
+static MObject *
+__mbus_arena_object_new( MArena * arena, MType type, gsize size )
+{
+  MObject * obj = mbus_arena_alloc( arena, size );
 
-  M_LIST( mlist )->list = g_slist_append( M_LIST( mlist )->list, element );
+  obj->type = type;
+  obj->ok = TRUE;
+  obj->in_arena = TRUE;
+  obj->heap_data = FALSE;
+
+  return obj;
 }
 
-static gint
-__first_non_whitespace( const gchar * buf )
+static MObject *
+__mbus_integer_new_in( MArena * arena, gint64 number )
 {
-  gint len = 0;
-  while ( (buf[ len ] == ' ' ) || ( buf[ len ] == '\t' ) ) len++;
+  MObject * obj;
+
+  if ( !arena ) return mbus_integer_new( number );
 
-  return len;
+  obj = __mbus_arena_object_new( arena, MINTEGER, sizeof( MInteger ) );
+  M_INTEGER( obj )->number = number;
+
+  return obj;
 }
 
-gint
-mbus_list_read( MObject * mlist, const guchar * buf )
+static MObject *
+__mbus_float_new_in( MArena * arena, gdouble number )
 {
-  MList *	list;
-  gint		len = 0;
+  MObject * obj;
 
-  M_OBJECT_ASSERT( mlist, MLIST );
-  list = M_LIST( mlist );
-  len += __first_non_whitespace( ( gchar * ) buf );
+  if ( !arena ) return mbus_float_new( number );
+
+  obj = __mbus_arena_object_new( arena, MFLOAT, sizeof( MFloat ) );
+  M_FLOAT( obj )->number = number;
+
+  return obj;
+}
+
+/* used for strings and symbols */
+static MObject *
+__mbus_string_new_in( MArena * arena, MType type,
+		      const gchar * str, gsize len )
+{
+  MObject *	obj;
+  MString *	me;
+
+  if ( !arena ) {
+    obj = type == MSTRING ? mbus_string_new( NULL ) : mbus_symbol_new( NULL );
+    __mbus_string_assign( obj, str, len );
+
+    return obj;
+  }
+
+  obj = __mbus_arena_object_new( arena, type, type == MSTRING ?
+				 sizeof( MString ) : sizeof( MSymbol ) );
+  me = M_STRING( obj );
+  me->refs = NULL;
+  if ( type == MSYMBOL ) M_SYMBOL( obj )->quark = 0;
+  /* long strings are copied into the arena as well, which is not marked
+     as heap_data, so the buffer is never freed on its own */
+  if ( len < M_STRING_INLINE_SIZE ) {
+    memcpy( me->inline_str, str, len );
+    me->inline_str[ len ] = '\0';
+    me->str = me->inline_str;
+  } else
+    me->str = mbus_arena_strndup( arena, str, len );
+  me->len = len;
+
+  return obj;
+}
+
+static MObject *
+__mbus_data_new_in( MArena * arena, const guint8 * str, guint len )
+{
+  MObject * obj;
+
+  if ( !arena ) return mbus_data_new( str, len, TRUE );
+
+  obj = __mbus_arena_object_new( arena, MDATA, sizeof( MData ) );
+  __mbus_data_init( M_DATA( obj ), str, len, TRUE );
+
+  return obj;
+}
+
+static MObject *
+__mbus_list_new_in( MArena * arena )
+{
+  MObject * obj;
+
+  if ( !arena ) return mbus_list_new();
+
+  obj = __mbus_arena_object_new( arena, MLIST, sizeof( MList ) );
+  M_LIST( obj )->elements = g_ptr_array_new();
+
+  return obj;
+}
+
+static gboolean
+__mbus_number_is_float( const gchar * pos, gsize len )
+{
+  gsize i;
+
+  for ( i = 0; i < len; i++ )
+    if ( pos[ i ] == '.' || pos[ i ] == 'e' || pos[ i ] == 'E' ) return TRUE;
+
+  return FALSE;
+}
+
+/* parses a number. Integers that do not fit into a gint64 are rejected. If
+   \a obj is NULL the number is only checked. */
+static gboolean
+__mbus_number_parse( MArena * arena, const gchar * pos, gsize len,
+		     MObject ** obj )
+{
+  MCursor	cursor;
+  gint64	integer;
+  gdouble	value;
+
+  if ( __mbus_number_is_float( pos, len ) ) {
+    if ( !mbus_double_parse( pos, len, &value ) ) return FALSE;
+    if ( obj ) *obj = __mbus_float_new_in( arena, value );
+    return TRUE;
+  }
+
+  mbus_cursor_init( &cursor, pos, len );
+  if ( !mbus_cursor_read_int64( &cursor, &integer ) ||
+       !mbus_cursor_at_end( &cursor ) )
+    return FALSE;
+  if ( obj ) *obj = __mbus_integer_new_in( arena, integer );
+
+  return TRUE;
+}
+
+/**
+\brief checks if the given characters may be used as a symbol
+\param str the characters
+\param len the number of characters
+\return TRUE if all characters are valid for symbols, otherwise FALSE
+*/
+gboolean
+mbus_symbol_is_valid_text( const gchar * str, gsize len )
+{
+  gsize i;
+
+  for ( i = 0; i < len; i++ )
+    if ( !mbus_symbol_is_valid_char( str[ i ] ) ) return FALSE;
+
+  return TRUE;
+}
+
+/* returns the closing quote of a string starting at pos or NULL if there
+   is none. escaped is set if the string contains escaped characters. */
+static const gchar *
+__mbus_string_end( const gchar * pos, const gchar * end, gboolean * escaped )
+{
+  *escaped = FALSE;
+
+  while ( pos < end ) {
+    const gchar * quote = memchr( pos, '"', end - pos );
+    const gchar * backslash;
+
+    if ( !quote ) return NULL;
+    backslash = memchr( pos, '\\', quote - pos );
+    if ( !backslash ) return quote;
+
+    /* the character behind the backslash may be a quote */
+    *escaped = TRUE;
+    pos = backslash + 2;
+  }
+
+  return NULL;
+}
+
+/* creates a string from text containing escaped characters */
+static MObject *
+__mbus_string_unescape_in( MArena * arena, const gchar * str, gsize len )
+{
+  gchar *	buf = g_malloc( len );
+  gsize		n = 0;
+  gsize		i;
+  MObject *	obj;
+
+  for ( i = 0; i < len; i++ ) {
+    if ( str[ i ] == '\\' && i + 1 < len ) {
+      i++;
+      buf[ n++ ] = str[ i ] == 'n' ? '\n' : str[ i ];
+    } else
+      buf[ n++ ] = str[ i ];
+  }
+
+  obj = __mbus_string_new_in( arena, MSTRING, buf, n );
+  g_free( buf );
+
+  return obj;
+}
+
+/* parses the list at the cursor. If mlist is NULL the list is only
+   validated and skipped without creating any objects. */
+static gboolean
+__mbus_list_walk( MObject * mlist, MCursor * cursor, MArena * arena )
+{
+  MObject *	stack[ M_LIST_MAX_DEPTH ];
+  gint		depth = 0;
+
+  mbus_cursor_skip_blanks( cursor );
   /* beginning of list */
+  if ( mbus_cursor_peek( cursor ) != '(' ) {
+    if ( mlist ) mlist->ok = FALSE;
+    return FALSE;
+  }
+  cursor->pos++;
+  stack[ depth++ ] = mlist;
 
-  if ( buf[ len++ ] == '(' ) {
-    const guchar *	start = &( buf[ len - 1 ] );
-    guchar *		pos = ( guchar * ) ( start + 1 );
-    guchar *		end = NULL;
+  while ( depth ) {
     MObject *		obj = NULL;
-
-    while ( *pos != '\0' && *pos != ')' ) {
-      pos += __first_non_whitespace( ( gchar * ) pos );
-      if ( *pos == '\0' || *pos == ')' ) break;
-      if ( *pos == '"' ) {
-	/* string */
-	end = mbus_util_find_char( ++pos, '"' );
-	if ( end ) {
-	  *end = '\0';
-	  obj = mbus_string_new( ( gchar * ) pos );
-	} else
-	  goto failed;
-      } else if ( *pos == '<' ) {
-	/* data */
-	end = mbus_util_find_char( ++pos, '>' );
-	if ( end ) {
-	  *end = '\0';
-	  obj = mbus_data_new( pos, ( gint ) ( end - pos ), TRUE );
-	} else
-	  goto failed;
-      } else if ( *pos == '(' ) {
-	/* list */
-	gint len;
-
-	obj = mbus_list_new();
-	len = mbus_list_read( obj, pos );
-        end = pos + len - 1;
-      } else if ( g_ascii_isdigit( *pos ) || *pos == '-' ) {
+    const gchar *	end;
+    gboolean		escaped;
+
+    mbus_cursor_skip_blanks( cursor );
+    /* an unterminated list at the end of the buffer is accepted */
+    if ( mbus_cursor_at_end( cursor ) ) break;
+
+    switch ( *cursor->pos ) {
+    case ')':
+      /* end of list */
+      if ( mlist ) stack[ depth - 1 ]->ok = TRUE;
+      depth--;
+      cursor->pos++;
+      continue;
+    case '(':
+      /* list */
+      if ( depth == M_LIST_MAX_DEPTH ) goto failed;
+      if ( mlist ) {
+	obj = __mbus_list_new_in( arena );
+	mbus_list_append( stack[ depth - 1 ], obj );
+      }
+      stack[ depth++ ] = obj;
+      cursor->pos++;
+      continue;
+    case '"':
+      /* string */
+      end = __mbus_string_end( cursor->pos + 1, cursor->end, &escaped );
+      if ( !end ) goto failed;
+      if ( mlist && escaped )
+	obj = __mbus_string_unescape_in( arena, cursor->pos + 1,
+					 end - cursor->pos - 1 );
+      else if ( mlist )
+	obj = __mbus_string_new_in( arena, MSTRING, cursor->pos + 1,
+				    end - cursor->pos - 1 );
+      end++;
+      break;
+    case '<':
+      /* data */
+      end = memchr( cursor->pos + 1, '>', cursor->end - cursor->pos - 1 );
+      if ( !end ) goto failed;
+      if ( mlist )
+	obj = __mbus_data_new_in( arena, ( const guint8 * ) cursor->pos + 1,
+				  ( guint ) ( end - cursor->pos - 1 ) );
+      end++;
+      break;
+    default:
+      end = mbus_scan_token_end( cursor->pos, cursor->end );
+      if ( g_ascii_isdigit( *cursor->pos ) || *cursor->pos == '-' ) {
 	/* number */
-	end = pos + 1;
-	while ( *end != ' ' && *end != '\n' && *end != '\0' ) ++end;
-	*end = '\0';
-        if ( mbus_util_find_char( pos + 1, '.' ) ) {
-          gdouble d = g_ascii_strtod( ( gchar * ) pos, NULL );
-          obj = mbus_float_new( d );
-        } else {
-          gint64 i = ( gint64 ) g_ascii_strtoull( ( gchar * ) pos,
-						  ( char ** ) NULL, 10 );
-          obj = mbus_integer_new( i );
-        }
-      } else if ( g_ascii_isalpha( *pos ) && g_ascii_isupper( *pos ) ) {
-	end = mbus_util_find_char( pos, ' ' );
-	if ( end ) {
-	  *end = '\0';
-	  obj = mbus_symbol_new( ( gchar * ) pos );
-          if ( !obj ) goto failed;
-	} else
+	if ( !__mbus_number_parse( arena, cursor->pos, end - cursor->pos,
+				   mlist ? &obj : NULL ) )
 	  goto failed;
-      }
-
-      pos = ++end;
-
-      list->list = g_slist_append( list->list, obj );
+      } else if ( g_ascii_isupper( *cursor->pos ) ) {
+	/* symbol */
+	if ( !mbus_symbol_is_valid_text( cursor->pos, end - cursor->pos ) )
+	  goto failed;
+	if ( mlist )
+	  obj = __mbus_string_new_in( arena, MSYMBOL, cursor->pos,
+				      end - cursor->pos );
+      } else
+	goto failed;
     }
-    mlist->ok = TRUE;
-    return ( pos - start + 1 );
+
+    if ( mlist ) mbus_list_append( stack[ depth - 1 ], obj );
+    cursor->pos = end;
   }
 
+  if ( mlist )
+    while ( depth ) stack[ --depth ]->ok = TRUE;
+
+  return TRUE;
+
  failed:
-  mlist->ok = FALSE;
-  return -1;
+  if ( mlist )
+    while ( depth ) stack[ --depth ]->ok = FALSE;
+
+  return FALSE;
+}
+
+/**
+\brief parses a list of Mbus objects at the current position of the
+    cursor. Nested lists are parsed in the same pass using an explicit
+    stack of open lists.
+\param mlist the list object that the parsed elements are appended to
+\param cursor the cursor pointing to the list (leading blanks are
+    skipped). On success it is moved behind the closing bracket, otherwise
+    it points to the character that could not be parsed.
+\param arena if not NULL the elements are allocated from this arena
+\return TRUE if the list could be parsed, otherwise FALSE
+*/
+gboolean
+mbus_list_parse( MObject * mlist, MCursor * cursor, MArena * arena )
+{
+  M_OBJECT_ASSERT( mlist, MLIST );
+
+  return __mbus_list_walk( mlist, cursor, arena );
+}
+
+/**
+\brief moves the cursor behind the list at its current position without
+    creating any objects. The cursor ends up at exactly the same position
+    as it would after calling mbus_list_parse.
+\param cursor the cursor pointing to the list
+\return TRUE if the list is valid, otherwise FALSE
+*/
+gboolean
+mbus_list_skip( MCursor * cursor )
+{
+  return __mbus_list_walk( NULL, cursor, NULL );
+}
+
+/**
+\brief parses a list of Mbus objects
+\param mlist the list object that the parsed elements are appended to
+\param buf the string containing the list
+\return the number of characters parsed or -1 on failure
+*/
+gint
+mbus_list_read( MObject * mlist, const guchar * buf )
+{
+  MCursor cursor;
+
+  mbus_cursor_init( &cursor, ( const gchar * ) buf,
+		    strlen( ( const gchar * ) buf ) );
+  if ( !mbus_list_parse( mlist, &cursor, NULL ) ) return -1;
+
+  return ( gint ) ( cursor.pos - ( const gchar * ) buf );
 }
 
 void
 mbus_list_as_string( MObject * mlist, GString * buf )
 {
-  GSList *	list;
-  MObject *	object;
-
   M_OBJECT_ASSERT( mlist, MLIST );
-  list = M_LIST( mlist )->list;
-
-  g_string_append_c( buf, '(' );
-  while ( list ) {
-    object = ( MObject * ) list->data;
-
-    if ( M_OBJECT_IS( object, MINTEGER ) ) {
-      mbus_integer_as_string( object, buf );
-    } else if ( M_OBJECT_IS( object, MFLOAT ) ) {
-      mbus_float_as_string( object, buf );
-    } else if ( M_OBJECT_IS( object, MSTRING ) ) {
-      mbus_string_as_string( object, buf );
-    } else if ( M_OBJECT_IS( object, MSYMBOL ) ) {
-      mbus_symbol_as_string( object, buf );
-    } else if ( M_OBJECT_IS( object, MDATA ) ) {
-      mbus_data_as_string( object, buf );
-    } else if ( M_OBJECT_IS( object, MLIST ) ) {
-      mbus_list_as_string( object, buf );
+  __mbus_object_append( mlist, buf );
+}
+
+/* floats are formatted twice, once to get the length of the text and once
+   to write it */
+static gsize
+__mbus_float_text_len( gdouble number )
+{
+  gchar tmp[ MBUS_DOUBLE_TEXT_SIZE ];
+
+  return mbus_double_format( number, tmp );
+}
+
+static void
+__mbus_float_write( gdouble number, MWriter * writer )
+{
+  gchar tmp[ MBUS_DOUBLE_TEXT_SIZE ];
+
+  mbus_writer_put( writer, tmp, mbus_double_format( number, tmp ) );
+}
+
+/**
+\brief computes the length of the text representation of an Mbus object
+\param obj the object
+\return the number of characters mbus_object_write will write
+*/
+gsize
+mbus_object_text_len( const MObject * obj )
+{
+  GPtrArray *	elements;
+  gsize		len;
+  guint		i;
+
+  switch ( obj->type ) {
+  case MINTEGER:
+    return mbus_writer_int64_len( M_INTEGER( obj )->number );
+  case MFLOAT:
+    return __mbus_float_text_len( M_FLOAT( obj )->number );
+  case MSTRING:
+    return mbus_string_quoted_len( M_STRING( obj )->str,
+				   M_STRING( obj )->len );
+  case MSYMBOL:
+    return M_SYMBOL( obj )->len;
+  case MDATA:
+    return base64encode_len( M_DATA( obj )->array->len ) + 2;
+  case MLIST:
+    elements = M_LIST( obj )->elements;
+    len = 2 + elements->len;
+    for ( i = 0; i < elements->len; i++ )
+      len += mbus_object_text_len( g_ptr_array_index( elements, i ) );
+
+    return len;
+  }
+
+  return 0;
+}
+
+/**
+\brief writes the text representation of an Mbus object
+\param obj the object
+\param writer the writer with room for at least mbus_object_text_len
+    characters
+*/
+void
+mbus_object_write( const MObject * obj, MWriter * writer )
+{
+  GPtrArray *	elements;
+  guint		i;
+
+  switch ( obj->type ) {
+  case MINTEGER:
+    mbus_writer_put_int64( writer, M_INTEGER( obj )->number );
+    break;
+  case MFLOAT:
+    __mbus_float_write( M_FLOAT( obj )->number, writer );
+    break;
+  case MSTRING:
+    mbus_string_write_quoted( writer, M_STRING( obj )->str,
+			      M_STRING( obj )->len );
+    break;
+  case MSYMBOL:
+    mbus_writer_put( writer, M_SYMBOL( obj )->str, M_SYMBOL( obj )->len );
+    break;
+  case MDATA:
+    mbus_writer_put_c( writer, '<' );
+    writer->pos += base64encode_raw( M_DATA( obj )->array->data,
+				     M_DATA( obj )->array->len,
+				     ( guchar * ) writer->pos );
+    mbus_writer_put_c( writer, '>' );
+    break;
+  case MLIST:
+    elements = M_LIST( obj )->elements;
+    mbus_writer_put_c( writer, '(' );
+    for ( i = 0; i < elements->len; i++ ) {
+      mbus_object_write( g_ptr_array_index( elements, i ), writer );
+      mbus_writer_put_c( writer, ' ' );
     }
-    list = g_slist_next( list );
-    g_string_append_c( buf, ' ' );
+    mbus_writer_put_c( writer, ')' );
+    break;
   }
-  g_string_append( buf, ")" );
 }
 
 guint
@@ -489,45 +1123,35 @@ mbus_list_length( MObject * mlist )
 {
   M_OBJECT_ASSERT( mlist, MLIST );
 
-  return g_slist_length( M_LIST( mlist )->list );
+  return M_LIST( mlist )->elements->len;
 }
 
 MObject *
 mbus_list_index( MObject * mlist, guint idx )
 {
+  GPtrArray * elements;
+
   M_OBJECT_ASSERT( mlist, MLIST );
+  elements = M_LIST( mlist )->elements;
+
+  if ( idx >= elements->len ) return NULL;
 
-  return g_slist_nth_data( M_LIST( mlist )->list, idx );
+  return g_ptr_array_index( elements, idx );
 }
 
 gboolean
 mbus_list_remove( MObject * mlist, guint idx, gboolean remove_data )
 {
-  GSList * list;
+  GPtrArray *	elements;
+  MObject *	object;
 
   M_OBJECT_ASSERT( mlist, MLIST );
+  elements = M_LIST( mlist )->elements;
 
-  list = g_slist_nth( M_LIST( mlist )->list, idx );
-  if ( !list ) return FALSE;
-
-  list = g_slist_remove( M_LIST( mlist )->list, list );
-  if ( remove_data ) {
-    MObject * object = ( MObject * ) list->data;
-
-    if ( M_OBJECT_IS( object, MINTEGER ) ) {
-      mbus_integer_free( object );
-    } else if ( M_OBJECT_IS( object, MFLOAT ) ) {
-      mbus_float_free( object );
-    } else if ( M_OBJECT_IS( object, MSTRING ) ) {
-      mbus_string_free( object );
-    } else if ( M_OBJECT_IS( object, MSYMBOL ) ) {
-      mbus_symbol_free( object );
-    } else if ( M_OBJECT_IS( object, MDATA ) ) {
-      mbus_data_free( object );
-    } else if ( M_OBJECT_IS( object, MLIST ) ) {
-      mbus_list_free( object );
-    }
-  }
+  if ( idx >= elements->len ) return FALSE;
+
+  object = g_ptr_array_remove_index( elements, idx );
+  if ( remove_data ) mbus_object_free( object );
 
   return TRUE;
 }
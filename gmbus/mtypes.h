@@ -26,6 +26,10 @@
 
 #include <glib.h>
 
+#include "gmbus/marena.h"
+#include "gmbus/mcursor.h"
+#include "gmbus/mwriter.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -43,14 +47,31 @@ typedef enum { MINTEGER, MFLOAT, MSTRING, MSYMBOL, MDATA, MLIST } MType;
 
 /**
 \struct MObject
-\brief MObject is the base class for all Mbus types.
+\brief MObject is the base class for all Mbus types. It is the first member
+  of each type structure, so every object is a single allocation.
+
+  Copies of long strings and data share the characters or bytes of the
+  original object. The shared part is reference counted and copied when
+  one of the objects is modified. Copying a list copies its elements, so
+  the copy is independent of the original list.
 */
 typedef struct {
   MType		type;
-  gpointer	data;
-  gboolean	ok;
+  guint		ok : 1;
+  /** TRUE if the object was allocated from an MArena. Such objects are
+      released together with the arena and must be copied with
+      mbus_object_copy if they are needed any longer. */
+  guint		in_arena : 1;
+  /** TRUE if the characters of a string or symbol are stored in a heap
+      buffer owned by the object */
+  guint		heap_data : 1;
 } MObject;
 
+MObject * mbus_object_copy( const MObject * obj );
+void mbus_object_free( MObject * obj );
+gsize mbus_object_text_len( const MObject * obj );
+void mbus_object_write( const MObject * obj, MWriter * writer );
+
 /**
 \struct MInteger
 \brief MInteger represents a whole-numbered value
@@ -82,13 +103,28 @@ void mbus_float_free( MObject * mfloat );
 void mbus_float_set( MObject * mfloat, gdouble number );
 void mbus_float_free( MObject * mfloat );
 
+/**
+\brief the number of characters (including the terminating zero) of a
+  string or symbol that are stored inside the object itself
+*/
+#define M_STRING_INLINE_SIZE 24
+
 /**
 \struct MString
-\brief MString represents a character string
+\brief MString represents a character string. Short strings are stored
+  inside the object, longer ones in a separate buffer.
 */
 typedef struct {
   MObject	_object;
-  GString *	str;
+  /** the zero terminated characters */
+  gchar *	str;
+  /** the number of characters */
+  gsize		len;
+  /** the number of objects sharing the heap buffer or NULL if it has not
+      been shared yet */
+  gint *	refs;
+  /** storage for short strings */
+  gchar		inline_str[ M_STRING_INLINE_SIZE ];
 } MString;
 
 MObject * mbus_string_new( const gchar * str );
@@ -97,6 +133,9 @@ void mbus_string_free( MObject * mstring );
 void mbus_string_set( MObject * mstring, const gchar * str );
 void mbus_string_free( MObject * mstring );
 void mbus_string_as_string( MObject * mstring, GString * buf );
+gsize mbus_string_quoted_len( const gchar * str, gsize len );
+void mbus_string_write_quoted( MWriter * writer, const gchar * str,
+			       gsize len );
 
 /**
 \struct MSymbol
@@ -105,7 +144,18 @@ void mbus_string_as_string( MObject * mstring, GString * buf );
 */
 typedef struct {
   MObject	_object;
-  GString *	str;
+  /** the zero terminated characters */
+  gchar *	str;
+  /** the number of characters */
+  gsize		len;
+  /** the number of objects sharing the heap buffer or NULL if it has not
+      been shared yet */
+  gint *	refs;
+  /** storage for short symbols */
+  gchar		inline_str[ M_STRING_INLINE_SIZE ];
+  /** the interned atom of the symbol or 0 if it is not known yet. Use
+      mbus_symbol_get_quark to access it */
+  GQuark	quark;
 } MSymbol;
 
 MObject * mbus_symbol_new( const gchar * str );
@@ -113,9 +163,14 @@ MObject * mbus_symbol_copy( const MObject * msymbol );
 void mbus_symbol_free( MObject * msymbol );
 gboolean mbus_symbol_is_valid_char( gchar c );
 gboolean mbus_symbol_is_valid( const MObject * msymbol );
+gboolean mbus_symbol_is_valid_text( const gchar * str, gsize len );
 void mbus_symbol_set( MObject * msymbol, const gchar * str );
 void mbus_symbol_free( MObject * msymbol );
 void mbus_symbol_as_string( MObject * msymbol, GString * buf );
+GQuark mbus_symbol_get_quark( MObject * msymbol );
+gboolean mbus_symbol_is( MObject * msymbol, GQuark quark );
+
+GQuark mbus_quark_try_string_len( const gchar * str, gsize len );
 
 /**
 \struct MData
@@ -125,6 +180,9 @@ void mbus_symbol_as_string( MObject * msymbol, GString * buf );
 typedef struct {
   MObject	_object;
   GByteArray *	array;
+  /** the number of objects sharing the array or NULL if it has not been
+      shared yet */
+  gint *	refs;
 } MData;
 
 MObject * mbus_data_new( const guint8 * str, guint len, gboolean decode );
@@ -133,19 +191,29 @@ void mbus_data_free( MObject * mdata );
 void mbus_data_set( MObject * mdata, const guint8 * str, guint len );
 void mbus_data_free( MObject * mdata );
 
+/**
+\brief maximum nesting depth of lists accepted by the parser
+*/
+#define M_LIST_MAX_DEPTH 64
+
 /**
 \struct MList
 \brief MList represents a list of MObject instances.
 */
 typedef struct {
   MObject	_object;
-  GSList *	list;
+  /** the elements of the list (MObject) */
+  GPtrArray *	elements;
 } MList;
 
 MObject * mbus_list_new( void );
+MObject * mbus_list_new_sized( guint size );
+void mbus_list_reserve( MObject * mlist, guint size );
 MObject * mbus_list_copy( const MObject * mlist );
 void mbus_list_free( MObject * mlist );
 void mbus_list_append( MObject * mlist, MObject * element );
+gboolean mbus_list_parse( MObject * mlist, MCursor * cursor, MArena * arena );
+gboolean mbus_list_skip( MCursor * cursor );
 gint mbus_list_read( MObject * mlist, const guchar * buf );
 void mbus_list_as_string( MObject * mlist, GString * buf );
 guint mbus_list_length( MObject * mlist );
@@ -157,20 +225,21 @@ gboolean mbus_list_remove( MObject * mlist, guint idx, gboolean remove_data );
 #define M_OBJECT_ASSERT(Object,Type) g_assert( Object->type == Type )
 #define M_OBJECT_OK(Object) ( Object->ok == TRUE )
 #define M_OBJECT_ALLOC(Object,Type)		\
-  MObject * obj = g_new( MObject, 1 );	\
   Object *  me = g_new( Object, 1 );	\
+  MObject * obj = ( MObject * ) me;	\
   obj->type = Type;			\
-  obj->data = me;                       \
-  obj->ok = TRUE;
-#define M_OBJECT_FREE(Object)	\
-  g_free( Object->data );		\
-  g_free( Object );
-#define M_INTEGER(Object) ( ( MInteger * ) Object->data )
-#define M_FLOAT(Object) ( ( MFloat * ) Object->data )
-#define M_STRING(Object) ( ( MString * ) Object->data )
-#define M_SYMBOL(Object) ( ( MSymbol * ) Object->data )
-#define M_DATA(Object) ( ( MData * ) Object->data )
-#define M_LIST(Object) ( ( MList * ) Object->data )
+  obj->ok = TRUE;			\
+  obj->in_arena = FALSE;		\
+  obj->heap_data = FALSE;
+#define M_OBJECT_FREE(Object)		\
+  if ( !Object->in_arena ) g_free( Object );
+#define M_OBJECT_IN_ARENA(Object) ( Object->in_arena )
+#define M_INTEGER(Object) ( ( MInteger * ) ( Object ) )
+#define M_FLOAT(Object) ( ( MFloat * ) ( Object ) )
+#define M_STRING(Object) ( ( MString * ) ( Object ) )
+#define M_SYMBOL(Object) ( ( MSymbol * ) ( Object ) )
+#define M_DATA(Object) ( ( MData * ) ( Object ) )
+#define M_LIST(Object) ( ( MList * ) ( Object ) )
 
 /**
 \}
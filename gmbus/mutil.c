@@ -21,12 +21,13 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 
+#include "gmbus/mcursor.h"
 #include "gmbus/mutil.h"
 
 #include <ctype.h>
 #include <stdarg.h>
 #include <stdlib.h>
-#include <errno.h>
+#include <string.h>
 
 /**
 \brief cuts all trailing whitespaces from the buffer
@@ -36,8 +37,9 @@ void
 mbus_util_cut_whitespaces( GString * buf )
 {
 	gchar * pos = buf->str;
+	gchar * end = buf->str + buf->len;
 
-	while( g_ascii_isspace( *pos ) || *pos == '\0' ) pos++;
+	while( pos < end && ( g_ascii_isspace( *pos ) || *pos == '\0' ) ) pos++;
 
 	g_string_erase( buf, 0, pos - buf->str );
 }
@@ -60,17 +62,21 @@ mbus_util_find_char( const guchar * start, guchar c )
 
 /**
 \brief converts the string \a buf to a long integer and stores it in \a v.
+    Leading whitespaces are skipped.
 \param buf string to convert
 \param[out] v pointer to a long, used to store the result
-\return TRUE if the conversion was successful, FALSE otherwise
+\return TRUE if the conversion was successful, FALSE if \a buf does not
+    start with a digit or the number does not fit into 64 bits
 */
 gboolean
 mbus_util_str_to_uint64( const gchar * buf, guint64 * v)
 {
-	errno = 0;
-	*v = ( guint64 ) strtoull( buf, NULL, 10 );
+	MCursor cursor;
 
-	return ( errno != EINVAL ) && ( errno != ERANGE );
+	mbus_cursor_init( &cursor, buf, strlen( buf ) );
+	mbus_cursor_skip_whitespaces( &cursor );
+
+	return mbus_cursor_read_uint64( &cursor, v );
 }
 
 /**
@@ -104,30 +110,17 @@ otherwise as a unsigned one
 void
 mbus_util_int64_to_str( GString * buf, guint64 number, gboolean sign )
 {
-	gchar		buffer[ 128 ];
-	gchar *		bufferend;
-	gchar *		pointer;
-	gboolean	negative = FALSE;
-	gint		i;
-
-	static const gchar *	digits = "0123456789ABCDEFX";
-
-	if ( sign && ( gint64 ) number < 0 ) negative = TRUE;
-	if ( negative ) number = - ( ( gint64 ) number );
-
-	/* Build number */
-	pointer = bufferend = &buffer[ sizeof( buffer ) - 1 ];
-	*pointer-- = '\0';
-
-	for ( i = 1; i < ( gint ) sizeof( buffer ); i++ ) {
-		*pointer-- = digits[ number % 10 ];
-		number /= 10;
-		if ( number == 0 ) break;
+	MWriter writer;
+
+	if ( sign ) {
+		mbus_writer_init_append( &writer, buf,
+				mbus_writer_int64_len( ( gint64 ) number ) );
+		mbus_writer_put_int64( &writer, ( gint64 ) number );
+	} else {
+		mbus_writer_init_append( &writer, buf,
+				mbus_writer_uint64_len( number ) );
+		mbus_writer_put_uint64( &writer, number );
 	}
-
-	if ( negative )
-		g_string_append_c( buf, '-' );
-	g_string_append( buf, ++pointer );
 }
 
 /**
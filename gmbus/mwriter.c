@@ -0,0 +1,163 @@
+/* mwriter.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "gmbus/mwriter.h"
+
+#include <string.h>
+
+/**
+\addtogroup mwriter MWriter
+\{
+*/
+
+/**
+\brief initializes a writer pointing to the beginning of the given buffer
+\param[out] self the writer
+\param buf the buffer to write to
+\param len the length of the buffer
+*/
+void
+mbus_writer_init( MWriter * self, gchar * buf, gsize len )
+{
+	self->pos = buf;
+	self->end = buf + len;
+}
+
+/**
+\brief grows the string buffer by \a len characters and initializes a
+    writer pointing to the new characters
+\param[out] self the writer
+\param buf the string buffer to append to
+\param len the number of characters that will be written
+*/
+void
+mbus_writer_init_append( MWriter * self, GString * buf, gsize len )
+{
+	gsize old = buf->len;
+
+	g_string_set_size( buf, old + len );
+	mbus_writer_init( self, buf->str + old, len );
+}
+
+/**
+\brief writes the given characters
+\param self the writer
+\param str the characters to write
+\param len the number of characters
+*/
+void
+mbus_writer_put( MWriter * self, const gchar * str, gsize len )
+{
+	memcpy( self->pos, str, len );
+	self->pos += len;
+}
+
+/* the decimal representations of 0 to 99 */
+static const gchar __mbus_digit_pairs[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+/**
+\brief returns the number of decimal digits of an unsigned number
+\param number the number
+\return the number of characters mbus_writer_put_uint64 will write
+*/
+gsize
+mbus_writer_uint64_len( guint64 number )
+{
+	gsize len = 1;
+
+	for ( ;; ) {
+		if ( number < 10 ) return len;
+		if ( number < 100 ) return len + 1;
+		if ( number < 1000 ) return len + 2;
+		if ( number < 10000 ) return len + 3;
+		number /= 10000;
+		len += 4;
+	}
+}
+
+/**
+\brief writes the decimal representation of an unsigned number. Two digits
+    are created per division.
+\param self the writer
+\param number the number to write
+*/
+void
+mbus_writer_put_uint64( MWriter * self, guint64 number )
+{
+	gchar * pos;
+
+	self->pos += mbus_writer_uint64_len( number );
+	pos = self->pos;
+	while ( number >= 100 ) {
+		guint pair = ( guint ) ( number % 100 ) * 2;
+
+		number /= 100;
+		*--pos = __mbus_digit_pairs[ pair + 1 ];
+		*--pos = __mbus_digit_pairs[ pair ];
+	}
+	if ( number >= 10 ) {
+		*--pos = __mbus_digit_pairs[ number * 2 + 1 ];
+		*--pos = __mbus_digit_pairs[ number * 2 ];
+	} else
+		*--pos = '0' + ( gchar ) number;
+}
+
+/**
+\brief returns the length of the decimal representation of a signed number
+\param number the number
+\return the number of characters mbus_writer_put_int64 will write
+*/
+gsize
+mbus_writer_int64_len( gint64 number )
+{
+	if ( number < 0 )
+		return 1 + mbus_writer_uint64_len( - ( guint64 ) number );
+
+	return mbus_writer_uint64_len( ( guint64 ) number );
+}
+
+/**
+\brief writes the decimal representation of a signed number
+\param self the writer
+\param number the number to write
+*/
+void
+mbus_writer_put_int64( MWriter * self, gint64 number )
+{
+	if ( number < 0 ) {
+		mbus_writer_put_c( self, '-' );
+		mbus_writer_put_uint64( self, - ( guint64 ) number );
+	} else
+		mbus_writer_put_uint64( self, ( guint64 ) number );
+}
+
+/**
+\}
+*/
+
+/* end of mwriter.c */
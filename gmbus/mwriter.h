@@ -0,0 +1,80 @@
+/* mwriter.h
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef MBUS_WRITER_H
+#define MBUS_WRITER_H
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+\addtogroup mwriter MWriter
+\{
+*/
+
+/**
+\brief A write position within a preallocated text buffer. The text
+    representation of an object is created in two passes: the first one
+    computes its exact length (the _text_len functions), the second one
+    writes it into a buffer of that size using a writer (the _write
+    functions). The writer does not check for the end of the buffer.
+*/
+typedef struct {
+	/** the current write position */
+	gchar *	pos;
+	/** the end of the buffer (points behind the last character) */
+	gchar *	end;
+} MWriter;
+
+void mbus_writer_init( MWriter * self, gchar * buf, gsize len );
+void mbus_writer_init_append( MWriter * self, GString * buf, gsize len );
+void mbus_writer_put( MWriter * self, const gchar * str, gsize len );
+gsize mbus_writer_uint64_len( guint64 number );
+void mbus_writer_put_uint64( MWriter * self, guint64 number );
+gsize mbus_writer_int64_len( gint64 number );
+void mbus_writer_put_int64( MWriter * self, gint64 number );
+
+/**
+\def mbus_writer_put_c
+\brief writes a single character
+*/
+#define mbus_writer_put_c( self, c ) ( *( self )->pos++ = ( c ) )
+
+/**
+\def mbus_writer_at_end
+\brief checks if the writer has filled the whole buffer
+*/
+#define mbus_writer_at_end( self ) ( ( self )->pos == ( self )->end )
+
+/**
+\}
+*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBUS_WRITER_H */
@@ -32,16 +32,19 @@ __rpc_entity_incoming_message( MMessage * msg, RPCEntity * entity )
 
 	if ( mbus_payload_size( msg->payload ) ) {
 		MCommand *	cmd;
-		gchar *		ret;
 
 		cmd = mbus_payload_index( msg->payload, 0 );
-		ret = cmd->cmd->str + ( cmd->cmd->len - 7 );
 
 		/* is a RPC command */
-		if ( strcmp( ret, ret_suffix ) ) {
-			RPCCommandCallback * callback;
-
-			callback = g_hash_table_lookup( entity->commands, cmd->cmd->str );
+		if ( !g_str_has_suffix( cmd->cmd, ret_suffix ) ) {
+			RPCCommandCallback *	callback = NULL;
+			GQuark					quark;
+
+			/* commands are registered by their interned names */
+			quark = mbus_command_get_quark( cmd );
+			if ( quark )
+				callback = g_hash_table_lookup( entity->commands,
+						GUINT_TO_POINTER( quark ) );
 			if ( callback ) {
 				RPCCommand *	rpccmd = rpc_command_new_from_command( cmd );
 				RPCReturn *		ret;
@@ -65,11 +68,11 @@ __rpc_entity_incoming_message( MMessage * msg, RPCEntity * entity )
 			gpointer			key;
 
 			g_hash_table_lookup_extended( entity->returns,
-					M_STRING( ret->id )->str->str, ( gpointer * ) &key,
+					M_STRING( ret->id )->str, ( gpointer * ) &key,
 					( gpointer * ) &callback );
 			if ( callback ) {
 				g_hash_table_remove( entity->returns,
-						M_STRING( ret->id )->str->str );
+						M_STRING( ret->id )->str );
 				g_free( key );
 				mbus_callback_invoke( ( *callback ), ret );
 				g_free( callback );
@@ -93,7 +96,7 @@ rpc_entity_new( const gchar * address, MConfig * config )
 	RPCEntity * self = g_new( RPCEntity, 1 );
 
 	self->client = mbus_client_new( address, config );
-	self->commands = g_hash_table_new( g_str_hash, g_str_equal );
+	self->commands = g_hash_table_new( g_direct_hash, g_direct_equal );
 	self->returns = g_hash_table_new( g_str_hash, g_str_equal );
 
 	mbus_callback_init( self->unknown_message );
@@ -129,7 +132,8 @@ rpc_entity_register( RPCEntity * self, const gchar * command,
 	RPCCommandCallback * callback = g_new( RPCCommandCallback, 1 );
 
 	mbus_callback_set( ( *callback ), func, data );
-	g_hash_table_insert( self->commands, g_strdup( command ), callback );
+	g_hash_table_insert( self->commands,
+			GUINT_TO_POINTER( g_quark_from_string( command ) ), callback );
 }
 
 /* void
@@ -206,20 +210,20 @@ rpc_entity_send_return( RPCEntity * self, RPCReturn * ret,
 		const MAddress * dest )
 {
 	MMessage *	msg = mbus_message_new();
-	MObject *	rpc_args = mbus_list_new();
-	MObject *	app_args = mbus_list_new();
-	MObject *	rpc_id = mbus_list_new();
-	MObject *	rpc_status = mbus_list_new();
-	MObject *	app_status = mbus_list_new();
+	MObject *	rpc_args = mbus_list_new_sized( 2 );
+	MObject *	app_args = mbus_list_new_sized( 2 );
+	MObject *	rpc_id = mbus_list_new_sized( 2 );
+	MObject *	rpc_status = mbus_list_new_sized( 2 );
+	MObject *	app_status = mbus_list_new_sized( 3 );
 	gchar *		tmp = g_strdup_printf( "%s.return", ret->command );
 	MCommand *	cmd = mbus_command_new( tmp );
 
 	g_free( tmp );
 	/* set destination address */
-	mbus_address_assign( msg->header->destination, dest );
+	mbus_header_set_destination( msg->header, dest );
 	mbus_list_append( rpc_id, mbus_string_new( "ID" ) );
 	mbus_list_append( rpc_id,
-			mbus_string_new( M_STRING( ret->id )->str->str ) );
+			mbus_string_new( M_STRING( ret->id )->str ) );
 
 	mbus_list_append( rpc_status, mbus_string_new( "RPC-STATUS" ) );
 
@@ -285,9 +289,9 @@ rpc_entity_send_command( RPCEntity * self, RPCCommand * cmd,
 		const MAddress * addr, RPCReturnFunc func, gpointer data )
 {
 	MMessage *			msg = mbus_message_new();
-	MObject *			rpc_args = mbus_list_new();
-	MObject *			rpc_id = mbus_list_new();
-	MObject *			rpc_type= mbus_list_new();
+	MObject *			rpc_args = mbus_list_new_sized( 2 );
+	MObject *			rpc_id = mbus_list_new_sized( 2 );
+	MObject *			rpc_type= mbus_list_new_sized( 2 );
 	MCommand *			command = mbus_command_new_with_name( cmd->command );
 	gboolean			ret;
 	RPCReturnCallback *	callback = g_new( RPCReturnCallback, 1 );
@@ -295,12 +299,12 @@ rpc_entity_send_command( RPCEntity * self, RPCCommand * cmd,
 	/* add callback for RPC return command */
 	mbus_callback_set( ( *callback ), func, data );
 	g_hash_table_insert( self->returns,
-			g_strdup( M_STRING( cmd->id )->str->str ), callback );
+			g_strdup( M_STRING( cmd->id )->str ), callback );
 
 	/* prepare RPC command message */
 	mbus_list_append( rpc_id, mbus_string_new( "ID" ) );
 	mbus_list_append( rpc_id,
-			mbus_string_new( M_STRING( cmd->id )->str->str ) );
+			mbus_string_new( M_STRING( cmd->id )->str ) );
 
 	mbus_list_append( rpc_type, mbus_string_new( "RPC-TYPE" ) );
 
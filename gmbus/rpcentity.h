@@ -46,7 +46,8 @@ typedef struct {
 	 * entity */
 	MClient *			client;
 
-	/** A hash table of registered RPC commands */
+	/** A hash table of registered RPC commands keyed by the interned
+	 * command names */
 	GHashTable *		commands;
 	/** A hash table of registered RPC return commands */
 	GHashTable *		returns;
@@ -65,7 +65,7 @@ rpc_command_new_from_command( MCommand * command )
 	MObject *		rpc_args = mbus_list_index( command->arguments, 0 );
 	gint			i;
 
-	self->command = g_strdup( command->cmd->str );
+	self->command = g_strdup( command->cmd );
 	self->id = mbus_string_new( NULL );
 	self->type = RPC_UNICAST;
 	self->source = mbus_address_new();
@@ -83,12 +83,12 @@ rpc_command_new_from_command( MCommand * command )
 			g_return_val_if_fail( key != NULL, NULL );
 			g_return_val_if_fail( value != NULL, NULL );
 
-			if ( !strcmp( M_STRING( key )->str->str, MBUS_RPC_ID ) )
-				mbus_string_set( self->id, M_STRING( value )->str->str );
-			else if ( strcmp( M_STRING( key )->str->str, MBUS_RPC_TYPE ) ) {
-				if ( !strcmp( M_STRING( value )->str->str, "UNICAST" ) )
+			if ( !strcmp( M_STRING( key )->str, MBUS_RPC_ID ) )
+				mbus_string_set( self->id, M_STRING( value )->str );
+			else if ( strcmp( M_STRING( key )->str, MBUS_RPC_TYPE ) ) {
+				if ( !strcmp( M_STRING( value )->str, "UNICAST" ) )
 					self->type = RPC_UNICAST;
-				else if ( !strcmp( M_STRING( value )->str->str, "ANYCAST" ) )
+				else if ( !strcmp( M_STRING( value )->str, "ANYCAST" ) )
 					self->type = RPC_ANYCAST;
 			}
 		} else
@@ -143,7 +143,7 @@ rpc_return_new_from_command( MCommand * command )
 	MObject *	app_args = mbus_list_index( command->arguments, 1 );
 	gint		i;
 
-	ret->command = g_strdup( command->cmd->str );
+	ret->command = g_strdup( command->cmd );
 	ret->id = mbus_string_new( NULL );
 	ret->status = RPC_OK;
 
@@ -160,12 +160,12 @@ rpc_return_new_from_command( MCommand * command )
 			g_return_val_if_fail( key != NULL, NULL );
 			g_return_val_if_fail( value != NULL, NULL );
 
-			if ( !strcmp( M_STRING( key )->str->str, MBUS_RPC_ID ) )
-				mbus_string_set( ret->id, M_STRING( value )->str->str );
-			else if ( strcmp( M_STRING( key )->str->str, MBUS_RPC_STATUS ) ) {
-				if ( !strcmp( M_STRING( value )->str->str, MBUS_RPC_OK ) )
+			if ( !strcmp( M_STRING( key )->str, MBUS_RPC_ID ) )
+				mbus_string_set( ret->id, M_STRING( value )->str );
+			else if ( strcmp( M_STRING( key )->str, MBUS_RPC_STATUS ) ) {
+				if ( !strcmp( M_STRING( value )->str, MBUS_RPC_OK ) )
 					ret->status = RPC_OK;
-				else if ( !strcmp( M_STRING( value )->str->str,
+				else if ( !strcmp( M_STRING( value )->str,
 								MBUS_RPC_UNKNOWN ) )
 					ret->status = RPC_UNKNOWN;
 				else
@@ -187,13 +187,14 @@ rpc_return_new_from_command( MCommand * command )
 
 			if ( M_OBJECT_IS( arg1, MSYMBOL ) && M_OBJECT_IS( arg2, MSYMBOL ) &&
 					M_OBJECT_IS( arg3, MSTRING ) ) {
-				if ( !strcmp( M_SYMBOL( arg1 )->str->str, MBUS_RPC_OK ) )
+				if ( mbus_symbol_is( arg1,
+							g_quark_from_static_string( MBUS_RPC_OK ) ) )
 					ret->app_status = RPC_OK;
 				else
 					ret->app_status = RPC_FAILED;
 
-				ret->app_result = g_strdup( M_STRING( arg2 )->str->str );
-				ret->app_description = g_strdup( M_STRING( arg3 )->str->str );
+				ret->app_result = g_strdup( M_STRING( arg2 )->str );
+				ret->app_description = g_strdup( M_STRING( arg3 )->str );
 			} else {
 				goto failure;
 			}
@@ -46,10 +46,15 @@ static void __mbus_socket_multicast_ipv6( gint fd, MEndpoint * ep );
    \param ep the remote trnasport address
    \param multicast if \a addr is a multicast address and this parameter is TRUE
    the multicast group is joined.
+   \param rcvbuf the size of the socket receive buffer in bytes or 0 to keep
+   the default of the system
+   \param sndbuf the size of the socket send buffer in bytes or 0 to keep the
+   default of the system
    \return A pointer to a GIOChannel object or NULL on failure.
 */
 GIOChannel *
-mbus_socket_new( MEndpoint * ep, gboolean multicast )
+mbus_socket_new( MEndpoint * ep, gboolean multicast, gint rcvbuf,
+    gint sndbuf )
 {
   gint			fd;
   gint			yes = 1;
@@ -59,6 +64,13 @@ mbus_socket_new( MEndpoint * ep, gboolean multicast )
   if ( setsockopt( fd, SOL_SOCKET, SO_REUSEADDR,
 	  ( gchar * ) &yes, sizeof yes ) )
     perror( "setsockopt( SO_REUSEADDR )" );
+  /* larger buffers keep bursts of datagrams from being dropped */
+  if ( rcvbuf > 0 && setsockopt( fd, SOL_SOCKET, SO_RCVBUF,
+	  ( gchar * ) &rcvbuf, sizeof rcvbuf ) )
+    perror( "setsockopt( SO_RCVBUF )" );
+  if ( sndbuf > 0 && setsockopt( fd, SOL_SOCKET, SO_SNDBUF,
+	  ( gchar * ) &sndbuf, sizeof sndbuf ) )
+    perror( "setsockopt( SO_SNDBUF )" );
 
   if ( bind( fd, ( struct sockaddr * ) ep,
 	  mbus_endpoint_get_size( ep ) ) == -1 ) {
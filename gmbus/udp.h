@@ -73,7 +73,8 @@ extern "C" {
 				   const MEndpoint * e2 );
   void mbus_endpoint_print( MEndpoint * self );
 
-  GIOChannel * mbus_socket_new( MEndpoint * ep, gboolean multicast );
+  GIOChannel * mbus_socket_new( MEndpoint * ep, gboolean multicast,
+				gint rcvbuf, gint sndbuf );
   void mbus_socket_get_name( GIOChannel * channel, MEndpoint * ep );
 
   /**
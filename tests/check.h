@@ -0,0 +1,45 @@
+/* check.h
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef MBUS_TESTS_CHECK_H
+#define MBUS_TESTS_CHECK_H
+
+#include <stdio.h>
+
+/* number of failed checks of the test program */
+static int check_failures = 0;
+
+/* reports a failed condition without stopping the test */
+#define CHECK( cond ) \
+  do { \
+    if ( !( cond ) ) { \
+      printf( "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond ); \
+      check_failures++; \
+    } \
+  } while ( 0 )
+
+/* the exit code of the test program */
+#define CHECK_RESULT() \
+  ( check_failures ? ( printf( "%d checks failed\n", check_failures ), 1 ) : 0 )
+
+#endif /* MBUS_TESTS_CHECK_H */
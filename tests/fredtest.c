@@ -31,7 +31,7 @@ __rpc_devices_list( const RPCReturn * ret, gpointer data )
   GString *     tmp = g_string_new( NULL );
 
   g_message( "received RPC return for RPC ID %s with %u arguments",
-      M_STRING( ret->id )->str->str, mbus_list_length( ret->arguments ) );
+      M_STRING( ret->id )->str, mbus_list_length( ret->arguments ) );
 
   if ( res ) {
     mbus_list_as_string( ret->arguments, tmp );
@@ -36,7 +36,7 @@ __rpc_math_sum( const RPCReturn * ret, gpointer data )
   MObject *	res = mbus_list_index( ret->arguments, 0 );
 
   g_message( "received RPC return for RPC ID %s with %u arguments",
-      M_STRING( ret->id )->str->str, mbus_list_length( ret->arguments ) );
+      M_STRING( ret->id )->str, mbus_list_length( ret->arguments ) );
 
   if ( res ) {
     GString * tmp = g_string_new( NULL );
@@ -52,7 +52,7 @@ __rpc_math_sub( const RPCReturn * ret, gpointer data )
   MObject *	res = mbus_list_index( ret->arguments, 1 );
 
   g_message( "received RPC return for RPC ID %s with %d arguments",
-      M_STRING( ret->id )->str->str, mbus_list_length( ret->arguments ) );
+      M_STRING( ret->id )->str, mbus_list_length( ret->arguments ) );
 
   if ( res ) {
     GString * tmp = g_string_new( NULL );
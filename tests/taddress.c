@@ -0,0 +1,230 @@
+/* taddress.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Checks the interning of Mbus addresses, their comparison and the
+   compiled matcher that decides whether a message is addressed to an
+   entity. */
+
+#include "gmbus/maddress.h"
+
+#include <string.h>
+
+#include "check.h"
+
+#define THREADS 4
+#define INTERNS 1000
+
+static MAddress *
+intern( const gchar * text )
+{
+  MCursor cursor;
+
+  mbus_cursor_init( &cursor, text, strlen( text ) );
+
+  return mbus_address_intern( &cursor );
+}
+
+static MAddress *
+parse( const gchar * text )
+{
+  MAddress *	self = mbus_address_new();
+  MCursor	cursor;
+
+  mbus_cursor_init( &cursor, text, strlen( text ) );
+  CHECK( mbus_address_parse( self, &cursor ) );
+
+  return self;
+}
+
+static void
+intern_test( void )
+{
+  MAddress *	a = intern( "(app:test id:1@host)" );
+  MAddress *	b = intern( "  (app:test id:1@host) rest" );
+  MAddress *	c = intern( "(app:test id:2@host)" );
+  MAddress *	copy;
+  MCursor	cursor;
+  const gchar *	text;
+
+  CHECK( a && b && c );
+  /* the same text yields the same object */
+  CHECK( a == b );
+  CHECK( a != c );
+  CHECK( mbus_address_is_interned( a ) );
+  CHECK( mbus_address_is_equal( a, b ) );
+  CHECK( !mbus_address_is_equal( a, c ) );
+  CHECK( mbus_address_find( a, "app" ) &&
+	 !strcmp( mbus_address_find( a, "app" )->value, "test" ) );
+
+  /* the cursor is moved behind the address */
+  text = "(app:test id:1@host) rest";
+  mbus_cursor_init( &cursor, text, strlen( text ) );
+  b = mbus_address_intern( &cursor );
+  CHECK( b == a );
+  CHECK( cursor.pos == text + 20 );
+  mbus_address_unref( b );
+
+  /* copies are independent and may be modified */
+  copy = mbus_address_copy( a );
+  CHECK( copy != a );
+  CHECK( !mbus_address_is_interned( copy ) );
+  CHECK( mbus_address_is_equal( copy, a ) );
+  mbus_address_unref( copy );
+
+  CHECK( !intern( "" ) );
+  CHECK( !intern( "app:test" ) );
+  CHECK( !intern( "(app:test" ) );
+  CHECK( !intern( "(app test)" ) );
+
+  mbus_address_unref( a );
+  mbus_address_unref( a );
+  mbus_address_unref( c );
+
+  /* interned again after the last reference is gone */
+  a = intern( "(app:test id:1@host)" );
+  CHECK( a && mbus_address_is_interned( a ) );
+  mbus_address_unref( a );
+}
+
+static gpointer
+intern_many( gpointer data )
+{
+  MAddress **	result = data;
+  gint		i;
+
+  for ( i = 0; i < INTERNS; i++ ) {
+    MAddress * address = intern( "(app:thread id:7@host)" );
+
+    if ( !i )
+      *result = address;
+    else {
+      CHECK( address == *result );
+      mbus_address_unref( address );
+    }
+  }
+
+  return NULL;
+}
+
+static void
+thread_test( void )
+{
+  MAddress *	results[ THREADS ];
+  GThread *	threads[ THREADS ];
+  MAddress *	kept = intern( "(app:thread id:7@host)" );
+  gint		t;
+
+  for ( t = 0; t < THREADS; t++ )
+    threads[ t ] = g_thread_new( "intern", intern_many, &results[ t ] );
+  for ( t = 0; t < THREADS; t++ ) g_thread_join( threads[ t ] );
+
+  for ( t = 0; t < THREADS; t++ ) {
+    CHECK( results[ t ] == kept );
+    mbus_address_unref( results[ t ] );
+  }
+  CHECK( kept->_ref_count == 1 );
+  mbus_address_unref( kept );
+}
+
+static void
+equal_test( void )
+{
+  MAddress *	a = parse( "(b:2 a:1)" );
+  MAddress *	b = parse( "(a:1 b:2)" );
+  MAddress *	any = parse( "(a:* b:2)" );
+  MAddress *	other = parse( "(a:1 b:3)" );
+  MAddress *	interned = intern( "(a:1 b:2)" );
+
+  /* the elements are sorted by key */
+  CHECK( mbus_address_is_equal( a, b ) );
+  CHECK( mbus_address_is_equal( a, interned ) );
+  CHECK( mbus_address_is_equal( interned, b ) );
+  CHECK( mbus_address_hash( a ) == mbus_address_hash( b ) );
+  CHECK( !mbus_address_is_equal( a, other ) );
+  /* a wildcard matches any value */
+  CHECK( mbus_address_is_equal( any, a ) );
+  CHECK( mbus_address_is_equal( other, any ) == FALSE );
+
+  mbus_address_unref( a );
+  mbus_address_unref( b );
+  mbus_address_unref( any );
+  mbus_address_unref( other );
+  mbus_address_unref( interned );
+}
+
+static void
+match_test( void )
+{
+  static const gchar *	destinations[] = {
+    "()",
+    "(app:test)",
+    "(app:other)",
+    "(app:*)",
+    "(module:engine app:test)",
+    "(module:* app:test)",
+    "(app:test media:audio)",
+    "(id:1@host)",
+    "(id:2@host)",
+    "(app:test module:engine id:1@host)",
+    "(app:test module:engine id:1@host lang:C)",
+    "(lang:*)",
+    NULL
+  };
+  static const gboolean	expected[] = {
+    TRUE, TRUE, FALSE, TRUE, TRUE, TRUE, FALSE, TRUE, FALSE, TRUE, FALSE,
+    FALSE
+  };
+  MAddress *		entity = parse( "(app:test module:engine id:1@host)" );
+  MAddressMatcher *	matcher = mbus_address_matcher_new( entity );
+  MAddress *		parsed[ G_N_ELEMENTS( expected ) ];
+  gint			i, round;
+
+  for ( i = 0; destinations[ i ]; i++ ) {
+    parsed[ i ] = intern( destinations[ i ] );
+    CHECK( mbus_address_is_subset_of( entity, parsed[ i ] ) == expected[ i ] );
+  }
+
+  /* more distinct addresses than the matcher remembers in varying order */
+  for ( round = 0; round < 10; round++ )
+    for ( i = 0; destinations[ i ]; i++ ) {
+      gint j = ( i * ( round + 1 ) ) % G_N_ELEMENTS( expected );
+
+      CHECK( mbus_address_matcher_match( matcher, parsed[ j ] ) ==
+	     expected[ j ] );
+    }
+
+  for ( i = 0; destinations[ i ]; i++ ) mbus_address_unref( parsed[ i ] );
+  mbus_address_matcher_free( matcher );
+  mbus_address_unref( entity );
+}
+
+int
+main( int argc, char * argv[] )
+{
+  intern_test();
+  thread_test();
+  equal_test();
+  match_test();
+
+  return CHECK_RESULT();
+}
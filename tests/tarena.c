@@ -0,0 +1,151 @@
+/* tarena.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Checks the arena allocator and that objects parsed into an arena can be
+   copied to the heap and outlive the arena. */
+
+#include "gmbus/mmessage.h"
+#include "gmbus/marena.h"
+
+#include <string.h>
+
+#include "check.h"
+
+#define BLOCKS 1000
+
+static void
+alloc_test( void )
+{
+  MArena *	arena = mbus_arena_new( 256 );
+  guint8 *	blocks[ BLOCKS ];
+  gsize		sizes[ BLOCKS ];
+  gchar *	str;
+  gint		i;
+  gsize		j;
+
+  /* small, odd and larger than the chunk size */
+  for ( i = 0; i < BLOCKS; i++ ) {
+    sizes[ i ] = i % 10 == 0 ? 300 + i : 1 + ( i * 7 ) % 61;
+    blocks[ i ] = mbus_arena_alloc( arena, sizes[ i ] );
+    CHECK( ( ( gsize ) blocks[ i ] ) % ( 2 * sizeof( gpointer ) ) == 0 );
+    memset( blocks[ i ], i & 0xff, sizes[ i ] );
+  }
+
+  /* the blocks do not overlap */
+  for ( i = 0; i < BLOCKS; i++ )
+    for ( j = 0; j < sizes[ i ]; j++ )
+      if ( blocks[ i ][ j ] != ( i & 0xff ) ) {
+	CHECK( blocks[ i ][ j ] == ( i & 0xff ) );
+	break;
+      }
+
+  str = mbus_arena_strndup( arena, "string and more", 6 );
+  CHECK( !strcmp( str, "string" ) );
+  str = mbus_arena_strndup( arena, "", 0 );
+  CHECK( str && !*str );
+
+  mbus_arena_free( arena );
+
+  /* the default chunk size */
+  arena = mbus_arena_new( 0 );
+  CHECK( arena->chunk_size == M_ARENA_CHUNK_SIZE );
+  CHECK( mbus_arena_alloc( arena, 1 ) != mbus_arena_alloc( arena, 1 ) );
+  mbus_arena_free( arena );
+}
+
+static void
+object_test( void )
+{
+  const gchar *	text = "(1 2.5 \"a string that does not fit into the object\" "
+    "Sym <ZGF0YQ==> (\"nested\" (3)))";
+  MArena *	arena = mbus_arena_new( 64 );
+  MObject *	list = mbus_list_new();
+  MObject *	copy;
+  GString *	parsed_text = g_string_new( NULL );
+  GString *	copy_text = g_string_new( NULL );
+  MCursor	cursor;
+  guint		i;
+
+  mbus_cursor_init( &cursor, text, strlen( text ) );
+  CHECK( mbus_list_parse( list, &cursor, arena ) );
+  CHECK( mbus_list_length( list ) == 6 );
+  for ( i = 0; i < mbus_list_length( list ); i++ )
+    CHECK( M_OBJECT_IN_ARENA( mbus_list_index( list, i ) ) );
+
+  copy = mbus_list_copy( list );
+  CHECK( !M_OBJECT_IN_ARENA( copy ) );
+  for ( i = 0; i < mbus_list_length( copy ); i++ )
+    CHECK( !M_OBJECT_IN_ARENA( mbus_list_index( copy, i ) ) );
+  CHECK( !M_OBJECT_IN_ARENA( mbus_list_index( mbus_list_index( copy, 5 ),
+					      1 ) ) );
+  mbus_list_as_string( list, parsed_text );
+
+  /* the copy stays valid without the arena */
+  mbus_list_free( list );
+  mbus_arena_free( arena );
+  mbus_list_as_string( copy, copy_text );
+  CHECK( !strcmp( parsed_text->str, copy_text->str ) );
+  mbus_list_append( mbus_list_index( copy, 5 ), mbus_integer_new( 4 ) );
+  mbus_list_free( copy );
+
+  g_string_free( parsed_text, TRUE );
+  g_string_free( copy_text, TRUE );
+}
+
+/* the commands of a received message are parsed into its arena */
+static void
+message_test( void )
+{
+  GString *	text = g_string_new( "mbus/1.0 1 100 U (app:a) () ()\n" );
+  MMessage *	msg = mbus_message_new();
+  MCommand *	cmd;
+  MCommand *	copy;
+  gint		i;
+
+  for ( i = 0; i < 100; i++ )
+    g_string_append_printf( text, "test.cmd%d(%d \"%d\" (Sym))\n", i, i, i );
+
+  CHECK( mbus_message_scan( msg, text->str, text->len ) );
+  cmd = mbus_payload_index( msg->payload, 42 );
+  CHECK( M_OBJECT_IN_ARENA( mbus_list_index( cmd->arguments, 0 ) ) );
+  copy = mbus_command_copy( cmd );
+
+  mbus_message_unref( msg );
+  g_string_free( text, TRUE );
+
+  CHECK( !strcmp( copy->cmd, "test.cmd42" ) );
+  CHECK( M_INTEGER( mbus_list_index( copy->arguments, 0 ) )->number == 42 );
+  CHECK( !strcmp( M_STRING( mbus_list_index( copy->arguments, 1 ) )->str,
+		  "42" ) );
+  mbus_command_free( copy );
+}
+
+int
+main( int argc, char * argv[] )
+{
+  alloc_test();
+  object_test();
+  message_test();
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,133 @@
+/* tbatch.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Sends a burst of messages and checks that all of them are received in
+   order and that the link sends and receives them in batches. */
+
+#include "gmbus/mprepared.h"
+#include "gmbus/init.h"
+
+#include <string.h>
+
+#include "check.h"
+
+#define BURST 1000
+
+static MClient *	sender;
+static MClient *	receiver;
+static MPreparedMessage *	prepared;
+static gint		received = 0;
+static guint64		last_sequence_no = 0;
+
+static MConfig *
+create_config( void )
+{
+  MConfig * config = mbus_config_new( FALSE );
+
+  g_byte_array_append( config->hash_key, ( guchar * ) "batchkey", 8 );
+  mbus_endpoint_set_address_from_string( config->group_addr,
+      "224.255.222.239" );
+  mbus_endpoint_set_port( config->group_addr, htons( 47303 ) );
+  config->rcvbuf_size = 1 << 20;
+
+  return config;
+}
+
+static void
+when_burst( const MMessage * msg, gpointer data )
+{
+  MCommand * cmd = mbus_payload_index( msg->payload, 0 );
+
+  CHECK( msg->header->sequence_no > last_sequence_no );
+  last_sequence_no = msg->header->sequence_no;
+  CHECK( M_INTEGER( mbus_list_index( cmd->arguments, 0 ) )->number ==
+	 received );
+  received++;
+}
+
+static gboolean
+send_burst( gpointer data )
+{
+  gint i;
+
+  for ( i = 0; i < BURST; i++ )
+    CHECK( mbus_prepared_send( prepared, ( gint64 ) i ) );
+
+  return FALSE;
+}
+
+static gboolean
+quit( gpointer data )
+{
+  mbus_quit();
+
+  return FALSE;
+}
+
+int
+main( int argc, char * argv[] )
+{
+  const MLinkStats *	stats;
+
+  mbus_init( NULL );
+
+  sender = mbus_client_new( "(app:sender id:1)", create_config() );
+  receiver = mbus_client_new( "(app:receiver id:2)", create_config() );
+  CHECK( mbus_client_ok( sender ) && mbus_client_ok( receiver ) );
+
+  mbus_client_register( receiver, "test.burst", when_burst, NULL );
+  prepared = mbus_prepared_new( sender, NULL, "test.burst", "i" );
+  CHECK( mbus_prepared_ok( prepared ) );
+
+  mbus_event_add_timeout( 100, send_burst, NULL );
+  mbus_event_add_timeout( 1000, quit, NULL );
+  mbus_loop();
+
+  CHECK( received == BURST );
+
+  /* the burst is queued and flushed with few system calls */
+  stats = mbus_link_stats( sender->trans->link );
+  CHECK( stats->send_datagrams >= BURST );
+  CHECK( stats->send_batches < stats->send_datagrams );
+  CHECK( stats->send_batch_max > 1 );
+  CHECK( stats->send_gso_datagrams <= stats->send_datagrams );
+#ifdef HAVE_SENDMMSG
+  /* without sendmmsg each datagram needs at least one call, and one more
+     if the send buffer was full */
+  CHECK( stats->send_calls < stats->send_datagrams );
+#endif
+
+  stats = mbus_link_stats( receiver->trans->link );
+  CHECK( stats->recv_datagrams >= BURST );
+  CHECK( stats->recv_batches <= stats->recv_datagrams );
+#ifdef HAVE_RECVMMSG
+  CHECK( stats->recv_batch_max > 1 );
+  CHECK( stats->recv_batches < stats->recv_datagrams );
+#endif
+
+  mbus_prepared_free( prepared );
+  mbus_client_free( receiver );
+  mbus_client_free( sender );
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,175 @@
+/* tevent.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Checks the timers of the event engines: the order of expiration,
+   repeated timers and the removal of timers within nested iterations
+   of the main loop. An I/O watch must not be dispatched again by a
+   nested iteration while its function runs. */
+
+#include "gmbus/init.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "check.h"
+
+static GString *	fired;
+static gint		repeated;
+static gint		nested;
+static guint		nested_ids[ 2 ];
+
+static gboolean
+when_fired( gpointer data )
+{
+  g_string_append( fired, data );
+
+  return FALSE;
+}
+
+static gboolean
+when_repeated( gpointer data )
+{
+  return ++repeated < 3;
+}
+
+/* both timers expire together; the first one removes the other and runs
+   a nested iteration of the main loop */
+static gboolean
+when_nested( gpointer data )
+{
+  guint other = nested_ids[ GPOINTER_TO_INT( data ) ? 0 : 1 ];
+
+  nested++;
+  mbus_event_remove( other );
+  mbus_loop_step( FALSE );
+
+  return FALSE;
+}
+
+static gint		io_calls;
+static gint		io_running;
+static gint		io_recursions;
+static gint		io_bytes;
+
+/* the first call makes the pipe readable again and runs a nested
+   iteration of the main loop */
+static MEventResult
+when_readable( gint fd, gpointer data )
+{
+  gint *	pipe_fds = data;
+  gchar		buf[ 16 ];
+  gssize	n;
+
+  if ( io_running ) io_recursions++;
+  io_running++;
+
+  if ( !io_calls++ ) {
+    if ( write( pipe_fds[ 1 ], "b", 1 ) != 1 ) CHECK( FALSE );
+    mbus_loop_step( FALSE );
+  }
+  while ( ( n = read( fd, buf, sizeof( buf ) ) ) > 0 ) io_bytes += n;
+
+  io_running--;
+
+  return M_EVENT_DRAINED;
+}
+
+static gboolean
+quit( gpointer data )
+{
+  mbus_quit();
+
+  return FALSE;
+}
+
+static void
+timer_test( const MEventEngine * engine )
+{
+  mbus_event_set_engine( engine );
+  mbus_init( NULL );
+
+  fired = g_string_new( NULL );
+  repeated = nested = 0;
+
+  mbus_event_add_timeout( 60, when_fired, "3" );
+  mbus_event_add_timeout( 20, when_fired, "1" );
+  mbus_event_add_timeout( 40, when_fired, "2" );
+  mbus_event_add_timeout( 5, when_repeated, NULL );
+  nested_ids[ 0 ] = mbus_event_add_timeout( 10, when_nested,
+      GINT_TO_POINTER( 0 ) );
+  nested_ids[ 1 ] = mbus_event_add_timeout( 10, when_nested,
+      GINT_TO_POINTER( 1 ) );
+  mbus_event_add_timeout( 150, quit, NULL );
+  mbus_loop();
+
+  printf( "%s: fired=%s repeated=%d nested=%d\n", engine->name, fired->str,
+      repeated, nested );
+  CHECK( !strcmp( fired->str, "123" ) );
+  CHECK( repeated == 3 );
+  CHECK( nested == 1 );
+
+  g_string_free( fired, TRUE );
+}
+
+static void
+io_test( const MEventEngine * engine )
+{
+  gint	pipe_fds[ 2 ];
+  guint	id;
+
+  mbus_event_set_engine( engine );
+  mbus_init( NULL );
+
+  io_calls = io_running = io_recursions = io_bytes = 0;
+  CHECK( pipe( pipe_fds ) == 0 );
+  fcntl( pipe_fds[ 0 ], F_SETFL, O_NONBLOCK );
+
+  id = mbus_event_add_io( pipe_fds[ 0 ], when_readable, pipe_fds );
+  if ( write( pipe_fds[ 1 ], "a", 1 ) != 1 ) CHECK( FALSE );
+  mbus_event_add_timeout( 50, quit, NULL );
+  mbus_loop();
+
+  printf( "%s: io calls=%d recursions=%d\n", engine->name, io_calls,
+      io_recursions );
+  CHECK( io_recursions == 0 );
+  CHECK( io_calls >= 1 );
+  CHECK( io_bytes == 2 );
+
+  mbus_event_remove( id );
+  close( pipe_fds[ 0 ] );
+  close( pipe_fds[ 1 ] );
+}
+
+int
+main( int argc, char * argv[] )
+{
+  timer_test( mbus_event_glib_engine() );
+  io_test( mbus_event_glib_engine() );
+  if ( mbus_event_epoll_engine() ) {
+    timer_test( mbus_event_epoll_engine() );
+    io_test( mbus_event_epoll_engine() );
+  }
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,203 @@
+/* tfilter.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Checks the payload prefilter of the link: the payload of a message that
+   is not addressed to the transport is not parsed, but its header is still
+   used to register the sender and to process acknowledgements. Own
+   messages are dropped and hellos always pass. */
+
+#include "gmbus/mtrans.h"
+#include "gmbus/init.h"
+
+#include <string.h>
+
+#include "check.h"
+
+#define SKIPPED_CMD	"test.skip (1 2 3)"
+
+static MTransport *	trans;
+static MLink *		peer;
+static MAddress *	peer_addr;
+static guint64		skipped;
+static gint		incoming;
+
+static MConfig *
+create_config( gint port, gboolean recv_thread )
+{
+  MConfig * config = mbus_config_new( FALSE );
+
+  g_byte_array_append( config->hash_key, ( guchar * ) "filterkey", 9 );
+  mbus_endpoint_set_address_from_string( config->group_addr,
+      "224.255.222.239" );
+  mbus_endpoint_set_port( config->group_addr, htons( port ) );
+  config->recv_thread = recv_thread;
+
+  return config;
+}
+
+static MAddress *
+create_address( const gchar * text )
+{
+  MAddress *	addr = mbus_address_new();
+  GString *	tmp = g_string_new( text );
+
+  mbus_address_read( addr, tmp );
+  g_string_free( tmp, TRUE );
+
+  return addr;
+}
+
+static void
+when_incoming( const MMessage * msg, gpointer data )
+{
+  CHECK( mbus_message_contains( msg, "test.pass" ) );
+  incoming++;
+}
+
+/* the peer sends on its own link directly to the unicast socket of the
+   transport, so the transport does not share the link with it */
+static void
+send_from_peer( const gchar * destination, const gchar * command,
+		const GArray * acks )
+{
+  MMessage *	msg = mbus_message_new();
+  static guint64 seq = 1;
+
+  msg->header->sequence_no = seq++;
+  mbus_header_set_source( msg->header, peer_addr );
+  if ( destination ) {
+    MAddress * dest = create_address( destination );
+
+    mbus_header_set_destination( msg->header, dest );
+    mbus_address_free( dest );
+  }
+  if ( acks )
+    g_array_append_vals( msg->header->acks, acks->data, acks->len );
+  mbus_message_add_command( msg, command );
+
+  mbus_link_send_unicast( peer, msg, &( trans->link->ep_unicast ) );
+  mbus_link_flush( peer );
+
+  mbus_message_free( msg );
+}
+
+/* sends a reliable message to nobody, which is acknowledged by the peer in
+   a message that is not addressed to the transport */
+static gboolean
+send_reliable( gpointer data )
+{
+  MMessage *	msg = mbus_message_new();
+  MAddress *	dest = create_address( "(app:nobody)" );
+  GArray *	acks = g_array_new( FALSE, FALSE, sizeof( gulong ) );
+  gulong	seq;
+
+  /* the own hello has been received by now */
+  CHECK( mbus_link_skipped_bytes( trans->link ) > 0 );
+
+  msg->header->type = RELIABLE;
+  mbus_header_set_destination( msg->header, dest );
+  mbus_message_add_command( msg, "test.reliable ()" );
+  mbus_transport_send( trans, msg );
+  CHECK( g_hash_table_size( trans->reliable_messages ) == 1 );
+
+  skipped = mbus_link_skipped_bytes( trans->link );
+  seq = msg->header->sequence_no;
+  g_array_append_val( acks, seq );
+  send_from_peer( "(app:other)", SKIPPED_CMD, acks );
+
+  g_array_free( acks, TRUE );
+  mbus_address_free( dest );
+  mbus_message_free( msg );
+
+  return FALSE;
+}
+
+static gboolean
+check_skipped( gpointer data )
+{
+  MEntity * entity;
+
+  /* the payload was not parsed, but the header was */
+  CHECK( incoming == 0 );
+  CHECK( mbus_link_skipped_bytes( trans->link ) >=
+      skipped + strlen( SKIPPED_CMD ) );
+  CHECK( mbus_transport_is_entity_available( trans, peer_addr ) );
+  CHECK( g_hash_table_size( trans->reliable_messages ) == 0 );
+
+  /* a hello is addressed to everyone, so its payload is parsed */
+  entity = g_hash_table_lookup( trans->entities, peer_addr );
+  if ( entity ) {
+    entity->last_hello.tv_sec = 0;
+    entity->last_hello.tv_usec = 0;
+  }
+  send_from_peer( NULL, "mbus.hello ()", NULL );
+  send_from_peer( "(app:filter)", "test.pass (4)", NULL );
+
+  return FALSE;
+}
+
+static gboolean
+check_passed( gpointer data )
+{
+  MEntity * entity = g_hash_table_lookup( trans->entities, peer_addr );
+
+  CHECK( entity && entity->last_hello.tv_sec != 0 );
+  CHECK( incoming == 1 );
+
+  mbus_quit();
+
+  return FALSE;
+}
+
+static void
+filter_test( gint port, gboolean recv_thread )
+{
+  mbus_init( NULL );
+
+  trans = mbus_transport_new( create_config( port, recv_thread ),
+      "(app:filter id:1)" );
+  peer = mbus_link_new( create_config( port + 1, FALSE ) );
+  CHECK( mbus_transport_ok( trans ) && mbus_link_ok( peer ) );
+  peer_addr = create_address( "(app:peer id:2)" );
+  incoming = 0;
+
+  mbus_callback_set( trans->incoming_message, when_incoming, NULL );
+
+  mbus_event_add_timeout( 100, send_reliable, NULL );
+  mbus_event_add_timeout( 200, check_skipped, NULL );
+  mbus_event_add_timeout( 300, check_passed, NULL );
+  mbus_loop();
+
+  mbus_address_free( peer_addr );
+  mbus_link_free( peer );
+  mbus_transport_free( trans );
+}
+
+int
+main( int argc, char * argv[] )
+{
+  filter_test( 47310, FALSE );
+  filter_test( 47312, TRUE );
+
+  return CHECK_RESULT();
+}
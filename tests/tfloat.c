@@ -0,0 +1,183 @@
+/* tfloat.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Checks the floating point codec: the shortest text of a number reads
+   back to exactly the same number and malformed text is rejected. */
+
+#include "gmbus/mdouble.h"
+#include "gmbus/mcursor.h"
+#include "gmbus/mtypes.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+
+static gboolean
+same_double( gdouble a, gdouble b )
+{
+  return !memcmp( &a, &b, sizeof( gdouble ) );
+}
+
+/* formats the number, compares the text if expected is given and reads it
+   back */
+static void
+check_double( gdouble number, const gchar * expected )
+{
+  gchar		buf[ MBUS_DOUBLE_TEXT_SIZE ];
+  gsize		len = mbus_double_format( number, buf );
+  gdouble	value = 0;
+
+  CHECK( len == strlen( buf ) );
+  CHECK( len < MBUS_DOUBLE_TEXT_SIZE );
+  if ( expected ) CHECK( !strcmp( buf, expected ) );
+  /* the text is always recognized as a floating point number */
+  CHECK( strchr( buf, '.' ) || strchr( buf, 'e' ) );
+
+  CHECK( mbus_double_parse( buf, len, &value ) );
+  CHECK( same_double( value, number ) );
+  /* the text is the same number for the C library */
+  CHECK( same_double( strtod( buf, NULL ), number ) );
+}
+
+static void
+format_test( void )
+{
+  guint64	seed = 7;
+  gdouble	number;
+  gint		i;
+
+  check_double( 0.0, "0.0" );
+  check_double( -0.0, "-0.0" );
+  check_double( 1.0, "1.0" );
+  check_double( -1.0, "-1.0" );
+  check_double( 0.1, "0.1" );
+  check_double( 0.3, "0.3" );
+  check_double( 0.1 + 0.2, "0.30000000000000004" );
+  check_double( 1.5, "1.5" );
+  check_double( 100.0, "100.0" );
+  check_double( 0.001234, "0.001234" );
+  check_double( 1.5e300, "1.5e300" );
+  check_double( 2.5e-10, "2.5e-10" );
+  check_double( 1e21, NULL );
+  check_double( 1e22, NULL );
+  check_double( 1e-7, NULL );
+  check_double( G_MAXDOUBLE, NULL );
+  check_double( -G_MAXDOUBLE, NULL );
+  check_double( G_MINDOUBLE, NULL );
+  /* the smallest and the largest subnormal numbers */
+  check_double( 4.9406564584124654e-324, NULL );
+  check_double( 2.2250738585072009e-308, NULL );
+  check_double( 9007199254740993.0, NULL );
+
+  /* random bit patterns except for infinity and NaN */
+  for ( i = 0; i < 100000; i++ ) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    memcpy( &number, &seed, sizeof( gdouble ) );
+    if ( ( seed & G_GUINT64_CONSTANT( 0x7ff0000000000000 ) ) ==
+	 G_GUINT64_CONSTANT( 0x7ff0000000000000 ) )
+      continue;
+    check_double( number, NULL );
+  }
+
+  /* random integers and short decimal fractions */
+  for ( i = 0; i < 10000; i++ ) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    check_double( ( gdouble ) ( seed >> 40 ), NULL );
+    check_double( ( gdouble ) ( seed >> 44 ) / 1000.0, NULL );
+  }
+}
+
+/* parses the text and compares the result with the C library */
+static void
+check_parse( const gchar * text )
+{
+  gdouble value = 0;
+
+  CHECK( mbus_double_parse( text, strlen( text ), &value ) );
+  CHECK( same_double( value, strtod( text, NULL ) ) );
+}
+
+static void
+parse_test( void )
+{
+  gdouble	value = 42.0;
+  MObject *	list = mbus_list_new();
+  MCursor	cursor;
+
+  check_parse( "0" );
+  check_parse( "-0.0" );
+  check_parse( "000123.4500" );
+  check_parse( ".5" );
+  check_parse( "5." );
+  check_parse( "1e10" );
+  check_parse( "1E+10" );
+  check_parse( "1e-10" );
+  check_parse( "123456789012345678901234567890" );
+  check_parse( "0.000000000000000000000000000001" );
+  check_parse( "2.2250738585072011e-308" );
+  check_parse( "4.9e-324" );
+  check_parse( "1e-400" );
+  check_parse( "1e400" );
+  check_parse( "-1e400" );
+  /* halfway between two doubles, needs more than 19 digits */
+  check_parse( "9007199254740993.00000000000000000001" );
+  check_parse( "9007199254740993" );
+  check_parse( "0.1000000000000000055511151231257827021181583404541015625" );
+
+  /* malformed text does not modify the number */
+  CHECK( !mbus_double_parse( "", 0, &value ) );
+  CHECK( !mbus_double_parse( "-", 1, &value ) );
+  CHECK( !mbus_double_parse( ".", 1, &value ) );
+  CHECK( !mbus_double_parse( "e5", 2, &value ) );
+  CHECK( !mbus_double_parse( "1e", 2, &value ) );
+  CHECK( !mbus_double_parse( "1e+", 3, &value ) );
+  CHECK( !mbus_double_parse( "1.2.3", 5, &value ) );
+  CHECK( !mbus_double_parse( "1.5x", 4, &value ) );
+  CHECK( !mbus_double_parse( "+1.5", 4, &value ) );
+  CHECK( !mbus_double_parse( " 1.5", 4, &value ) );
+  CHECK( value == 42.0 );
+
+  /* only the given length is parsed */
+  CHECK( mbus_double_parse( "1.25e3", 4, &value ) );
+  CHECK( value == 1.25 );
+
+  /* floating point numbers within lists */
+  mbus_cursor_init( &cursor, "(1.5 -2.5e-3 7)", 15 );
+  CHECK( mbus_list_parse( list, &cursor, NULL ) );
+  CHECK( mbus_list_length( list ) == 3 );
+  CHECK( M_OBJECT_IS( mbus_list_index( list, 0 ), MFLOAT ) );
+  CHECK( M_FLOAT( mbus_list_index( list, 0 ) )->number == 1.5 );
+  CHECK( M_FLOAT( mbus_list_index( list, 1 ) )->number == -2.5e-3 );
+  CHECK( M_OBJECT_IS( mbus_list_index( list, 2 ), MINTEGER ) );
+  mbus_list_free( list );
+}
+
+int
+main( int argc, char * argv[] )
+{
+  format_test();
+  parse_test();
+
+  return CHECK_RESULT();
+}
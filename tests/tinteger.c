@@ -0,0 +1,186 @@
+/* tinteger.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Checks the integer codec: numbers written by the writer are read back
+   unchanged and numbers that do not fit into 64 bits are rejected. */
+
+#include "gmbus/mcursor.h"
+#include "gmbus/mwriter.h"
+#include "gmbus/mtypes.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+
+/* writes and reads a signed number */
+static void
+check_int64( gint64 number )
+{
+  gchar		buf[ 32 ];
+  gchar		expected[ 32 ];
+  gsize		len = mbus_writer_int64_len( number );
+  MWriter	writer;
+  MCursor	cursor;
+  gint64	value = 0;
+
+  mbus_writer_init( &writer, buf, len );
+  mbus_writer_put_int64( &writer, number );
+  CHECK( mbus_writer_at_end( &writer ) );
+  buf[ len ] = '\0';
+
+  g_snprintf( expected, sizeof( expected ), "%" G_GINT64_FORMAT, number );
+  CHECK( !strcmp( buf, expected ) );
+
+  mbus_cursor_init( &cursor, buf, len );
+  CHECK( mbus_cursor_read_int64( &cursor, &value ) );
+  CHECK( value == number );
+  CHECK( mbus_cursor_at_end( &cursor ) );
+}
+
+/* writes and reads an unsigned number */
+static void
+check_uint64( guint64 number )
+{
+  gchar		buf[ 32 ];
+  gchar		expected[ 32 ];
+  gsize		len = mbus_writer_uint64_len( number );
+  MWriter	writer;
+  MCursor	cursor;
+  guint64	value = 0;
+
+  mbus_writer_init( &writer, buf, len );
+  mbus_writer_put_uint64( &writer, number );
+  CHECK( mbus_writer_at_end( &writer ) );
+  buf[ len ] = '\0';
+
+  g_snprintf( expected, sizeof( expected ), "%" G_GUINT64_FORMAT, number );
+  CHECK( !strcmp( buf, expected ) );
+
+  mbus_cursor_init( &cursor, buf, len );
+  CHECK( mbus_cursor_read_uint64( &cursor, &value ) );
+  CHECK( value == number );
+}
+
+static void
+round_trip_test( void )
+{
+  guint64	power = 1;
+  guint64	seed = 42;
+  gint		i;
+
+  check_int64( 0 );
+  check_int64( G_MAXINT64 );
+  check_int64( G_MININT64 );
+  check_uint64( G_MAXUINT64 );
+
+  /* around each power of ten */
+  for ( i = 0; i < 19; i++ ) {
+    check_uint64( power - 1 );
+    check_uint64( power );
+    check_int64( ( gint64 ) power );
+    check_int64( -( gint64 ) power );
+    check_int64( -( gint64 ) power + 1 );
+    power *= 10;
+  }
+
+  for ( i = 0; i < 10000; i++ ) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    check_uint64( seed >> ( i % 64 ) );
+    check_int64( ( gint64 ) seed >> ( i % 64 ) );
+  }
+}
+
+/* reads a number from text and returns the number of characters read or
+   -1 if it failed */
+static gint
+read_int64( const gchar * text, gsize len, gint64 * value )
+{
+  MCursor cursor;
+
+  mbus_cursor_init( &cursor, text, len );
+  if ( !mbus_cursor_read_int64( &cursor, value ) ) {
+    /* the cursor is not moved on failure */
+    CHECK( cursor.pos == text );
+    return -1;
+  }
+
+  return cursor.pos - text;
+}
+
+static void
+edge_test( void )
+{
+  MObject *	list = mbus_list_new();
+  MCursor	cursor;
+  guint64	uvalue;
+  gint64	value;
+
+  /* overflow */
+  mbus_cursor_init( &cursor, "18446744073709551615", 20 );
+  CHECK( mbus_cursor_read_uint64( &cursor, &uvalue ) );
+  CHECK( uvalue == G_MAXUINT64 );
+  mbus_cursor_init( &cursor, "18446744073709551616", 20 );
+  CHECK( !mbus_cursor_read_uint64( &cursor, &uvalue ) );
+  mbus_cursor_init( &cursor, "100000000000000000000", 21 );
+  CHECK( !mbus_cursor_read_uint64( &cursor, &uvalue ) );
+  CHECK( read_int64( "9223372036854775808", 19, &value ) == -1 );
+  CHECK( read_int64( "-9223372036854775809", 20, &value ) == -1 );
+  CHECK( read_int64( "-9223372036854775808", 20, &value ) == 20 );
+  CHECK( value == G_MININT64 );
+
+  /* no digits */
+  CHECK( read_int64( "", 0, &value ) == -1 );
+  CHECK( read_int64( "-", 1, &value ) == -1 );
+  CHECK( read_int64( "-x", 2, &value ) == -1 );
+  CHECK( read_int64( "abc", 3, &value ) == -1 );
+
+  /* the number ends at the first other character or the end of the
+     buffer, even within a block of eight digits */
+  CHECK( read_int64( "123 rest", 8, &value ) == 3 && value == 123 );
+  CHECK( read_int64( "1234567890123", 5, &value ) == 5 && value == 12345 );
+  CHECK( read_int64( "12345678)", 9, &value ) == 8 && value == 12345678 );
+  CHECK( read_int64( "-0", 2, &value ) == 2 && value == 0 );
+  CHECK( read_int64( "007", 3, &value ) == 3 && value == 7 );
+
+  /* integers within lists */
+  mbus_cursor_init( &cursor, "(0 -1 9223372036854775807)", 26 );
+  CHECK( mbus_list_parse( list, &cursor, NULL ) );
+  CHECK( mbus_list_length( list ) == 3 );
+  CHECK( M_INTEGER( mbus_list_index( list, 2 ) )->number == G_MAXINT64 );
+  mbus_list_free( list );
+
+  list = mbus_list_new();
+  mbus_cursor_init( &cursor, "(1 99999999999999999999)", 24 );
+  CHECK( !mbus_list_parse( list, &cursor, NULL ) );
+  mbus_list_free( list );
+}
+
+int
+main( int argc, char * argv[] )
+{
+  round_trip_test();
+  edge_test();
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,255 @@
+/* tlink.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Checks the delivery of the datagrams received by a link when a callback
+   runs a nested iteration of the main loop and when the receive budget is
+   smaller than the number of waiting datagrams. Also checks the messages
+   sent from a template. */
+
+#include "gmbus/mlink.h"
+#include "gmbus/init.h"
+
+#include <string.h>
+
+#include "check.h"
+
+#define COUNT 8
+#define BURST 32
+#define BUDGET 4
+
+static MLink *		mlink;
+static GArray *		received;
+static gint		depth;
+
+static MConfig *
+create_config( gint port )
+{
+  MConfig * config = mbus_config_new( FALSE );
+
+  g_byte_array_append( config->hash_key, ( guchar * ) "linkkey", 7 );
+  mbus_endpoint_set_address_from_string( config->group_addr,
+      "224.255.222.239" );
+  mbus_endpoint_set_port( config->group_addr, htons( port ) );
+
+  return config;
+}
+
+static void
+when_error( const MError * error, gpointer data )
+{
+}
+
+/* the first message runs a nested iteration, which dispatches the
+   datagrams waiting on the other socket */
+static void
+when_nested( const MLinkMessage * msg, gpointer data )
+{
+  g_array_append_val( received, msg->message->header->sequence_no );
+
+  if ( !depth++ ) mbus_loop_step( FALSE );
+  depth--;
+}
+
+/* records the messages without interfering with the loop */
+static void
+when_message( const MLinkMessage * msg, gpointer data )
+{
+  g_array_append_val( received, msg->message->header->sequence_no );
+}
+
+/* sends count messages starting with the given sequence number */
+static void
+send_messages( guint64 first, guint64 count, const MEndpoint * ep )
+{
+  MMessage *	msg = mbus_message_new();
+  guint64	i;
+
+  for ( i = first; i < first + count; i++ ) {
+    msg->header->sequence_no = i;
+    if ( ep )
+      mbus_link_send_unicast( mlink, msg, ep );
+    else
+      mbus_link_send( mlink, msg );
+  }
+  mbus_link_flush( mlink );
+
+  mbus_message_free( msg );
+}
+
+static gboolean
+quit( gpointer data )
+{
+  mbus_quit();
+
+  return FALSE;
+}
+
+/* every message is delivered exactly once and in the order it was sent
+   on its socket */
+static void
+check_received( guint count )
+{
+  guint64	next[ 2 ] = { 1, 101 };
+  guint		i;
+
+  CHECK( received->len == count );
+  for ( i = 0; i < received->len; i++ ) {
+    guint64 seq = g_array_index( received, guint64, i );
+    gint    k = seq > 100;
+
+    CHECK( seq == next[ k ] );
+    next[ k ] = seq + 1;
+  }
+}
+
+static void
+nested_test( const MEventEngine * engine, gint port )
+{
+  MLinkCallback cb;
+
+  mbus_event_set_engine( engine );
+  mbus_init( NULL );
+
+  mlink = mbus_link_new( create_config( port ) );
+  CHECK( mbus_link_ok( mlink ) );
+  received = g_array_new( FALSE, FALSE, sizeof( guint64 ) );
+  depth = 0;
+
+  memset( &cb, 0, sizeof( cb ) );
+  cb.when_error = when_error;
+  cb.when_message = when_nested;
+  mbus_link_attach( mlink, cb );
+
+  /* both sockets are readable when the loop starts */
+  send_messages( 1, COUNT, NULL );
+  send_messages( 101, COUNT, &mlink->ep_unicast );
+
+  mbus_event_add_timeout( 200, quit, NULL );
+  mbus_loop();
+
+  check_received( 2 * COUNT );
+
+  mbus_link_free( mlink );
+  g_array_free( received, TRUE );
+}
+
+/* a burst of multicast messages needs several socket events. The
+   datagrams left behind are read by the pending dispatch, while the
+   unicast socket gets its turn in between. */
+static void
+budget_test( const MEventEngine * engine, gint port )
+{
+  MConfig *	config;
+  MLinkCallback cb;
+  guint		i, last_unicast = 0, half_burst = 0;
+
+  mbus_event_set_engine( engine );
+  mbus_init( NULL );
+
+  config = create_config( port );
+  config->recv_budget = BUDGET;
+  mlink = mbus_link_new( config );
+  CHECK( mbus_link_ok( mlink ) );
+  received = g_array_new( FALSE, FALSE, sizeof( guint64 ) );
+
+  memset( &cb, 0, sizeof( cb ) );
+  cb.when_error = when_error;
+  cb.when_message = when_message;
+  mbus_link_attach( mlink, cb );
+
+  send_messages( 1, BURST, NULL );
+  send_messages( 101, COUNT, &mlink->ep_unicast );
+
+  mbus_event_add_timeout( 200, quit, NULL );
+  mbus_loop();
+
+  check_received( BURST + COUNT );
+  CHECK( mbus_link_stats( mlink )->recv_budget_exhausted > 0 );
+
+  /* the unicast messages are not queued behind the whole burst */
+  for ( i = 0; i < received->len; i++ ) {
+    guint64 seq = g_array_index( received, guint64, i );
+
+    if ( seq > 100 ) last_unicast = i;
+    else if ( seq == BURST / 2 ) half_burst = i;
+  }
+  CHECK( last_unicast < half_burst );
+
+  mbus_link_free( mlink );
+  g_array_free( received, TRUE );
+}
+
+/* the template leaves the message alone and sends it with the sequence
+   number given to mbus_link_send_template */
+static void
+template_test( gint port )
+{
+  MLinkCallback	cb;
+  MLinkTemplate *	tmpl;
+  MMessage *	msg = mbus_message_new();
+
+  mbus_event_set_engine( mbus_event_glib_engine() );
+  mbus_init( NULL );
+
+  mlink = mbus_link_new( create_config( port ) );
+  CHECK( mbus_link_ok( mlink ) );
+  received = g_array_new( FALSE, FALSE, sizeof( guint64 ) );
+
+  memset( &cb, 0, sizeof( cb ) );
+  cb.when_error = when_error;
+  cb.when_message = when_message;
+  mbus_link_attach( mlink, cb );
+
+  msg->header->sequence_no = 42;
+  tmpl = mbus_link_template_new( mlink, msg );
+  CHECK( tmpl != NULL );
+  CHECK( msg->header->sequence_no == 42 );
+
+  mbus_link_send_template( mlink, tmpl, 7, NULL, 0, NULL );
+  mbus_link_flush( mlink );
+
+  mbus_event_add_timeout( 200, quit, NULL );
+  mbus_loop();
+
+  CHECK( received->len == 1 );
+  CHECK( received->len && g_array_index( received, guint64, 0 ) == 7 );
+
+  mbus_link_template_free( tmpl );
+  mbus_message_free( msg );
+  mbus_link_free( mlink );
+  g_array_free( received, TRUE );
+}
+
+int
+main( int argc, char * argv[] )
+{
+  nested_test( mbus_event_glib_engine(), 47308 );
+  if ( mbus_event_epoll_engine() )
+    nested_test( mbus_event_epoll_engine(), 47309 );
+  budget_test( mbus_event_glib_engine(), 47314 );
+  if ( mbus_event_epoll_engine() )
+    budget_test( mbus_event_epoll_engine(), 47315 );
+  template_test( 47316 );
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,285 @@
+/* tparser.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Checks the parser of the Mbus text format: headers, commands and nested
+   lists, the rejection of malformed text, the lazy payload scan and the
+   scanning implementation selected for the CPU. */
+
+#include "gmbus/mmessage.h"
+#include "gmbus/mscan.h"
+
+#include <string.h>
+
+#include "check.h"
+
+/* parses a header and returns whether it is ok */
+static gboolean
+parse_header( MHeader * header, const gchar * text )
+{
+  MCursor cursor;
+
+  mbus_cursor_init( &cursor, text, strlen( text ) );
+
+  return mbus_header_parse( header, &cursor ) && mbus_header_ok( header );
+}
+
+static void
+header_test( void )
+{
+  MHeader *	header = mbus_header_new();
+  GString *	buf = g_string_new( NULL );
+
+  CHECK( parse_header( header, "mbus/1.0 12 345 R (app:test id:1-2@host) "
+		       "(module:x) (7 8 9 )\n" ) );
+  CHECK( header->sequence_no == 12 );
+  CHECK( header->timestamp == 345 );
+  CHECK( header->type == RELIABLE );
+  CHECK( header->acks->len == 3 );
+  CHECK( g_array_index( header->acks, guint64, 2 ) == 9 );
+  mbus_address_as_string( header->destination, buf );
+  CHECK( !strcmp( buf->str, "(module:x )" ) );
+
+  CHECK( parse_header( header, "  mbus/1.0   1 2 U (app:a) () ()" ) );
+  CHECK( header->type == UNRELIABLE );
+  CHECK( header->acks->len == 0 );
+
+  CHECK( !parse_header( header, "" ) );
+  CHECK( !parse_header( header, "mbus/2.0 1 2 U (app:a) () ()" ) );
+  CHECK( !parse_header( header, "mbus/1.0 x 2 U (app:a) () ()" ) );
+  CHECK( !parse_header( header, "mbus/1.0 -1 2 U (app:a) () ()" ) );
+  CHECK( !parse_header( header, "mbus/1.0 1 2x U (app:a) () ()" ) );
+  CHECK( !parse_header( header, "mbus/1.0 1 2 X (app:a) () ()" ) );
+  CHECK( !parse_header( header, "mbus/1.0 1 2 U app:a () ()" ) );
+  CHECK( !parse_header( header, "mbus/1.0 1 2 U (app:a) ()" ) );
+  CHECK( !parse_header( header, "mbus/1.0 1 2 U (app:a) () (1 x)" ) );
+  CHECK( !parse_header( header, "mbus/1.0 18446744073709551616 2 U (app:a) "
+			"() ()" ) );
+
+  g_string_free( buf, TRUE );
+  mbus_header_free( header );
+}
+
+/* parses a list and checks that skipping it ends at the same position */
+static gboolean
+parse_list( const gchar * text, MObject ** result )
+{
+  MObject *	list = mbus_list_new();
+  MCursor	parsed, skipped;
+  gboolean	ok, skip_ok;
+
+  mbus_cursor_init( &parsed, text, strlen( text ) );
+  skipped = parsed;
+  ok = mbus_list_parse( list, &parsed, NULL );
+  skip_ok = mbus_list_skip( &skipped );
+  CHECK( ok == skip_ok );
+  if ( ok ) CHECK( parsed.pos == skipped.pos );
+
+  if ( ok && result )
+    *result = list;
+  else
+    mbus_list_free( list );
+
+  return ok;
+}
+
+static void
+list_test( void )
+{
+  MObject *	list = NULL;
+  MObject *	obj;
+  GString *	text = g_string_new( NULL );
+  gint		i;
+
+  CHECK( parse_list( "(1 2.5 \"str ing\" Sym <ZGF0YQ==> (Nested (Deep) ()))",
+		     &list ) );
+  CHECK( mbus_list_length( list ) == 6 );
+  CHECK( M_OBJECT_IS( mbus_list_index( list, 0 ), MINTEGER ) );
+  CHECK( M_OBJECT_IS( mbus_list_index( list, 1 ), MFLOAT ) );
+  obj = mbus_list_index( list, 2 );
+  CHECK( M_OBJECT_IS( obj, MSTRING ) && !strcmp( M_STRING( obj )->str,
+						 "str ing" ) );
+  obj = mbus_list_index( list, 3 );
+  CHECK( M_OBJECT_IS( obj, MSYMBOL ) && !strcmp( M_SYMBOL( obj )->str,
+						 "Sym" ) );
+  obj = mbus_list_index( list, 4 );
+  CHECK( M_OBJECT_IS( obj, MDATA ) );
+  CHECK( M_DATA( obj )->array->len == 4 &&
+	 !memcmp( M_DATA( obj )->array->data, "data", 4 ) );
+  obj = mbus_list_index( list, 5 );
+  CHECK( M_OBJECT_IS( obj, MLIST ) && mbus_list_length( obj ) == 3 );
+  obj = mbus_list_index( obj, 1 );
+  CHECK( M_OBJECT_IS( obj, MLIST ) && mbus_list_length( obj ) == 1 );
+  mbus_list_free( list );
+
+  CHECK( parse_list( "  ( )", NULL ) );
+  CHECK( parse_list( "(\t1\t2 )", NULL ) );
+  /* an unterminated list at the end of the buffer is accepted */
+  CHECK( parse_list( "(1 (2", NULL ) );
+
+  CHECK( !parse_list( "", NULL ) );
+  CHECK( !parse_list( "1 2", NULL ) );
+  CHECK( !parse_list( "(\"open)", NULL ) );
+  CHECK( !parse_list( "(<ZGF0YQ==)", NULL ) );
+  CHECK( !parse_list( "(lower)", NULL ) );
+  CHECK( !parse_list( "(1x)", NULL ) );
+  CHECK( !parse_list( "(1.5.5)", NULL ) );
+  CHECK( !parse_list( "(Sym\"bol)", NULL ) );
+  CHECK( !parse_list( "(1 @)", NULL ) );
+  /* a command ends at the end of the line */
+  CHECK( !parse_list( "(1\n2)", NULL ) );
+
+  /* the nesting depth is limited */
+  for ( i = 0; i < M_LIST_MAX_DEPTH; i++ ) g_string_append_c( text, '(' );
+  for ( i = 0; i < M_LIST_MAX_DEPTH; i++ ) g_string_append_c( text, ')' );
+  CHECK( parse_list( text->str, NULL ) );
+  g_string_prepend_len( text, "(", 1 );
+  g_string_append_c( text, ')' );
+  CHECK( !parse_list( text->str, NULL ) );
+
+  g_string_free( text, TRUE );
+}
+
+static void
+command_test( void )
+{
+  MCommand *	cmd = mbus_command_new( NULL );
+  MCursor	cursor;
+  const gchar *	text = "test.cmd (1 \"a\") next()";
+
+  mbus_cursor_init( &cursor, text, strlen( text ) );
+  CHECK( mbus_command_parse( cmd, &cursor, NULL ) );
+  CHECK( !strcmp( cmd->cmd, "test.cmd" ) );
+  CHECK( mbus_list_length( cmd->arguments ) == 2 );
+  CHECK( cursor.pos == text + 16 );
+
+  /* skipping a command ends at the same position as parsing it */
+  mbus_cursor_init( &cursor, text, strlen( text ) );
+  CHECK( mbus_command_skip( &cursor ) == 8 );
+  CHECK( cursor.pos == text + 16 );
+
+  mbus_command_free( cmd );
+}
+
+/* a scanned payload yields the same commands as a parsed one */
+static void
+scan_test( void )
+{
+  GString *	text = g_string_new( "mbus/1.0 1 100 U (app:a) () ()\n" );
+  GString *	parsed_text = g_string_new( NULL );
+  GString *	scanned_text = g_string_new( NULL );
+  MMessage *	parsed = mbus_message_new();
+  MMessage *	scanned = mbus_message_new();
+  guint		i;
+
+  g_string_append( text, "empty()\n" );
+  g_string_append( text, "args(1 -2 3.5 \"s \\\"q\\\"\" Sym <YWJj>)\n" );
+  g_string_append( text, "nested((1 (2 (3))) ())\n" );
+  g_string_append( text, "mbus.hello()\n" );
+
+  CHECK( mbus_message_parse( parsed, text->str, text->len ) );
+  CHECK( mbus_message_scan( scanned, text->str, text->len ) );
+  CHECK( parsed->payload->cmds->len == 4 );
+  CHECK( scanned->payload->cmds->len == 4 );
+
+  for ( i = 0; i < parsed->payload->cmds->len; i++ ) {
+    MCommand * a = mbus_payload_index( parsed->payload, i );
+    MCommand * b = mbus_payload_index( scanned->payload, i );
+
+    CHECK( !strcmp( a->cmd, b->cmd ) );
+    CHECK( mbus_payload_get_quark( parsed->payload, i ) ==
+	   mbus_payload_get_quark( scanned->payload, i ) );
+    CHECK( mbus_payload_is_command( scanned->payload, i, a->cmd ) );
+  }
+
+  mbus_payload_as_string( parsed->payload, parsed_text );
+  mbus_payload_as_string( scanned->payload, scanned_text );
+  CHECK( !strcmp( parsed_text->str, scanned_text->str ) );
+
+  /* a malformed header is rejected by both */
+  CHECK( !mbus_message_parse( parsed, "mbus/1.0 x\n", 11 ) );
+  CHECK( !mbus_message_scan( scanned, "mbus/1.0 x\n", 11 ) );
+
+  mbus_message_unref( parsed );
+  mbus_message_unref( scanned );
+  g_string_free( text, TRUE );
+  g_string_free( parsed_text, TRUE );
+  g_string_free( scanned_text, TRUE );
+}
+
+static gboolean
+is_structural( gchar c )
+{
+  return c != '\0' && strchr( " \t\n()\"<>", c ) != NULL;
+}
+
+/* the selected implementation finds the same characters as a plain loop
+   for every alignment and length */
+static void
+structural_test( void )
+{
+  static const gchar	chars[] = "aZ0.-_ \t\n()\"<>\x80\xff";
+  gchar			buf[ 160 ];
+  guint64		seed = 3;
+  gint			round, i, start, len;
+
+  for ( round = 0; round < 2000; round++ ) {
+    /* mostly plain characters to get long runs */
+    for ( i = 0; i < ( gint ) sizeof( buf ); i++ ) {
+      seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+      if ( ( seed >> 33 ) % ( 1 + round % 80 ) )
+	buf[ i ] = 'x';
+      else
+	buf[ i ] = chars[ ( seed >> 20 ) % ( sizeof( chars ) - 1 ) ];
+    }
+    start = round % 40;
+    len = ( round * 7 ) % ( sizeof( buf ) - start );
+
+    for ( i = start; i <= start + len; i++ ) {
+      const gchar * end = buf + start + len;
+      const gchar * expected = buf + i;
+      const gchar * token = buf + i;
+
+      while ( expected < end && !is_structural( *expected ) ) expected++;
+      CHECK( mbus_scan_structural( buf + i, end ) == expected );
+
+      while ( token < end && !strchr( " \t\n)", *token ) ) token++;
+      CHECK( mbus_scan_token_end( buf + i, end ) == token );
+    }
+  }
+
+  CHECK( !strcmp( mbus_scan_impl_name(), "avx2" ) ||
+	 !strcmp( mbus_scan_impl_name(), "sse2" ) ||
+	 !strcmp( mbus_scan_impl_name(), "scalar" ) );
+}
+
+int
+main( int argc, char * argv[] )
+{
+  header_test();
+  list_test();
+  command_test();
+  scan_test();
+  structural_test();
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,99 @@
+/* tpayload.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Reads the commands of a scanned message from several threads at the same
+   time. Each command has to be parsed exactly once. */
+
+#include "gmbus/mmessage.h"
+
+#include <string.h>
+
+#include "check.h"
+
+#define COMMANDS 500
+#define THREADS 4
+
+typedef struct {
+  MMessage *	msg;
+  guint		first;
+  MCommand *	cmds[ COMMANDS ];
+} Reader;
+
+static gpointer
+read_commands( gpointer data )
+{
+  Reader *	self = data;
+  guint		i;
+
+  /* each thread starts at another command */
+  for ( i = 0; i < COMMANDS; i++ ) {
+    guint idx = ( self->first + i ) % COMMANDS;
+
+    mbus_payload_get_quark( self->msg->payload, idx );
+    self->cmds[ idx ] = mbus_payload_index( self->msg->payload, idx );
+  }
+  mbus_message_unref( self->msg );
+
+  return NULL;
+}
+
+int
+main( int argc, char * argv[] )
+{
+  GString *	text = g_string_new( "mbus/1.0 1 100 U (app:a) () ()\n" );
+  MMessage *	msg = mbus_message_new();
+  Reader	readers[ THREADS ];
+  GThread *	threads[ THREADS ];
+  guint		i, t;
+
+  for ( i = 0; i < COMMANDS; i++ )
+    g_string_append_printf( text, "test.cmd%u(%u \"arg %u\")\n", i, i, i );
+
+  CHECK( mbus_message_scan( msg, text->str, text->len ) );
+  CHECK( msg->payload->cmds->len == COMMANDS );
+
+  for ( t = 0; t < THREADS; t++ ) {
+    readers[ t ].msg = mbus_message_ref( msg );
+    readers[ t ].first = t * COMMANDS / THREADS;
+    threads[ t ] = g_thread_new( "reader", read_commands, &readers[ t ] );
+  }
+  for ( t = 0; t < THREADS; t++ ) g_thread_join( threads[ t ] );
+
+  for ( i = 0; i < COMMANDS; i++ ) {
+    MCommand *	cmd = readers[ 0 ].cmds[ i ];
+    gchar *	name = g_strdup_printf( "test.cmd%u", i );
+    MObject *	arg;
+
+    for ( t = 1; t < THREADS; t++ )
+      CHECK( readers[ t ].cmds[ i ] == cmd );
+    CHECK( mbus_command_is_command( cmd, name ) );
+    arg = mbus_list_index( cmd->arguments, 0 );
+    CHECK( arg && arg->type == MINTEGER && ( ( MInteger * ) arg )->number == i );
+    g_free( name );
+  }
+
+  mbus_message_unref( msg );
+  g_string_free( text, TRUE );
+
+  return CHECK_RESULT();
+}
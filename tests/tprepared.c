@@ -0,0 +1,110 @@
+/* tprepared.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Sends prepared messages with arguments that have to be escaped and
+   checks that they are received unchanged. */
+
+#include "gmbus/mprepared.h"
+#include "gmbus/init.h"
+
+#include <string.h>
+
+#include "check.h"
+
+#define TEXT "say \"hi\"\\\n(again)"
+
+static MClient *	sender;
+static MClient *	receiver;
+static MPreparedMessage *	prepared;
+static gint		received = 0;
+
+static MConfig *
+create_config( void )
+{
+  MConfig * config = mbus_config_new( FALSE );
+
+  g_byte_array_append( config->hash_key, ( guchar * ) "preparedkey", 11 );
+  mbus_endpoint_set_address_from_string( config->group_addr,
+      "224.255.222.239" );
+  mbus_endpoint_set_port( config->group_addr, htons( 47302 ) );
+
+  return config;
+}
+
+static void
+when_prepared( const MMessage * msg, gpointer data )
+{
+  MCommand *	cmd = mbus_payload_index( msg->payload, 0 );
+  MObject *	str = mbus_list_index( cmd->arguments, 1 );
+  MObject *	sym = mbus_list_index( cmd->arguments, 2 );
+
+  CHECK( mbus_list_length( cmd->arguments ) == 3 );
+  CHECK( M_INTEGER( mbus_list_index( cmd->arguments, 0 ) )->number == 42 );
+  CHECK( str && str->type == MSTRING && !strcmp( M_STRING( str )->str, TEXT ) );
+  CHECK( sym && sym->type == MSYMBOL && !strcmp( M_SYMBOL( sym )->str, "Ok" ) );
+  received++;
+}
+
+static gboolean
+send_prepared( gpointer data )
+{
+  CHECK( mbus_prepared_send( prepared, ( gint64 ) 42, TEXT, "Ok" ) );
+  /* the invalid symbol is not sent */
+  CHECK( !mbus_prepared_send( prepared, ( gint64 ) 1, "x", "no symbol" ) );
+
+  return FALSE;
+}
+
+static gboolean
+quit( gpointer data )
+{
+  mbus_quit();
+
+  return FALSE;
+}
+
+int
+main( int argc, char * argv[] )
+{
+  mbus_init( NULL );
+
+  sender = mbus_client_new( "(app:sender id:1)", create_config() );
+  receiver = mbus_client_new( "(app:receiver id:2)", create_config() );
+  CHECK( mbus_client_ok( sender ) && mbus_client_ok( receiver ) );
+
+  mbus_client_register( receiver, "test.prepared", when_prepared, NULL );
+  prepared = mbus_prepared_new( sender, NULL, "test.prepared", "isy" );
+  CHECK( mbus_prepared_ok( prepared ) );
+
+  mbus_event_add_timeout( 100, send_prepared, NULL );
+  mbus_event_add_timeout( 600, quit, NULL );
+  mbus_loop();
+
+  CHECK( received == 1 );
+
+  mbus_prepared_free( prepared );
+  mbus_client_free( receiver );
+  mbus_client_free( sender );
+
+  return CHECK_RESULT();
+}
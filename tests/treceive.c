@@ -0,0 +1,162 @@
+/* treceive.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Receives bursts of messages with a receive thread and checks that they
+   are delivered in order, also when the main loop does not keep up and
+   the receive ring drops messages. */
+
+#include "gmbus/mprepared.h"
+#include "gmbus/init.h"
+
+#include <string.h>
+
+#include "check.h"
+
+#define BURST 1000
+#define LONG_BURST ( 3 * MBUS_LINK_RING_SIZE )
+
+static MPreparedMessage *	prepared;
+static gint		burst;
+static gboolean		block;
+static gint		received;
+static gint64		last_number;
+
+static MConfig *
+create_config( gint port, guint workers )
+{
+  MConfig * config = mbus_config_new( FALSE );
+
+  g_byte_array_append( config->hash_key, ( guchar * ) "receivekey", 10 );
+  mbus_endpoint_set_address_from_string( config->group_addr,
+      "224.255.222.239" );
+  mbus_endpoint_set_port( config->group_addr, htons( port ) );
+  config->rcvbuf_size = 1 << 20;
+  config->recv_thread = TRUE;
+  config->recv_workers = workers;
+
+  return config;
+}
+
+static void
+when_burst( const MMessage * msg, gpointer data )
+{
+  MCommand *	cmd = mbus_payload_index( msg->payload, 0 );
+  gint64	number = M_INTEGER( mbus_list_index( cmd->arguments, 0 ) )->number;
+
+  /* messages may be dropped but never reordered */
+  CHECK( number > last_number );
+  last_number = number;
+  received++;
+}
+
+static gboolean
+send_burst( gpointer data )
+{
+  gint i;
+
+  for ( i = 0; i < burst; i++ )
+    CHECK( mbus_prepared_send( prepared, ( gint64 ) i ) );
+  mbus_link_flush( ( ( MClient * ) data )->trans->link );
+
+  /* the receive thread fills the ring while the main loop is blocked */
+  if ( block ) g_usleep( 300000 );
+
+  return FALSE;
+}
+
+static gboolean
+quit( gpointer data )
+{
+  mbus_quit();
+
+  return FALSE;
+}
+
+/* sends a burst from one client to another and returns the statistics of
+   the receiving link */
+static MLinkStats
+run( gint port, guint workers, gint count, gboolean blocking )
+{
+  MClient *	sender;
+  MClient *	receiver;
+  MLinkStats	stats;
+
+  /* mbus_quit frees the main loop */
+  mbus_init( NULL );
+
+  sender = mbus_client_new( "(app:sender id:1)",
+			    create_config( port, workers ) );
+  receiver = mbus_client_new( "(app:receiver id:2)",
+			      create_config( port, workers ) );
+  CHECK( mbus_client_ok( sender ) && mbus_client_ok( receiver ) );
+
+  burst = count;
+  block = blocking;
+  received = 0;
+  last_number = -1;
+
+  mbus_client_register( receiver, "test.burst", when_burst, NULL );
+  prepared = mbus_prepared_new( sender, NULL, "test.burst", "i" );
+  CHECK( mbus_prepared_ok( prepared ) );
+
+  mbus_event_add_timeout( 100, send_burst, sender );
+  mbus_event_add_timeout( 1500, quit, NULL );
+  mbus_loop();
+
+  stats = *mbus_link_stats( receiver->trans->link );
+
+  mbus_prepared_free( prepared );
+  mbus_client_free( receiver );
+  mbus_client_free( sender );
+
+  return stats;
+}
+
+int
+main( int argc, char * argv[] )
+{
+  MLinkStats stats;
+
+  /* the receive thread parses the messages */
+  stats = run( 47304, 0, BURST, FALSE );
+  CHECK( received == BURST );
+  CHECK( stats.recv_datagrams >= BURST );
+  CHECK( stats.recv_ring_drops == 0 );
+
+  /* worker threads parse the messages */
+  stats = run( 47305, 4, BURST, FALSE );
+  CHECK( received == BURST );
+  CHECK( stats.recv_ring_drops == 0 );
+
+  /* more messages than the ring holds while the main loop is blocked */
+  stats = run( 47306, 0, LONG_BURST, TRUE );
+  CHECK( stats.recv_ring_drops > 0 );
+  CHECK( received > 0 && received < LONG_BURST );
+  CHECK( received + stats.recv_ring_drops <= stats.recv_datagrams );
+
+  stats = run( 47307, 4, LONG_BURST, TRUE );
+  CHECK( stats.recv_ring_drops > 0 );
+  CHECK( received > 0 && received < LONG_BURST );
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,173 @@
+/* tresend.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Sends received messages again with another source address. The
+   addresses of received messages are interned and must be replaced
+   instead of modified. */
+
+#include "gmbus/mclient.h"
+#include "gmbus/init.h"
+
+#include <string.h>
+
+#include "check.h"
+
+static MConfig *
+create_config( void )
+{
+  MConfig * config = mbus_config_new( FALSE );
+
+  g_byte_array_append( config->hash_key, ( guchar * ) "resendkey", 9 );
+  mbus_endpoint_set_address_from_string( config->group_addr,
+      "224.255.222.239" );
+  mbus_endpoint_set_port( config->group_addr, htons( 47301 ) );
+
+  return config;
+}
+
+static void
+header_test( void )
+{
+  const gchar *	text = "mbus/1.0 7 100 U (app:a id:1@x) (app:b) ()\n"
+    "mbus.test(1)";
+  MMessage *	received = mbus_message_new();
+  MMessage *	copy = mbus_message_new();
+  GString *	buf = g_string_new( NULL );
+  GString *	tmp = g_string_new( "(app:c id:3@y)" );
+  MAddress *	source = mbus_address_new();
+  MAddress *	dest = mbus_address_new();
+
+  CHECK( mbus_message_parse( received, text, strlen( text ) ) );
+  CHECK( mbus_address_is_interned( received->header->source ) );
+
+  mbus_address_read( source, tmp );
+  g_string_assign( tmp, "(app:d)" );
+  mbus_address_read( dest, tmp );
+
+  mbus_message_assign( copy, received );
+  mbus_header_set_source( copy->header, source );
+  mbus_header_set_destination( copy->header, dest );
+  CHECK( !mbus_address_is_interned( copy->header->source ) );
+  CHECK( mbus_address_is_equal( copy->header->source, source ) );
+
+  mbus_message_as_string( copy, buf );
+  CHECK( strstr( buf->str, "app:c" ) != NULL );
+  CHECK( strstr( buf->str, "app:d" ) != NULL );
+  CHECK( strstr( buf->str, "app:a" ) == NULL );
+
+  /* the received message is not changed */
+  g_string_truncate( buf, 0 );
+  mbus_message_as_string( received, buf );
+  CHECK( strstr( buf->str, "app:a" ) != NULL );
+  CHECK( strstr( buf->str, "app:c" ) == NULL );
+  /* the text is stamped with the current time, the message keeps its own */
+  CHECK( received->header->timestamp == 100 );
+  CHECK( copy->header->timestamp == 100 );
+
+  mbus_address_free( source );
+  mbus_address_free( dest );
+  g_string_free( tmp, TRUE );
+  g_string_free( buf, TRUE );
+  mbus_message_free( copy );
+  mbus_message_free( received );
+}
+
+static MClient *	sender;
+static MClient *	forwarder;
+static gint		forwarded = 0;
+static gint		returned = 0;
+
+/* the forwarder sends each message it receives from the sender again */
+static void
+when_forward( const MMessage * msg, gpointer data )
+{
+  MMessage * copy;
+
+  if ( !mbus_address_is_equal( msg->header->source, sender->trans->address ) )
+    return;
+
+  copy = mbus_message_new();
+  mbus_message_assign( copy, ( MMessage * ) msg );
+  mbus_client_send( forwarder, copy );
+  forwarded++;
+}
+
+/* the sender gets the forwarded messages with the forwarder as source */
+static void
+when_returned( const MMessage * msg, gpointer data )
+{
+  CHECK( mbus_address_is_equal( msg->header->source,
+	forwarder->trans->address ) );
+  returned++;
+}
+
+static gboolean
+send_ping( gpointer data )
+{
+  MMessage * msg = mbus_message_new();
+
+  mbus_message_add_command( msg, "test.ping(1)" );
+  mbus_client_send( sender, msg );
+
+  return FALSE;
+}
+
+static gboolean
+quit( gpointer data )
+{
+  mbus_quit();
+
+  return FALSE;
+}
+
+static void
+client_test( void )
+{
+  mbus_init( NULL );
+
+  sender = mbus_client_new( "(app:sender id:1)", create_config() );
+  forwarder = mbus_client_new( "(app:forwarder id:2)", create_config() );
+  CHECK( mbus_client_ok( sender ) && mbus_client_ok( forwarder ) );
+
+  mbus_client_register( forwarder, "test.ping", when_forward, NULL );
+  mbus_client_register( sender, "test.ping", when_returned, NULL );
+
+  mbus_event_add_timeout( 100, send_ping, NULL );
+  mbus_event_add_timeout( 600, quit, NULL );
+  mbus_loop();
+
+  CHECK( forwarded == 1 );
+  CHECK( returned == 1 );
+
+  mbus_client_free( forwarder );
+  mbus_client_free( sender );
+}
+
+int
+main( int argc, char * argv[] )
+{
+  header_test();
+  client_test();
+
+  return CHECK_RESULT();
+}
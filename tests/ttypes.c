@@ -0,0 +1,190 @@
+/* ttypes.c
+ * -*- coding: utf-8 -*-
+ *
+ * Author: Andreas Büsching  <crunchy@bitkipper.net>
+ *
+ * Copyright (C) 2004, 2005, 2006, 2007
+ *		Andreas Büsching <crunchy@bitkipper.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Checks that copies of Mbus objects are independent of the original
+   objects while sharing long strings and data until they are modified. */
+
+#include "gmbus/mtypes.h"
+
+#include <string.h>
+
+#include "check.h"
+
+#define LONG_TEXT "a string that does not fit into the object itself"
+
+#define COPIES 1000
+#define THREADS 4
+
+static void
+list_test( void )
+{
+  MObject *	list = mbus_list_new();
+  MObject *	nested = mbus_list_new();
+  MObject *	copy;
+  MObject *	first;
+  MObject *	elem;
+
+  mbus_list_append( nested, mbus_integer_new( 2 ) );
+  mbus_list_append( list, mbus_integer_new( 1 ) );
+  mbus_list_append( list, mbus_string_new( LONG_TEXT ) );
+  mbus_list_append( list, nested );
+
+  first = mbus_list_index( list, 0 );
+  copy = mbus_list_copy( list );
+
+  /* reading the original does not change it */
+  CHECK( mbus_list_index( list, 0 ) == first );
+  CHECK( mbus_list_index( list, 2 ) == nested );
+
+  /* the elements are not aliased */
+  elem = mbus_list_index( copy, 0 );
+  CHECK( elem != first );
+  mbus_integer_set( elem, 5 );
+  CHECK( M_INTEGER( first )->number == 1 );
+
+  elem = mbus_list_index( copy, 2 );
+  CHECK( elem != nested );
+  mbus_list_append( elem, mbus_integer_new( 3 ) );
+  CHECK( mbus_list_length( nested ) == 1 );
+  CHECK( mbus_list_length( elem ) == 2 );
+
+  /* long strings are shared until they are modified */
+  elem = mbus_list_index( copy, 1 );
+  CHECK( M_STRING( elem )->str ==
+	 M_STRING( mbus_list_index( list, 1 ) )->str );
+  mbus_string_set( elem, "changed" );
+  CHECK( !strcmp( M_STRING( mbus_list_index( list, 1 ) )->str, LONG_TEXT ) );
+  CHECK( !strcmp( M_STRING( elem )->str, "changed" ) );
+
+  /* modifying the original does not change the copy */
+  mbus_list_remove( list, 0, TRUE );
+  CHECK( mbus_list_length( copy ) == 3 );
+  CHECK( M_INTEGER( mbus_list_index( copy, 0 ) )->number == 5 );
+
+  mbus_list_free( copy );
+  mbus_list_free( list );
+}
+
+static void
+data_test( void )
+{
+  MObject *	data = mbus_data_new( ( guint8 * ) "0123456789", 10, FALSE );
+  MObject *	copy = mbus_data_copy( data );
+
+  CHECK( M_DATA( copy )->array == M_DATA( data )->array );
+  mbus_data_set( copy, ( guint8 * ) "abc", 3 );
+  CHECK( M_DATA( copy )->array != M_DATA( data )->array );
+  CHECK( M_DATA( data )->array->len == 10 );
+  CHECK( !memcmp( M_DATA( data )->array->data, "0123456789", 10 ) );
+  CHECK( M_DATA( copy )->array->len == 3 );
+
+  mbus_data_free( data );
+  CHECK( !memcmp( M_DATA( copy )->array->data, "abc", 3 ) );
+  mbus_data_free( copy );
+}
+
+/* strings are escaped when written and unescaped when parsed */
+static void
+escape_test( void )
+{
+  const gchar *	text = "say \"hi\"\\\n";
+  MObject *	list = mbus_list_new();
+  MObject *	parsed = mbus_list_new();
+  GString *	buf = g_string_new( NULL );
+  MCursor	cursor;
+
+  mbus_list_append( list, mbus_string_new( text ) );
+  mbus_list_append( list, mbus_string_new( "plain" ) );
+  mbus_list_as_string( list, buf );
+  CHECK( !strcmp( buf->str, "(\"say \\\"hi\\\"\\\\\\n\" \"plain\" )" ) );
+  CHECK( !strchr( buf->str, '\n' ) );
+
+  mbus_cursor_init( &cursor, buf->str, buf->len );
+  CHECK( mbus_list_parse( parsed, &cursor, NULL ) );
+  CHECK( mbus_list_length( parsed ) == 2 );
+  CHECK( !strcmp( M_STRING( mbus_list_index( parsed, 0 ) )->str, text ) );
+  CHECK( !strcmp( M_STRING( mbus_list_index( parsed, 1 ) )->str, "plain" ) );
+
+  /* an escaped quote does not end the string */
+  mbus_cursor_init( &cursor, "(\"open\\\")", 9 );
+  CHECK( !mbus_list_skip( &cursor ) );
+
+  CHECK( mbus_symbol_is_valid_text( "Symbol_1.a-b", 12 ) );
+  CHECK( !mbus_symbol_is_valid_text( "two words", 9 ) );
+
+  g_string_free( buf, TRUE );
+  mbus_list_free( parsed );
+  mbus_list_free( list );
+}
+
+/* several threads copy the same string, which has not been shared before */
+static MObject *	shared;
+
+static gpointer
+copy_shared( gpointer data )
+{
+  MObject **	copies = data;
+  guint		i;
+
+  for ( i = 0; i < COPIES; i++ ) copies[ i ] = mbus_string_copy( shared );
+
+  return NULL;
+}
+
+static void
+thread_test( void )
+{
+  GThread *	threads[ THREADS ];
+  MObject **	copies[ THREADS ];
+  guint		t, i;
+
+  shared = mbus_string_new( LONG_TEXT );
+  for ( t = 0; t < THREADS; t++ ) {
+    copies[ t ] = g_new( MObject *, COPIES );
+    threads[ t ] = g_thread_new( "copy", copy_shared, copies[ t ] );
+  }
+  for ( t = 0; t < THREADS; t++ ) g_thread_join( threads[ t ] );
+
+  CHECK( *M_STRING( shared )->refs == THREADS * COPIES + 1 );
+  for ( t = 0; t < THREADS; t++ ) {
+    for ( i = 0; i < COPIES; i++ ) {
+      CHECK( M_STRING( copies[ t ][ i ] )->refs == M_STRING( shared )->refs );
+      mbus_string_free( copies[ t ][ i ] );
+    }
+    g_free( copies[ t ] );
+  }
+  CHECK( *M_STRING( shared )->refs == 1 );
+
+  mbus_string_free( shared );
+}
+
+int
+main( int argc, char * argv[] )
+{
+  list_test();
+  data_test();
+  escape_test();
+  thread_test();
+
+  return CHECK_RESULT();
+}